@@ -0,0 +1,50 @@
+# Headless core: auth, database, Firestore, storage and transport without any QML or GUI dependency
+QT += network
+
+# Awaitable C++ API (FirebaseTask), enabled when building with C++20 coroutines, e.g CONFIG += c++2a
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+	$$PWD/firebase/firebaseapp.cpp \
+	$$PWD/firebase/firebaseauth.cpp \
+	$$PWD/firebase/firebasedatabase.cpp \
+	$$PWD/firebase/firebaseuser.cpp \
+	$$PWD/firebase/firebasetokenverifier.cpp \
+	$$PWD/firebase/firebaseerror.cpp \
+	$$PWD/firebase/firebasetransport.cpp \
+	$$PWD/firebase/firebasesessionpool.cpp \
+	$$PWD/firebase/firebasestorage.cpp \
+	$$PWD/firebase/firebasestoragecache.cpp \
+	$$PWD/firebase/firebasefirestore.cpp \
+	$$PWD/firebase/firebasememorybudget.cpp \
+	$$PWD/firebase/firebasedatasnapshot.cpp \
+	$$PWD/firebase/firebasedatacache.cpp \
+	$$PWD/firebase/firebasememorybackend.cpp \
+	$$PWD/firebase/firebasevalue.cpp \
+	$$PWD/firebase/firebasetrace.cpp
+
+HEADERS += \
+    $$PWD/utils/AuthUtils.h \
+    $$PWD/utils/JwtUtils.h \
+    $$PWD/utils/FirestoreUtils.h \
+    $$PWD/utils/DatabaseUtils.h \
+    $$PWD/utils/JsonUtils.h \
+    $$PWD/firebase/firebaseapp.h \
+    $$PWD/firebase/firebaseauth.h \
+    $$PWD/firebase/firebasedatabase.h \
+    $$PWD/firebase/firebaseuser.h \
+    $$PWD/firebase/firebasetokenverifier.h \
+    $$PWD/firebase/firebaseerror.h \
+    $$PWD/firebase/firebasetransport.h \
+    $$PWD/firebase/firebasesessionpool.h \
+    $$PWD/firebase/firebasestorage.h \
+    $$PWD/firebase/firebasestoragecache.h \
+    $$PWD/firebase/firebasefirestore.h \
+    $$PWD/firebase/firebasememorybudget.h \
+    $$PWD/firebase/firebasedatasnapshot.h \
+    $$PWD/firebase/firebasedatacache.h \
+    $$PWD/firebase/firebasememorybackend.h \
+    $$PWD/firebase/firebasevalue.h \
+    $$PWD/firebase/firebasetrace.h \
+    $$PWD/firebase/firebasetask.h
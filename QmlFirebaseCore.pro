@@ -0,0 +1,7 @@
+# Builds the headless core as a static library for daemons that do not run a QML engine
+TEMPLATE = lib
+TARGET = QmlFirebaseCore
+CONFIG += staticlib
+QT -= gui
+
+include(QmlFirebaseCore.pri)
@@ -1,174 +1,361 @@
-#include "firebaseapp.h"
-#include <QFile>
-#include <QDebug>
-#include <QJsonArray>
-#include <QJsonObject>
-#include <QNetworkReply>
-#include <QDataStream>
-
-/*!
-    \qmlmodule Firebase 1.0
- */
-
-
-/*!
-    \qmltype FirebaseApp
-    \inqmlmodule Firebase
-    \ingroup Firebase
-    \brief Type that holds all relevant data related to the Firebase project.
-
-    The FirebaseApp type holds crucial data from the Firebase project such as API Key or database URL which
-    will then be passed on to \l FirebaseAuth or \l FirebaseDatabase.
-    The properties of the Firebase App can be set by downloading the \a google-services.json file from Firebase
-    and store it in the resources for automatic parsing. An alternative is manually setting the properties in qml:
-
-    \code
-    FirebaseApp {
-        id: fbApp
-        apiKey: "insert-key"
-        databaseUrl: "insert-url"
-    }
-
-    FirebaseDatabase {
-        apiKey: fbApp.apiKey
-        databaseUrl: fbApp.databaseUrl
-    }
-    \endcode
-
-    \sa FirebaseAuth, FirebaseDatabase, FirebaseUser
-
- */
-FirebaseApp::FirebaseApp(QObject *parent) : QObject(parent)
-{
-    connect(this, &FirebaseApp::sourceChanged, this, &FirebaseApp::parseFirebaseJson);
-}
-
-/*!
-    \qmlproperty string FirebaseApp::apiKey
-
-    This property holds the API Key of the Firebase project, used by the types \l FirebaseDatabase and \l FirebaseAuth.
- */
-QString FirebaseApp::apiKey() const
-{
-    return m_apiKey;
-}
-
-/*!
-    \qmlproperty string FirebaseApp::authDomain
-
-    Domain of the authentication, currently not used.
- */
-QString FirebaseApp::authDomain() const
-{
-    return m_authDomain;
-}
-
-/*!
-    \qmlproperty string FirebaseApp::databaseUrl
-
-    Property that holds the URL where the Firebase Realtime Database resides and should be passed
-    to \l FirebaseDatabase objects.
- */
-QString FirebaseApp::databaseUrl() const
-{
-    return m_databaseUrl;
-}
-
-/*!
-    \qmlproperty string FirebaseApp::storageBucket
-
-    This property holds the URL of the Firebase Storage, currently not implemented.
- */
-QString FirebaseApp::storageBucket() const
-{
-    return m_storageBucket;
-}
-
-void FirebaseApp::setApiKey(const QString &apiKey)
-{
-    if(m_apiKey == apiKey)
-        return;
-    m_apiKey = apiKey;
-    emit apiKeyChanged();
-}
-
-void FirebaseApp::setAuthDomain(const QString &authDomain)
-{
-    if(m_authDomain == authDomain)
-        return;
-
-    m_authDomain = authDomain;
-    emit authDomainChanged();
-}
-
-void FirebaseApp::setDatabaseUrl(const QString &databaseUrl)
-{
-    if(m_databaseUrl == databaseUrl)
-        return;
-
-    m_databaseUrl = databaseUrl;
-    emit databaseUrlChanged();
-}
-
-void FirebaseApp::setStorageBucket(const QString &storageBucket)
-{
-    if(m_storageBucket == storageBucket)
-        return;
-
-    m_storageBucket = storageBucket;
-    emit storageBucketChanged();
-}
-
-/*!
-    \qmlproperty url FirebaseApp::source
-
-    This property holds the URL of the google-services.json that contains all information about a Firebase Project (usually obtained in Firebase Console).
-    If this path is set, the file will be parsed and all the other properties will be automatically set.
- */
-QString FirebaseApp::source() const
-{
-    return m_source;
-}
-
-void FirebaseApp::setSource(const QString &source)
-{
-    if(m_source == source)
-        return;
-
-    m_source = source;
-    emit sourceChanged();
-}
-
-// Private function for parsing google-services.json file to scrape API Key, Database URL, etc
-void FirebaseApp::parseFirebaseJson()
-{
-    QFile file(m_source);
-
-    if(!file.open(QIODevice::ReadOnly|QIODevice::Text))
-        return;
-
-    QByteArray data = file.readAll();
-    file.close();
-
-    QJsonParseError errorPtr;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &errorPtr);
-    if (errorPtr.error == QJsonParseError::NoError) {
-        QJsonObject root = doc.object();
-        QJsonObject projectInfo = root["project_info"].toObject();
-        QJsonArray client = root["client"].toArray();
-
-        setDatabaseUrl(projectInfo["firebase_url"].toString() + "/");
-        setStorageBucket(projectInfo["storage_bucket"].toString());
-        setAuthDomain(projectInfo["project_id"].toString() + ".firebase.com");
-
-
-        if(client.count() > 0) {
-            QJsonArray api_key = client.at(0).toObject()["api_key"].toArray();
-
-            if(api_key.count() > 0) {
-                setApiKey(api_key.at(0).toObject()["current_key"].toString());
-            }
-        }
-    }
-}
-
+#include "firebaseapp.h"
+#include <QFile>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QNetworkReply>
+#include <QDataStream>
+#include "utils/AuthUtils.h"
+#include "utils/FirestoreUtils.h"
+
+/*!
+    \qmlmodule Firebase 1.0
+ */
+
+
+/*!
+    \qmltype FirebaseApp
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Type that holds all relevant data related to the Firebase project.
+
+    The FirebaseApp type holds crucial data from the Firebase project such as API Key or database URL which
+    will then be passed on to \l FirebaseAuth or \l FirebaseDatabase.
+    The properties of the Firebase App can be set by downloading the \a google-services.json file from Firebase
+    and store it in the resources for automatic parsing. An alternative is manually setting the properties in qml:
+
+    \code
+    FirebaseApp {
+        id: fbApp
+        apiKey: "insert-key"
+        databaseUrl: "insert-url"
+    }
+
+    FirebaseDatabase {
+        apiKey: fbApp.apiKey
+        databaseUrl: fbApp.databaseUrl
+    }
+    \endcode
+
+    \sa FirebaseAuth, FirebaseDatabase, FirebaseUser
+
+ */
+FirebaseApp::FirebaseApp(QObject *parent) : QObject(parent)
+{
+    connect(this, &FirebaseApp::sourceChanged, this, &FirebaseApp::parseFirebaseJson);
+}
+
+/*!
+    \qmlproperty string FirebaseApp::apiKey
+
+    This property holds the API Key of the Firebase project, used by the types \l FirebaseDatabase and \l FirebaseAuth.
+ */
+QString FirebaseApp::apiKey() const
+{
+    return m_apiKey;
+}
+
+/*!
+    \qmlproperty string FirebaseApp::authDomain
+
+    Domain of the authentication, currently not used.
+ */
+QString FirebaseApp::authDomain() const
+{
+    return m_authDomain;
+}
+
+/*!
+    \qmlproperty string FirebaseApp::databaseUrl
+
+    Property that holds the URL where the Firebase Realtime Database resides and should be passed
+    to \l FirebaseDatabase objects.
+ */
+QString FirebaseApp::databaseUrl() const
+{
+    return m_databaseUrl;
+}
+
+/*!
+    \qmlproperty string FirebaseApp::storageBucket
+
+    This property holds the bucket of the Firebase Storage and should be passed to \l FirebaseStorage objects.
+ */
+QString FirebaseApp::storageBucket() const
+{
+    return m_storageBucket;
+}
+
+/*!
+    \qmlproperty bool FirebaseApp::preconnect
+
+    If true (default), connections to the authentication, database, storage and Firestore servers are opened in parallel once
+    \l source has been parsed and control returns to the event loop, so that the first requests do not have to wait for DNS,
+    TCP and TLS handshakes. Only \c https servers are pre-connected.
+
+    \sa warmUpConnections()
+ */
+bool FirebaseApp::preconnect() const
+{
+    return m_preconnect;
+}
+
+void FirebaseApp::setPreconnect(bool preconnect)
+{
+    if(m_preconnect == preconnect)
+        return;
+
+    m_preconnect = preconnect;
+    emit preconnectChanged();
+}
+
+/*!
+    \qmlproperty FirebaseMemoryBudget FirebaseApp::memoryBudget
+
+    The process wide memory budget for network data. Disabled by default; on devices with little RAM set a limit so
+    that large responses go to disk and listeners are throttled instead of exhausting memory:
+
+    \code
+    FirebaseApp {
+        source: ":/google-services.json"
+        memoryBudget.limit: 4 * 1024 * 1024
+    }
+    \endcode
+
+    \sa FirebaseMemoryBudget
+ */
+FirebaseMemoryBudget *FirebaseApp::memoryBudget() const
+{
+    return FirebaseMemoryBudget::instance();
+}
+
+/*!
+    \qmlmethod void FirebaseApp::warmUpConnections()
+
+    Starts connecting to every Firebase host known from the current properties. Called automatically after parsing
+    \l source when \l preconnect is set; call it manually when the properties are set in QML instead. TLS sessions
+    are persisted in the cache directory, so connections after a restart resume the previous session.
+ */
+void FirebaseApp::warmUpConnections()
+{
+    FirebaseTransport *transport = FirebaseTransport::shared();
+    // Only real Firebase servers are worth a handshake, e.g. memory:// databases never touch the network
+    auto preconnect = [transport](const QUrl &url) {
+        if(url.scheme() == "https")
+            transport->preconnect(url);
+    };
+
+    preconnect(QUrl(AuthUtils::endpoint_signIn));
+    preconnect(QUrl(AuthUtils::endpoint_refreshToken));
+
+    if(!m_databaseUrl.isEmpty())
+        preconnect(QUrl(m_databaseUrl));
+    if(!m_storageBucket.isEmpty())
+        preconnect(QUrl("https://firebasestorage.googleapis.com/"));
+    if(!m_projectId.isEmpty())
+        preconnect(QUrl(FirestoreUtils::endpoint_documents));
+}
+
+/*!
+    \qmlmethod object FirebaseApp::connectionMetrics()
+
+    Returns startup metrics keyed by host name. Each entry holds \c preconnected, \c preconnectLead (milliseconds
+    between pre-connecting and the first request, i.e handshake time taken off the first request),
+    \c sessionTicketOffered, \c firstRequestTime, \c averageRequestTime and \c requests. Comparing the first
+    request time with \l preconnect enabled and disabled shows the latency saved at startup.
+
+    Hosts that received requests also report the current adaptive limits: \c rateLimit (requests per second),
+    \c concurrencyLimit, the number of \c queued requests and how often the host \c throttled the client.
+ */
+QVariantMap FirebaseApp::connectionMetrics() const
+{
+    return FirebaseTransport::shared()->connectionMetrics();
+}
+
+/*!
+    \qmlmethod void FirebaseApp::setRequestLimits(real requestsPerSecond, int burst, int maxConcurrency)
+
+    Sets the upper bounds of the client side rate limiting, per host, for the requests of objects in the calling
+    thread. Within these bounds the rate and the number of concurrent requests adapt to the latency and throttling
+    responses of the server. Defaults are 200 requests per second with bursts of 20, and 64 concurrent requests.
+ */
+void FirebaseApp::setRequestLimits(double requestsPerSecond, int burst, int maxConcurrency)
+{
+    FirebaseTransport *transport = FirebaseTransport::shared();
+    transport->setRateLimit(requestsPerSecond, burst);
+    transport->setMaxConcurrency(maxConcurrency);
+}
+
+/*!
+    \qmlmethod bool FirebaseApp::startCapture(string fileName)
+
+    Records all requests of the Firebase objects in the calling thread, \l FirebaseAuth and \l FirebaseDatabase
+    listeners included, with their responses and the timing of streamed events into the trace file \a fileName.
+    ID tokens, refresh tokens, API keys and passwords are redacted before they are written. Returns false if the file
+    cannot be created.
+
+    \sa stopCapture(), startReplay()
+ */
+bool FirebaseApp::startCapture(const QString &fileName)
+{
+    return FirebaseTransport::shared()->startCapture(fileName);
+}
+
+/*!
+    \qmlmethod void FirebaseApp::stopCapture()
+
+    Stops recording and closes the trace file.
+ */
+void FirebaseApp::stopCapture()
+{
+    FirebaseTransport::shared()->stopCapture();
+}
+
+/*!
+    \qmlmethod bool FirebaseApp::startReplay(string fileName, real speed)
+
+    Answers the requests of the Firebase objects in the calling thread from the trace file \a fileName, written by
+    \l startCapture(), instead of the network. Responses and streamed events arrive at their recorded delays divided
+    by \a speed, e.g 10 replays ten times faster and 0 without any delay, so a recorded workload can be reproduced
+    and profiled offline by running the same application code against it:
+
+    \code
+    Component.onCompleted: {
+        fbApp.startReplay("/tmp/session.trace", 4)
+        fbDatabase.listenEvents("/devices.json", "", 1, false, true)
+    }
+    \endcode
+
+    Requests are matched to the trace by verb and URL, in recording order. Requests that are not in the trace fail.
+
+    \sa stopReplay()
+ */
+bool FirebaseApp::startReplay(const QString &fileName, double speed)
+{
+    return FirebaseTransport::shared()->startReplay(fileName, speed);
+}
+
+/*!
+    \qmlmethod void FirebaseApp::stopReplay()
+
+    Sends requests to the network again.
+ */
+void FirebaseApp::stopReplay()
+{
+    FirebaseTransport::shared()->stopReplay();
+}
+
+/*!
+    \qmlproperty string FirebaseApp::projectId
+
+    This property holds the id of the Firebase project and should be passed to \l FirebaseFirestore objects.
+ */
+QString FirebaseApp::projectId() const
+{
+    return m_projectId;
+}
+
+void FirebaseApp::setProjectId(const QString &projectId)
+{
+    if(m_projectId == projectId)
+        return;
+
+    m_projectId = projectId;
+    emit projectIdChanged();
+}
+
+void FirebaseApp::setApiKey(const QString &apiKey)
+{
+    if(m_apiKey == apiKey)
+        return;
+    m_apiKey = apiKey;
+    emit apiKeyChanged();
+}
+
+void FirebaseApp::setAuthDomain(const QString &authDomain)
+{
+    if(m_authDomain == authDomain)
+        return;
+
+    m_authDomain = authDomain;
+    emit authDomainChanged();
+}
+
+void FirebaseApp::setDatabaseUrl(const QString &databaseUrl)
+{
+    if(m_databaseUrl == databaseUrl)
+        return;
+
+    m_databaseUrl = databaseUrl;
+    emit databaseUrlChanged();
+}
+
+void FirebaseApp::setStorageBucket(const QString &storageBucket)
+{
+    if(m_storageBucket == storageBucket)
+        return;
+
+    m_storageBucket = storageBucket;
+    emit storageBucketChanged();
+}
+
+/*!
+    \qmlproperty url FirebaseApp::source
+
+    This property holds the URL of the google-services.json that contains all information about a Firebase Project (usually obtained in Firebase Console).
+    If this path is set, the file will be parsed and all the other properties will be automatically set.
+ */
+QString FirebaseApp::source() const
+{
+    return m_source;
+}
+
+void FirebaseApp::setSource(const QString &source)
+{
+    if(m_source == source)
+        return;
+
+    m_source = source;
+    emit sourceChanged();
+}
+
+// Private function for parsing google-services.json file to scrape API Key, Database URL, etc
+void FirebaseApp::parseFirebaseJson()
+{
+    QFile file(m_source);
+
+    if(!file.open(QIODevice::ReadOnly|QIODevice::Text))
+        return;
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    QJsonParseError errorPtr;
+    QJsonDocument doc = QJsonDocument::fromJson(data, &errorPtr);
+    if (errorPtr.error == QJsonParseError::NoError) {
+        QJsonObject root = doc.object();
+        QJsonObject projectInfo = root["project_info"].toObject();
+        QJsonArray client = root["client"].toArray();
+
+        setDatabaseUrl(projectInfo["firebase_url"].toString() + "/");
+        setStorageBucket(projectInfo["storage_bucket"].toString());
+        setProjectId(projectInfo["project_id"].toString());
+        setAuthDomain(projectInfo["project_id"].toString() + ".firebase.com");
+
+
+        if(client.count() > 0) {
+            QJsonArray api_key = client.at(0).toObject()["api_key"].toArray();
+
+            if(api_key.count() > 0) {
+                setApiKey(api_key.at(0).toObject()["current_key"].toString());
+            }
+        }
+
+        // Deferred so that a preconnect property declared after source in QML is already applied
+        QMetaObject::invokeMethod(this, [this]() {
+            if(m_preconnect)
+                warmUpConnections();
+        }, Qt::QueuedConnection);
+    }
+}
+
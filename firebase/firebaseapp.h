@@ -1,48 +1,70 @@
-#ifndef FIREBASEAPP_H
-#define FIREBASEAPP_H
-
-#include <QObject>
-#include <QJsonDocument>
-#include "firebaseauth.h"
-#include "firebasedatabase.h"
-#include "firebaseuser.h"
-
-class FirebaseApp : public QObject
-{
-    Q_OBJECT
-    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
-    Q_PROPERTY(QString apiKey READ apiKey WRITE setApiKey NOTIFY apiKeyChanged)
-    Q_PROPERTY(QString authDomain READ authDomain WRITE setAuthDomain NOTIFY authDomainChanged)
-    Q_PROPERTY(QString databaseUrl READ databaseUrl WRITE setDatabaseUrl NOTIFY databaseUrlChanged)
-    Q_PROPERTY(QString storageBucket READ storageBucket WRITE setStorageBucket NOTIFY storageBucketChanged)
-
-public:
-    explicit FirebaseApp(QObject *parent = nullptr);
-
-    QString source() const;
-    QString apiKey() const;
-    QString authDomain() const;
-    QString databaseUrl() const;
-    QString storageBucket() const;
-
-    void setSource(const QString &source);
-    void setApiKey(const QString &apiKey);
-    void setAuthDomain(const QString &authDomain);
-    void setDatabaseUrl(const QString &databaseUrl);
-    void setStorageBucket(const QString &storageBucket);
-
-signals:
-    void apiKeyChanged();
-    void authDomainChanged();
-    void databaseUrlChanged();
-    void storageBucketChanged();
-    void sourceChanged();
-
-private:
-    void parseFirebaseJson();
-
-    QString m_source;
-    QString m_apiKey, m_authDomain, m_databaseUrl, m_storageBucket;
-};
-
-#endif // FIREBASEAPP_H
+#ifndef FIREBASEAPP_H
+#define FIREBASEAPP_H
+
+#include <QObject>
+#include <QJsonDocument>
+#include "firebaseauth.h"
+#include "firebasedatabase.h"
+#include "firebaseuser.h"
+#include "firebasememorybudget.h"
+
+class FirebaseApp : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(QString apiKey READ apiKey WRITE setApiKey NOTIFY apiKeyChanged)
+    Q_PROPERTY(QString authDomain READ authDomain WRITE setAuthDomain NOTIFY authDomainChanged)
+    Q_PROPERTY(QString databaseUrl READ databaseUrl WRITE setDatabaseUrl NOTIFY databaseUrlChanged)
+    Q_PROPERTY(QString storageBucket READ storageBucket WRITE setStorageBucket NOTIFY storageBucketChanged)
+    Q_PROPERTY(QString projectId READ projectId WRITE setProjectId NOTIFY projectIdChanged)
+    Q_PROPERTY(bool preconnect READ preconnect WRITE setPreconnect NOTIFY preconnectChanged)
+    Q_PROPERTY(FirebaseMemoryBudget* memoryBudget READ memoryBudget CONSTANT)
+
+public:
+    explicit FirebaseApp(QObject *parent = nullptr);
+
+    QString source() const;
+    QString apiKey() const;
+    QString authDomain() const;
+    QString databaseUrl() const;
+    QString storageBucket() const;
+    QString projectId() const;
+    bool preconnect() const;
+    FirebaseMemoryBudget *memoryBudget() const;
+
+    void setSource(const QString &source);
+    void setApiKey(const QString &apiKey);
+    void setAuthDomain(const QString &authDomain);
+    void setDatabaseUrl(const QString &databaseUrl);
+    void setStorageBucket(const QString &storageBucket);
+    void setProjectId(const QString &projectId);
+    void setPreconnect(bool preconnect);
+
+    Q_INVOKABLE QVariantMap connectionMetrics() const;
+    Q_INVOKABLE void setRequestLimits(double requestsPerSecond, int burst, int maxConcurrency);
+    Q_INVOKABLE bool startCapture(const QString &fileName);
+    Q_INVOKABLE void stopCapture();
+    Q_INVOKABLE bool startReplay(const QString &fileName, double speed = 1.0);
+    Q_INVOKABLE void stopReplay();
+
+public slots:
+    void warmUpConnections();
+
+signals:
+    void apiKeyChanged();
+    void authDomainChanged();
+    void databaseUrlChanged();
+    void storageBucketChanged();
+    void projectIdChanged();
+    void sourceChanged();
+    void preconnectChanged();
+
+private:
+    void parseFirebaseJson();
+
+    QString m_source;
+    QString m_apiKey, m_authDomain, m_databaseUrl, m_storageBucket, m_projectId;
+    bool m_preconnect = true;
+};
+
+#endif // FIREBASEAPP_H
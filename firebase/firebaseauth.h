@@ -1,59 +1,102 @@
-#ifndef FIREBASEAUTH_H
-#define FIREBASEAUTH_H
-
-#include <QObject>
-#include <QNetworkAccessManager>
-#include "firebaseuser.h"
-
-
-class FirebaseAuth : public QObject
-{
-    Q_OBJECT
-    Q_PROPERTY(QString apiKey READ apiKey WRITE setApiKey REQUIRED)
-    Q_PROPERTY(FirebaseUser* currentUser READ currentUser NOTIFY currentUserChanged)
-
-public:
-    explicit FirebaseAuth(QObject *parent = nullptr);
-
-    void setApiKey(const QString &apiKey);
-    QString apiKey() const;
-
-    FirebaseUser *currentUser() const;
-
-public slots:
-    void signUpWithEmailAndPassword(QString email, QString password, QString name);
-    void signInWithEmailAndPassword(QString email, QString password);
-    void signInWithOAuthCredential(QString authToken, QString providerId);
-    void exchangeRefreshToken(QString refreshToken);
-
-    // Email
-    void sendEmailVerification(QString idToken);
-    void changeEmail(QString idToken, QString newEmail);
-    void confirmEmailVerification(QString verificationCode);
-
-
-    // Password
-    void sendPasswordResetEmail(QString email);
-    void changePassword(QString idToken, QString newPassword);
-    void verifyPasswordResetCode(QString verificationCode);
-    void confirmPasswordReset(QString verificationCode, QString newPassword);
-
-
-    // User data
-    void getUserData(QString idToken);
-    void profileUpdate(QString idToken, QString name, QString photoUrl);
-    void deleteAccount(QString idToken);
-
-signals:
-    void currentUserChanged();
-    void signedIn();
-    void signedOut();
-    void errorOcurred(QString error);
-
-private:
-    QString m_apiKey;
-    QNetworkAccessManager m_manager;
-    FirebaseUser *m_currentUser;
-};
-
-#endif // FIREBASEAUTH_H
+#ifndef FIREBASEAUTH_H
+#define FIREBASEAUTH_H
+
+#include <QObject>
+#include <QJsonObject>
+#include "firebaseuser.h"
+#include "firebasetransport.h"
+#include "firebasetask.h"
+
+namespace AuthUtils { struct Request; }
+
+class FirebaseAuth : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString apiKey READ apiKey WRITE setApiKey REQUIRED)
+    Q_PROPERTY(FirebaseUser* currentUser READ currentUser NOTIFY currentUserChanged)
+    Q_PROPERTY(QString projectId READ projectId WRITE setProjectId NOTIFY projectIdChanged)
+    Q_PROPERTY(bool verifyIdTokens READ verifyIdTokens WRITE setVerifyIdTokens NOTIFY verifyIdTokensChanged)
+
+public:
+    explicit FirebaseAuth(QObject *parent = nullptr);
+
+    void setApiKey(const QString &apiKey);
+    QString apiKey() const;
+
+    FirebaseUser *currentUser() const;
+
+    QString projectId() const;
+    void setProjectId(const QString &projectId);
+
+    bool verifyIdTokens() const;
+    void setVerifyIdTokens(bool verifyIdTokens);
+
+#ifdef FIREBASE_HAS_COROUTINES
+    // Awaitable variants of the slots, they update currentUser and emit the same signals
+    FirebaseTask<FirebaseResponse> signUpWithEmailAndPasswordAsync(QString email, QString password, QString name, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> signInWithEmailAndPasswordAsync(QString email, QString password, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> signInWithOAuthCredentialAsync(QString authToken, QString providerId, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> exchangeRefreshTokenAsync(QString refreshToken, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> sendEmailVerificationAsync(QString idToken, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> changeEmailAsync(QString idToken, QString newEmail, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> confirmEmailVerificationAsync(QString verificationCode, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> sendPasswordResetEmailAsync(QString email, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> changePasswordAsync(QString idToken, QString newPassword, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> verifyPasswordResetCodeAsync(QString verificationCode, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> confirmPasswordResetAsync(QString verificationCode, QString newPassword, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> getUserDataAsync(QString idToken, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> profileUpdateAsync(QString idToken, QString name, QString photoUrl, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> deleteAccountAsync(QString idToken, FirebaseRequestOptions options = {});
+#endif
+
+public slots:
+    void signUpWithEmailAndPassword(QString email, QString password, QString name);
+    void signInWithEmailAndPassword(QString email, QString password);
+    void signInWithOAuthCredential(QString authToken, QString providerId);
+    void exchangeRefreshToken(QString refreshToken);
+
+    // Email
+    void sendEmailVerification(QString idToken);
+    void changeEmail(QString idToken, QString newEmail);
+    void confirmEmailVerification(QString verificationCode);
+
+
+    // Password
+    void sendPasswordResetEmail(QString email);
+    void changePassword(QString idToken, QString newPassword);
+    void verifyPasswordResetCode(QString verificationCode);
+    void confirmPasswordReset(QString verificationCode, QString newPassword);
+
+
+    // User data
+    void getUserData(QString idToken);
+    void profileUpdate(QString idToken, QString name, QString photoUrl);
+    void deleteAccount(QString idToken);
+
+signals:
+    void currentUserChanged();
+    void projectIdChanged();
+    void verifyIdTokensChanged();
+    void signedIn();
+    void signedOut();
+    void errorOcurred(QString error, FirebaseError::Code code);
+
+private:
+    // Measures handleReply() as it runs for every response
+    friend class tst_BenchAuthReply;
+
+    void sendRequest(const AuthUtils::Request &request, const QByteArray &data);
+    quint64 sendRequest(const AuthUtils::Request &request, const QByteArray &data, FirebaseTransport::Callback done);
+    void handleReply(const AuthUtils::Request &request, const FirebaseResponse &response);
+#ifdef FIREBASE_HAS_COROUTINES
+    FirebaseTask<FirebaseResponse> requestAsync(const AuthUtils::Request &request, QByteArray data, FirebaseRequestOptions options);
+#endif
+
+    QString m_apiKey;
+    QString m_projectId;
+    FirebaseTransport *m_transport;
+    FirebaseUser *m_currentUser;
+    bool m_verifyIdTokens = false;
+};
+
+#endif // FIREBASEAUTH_H
@@ -1,404 +1,1246 @@
-#include <QUrlQuery>
-#include <QNetworkReply>
-#include <QJSEngine>
-#include "firebasedatabase.h"
-
-
-/*!
-    \qmltype FirebaseDatabase
-    \inqmlmodule Firebase
-    \ingroup Firebase
-    \brief Type that offers methods for adding, updating and deleting data from the Firebase Realtime Database.
-
-    FirebaseDatabase provides methods for adding, updating and deleting data from the Firebase Realtime Database.
-    Moreover, it also provides the method \l listenEvents that listens to events in a given database path and fires
-    a signal when an event occurs.
-*/
-FirebaseDatabase::FirebaseDatabase(QObject *parent) : QObject(parent)
-{
-
-}
-
-/*!
-    \qmlsignal FirebaseDatabase::dataRetrieved(string data, int requestCode)
-
-    Emitted when the response to a call of \l getValue() arrives and sends the corresponding \a data and \a requestCode.
-
-    \sa getValue()
- */
-
-/*!
-    \qmlsignal FirebaseDatabase::dataUpdated()
-
-    Emitted when a call to \l updateValue() is successfull.
- */
-
-/*!
-    \qmlsignal FirebaseDatabase::dataEvent(string data, int requestCode)
-
-    Emitted when an event from a listener occurs, sends the server response \a data and the corresponding \a requestCode.
-
-    \sa listenEvents()
- */
-
-/*!
-    \qmlsignal FirebaseDatabase::getValueFinished()
-
-    Emitted when a call to \l getValue() finishes.
- */
-/*!
-    \qmlsignal FirebaseDatabase::updateValueFinished()
-
-    Emitted when a call to \l updateValue() finishes.
- */
-/*!
-    \qmlsignal FirebaseDatabase::writeValueFinished()
-
-    Emitted when a call to \l writeValue() finishes.
- */
-/*!
-    \qmlsignal FirebaseDatabase::pushValueFinished()
-
-    Emitted when a call to \l pushValueWithUniqueKey() finishes.
- */
-/*!
-    \qmlsignal FirebaseDatabase::deleteValueFinished()
-
-    Emitted when a call to \l deleteValue() finishes.
- */
-
-
-/*!
-    \qmlmethod void FirebaseDatabase::listenEvents(string dbPath, string idToken, int requestCode, bool ignoreFirstEvent, bool recursive)
-
-    Registers a listener to the database path \a dbPath with \a idToken if the Firebase Database rules require authentication.
-
-    When an event occurs (e.g data was added, updated or deleted) on that path, the signal \l dataEvent() is triggered with the
-    contents of the server response atached to the code \a requestCode. The request code
-    provides a way to differentiate where the response comes from, as seen in the example:
-
-    \code
-    FirebaseDatabase {
-        id: fbDb
-        ...
-        onDataEvent: { // params (data, requestCode)
-            if(requestCode == 10)
-                console.log(data) // data contains event from Users path
-            else if(requestCode == 20)
-                console.log(data) // data contains event from Alerts path
-        }
-        Component.onCompleted: {
-            fbDb.listenEvents("/Users/.json", "insert-if-necessary", 10)
-            fbDb.listenEvents("/Alerts/.json", "insert-if-necessary", 20)
-        }
-    }
-    \endcode
-
-    When an event listener is first registered, the first event will always return the entire contents of the chosen path.
-    To ignore the first event, set \a ignoreFirstEvent to true (if no parameter passed, is true by default).
-
-    If you want the listener to be recursive (i.e it re-registers itself when the server closes connection) set the argument \a recursive to true.
-
-    \sa dataEvent()
- */
-void FirebaseDatabase::listenEvents(QString dbPath, QString idToken, int requestCode, bool ignoreFirstEvent, bool recursive)
-{
-    QUrl url = m_databaseUrl + dbPath;
-
-    // Check if idToken was passed
-    if(!idToken.isEmpty()) {
-        QUrlQuery query;
-        query.addQueryItem("auth", idToken);
-        url.setQuery(query);
-    }
-
-    // Open connection with server
-    QNetworkRequest request(url);
-    request.setRawHeader("Accept", "text/event-stream");
-    QNetworkReply *reply = m_manager.get(request);
-
-    // Event received lambda
-    connect(reply, &QNetworkReply::readyRead, this, [=]() mutable {
-        QByteArray data = reply->readAll();
-
-        // Ignore the keep-alive events
-        if(!data.contains("keep-alive")) {
-            if(!ignoreFirstEvent) {
-                dataEvent(data, requestCode);
-                qDebug().noquote() << "EVENT\n" << data;
-            } else ignoreFirstEvent = false;
-        }
-    });
-
-    // Event finished lambda
-    connect(reply, &QNetworkReply::finished, this, [=](){
-        if (reply) {
-            QUrl redirectUrl = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
-            if (!redirectUrl.isEmpty()) {
-                // Do something with redirect URL here
-            }
-            reply->deleteLater();
-            qDebug() << "Event finished";
-            if(recursive) {
-                listenEvents(dbPath, idToken, requestCode, ignoreFirstEvent, recursive);
-                qDebug() << "Registering listener again";
-            }
-        }
-    });
-}
-
-
-/*!
-    \qmlmethod void FirebaseDatabase::pushValueWithUniqueKey(string dbPath, string jsonData, string idToken)
-
-    Writes to the database path \a dbPath a new entry with a randomized unique key and value \a jsonData.
-
-    \code
-    FirebaseDatabase {
-        id: fbDb
-        ...
-    }
-
-    Button {
-        text: "Push value"
-        onClicked: fbDb.pushValueWithUniqueKey("/random.json", JSON.stringify({"text":"Foo Bar"}), fbAuth.currentUser.idToken)
-    }
-    \endcode
-
-    In the example above, if the button is repeatedly clicked, multiple entries with random keys will be added to the path.
-
-    \sa writeValue(), updateValue(), deleteValue()
- */
-void FirebaseDatabase::pushValueWithUniqueKey(QString dbPath, QString jsonData, QString idToken)
-{
-    QUrl url = m_databaseUrl + dbPath;
-
-    // Check if idToken was passed
-    if(!idToken.isEmpty()) {
-        QUrlQuery query;
-        query.addQueryItem("auth", idToken);
-        url.setQuery(query);
-    }
-
-    QNetworkRequest request(url);
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
-
-    QNetworkReply *reply = m_manager.post(request, jsonData.toUtf8());
-
-    connect(reply, &QNetworkReply::finished, this, [=](){
-        //qDebug().noquote() << "PUSH RESPONSE: \n" << reply->readAll();
-        emit pushValueFinished();
-    });
-}
-
-
-/*!
-    \qmlmethod void FirebaseDatabase::writeValue(string dbPath, string jsonData, string idToken)
-
-    Writes to the database path \a dbPath a new entry with a randomized unique key and value \a jsonData.
-
-    \warning Careful use of this method is required since the last specifier of the path denotes the key of the new entry
-    and all data in that path will be overwritten, for example:
-
-    \code
-    FirebaseDatabase {
-        id: fbDb
-        ...
-    }
-    Button {
-        id: button1
-        onClicked: fbDb.writeValue("/random/myText.json", JSON.stringify({"text":"Foo Bar"}), fbAuth.currentUser.idToken)
-    }
-    Button {
-        id: button2
-        onClicked: fbDb.writeValue("/random.json", JSON.stringify({"text":"Foo Bar"}), fbAuth.currentUser.idToken)
-    }
-    \endcode
-
-    In the example above, if button1 is pressed, a new entry with key \a myText and the given value, as expected. If button2 is pressed,
-    the entire contents of the path "/random.json" will be replaced by the given value, as opposed to inserting the new entry in the "/random.json" path.
-
-    \sa pushValueWithUniqueKey(), updateValue(), deleteValue()
- */
-void FirebaseDatabase::writeValue(QString dbPath, QString jsonData, QString idToken)
-{
-    QUrl url = m_databaseUrl + dbPath;
-
-    // Check if idToken was passed
-    if(!idToken.isEmpty()) {
-        QUrlQuery query;
-        query.addQueryItem("auth", idToken);
-        url.setQuery(query);
-    }
-
-    QNetworkRequest request(url);
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
-
-    QNetworkReply *reply = m_manager.put(request, jsonData.toUtf8());
-
-    connect(reply, &QNetworkReply::finished, this, [=](){
-        qDebug().noquote() << "WRITE DATA RESPONSE: \n" << reply->readAll();
-        emit writeValueFinished();
-    });
-}
-
-/*!
-    \qmlmethod void FirebaseDatabase::updateValue(string dbPath, string jsonData, string idToken)
-
-    Updates the entry in \a dbPath with the new value in \a jsonData. The contents of \a jsonData can be used to update the entire entry
-    or just patch one of the fields, for example:
-
-    \code
-    FirebaseDatabase {
-        id: fbDb
-        ...
-    }
-
-    Button {
-        text: "Push value"
-        onClicked: fbDb.pushValueWithUniqueKey("/random/myData.json", JSON.stringify({"text":"Foo Bar", "myInt" : 10}), fbAuth.currentUser.idToken)
-    }
-    Button {
-        text: "Update value"
-        onClicked: fbDb.pushValueWithUniqueKey("/random/myData.json", JSON.stringify({"text":"Foo Bar"}), fbAuth.currentUser.idToken)
-    }
-    \endcode
-
-    In the example above, if the value is pushed and then updated, only the text will be updated and "myInt" will remain the same.
-
-    \sa writeValue()
- */
-void FirebaseDatabase::updateValue(QString dbPath, QString jsonData, QString idToken)
-{
-    QUrl url = m_databaseUrl + dbPath;
-
-    // Check if idToken was passed
-    if(!idToken.isEmpty()) {
-        QUrlQuery query;
-        query.addQueryItem("auth", idToken);
-        url.setQuery(query);
-    }
-
-    QNetworkRequest request(url);
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
-
-    QNetworkReply *reply = m_manager.sendCustomRequest(request, "PATCH", jsonData.toUtf8());
-
-    connect(reply, &QNetworkReply::finished, this, [=](){
-        //qDebug().noquote() << "PATCH DATA RESPONSE: \n" << reply->readAll();
-        emit updateValueFinished();
-    });
-}
-
-
-/*!
-    \qmlmethod void FirebaseDatabase::getValue(string dbPath, string idToken, int requestCode)
-
-    Requests all the data in path \a dbPath with \a idToken if the Firebase Database rules require authentication.
-
-    When the request is successful the signal \l dataRetrieved() is triggered with the
-    contents of the server response atached to the code \a requestCode. The request code
-    provides a way to differentiate where the response comes from, as seen in the example:
-
-    \code
-    FirebaseDatabase {
-        id: fbDb
-        ...
-        onDataRetrieved: { // params (data, requestCode)
-            if(requestCode == 10)
-                console.log(data) // data contains event from Users path
-            else if(requestCode == 20)
-                console.log(data) // data contains event from Alerts path
-        }
-        Component.onCompleted: {
-            fbDb.getValue("/Users/.json", "insert-if-necessary", 10)
-            fbDb.getValue("/Alerts/.json", "insert-if-necessary", 20)
-        }
-    }
-    \endcode
-
-    \sa dataRetrieved()
- */
-void FirebaseDatabase::getValue(QString dbPath, QString idToken, int requestCode)
-{
-    QUrl url = m_databaseUrl + dbPath;
-
-    // Check if idToken was passed
-    if(!idToken.isEmpty()) {
-        QUrlQuery query;
-        query.addQueryItem("auth", idToken);
-        url.setQuery(query);
-    }
-
-    QNetworkRequest request(url);
-
-    QNetworkReply *reply = m_manager.get(request);
-
-    connect(reply, &QNetworkReply::finished, this, [=](){
-        //qDebug().noquote() << "GETVALUE RESPONSE: \n" << reply->readAll();
-        QByteArray data = reply->readAll();
-
-        if(reply->error() == QNetworkReply::NoError)
-            emit dataRetrieved(data, requestCode);
-
-        emit getValueFinished();
-    });
-}
-
-/*!
-    \qmlmethod void FirebaseDatabase::deleteValue(string dbPath, string idToken)
-
-    Deletes all data in path \a dbPath with \a idToken if the Firebase Database rules require authentication.
- */
-void FirebaseDatabase::deleteValue(QString dbPath, QString idToken)
-{
-    QUrl url = m_databaseUrl + dbPath;
-
-    // Check if idToken was passed
-    if(!idToken.isEmpty()) {
-        QUrlQuery query;
-        query.addQueryItem("auth", idToken);
-        url.setQuery(query);
-    }
-
-    QNetworkRequest request(url);
-
-    QNetworkReply *reply = m_manager.sendCustomRequest(request, "DELETE");
-
-    connect(reply, &QNetworkReply::finished, this, [=](){
-        //qDebug().noquote() << "DELETE RESPONSE: \n" << reply->readAll();
-        emit deleteValueFinished();
-    });
-}
-
-
-/*!
-    \qmlproperty string FirebaseDatabase::apiKey
-
-    This property holds the API Key of the Firebase project, obtained from \l FirebaseApp.
- */
-QString FirebaseDatabase::apiKey() const
-{
-    return m_apiKey;
-}
-
-/*!
-    \qmlproperty string FirebaseDatabase::databaseUrl
-
-    This property holds the database where the Firebase Realtime Database resides, obtained from \l FirebaseApp.
- */
-QString FirebaseDatabase::databaseUrl() const
-{
-    return m_databaseUrl;
-}
-
-void FirebaseDatabase::setDatabaseUrl(const QString &databaseUrl)
-{
-    m_databaseUrl = databaseUrl;
-}
-
-
-void FirebaseDatabase::setApiKey(const QString &apiKey)
-{
-    m_apiKey = apiKey;
-}
+#include <QUrlQuery>
+#include <QNetworkReply>
+#include <QLoggingCategory>
+#include <QTimer>
+#include <QMetaMethod>
+#include <QMutex>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include "firebasedatabase.h"
+#include "firebasememorybudget.h"
+#include "firebasedatacache.h"
+#include "firebasememorybackend.h"
+#include "utils/DatabaseUtils.h"
+#include "utils/JwtUtils.h"
+
+Q_LOGGING_CATEGORY(lcFirebaseDatabase, "firebase.database", QtWarningMsg)
+
+namespace {
+
+struct ServerEvent {
+    QByteArray name;
+    QByteArray data;
+};
+
+// Events held per listener when coalescing before they are delivered early
+const int maxQueuedEvents = 256;
+
+// One generator for the process keeps the keys of all objects in order
+QString nextPushId()
+{
+    static QMutex mutex;
+    static DatabaseUtils::PushIdGenerator generator;
+
+    QMutexLocker locker(&mutex);
+    return generator.next(QDateTime::currentMSecsSinceEpoch());
+}
+
+// Takes the complete server-sent events off the front of buffer, an incomplete one stays for the next chunk
+QList<ServerEvent> takeEvents(QByteArray *buffer)
+{
+    QList<ServerEvent> events;
+    buffer->replace("\r\n", "\n");
+
+    int end;
+    while((end = buffer->indexOf("\n\n")) >= 0) {
+        ServerEvent event;
+        for(const QByteArray &line : buffer->left(end).split('\n')) {
+            if(line.startsWith("event:"))
+                event.name = line.mid(6).trimmed();
+            else if(line.startsWith("data:"))
+                event.data += line.mid(5).trimmed();
+        }
+        buffer->remove(0, end + 2);
+
+        if(!event.name.isEmpty())
+            events.append(event);
+    }
+
+    return events;
+}
+
+}
+
+/*!
+    \qmltype FirebaseDatabase
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Type that offers methods for adding, updating and deleting data from the Firebase Realtime Database.
+
+    FirebaseDatabase provides methods for adding, updating and deleting data from the Firebase Realtime Database.
+    Moreover, it also provides the method \l listenEvents that listens to events in a given database path and fires
+    a signal when an event occurs.
+*/
+FirebaseDatabase::FirebaseDatabase(QObject *parent) : QObject(parent), m_transport(FirebaseTransport::shared())
+{
+    m_eventTimer.setSingleShot(true);
+    connect(&m_eventTimer, &QTimer::timeout, this, &FirebaseDatabase::flushEvents);
+
+    m_dispatchTimer.setSingleShot(true);
+    m_dispatchTimer.setInterval(0);
+    connect(&m_dispatchTimer, &QTimer::timeout, this, &FirebaseDatabase::drainDispatch);
+}
+
+// Events waiting for their turn under a dispatch budget
+struct FirebaseDatabase::Dispatch {
+    quint64 sequence;
+    QList<DatabaseUtils::Event> events;
+};
+
+FirebaseDatabase::~FirebaseDatabase()
+{
+}
+
+/*!
+    \qmlsignal FirebaseDatabase::dataRetrieved(string data, int requestCode)
+
+    Emitted when the response to a call of \l getValue() arrives and sends the corresponding \a data and \a requestCode.
+
+    \sa getValue()
+ */
+
+/*!
+    \qmlsignal FirebaseDatabase::dataSnapshotRetrieved(FirebaseDataSnapshot snapshot, int requestCode)
+
+    Emitted together with \l dataRetrieved(), with the response already parsed. The response is parsed once and all
+    receivers share the same \a snapshot, so prefer this signal when several components handle the same request.
+
+    \sa getValue(), FirebaseDataSnapshot
+ */
+
+/*!
+    \qmlsignal FirebaseDatabase::dataRetrievedToFile(string filePath, int size, int requestCode)
+
+    Emitted instead of \l dataRetrieved() when a \l {FirebaseApp::memoryBudget}{memory budget} is set and the response to
+    \l getValue() was too large to be held in memory. The \a size bytes of data are in the file \a filePath, which is
+    removed once the signal handlers return, so it has to be read or copied right away.
+
+    \sa getValue(), FirebaseMemoryBudget
+ */
+
+/*!
+    \qmlsignal FirebaseDatabase::dataUpdated()
+
+    Emitted when a call to \l updateValue() is successfull.
+ */
+
+/*!
+    \qmlsignal FirebaseDatabase::dataEvent(string data, int requestCode)
+
+    Emitted when an event from a listener occurs, sends the server response \a data and the corresponding \a requestCode.
+
+    \sa listenEvents()
+ */
+
+/*!
+    \qmlsignal FirebaseDatabase::dataSnapshotEvent(string event, string path, FirebaseDataSnapshot snapshot, int requestCode)
+
+    Emitted for every event of a listener with the \a event type (\c "put" or \c "patch"), the \a path it applies to,
+    relative to the listened location, and the parsed data as \a snapshot, shared by all receivers.
+
+    \sa listenEvents(), FirebaseDataSnapshot
+ */
+
+/*!
+    \qmlsignal FirebaseDatabase::errorOcurred(string error, FirebaseError::Code code, string dbPath)
+
+    Emitted when a request on \a dbPath failed, with the \a error in human readable format and its \l FirebaseError \a code.
+    Transient errors are retried automatically before this signal is emitted. The corresponding finished signal is still emitted.
+ */
+
+/*!
+    \qmlsignal FirebaseDatabase::getValueFinished()
+
+    Emitted when a call to \l getValue() finishes.
+ */
+/*!
+    \qmlsignal FirebaseDatabase::updateValueFinished()
+
+    Emitted when a call to \l updateValue() finishes.
+ */
+/*!
+    \qmlsignal FirebaseDatabase::writeValueFinished()
+
+    Emitted when a call to \l writeValue() finishes.
+ */
+/*!
+    \qmlsignal FirebaseDatabase::pushValueFinished()
+
+    Emitted when a call to \l pushValueWithUniqueKey() finishes.
+ */
+/*!
+    \qmlsignal FirebaseDatabase::deleteValueFinished()
+
+    Emitted when a call to \l deleteValue() finishes.
+ */
+
+
+/*!
+    \qmlmethod void FirebaseDatabase::listenEvents(string dbPath, string idToken, int requestCode, bool ignoreFirstEvent, bool recursive)
+
+    Registers a listener to the database path \a dbPath with \a idToken if the Firebase Database rules require authentication.
+
+    When an event occurs (e.g data was added, updated or deleted) on that path, the signal \l dataEvent() is triggered with the
+    contents of the server response atached to the code \a requestCode. The request code
+    provides a way to differentiate where the response comes from, as seen in the example:
+
+    \code
+    FirebaseDatabase {
+        id: fbDb
+        ...
+        onDataEvent: { // params (data, requestCode)
+            if(requestCode == 10)
+                console.log(data) // data contains event from Users path
+            else if(requestCode == 20)
+                console.log(data) // data contains event from Alerts path
+        }
+        Component.onCompleted: {
+            fbDb.listenEvents("/Users/.json", "insert-if-necessary", 10)
+            fbDb.listenEvents("/Alerts/.json", "insert-if-necessary", 20)
+        }
+    }
+    \endcode
+
+    When an event listener is first registered, the first event will always return the entire contents of the chosen path.
+    To ignore the first event, set \a ignoreFirstEvent to true (if no parameter passed, is true by default).
+
+    If you want the listener to be recursive (i.e it re-registers itself when the server closes connection) set the argument \a recursive to true.
+
+    \sa dataEvent()
+ */
+void FirebaseDatabase::listenEvents(QString dbPath, QString idToken, int requestCode, bool ignoreFirstEvent, bool recursive)
+{
+    // Shared by the connections of one listener, including its reconnects, and cleared when it is stopped
+    QSharedPointer<bool> active = m_activeListeners.value(requestCode);
+    if(!active) {
+        active.reset(new bool(true));
+        m_activeListeners.insert(requestCode, active);
+    }
+
+    if(FirebaseMemoryBackend::handles(m_databaseUrl)) {
+        listenMemory(dbPath, requestCode, ignoreFirstEvent, active);
+        return;
+    }
+
+    QUrl url = requestUrl(dbPath, idToken);
+
+    // Open connection with server
+    QNetworkRequest request(url);
+    request.setRawHeader("Accept", "text/event-stream");
+    m_transport->prepare(request);
+    QNetworkReply *reply = m_transport->manager()->get(request);
+    m_listenerReplies.insert(requestCode, reply);
+
+    // With a memory budget the socket is not drained while memory is short, the server is slowed down by TCP instead
+    FirebaseMemoryBudget *budget = FirebaseMemoryBudget::instance();
+    if(budget->isEnabled())
+        reply->setReadBufferSize(budget->readBufferSize());
+
+    const QString location = DatabaseUtils::location(dbPath);
+    addListener(location, requestCode);
+
+    // The last known data is shown right away, the first event of the server then replaces it
+    const QString cacheKey = cacheKeyOf(dbPath, idToken);
+    QJsonValue cached;
+    if(!ignoreFirstEvent && !cacheKey.isEmpty() && FirebaseDataCache::shared()->find(cacheKey, &cached)) {
+        QTimer::singleShot(0, this, [=]() {
+            if(*active)
+                deliverEvent(location, "put", "/", cached, requestCode);
+        });
+    }
+
+    // Event received lambda
+    QSharedPointer<bool> ignoreNext(new bool(ignoreFirstEvent));
+    QSharedPointer<bool> ignoreNextSnapshot(new bool(ignoreFirstEvent));
+    QSharedPointer<QByteArray> pending(new QByteArray);
+    auto readEvents = [=](bool force) {
+        if(!force && budget->underPressure())
+            return;
+
+        QByteArray data = reply->readAll();
+
+        // Ignore the keep-alive events, coalesced and budgeted events are delivered from the parsed events below
+        const bool queued = m_eventInterval > 0 || m_dispatchBudget > 0;
+        if(!queued && !data.isEmpty() && !data.contains("keep-alive")) {
+            if(!*ignoreNext) {
+                dataEvent(data, requestCode);
+                qCDebug(lcFirebaseDatabase).noquote() << "EVENT\n" << data;
+            } else *ignoreNext = false;
+        }
+
+        // Events are only parsed for snapshot receivers, the cache and the local view, each one once for all of them
+        const bool snapshots = isSignalConnected(QMetaMethod::fromSignal(&FirebaseDatabase::dataSnapshotEvent));
+        if(data.isEmpty() || (!snapshots && cacheKey.isEmpty() && !m_optimisticWrites && !queued))
+            return;
+
+        pending->append(data);
+        for(const ServerEvent &event : takeEvents(pending.data())) {
+            if(event.name == "keep-alive")
+                continue;
+
+            // Large payloads are only indexed, their data is converted if the cache, local view or queue needs it
+            const FirebaseDataSnapshot payload = FirebaseDataSnapshot::fromJson(event.data);
+            const QString path = payload.child("path").json().toString();
+            const FirebaseDataSnapshot snapshot(path.section('/', -1), payload.child("data"));
+            const QJsonValue value = !cacheKey.isEmpty() || m_optimisticWrites || queued ? snapshot.json() : QJsonValue();
+
+            if(!cacheKey.isEmpty())
+                FirebaseDataCache::shared()->apply(cacheKey, event.name, path, value);
+            trackServerData(location, event.name, path, value);
+
+            if(*ignoreNextSnapshot && event.name == "put") {
+                *ignoreNextSnapshot = false;
+                continue;
+            }
+
+            if(queued)
+                deliverEvent(location, event.name, path, value, requestCode);
+            else if(snapshots)
+                emit dataSnapshotEvent(QString::fromUtf8(event.name), path, snapshot, requestCode);
+        }
+    };
+
+    connect(reply, &QNetworkReply::readyRead, this, [=]() {
+        readEvents(false);
+    });
+
+    // Events held back under pressure are read once it is over
+    if(budget->isEnabled()) {
+        connect(budget, &FirebaseMemoryBudget::pressureChanged, reply, [=](bool underPressure) {
+            if(!underPressure)
+                readEvents(false);
+        });
+    }
+
+    // Event finished lambda
+    connect(reply, &QNetworkReply::finished, this, [=](){
+        if (reply) {
+            QUrl redirectUrl = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+            if (!redirectUrl.isEmpty()) {
+                // Do something with redirect URL here
+            }
+            reply->deleteLater();
+            m_listenerReplies.remove(requestCode, reply);
+            qCDebug(lcFirebaseDatabase) << "Event finished";
+
+            // Events still waiting in the buffer
+            readEvents(true);
+
+            const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            const FirebaseError::Code error = FirebaseError::fromReply(reply->error(), status, QByteArray());
+            const bool failed = error != FirebaseError::NoError && FirebaseError::category(error) != FirebaseError::Retryable;
+            const bool stopped = !*active;
+            if(failed || stopped || !recursive)
+                removeListener(location, requestCode);
+            if(stopped)
+                return;
+
+            // A listener that ended by itself is forgotten like a stopped one
+            if((failed || !recursive) && !m_listenerReplies.contains(requestCode) && m_activeListeners.value(requestCode) == active)
+                m_activeListeners.remove(requestCode);
+
+            if(failed) {
+                emit errorOcurred(FirebaseError::message(error, reply->errorString()), error, dbPath);
+                return;
+            }
+
+            if(recursive) {
+                // Back off when the connection failed so an unreachable server is not hammered with reconnects
+                const int delay = error == FirebaseError::NoError ? 0 : m_transport->retryDelay(0);
+                QTimer::singleShot(delay, this, [=]() {
+                    if(*active)
+                        listenEvents(dbPath, idToken, requestCode, ignoreFirstEvent, recursive);
+                });
+                qCDebug(lcFirebaseDatabase) << "Registering listener again in" << delay << "ms";
+            }
+        }
+    });
+}
+
+/*!
+    \qmlmethod void FirebaseDatabase::stopListening(int requestCode)
+
+    Closes the listeners started by \l listenEvents() with \a requestCode, recursive ones included. No further
+    \l dataEvent() is emitted for them, except for events already waiting for the next \l eventInterval.
+ */
+void FirebaseDatabase::stopListening(int requestCode)
+{
+    // Pending reconnects, cached data and queued events of the listener see the flag and are dropped
+    const QSharedPointer<bool> active = m_activeListeners.take(requestCode);
+    if(active)
+        *active = false;
+
+    for(const QMetaObject::Connection &connection : m_memoryListeners.values(requestCode))
+        disconnect(connection);
+    m_memoryListeners.remove(requestCode);
+
+    m_dispatchQueues.remove(requestCode);
+
+    for(auto it = m_listeners.begin(); it != m_listeners.end();) {
+        if(it->requestCode == requestCode)
+            it = m_listeners.erase(it);
+        else
+            ++it;
+    }
+
+    // Aborting finishes the replies, their handlers see the listener is stopped and do not reconnect
+    for(const QPointer<QNetworkReply> &reply : m_listenerReplies.values(requestCode)) {
+        if(reply)
+            reply->abort();
+    }
+}
+
+/*!
+    \qmlmethod string FirebaseDatabase::pushValueWithUniqueKey(string dbPath, string jsonData, string idToken)
+
+    Writes to the database path \a dbPath a new entry with a randomized unique key and value \a jsonData, and returns the key.
+
+    The key is generated locally with \l pushId(), so it is known right away and can be used by further writes before
+    the server has answered. The entry is written with a PUT to the new key, which is safe to retry: a request resent
+    after a network failure cannot create a second entry.
+
+    \code
+    FirebaseDatabase {
+        id: fbDb
+        ...
+    }
+
+    Button {
+        text: "Push value"
+        onClicked: fbDb.pushValueWithUniqueKey("/random.json", JSON.stringify({"text":"Foo Bar"}), fbAuth.currentUser.idToken)
+    }
+    \endcode
+
+    In the example above, if the button is repeatedly clicked, multiple entries with random keys will be added to the path.
+
+    \sa writeValue(), updateValue(), deleteValue()
+ */
+QString FirebaseDatabase::pushValueWithUniqueKey(QString dbPath, QString jsonData, QString idToken)
+{
+    const QString key = pushId();
+    const QString entryPath = DatabaseUtils::childPath(dbPath, key);
+
+    const quint64 localWrite = applyLocally("PUT", entryPath, jsonData.toUtf8());
+    sendRequest("PUT", entryPath, idToken, jsonData.toUtf8(), [=](const FirebaseResponse &response) {
+        reportError(response, dbPath);
+        updateCache("PUT", entryPath, idToken, response);
+        settleLocally(localWrite, entryPath, response);
+        emit pushValueFinished();
+    });
+
+    return key;
+}
+
+/*!
+    \qmlmethod string FirebaseDatabase::pushId()
+
+    Returns a new unique key in the format of the keys created by the Firebase SDKs: keys sort by the time they were
+    generated. Use it to write several locations referring to the same new entry in one \l updateValue():
+
+    \code
+    var id = fbDb.pushId()
+    var update = {}
+    update["messages/" + id] = { text: "Hello", room: "lobby" }
+    update["rooms/lobby/lastMessage"] = id
+    fbDb.updateValue("/.json", JSON.stringify(update), fbAuth.currentUser.idToken)
+    \endcode
+
+    \sa pushValueWithUniqueKey()
+ */
+QString FirebaseDatabase::pushId() const
+{
+    return nextPushId();
+}
+
+
+/*!
+    \qmlmethod void FirebaseDatabase::writeValue(string dbPath, string jsonData, string idToken)
+
+    Writes to the database path \a dbPath a new entry with a randomized unique key and value \a jsonData.
+
+    \warning Careful use of this method is required since the last specifier of the path denotes the key of the new entry
+    and all data in that path will be overwritten, for example:
+
+    \code
+    FirebaseDatabase {
+        id: fbDb
+        ...
+    }
+    Button {
+        id: button1
+        onClicked: fbDb.writeValue("/random/myText.json", JSON.stringify({"text":"Foo Bar"}), fbAuth.currentUser.idToken)
+    }
+    Button {
+        id: button2
+        onClicked: fbDb.writeValue("/random.json", JSON.stringify({"text":"Foo Bar"}), fbAuth.currentUser.idToken)
+    }
+    \endcode
+
+    In the example above, if button1 is pressed, a new entry with key \a myText and the given value, as expected. If button2 is pressed,
+    the entire contents of the path "/random.json" will be replaced by the given value, as opposed to inserting the new entry in the "/random.json" path.
+
+    \sa pushValueWithUniqueKey(), updateValue(), deleteValue()
+ */
+void FirebaseDatabase::writeValue(QString dbPath, QString jsonData, QString idToken)
+{
+    const quint64 localWrite = applyLocally("PUT", dbPath, jsonData.toUtf8());
+    sendRequest("PUT", dbPath, idToken, jsonData.toUtf8(), [=](const FirebaseResponse &response) {
+        qCDebug(lcFirebaseDatabase).noquote() << "WRITE DATA RESPONSE: \n" << response.body;
+        reportError(response, dbPath);
+        updateCache("PUT", dbPath, idToken, response);
+        settleLocally(localWrite, dbPath, response);
+        emit writeValueFinished();
+    });
+}
+
+/*!
+    \qmlmethod void FirebaseDatabase::updateValue(string dbPath, string jsonData, string idToken)
+
+    Updates the entry in \a dbPath with the new value in \a jsonData. The contents of \a jsonData can be used to update the entire entry
+    or just patch one of the fields, for example:
+
+    \code
+    FirebaseDatabase {
+        id: fbDb
+        ...
+    }
+
+    Button {
+        text: "Push value"
+        onClicked: fbDb.pushValueWithUniqueKey("/random/myData.json", JSON.stringify({"text":"Foo Bar", "myInt" : 10}), fbAuth.currentUser.idToken)
+    }
+    Button {
+        text: "Update value"
+        onClicked: fbDb.pushValueWithUniqueKey("/random/myData.json", JSON.stringify({"text":"Foo Bar"}), fbAuth.currentUser.idToken)
+    }
+    \endcode
+
+    In the example above, if the value is pushed and then updated, only the text will be updated and "myInt" will remain the same.
+
+    \sa writeValue()
+ */
+void FirebaseDatabase::updateValue(QString dbPath, QString jsonData, QString idToken)
+{
+    const quint64 localWrite = applyLocally("PATCH", dbPath, jsonData.toUtf8());
+    sendRequest("PATCH", dbPath, idToken, jsonData.toUtf8(), [=](const FirebaseResponse &response) {
+        reportError(response, dbPath);
+        updateCache("PATCH", dbPath, idToken, response);
+        settleLocally(localWrite, dbPath, response);
+        emit updateValueFinished();
+    });
+}
+
+
+/*!
+    \qmlmethod void FirebaseDatabase::getValue(string dbPath, string idToken, int requestCode)
+
+    Requests all the data in path \a dbPath with \a idToken if the Firebase Database rules require authentication.
+
+    When the request is successful the signal \l dataRetrieved() is triggered with the
+    contents of the server response atached to the code \a requestCode. The request code
+    provides a way to differentiate where the response comes from, as seen in the example:
+
+    \code
+    FirebaseDatabase {
+        id: fbDb
+        ...
+        onDataRetrieved: { // params (data, requestCode)
+            if(requestCode == 10)
+                console.log(data) // data contains event from Users path
+            else if(requestCode == 20)
+                console.log(data) // data contains event from Alerts path
+        }
+        Component.onCompleted: {
+            fbDb.getValue("/Users/.json", "insert-if-necessary", 10)
+            fbDb.getValue("/Alerts/.json", "insert-if-necessary", 20)
+        }
+    }
+    \endcode
+
+    With a \l {FirebaseApp::memoryBudget}{memory budget}, large responses arrive through \l dataRetrievedToFile() instead.
+
+    \sa dataRetrieved(), dataRetrievedToFile()
+ */
+void FirebaseDatabase::getValue(QString dbPath, QString idToken, int requestCode)
+{
+    // The last known data is delivered right away and the response only emitted again if it differs
+    const QString cacheKey = cacheKeyOf(dbPath, idToken);
+    QSharedPointer<QJsonValue> shown;
+    QJsonValue cached;
+    if(!cacheKey.isEmpty() && FirebaseDataCache::shared()->find(cacheKey, &cached)) {
+        shown.reset(new QJsonValue(cached));
+        QTimer::singleShot(0, this, [=]() {
+            if(!shown->isUndefined())
+                emitRetrieved(DatabaseUtils::serialize(*shown), requestCode);
+        });
+    }
+
+    sendRequest("GET", dbPath, idToken, QByteArray(), [=](const FirebaseResponse &response) {
+        if(response.error != FirebaseError::NoError) {
+            reportError(response, dbPath);
+        } else if(response.bodyFile) {
+            emit dataRetrievedToFile(response.bodyFile->fileName(), response.bodyFile->size(), requestCode);
+        } else if(cacheKey.isEmpty()) {
+            if(m_optimisticWrites && !dbPath.contains('?'))
+                trackServerData(DatabaseUtils::location(dbPath), "put", "/", DatabaseUtils::parse(response.body));
+            emitRetrieved(response.body, requestCode);
+        } else {
+            const QJsonValue value = DatabaseUtils::parse(response.body);
+            FirebaseDataCache::shared()->store(cacheKey, value);
+            trackServerData(DatabaseUtils::location(dbPath), "put", "/", value);
+            if(!shown || *shown != value)
+                emitRetrieved(response.body, requestCode);
+            if(shown)
+                *shown = QJsonValue::Undefined;
+        }
+
+        emit getValueFinished();
+    }, FirebaseTransport::Idempotent | FirebaseTransport::SpillToFile);
+}
+
+/*!
+    \qmlmethod void FirebaseDatabase::deleteValue(string dbPath, string idToken)
+
+    Deletes all data in path \a dbPath with \a idToken if the Firebase Database rules require authentication.
+ */
+void FirebaseDatabase::deleteValue(QString dbPath, QString idToken)
+{
+    const quint64 localWrite = applyLocally("DELETE", dbPath, QByteArray());
+    sendRequest("DELETE", dbPath, idToken, QByteArray(), [=](const FirebaseResponse &response) {
+        reportError(response, dbPath);
+        updateCache("DELETE", dbPath, idToken, response);
+        settleLocally(localWrite, dbPath, response);
+        emit deleteValueFinished();
+    });
+}
+
+
+/*!
+    \qmlproperty string FirebaseDatabase::apiKey
+
+    This property holds the API Key of the Firebase project, obtained from \l FirebaseApp.
+ */
+QString FirebaseDatabase::apiKey() const
+{
+    return m_apiKey;
+}
+
+/*!
+    \qmlproperty string FirebaseDatabase::databaseUrl
+
+    This property holds the database where the Firebase Realtime Database resides, obtained from \l FirebaseApp.
+
+    A URL of the form \c memory://name selects an in process database instead, e.g for devices running disconnected or
+    for tests. It supports the whole API with the same responses and events as the server, security rules and ID tokens
+    are ignored. All FirebaseDatabase objects with the same name, in any thread, share the data until the process ends.
+
+    \code
+    FirebaseDatabase {
+        databaseUrl: offline ? "memory://rig" : fbApp.databaseUrl
+        ...
+    }
+    \endcode
+ */
+QString FirebaseDatabase::databaseUrl() const
+{
+    return m_databaseUrl;
+}
+
+void FirebaseDatabase::setDatabaseUrl(const QString &databaseUrl)
+{
+    m_databaseUrl = databaseUrl;
+}
+
+
+void FirebaseDatabase::setApiKey(const QString &apiKey)
+{
+    m_apiKey = apiKey;
+}
+
+/*!
+    \qmlproperty bool FirebaseDatabase::cacheEnabled
+
+    If true, the last known data of every location read with \l getValue() or \l listenEvents() is kept on disk, in a
+    compact binary form, and delivered right away the next time the location is requested, even after a restart. The
+    server's answer follows as soon as it arrives: \l getValue() only emits \l dataRetrieved() again if the data changed,
+    listeners receive the server data as their first event as usual. Successful writes update the cache too.
+
+    Cached data belongs to the user of the ID token it was read with, so after a sign out or a user switch the data of
+    the previous user is not delivered. Call \l clearCache() on sign out to also remove it from the device. The cache is
+    bounded, see \l setCacheLimits().
+
+    Requests with query parameters, e.g \c shallow or \c orderBy, are never cached. Default is false.
+ */
+bool FirebaseDatabase::cacheEnabled() const
+{
+    return m_cacheEnabled;
+}
+
+void FirebaseDatabase::setCacheEnabled(bool cacheEnabled)
+{
+    if(m_cacheEnabled == cacheEnabled)
+        return;
+
+    m_cacheEnabled = cacheEnabled;
+    emit cacheEnabledChanged();
+}
+
+/*!
+    \qmlmethod void FirebaseDatabase::clearCache()
+
+    Removes the cached data of every user and location, in memory and on disk, e.g when a user signs out.
+
+    \sa cacheEnabled
+ */
+void FirebaseDatabase::clearCache()
+{
+    FirebaseDataCache::shared()->clear();
+}
+
+/*!
+    \qmlmethod void FirebaseDatabase::setCacheLimits(int maxSize, int maxEntries)
+
+    Bounds the data cache of the calling thread to \a maxSize bytes and \a maxEntries locations on disk. The least
+    recently saved locations are removed first. Defaults are 32 MiB and 1000 locations. Only the most recently used
+    locations are also kept decoded in memory.
+ */
+void FirebaseDatabase::setCacheLimits(qint64 maxSize, int maxEntries)
+{
+    FirebaseDataCache *cache = FirebaseDataCache::shared();
+    cache->setMaxSize(maxSize);
+    cache->setMaxEntries(maxEntries);
+}
+
+/*!
+    \qmlproperty FirebaseSessionPool FirebaseDatabase::sessionPool
+
+    Optional pool of authenticated sessions. When set, the idToken argument of every method may also be the id of a
+    session in the pool, and each request is sent with the current ID token of that session. Recursive listeners pick up
+    refreshed tokens whenever they reconnect.
+
+    \sa FirebaseSessionPool
+ */
+FirebaseSessionPool *FirebaseDatabase::sessionPool() const
+{
+    return m_sessionPool;
+}
+
+void FirebaseDatabase::setSessionPool(FirebaseSessionPool *sessionPool)
+{
+    if(m_sessionPool == sessionPool)
+        return;
+
+    m_sessionPool = sessionPool;
+    emit sessionPoolChanged();
+}
+
+/*!
+    \qmlproperty bool FirebaseDatabase::optimisticWrites
+
+    If true, \l writeValue(), \l updateValue(), \l pushValueWithUniqueKey() and \l deleteValue() are applied locally
+    before the request is sent: listeners of this object whose location is affected receive the resulting events
+    right away, as if the server had already accepted the write. The local data is built from the events of the
+    listeners and the responses of \l getValue().
+
+    When the server answers, \l writeConfirmed() is emitted, or, if it rejected the write, the listeners receive the
+    data as it is without the write and \l writeRolledBack() is emitted. Writes made after the rejected one stay
+    applied. Turning this off drops the local data, writes still waiting for the server are then neither confirmed
+    nor rolled back. Default is false.
+ */
+bool FirebaseDatabase::optimisticWrites() const
+{
+    return m_optimisticWrites;
+}
+
+void FirebaseDatabase::setOptimisticWrites(bool optimisticWrites)
+{
+    if(m_optimisticWrites == optimisticWrites)
+        return;
+
+    // The local data is only kept up to date while the flag is set, it is built anew when turned on again
+    m_optimisticWrites = optimisticWrites;
+    if(m_optimisticWrites) {
+        m_localView.reset(new DatabaseUtils::LocalView(m_lastLocalWrite));
+    } else {
+        m_lastLocalWrite = m_localView->lastId();
+        m_localView.reset();
+    }
+    emit optimisticWritesChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseDatabase::eventInterval
+
+    Minimum time in milliseconds between deliveries of listener events. With the default 0 every event is emitted as it
+    arrives. With an interval, e.g 16 to deliver once per frame at 60 Hz, the events of each listener are collected and
+    merged: a value written many times in one interval is delivered once with its latest data, and changes below a
+    location that is replaced anyway are folded into it. Each listener then emits at most one \l dataEvent() per
+    interval, holding all remaining events, and one \l dataSnapshotEvent() per remaining event.
+
+    The data seen after each delivery is the same as with immediate delivery, only intermediate states are skipped.
+    At most 256 events are held per listener; beyond that they are delivered right away. \l eventStatistics() tells
+    how many events were merged.
+ */
+int FirebaseDatabase::eventInterval() const
+{
+    return m_eventInterval;
+}
+
+void FirebaseDatabase::setEventInterval(int eventInterval)
+{
+    eventInterval = qMax(0, eventInterval);
+    if(m_eventInterval == eventInterval)
+        return;
+
+    m_eventInterval = eventInterval;
+    if(m_eventInterval == 0)
+        flushEvents();
+    emit eventIntervalChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseDatabase::dispatchBudget
+
+    Time in milliseconds that listener events may take per event loop iteration, 0 (the default) for no limit.
+    When many events arrive at once, e.g when several listeners reconnect, emitting all of them in one go blocks input
+    handling and rendering for as long as the handlers run. With a budget such as 4, events are emitted until the
+    budget is spent and the rest is delivered in the next iterations, listeners with a higher priority first (see
+    \l setListenerPriority()). One delivery, i.e one \l dataEvent() with its \l dataSnapshotEvent() signals, is never
+    split, so the budget can be exceeded by the handlers of a single delivery.
+
+    \code
+    FirebaseDatabase {
+        id: fbDatabase
+        apiKey: fbApp.apiKey
+        databaseUrl: fbApp.databaseUrl
+        dispatchBudget: 4
+        Component.onCompleted: setListenerPriority(1, 10)     // the visible list before the background sync
+    }
+    \endcode
+ */
+int FirebaseDatabase::dispatchBudget() const
+{
+    return m_dispatchBudget;
+}
+
+void FirebaseDatabase::setDispatchBudget(int dispatchBudget)
+{
+    dispatchBudget = qMax(0, dispatchBudget);
+    if(m_dispatchBudget == dispatchBudget)
+        return;
+
+    m_dispatchBudget = dispatchBudget;
+    if(m_dispatchBudget == 0 && !m_dispatchQueues.isEmpty()) {
+        m_dispatchTimer.stop();
+        drainDispatch();
+    }
+    emit dispatchBudgetChanged();
+}
+
+/*!
+    \qmlmethod void FirebaseDatabase::setListenerPriority(int requestCode, int priority)
+
+    Sets the \a priority of the events of the listener \a requestCode under a \l dispatchBudget. Events of listeners
+    with a higher priority are delivered first, the default priority is 0.
+ */
+void FirebaseDatabase::setListenerPriority(int requestCode, int priority)
+{
+    if(priority == 0)
+        m_listenerPriorities.remove(requestCode);
+    else
+        m_listenerPriorities.insert(requestCode, priority);
+}
+
+/*!
+    \qmlmethod object FirebaseDatabase::eventStatistics()
+
+    Returns the counters of event delivery: \c delivered events, \c merged events that were folded into others,
+    \c pending events waiting for the next interval and \c earlyFlushes, deliveries forced by a full queue.
+    With a \l dispatchBudget, \c dispatchQueued is the number of deliveries waiting for the next event loop iteration
+    and \c dispatchYields how often delivery was interrupted because the budget was spent.
+
+    \sa eventInterval, dispatchBudget
+ */
+QVariantMap FirebaseDatabase::eventStatistics() const
+{
+    int pending = 0;
+    for(const auto &queue : m_pendingEvents)
+        pending += queue->size();
+
+    QVariantMap statistics;
+    statistics["delivered"] = m_eventsDelivered;
+    statistics["merged"] = m_eventsMerged;
+    statistics["pending"] = pending;
+    statistics["earlyFlushes"] = m_earlyFlushes;
+
+    int queued = 0;
+    for(const auto &queue : m_dispatchQueues)
+        queued += queue.size();
+    statistics["dispatchQueued"] = queued;
+    statistics["dispatchYields"] = m_dispatchYields;
+    return statistics;
+}
+
+/*!
+    \qmlsignal FirebaseDatabase::writeConfirmed(string dbPath)
+
+    Emitted with \l optimisticWrites when the server accepted the write to \a dbPath.
+ */
+
+/*!
+    \qmlsignal FirebaseDatabase::writeRolledBack(string dbPath, string error, FirebaseError::Code code)
+
+    Emitted with \l optimisticWrites when the server rejected the write to \a dbPath, after the listeners received the
+    corrected data. \l errorOcurred() is emitted as well.
+ */
+
+void FirebaseDatabase::addListener(const QString &location, int requestCode)
+{
+    const Listener listener {location, requestCode};
+    if(!m_listeners.contains(listener))
+        m_listeners.append(listener);
+}
+
+void FirebaseDatabase::removeListener(const QString &location, int requestCode)
+{
+    m_listeners.removeOne(Listener {location, requestCode});
+}
+
+// Keeps the local view in sync with what a listener on location was told by the server
+void FirebaseDatabase::trackServerData(const QString &location, const QByteArray &event, const QString &path, const QJsonValue &data)
+{
+    if(!m_optimisticWrites)
+        return;
+
+    m_localView->serverData(path == "/" ? location : (location == "/" ? path : location + path), event, data);
+}
+
+// Applies a write to the local view and tells the listeners right away, returns the id to settle it with
+quint64 FirebaseDatabase::applyLocally(const QByteArray &verb, const QString &dbPath, const QByteArray &body)
+{
+    if(!m_optimisticWrites || dbPath.contains('?'))
+        return 0;
+
+    const QString location = DatabaseUtils::location(dbPath);
+    const QJsonValue data = verb == "DELETE" ? QJsonValue(QJsonValue::Null) : DatabaseUtils::parse(body);
+    const quint64 id = m_localView->addWrite(verb, location, data);
+
+    notifyListeners(verb == "PATCH" ? "patch" : "put", location, data);
+    return id;
+}
+
+void FirebaseDatabase::settleLocally(quint64 id, const QString &dbPath, const FirebaseResponse &response)
+{
+    if(id == 0 || !m_localView)
+        return;
+
+    // Writes made before optimisticWrites was last turned off are not in the view
+    if(response.error == FirebaseError::NoError) {
+        if(m_localView->confirm(id))
+            emit writeConfirmed(dbPath);
+        return;
+    }
+
+    // Listeners see the location as it is without the rejected write
+    if(!m_localView->reject(id))
+        return;
+    const QString location = DatabaseUtils::location(dbPath);
+    notifyListeners("put", location, DatabaseUtils::valueAt(m_localView->root(), location));
+    emit writeRolledBack(dbPath, response.errorString, response.error);
+}
+
+void FirebaseDatabase::notifyListeners(const QByteArray &event, const QString &path, const QJsonValue &data)
+{
+    const QJsonValue root = m_localView->root();
+
+    for(const Listener &listener : qAsConst(m_listeners)) {
+        QByteArray listenerEvent = event;
+        QString listenerPath = path;
+        QJsonValue listenerData = data;
+        if(DatabaseUtils::eventFor(listener.location, root, &listenerEvent, &listenerPath, &listenerData))
+            deliverEvent(listener.location, listenerEvent, listenerPath, listenerData, listener.requestCode);
+    }
+}
+
+// Cache entry of dbPath as read with idToken, empty if it is not cached. Entries are kept per user, so the data of a
+// previous user is never delivered after a sign out or a user switch.
+QString FirebaseDatabase::cacheKeyOf(const QString &dbPath, const QString &idToken) const
+{
+    if(!m_cacheEnabled || dbPath.contains('?') || FirebaseMemoryBackend::handles(m_databaseUrl))
+        return QString();
+
+    const QString token = m_sessionPool && m_sessionPool->contains(idToken) ? m_sessionPool->idToken(idToken) : idToken;
+    const QString userId = JwtUtils::payload(token)["sub"].toString();
+
+    QString databaseUrl = m_databaseUrl;
+    while(databaseUrl.endsWith('/'))
+        databaseUrl.chop(1);
+    return userId + '@' + databaseUrl + DatabaseUtils::location(dbPath);
+}
+
+// Mirrors a successful write in the cached data of that location
+void FirebaseDatabase::updateCache(const QByteArray &verb, const QString &dbPath, const QString &idToken, const FirebaseResponse &response)
+{
+    const QString cacheKey = cacheKeyOf(dbPath, idToken);
+    if(cacheKey.isEmpty() || response.error != FirebaseError::NoError)
+        return;
+
+    FirebaseDataCache *cache = FirebaseDataCache::shared();
+    if(verb == "DELETE") {
+        cache->remove(cacheKey);
+        return;
+    }
+
+    // The server answers a write with the data written
+    QJsonValue value;
+    if(verb == "PUT")
+        cache->store(cacheKey, DatabaseUtils::parse(response.body));
+    else if(cache->find(cacheKey, &value))
+        cache->store(cacheKey, DatabaseUtils::patchAt(value, "/", DatabaseUtils::parse(response.body).toObject()));
+}
+
+QUrl FirebaseDatabase::requestUrl(const QString &dbPath, const QString &sessionOrToken) const
+{
+    QUrl url = m_databaseUrl + dbPath;
+
+    // Route requests made on behalf of a pooled session with that session's current token
+    const QString idToken = m_sessionPool && m_sessionPool->contains(sessionOrToken) ? m_sessionPool->idToken(sessionOrToken) : sessionOrToken;
+
+    // Check if idToken was passed
+    if(!idToken.isEmpty()) {
+        QUrlQuery query;
+        query.addQueryItem("auth", idToken);
+        url.setQuery(query);
+    }
+
+    return url;
+}
+
+quint64 FirebaseDatabase::sendRequest(const QByteArray &verb, const QString &dbPath, const QString &idToken, const QByteArray &body,
+                                      FirebaseTransport::Callback callback, FirebaseTransport::Options options)
+{
+    if(FirebaseMemoryBackend::handles(m_databaseUrl)) {
+        // Answered right away, but delivered from the event loop like a response from the network
+        const FirebaseResponse response = FirebaseMemoryBackend::instance()->request(m_databaseUrl, verb, dbPath, body);
+        QMetaObject::invokeMethod(this, [callback, response]() {
+            callback(response);
+        }, Qt::QueuedConnection);
+        return 0;
+    }
+
+    QNetworkRequest request(requestUrl(dbPath, idToken));
+    if(!body.isEmpty())
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+
+    return m_transport->send(verb, request, body, this, callback, options);
+}
+
+// Listener on the in process database, producing the same events the server would send
+void FirebaseDatabase::listenMemory(const QString &dbPath, int requestCode, bool ignoreFirstEvent, const QSharedPointer<bool> &active)
+{
+    FirebaseMemoryBackend *backend = FirebaseMemoryBackend::instance();
+    const QString database = FirebaseMemoryBackend::databaseName(m_databaseUrl);
+    const QString location = DatabaseUtils::location(dbPath);
+    addListener(location, requestCode);
+
+    // The value the listener starts from, delivered before any later write whichever arrives first
+    struct Start { QJsonValue value; quint64 revision = 0; bool pending = false; };
+    const QSharedPointer<Start> start(new Start);
+    const auto deliverStart = [=]() {
+        if(!start->pending || !*active)
+            return;
+        start->pending = false;
+        deliverEvent(location, "put", "/", start->value, requestCode);
+        start->value = QJsonValue();
+    };
+
+    // Queued even within one thread, so events arrive from the event loop like network events. Connected before the
+    // value is read so no write is missed, the ones the value already contains are skipped by their revision
+    const QMetaObject::Connection connection = connect(backend, &FirebaseMemoryBackend::changed, this, [=](const QString &changedDatabase, QByteArray event, QString path,
+                                                               QJsonValue data, const QJsonValue &root, quint64 revision) {
+        if(changedDatabase != database || !*active || revision <= start->revision)
+            return;
+
+        deliverStart();
+        if(!DatabaseUtils::eventFor(location, root, &event, &path, &data))
+            return;
+
+        trackServerData(location, event, path, data);
+        deliverEvent(location, event, path, data, requestCode);
+    }, Qt::QueuedConnection);
+    m_memoryListeners.insert(requestCode, connection);
+
+    start->value = backend->value(m_databaseUrl, location, &start->revision);
+    start->pending = !ignoreFirstEvent;
+    if(start->pending)
+        QMetaObject::invokeMethod(this, deliverStart, Qt::QueuedConnection);
+}
+
+// Emits an event to the receivers of listener requestCode on location, or queues it when events are coalesced
+void FirebaseDatabase::deliverEvent(const QString &location, const QByteArray &event, const QString &path, const QJsonValue &data, int requestCode)
+{
+    if(m_eventInterval <= 0) {
+        dispatchEvents({DatabaseUtils::Event {event, path, data}}, requestCode);
+        return;
+    }
+
+    QSharedPointer<DatabaseUtils::EventQueue> &queue = m_pendingEvents[qMakePair(location, requestCode)];
+    if(!queue)
+        queue.reset(new DatabaseUtils::EventQueue);
+
+    if(queue->add(event, path, data))
+        ++m_eventsMerged;
+
+    // A full queue is delivered early, so memory stays bounded when events touch many different paths
+    if(queue->size() >= maxQueuedEvents) {
+        ++m_earlyFlushes;
+        dispatchEvents(queue->take(), requestCode);
+        return;
+    }
+
+    if(!m_eventTimer.isActive())
+        m_eventTimer.start(m_eventInterval);
+}
+
+void FirebaseDatabase::flushEvents()
+{
+    // Delivery may start new listeners or writes, which queue into a fresh set
+    const auto pending = m_pendingEvents;
+    m_pendingEvents.clear();
+
+    for(auto it = pending.cbegin(); it != pending.cend(); ++it)
+        dispatchEvents(it.value()->take(), it.key().second);
+}
+
+// Hands events to emitEvents(), right away or, with a dispatch budget, through the queue drained by drainDispatch()
+void FirebaseDatabase::dispatchEvents(const QList<DatabaseUtils::Event> &events, int requestCode)
+{
+    if(events.isEmpty())
+        return;
+
+    if(m_dispatchBudget <= 0) {
+        emitEvents(events, requestCode);
+        return;
+    }
+
+    m_dispatchQueues[requestCode].enqueue(Dispatch {m_nextDispatch++, events});
+    if(!m_dispatchTimer.isActive())
+        m_dispatchTimer.start();
+}
+
+/*
+    Emits queued events until the budget of this event loop iteration is spent, then yields so input and rendering
+    are handled before the rest. The listener with the highest priority goes first, listeners of equal priority take
+    turns in arrival order. Events of one listener always keep their order.
+*/
+void FirebaseDatabase::drainDispatch()
+{
+    QElapsedTimer clock;
+    clock.start();
+    const qint64 budget = static_cast<qint64>(m_dispatchBudget) * 1000000;
+
+    while(!m_dispatchQueues.isEmpty()) {
+        auto next = m_dispatchQueues.begin();
+        for(auto it = m_dispatchQueues.begin(); it != m_dispatchQueues.end(); ++it) {
+            const int priority = m_listenerPriorities.value(it.key());
+            const int nextPriority = m_listenerPriorities.value(next.key());
+            if(priority > nextPriority || (priority == nextPriority && it->head().sequence < next->head().sequence))
+                next = it;
+        }
+
+        const int requestCode = next.key();
+        const QList<DatabaseUtils::Event> events = next->dequeue().events;
+        if(next->isEmpty())
+            m_dispatchQueues.erase(next);
+
+        emitEvents(events, requestCode);
+
+        if(budget > 0 && clock.nsecsElapsed() >= budget)
+            break;
+    }
+
+    if(!m_dispatchQueues.isEmpty()) {
+        ++m_dispatchYields;
+        m_dispatchTimer.start();
+    }
+}
+
+// All events go out in one dataEvent, formatted as server-sent events, and one dataSnapshotEvent each
+void FirebaseDatabase::emitEvents(const QList<DatabaseUtils::Event> &events, int requestCode)
+{
+    if(events.isEmpty())
+        return;
+
+    QByteArray stream;
+    for(const DatabaseUtils::Event &event : events) {
+        const QJsonObject payload {{"path", event.path}, {"data", event.data}};
+        stream += "event: " + event.name + "\ndata: " + DatabaseUtils::serialize(payload) + "\n\n";
+    }
+
+    m_eventsDelivered += events.size();
+    emit dataEvent(stream, requestCode);
+
+    if(isSignalConnected(QMetaMethod::fromSignal(&FirebaseDatabase::dataSnapshotEvent))) {
+        for(const DatabaseUtils::Event &event : events)
+            emit dataSnapshotEvent(QString::fromUtf8(event.name), event.path, FirebaseDataSnapshot(event.path.section('/', -1), event.data), requestCode);
+    }
+}
+
+void FirebaseDatabase::emitRetrieved(const QByteArray &data, int requestCode)
+{
+    emit dataRetrieved(data, requestCode);
+
+    if(isSignalConnected(QMetaMethod::fromSignal(&FirebaseDatabase::dataSnapshotRetrieved)))
+        emit dataSnapshotRetrieved(FirebaseDataSnapshot::fromJson(data), requestCode);
+}
+
+void FirebaseDatabase::reportError(const FirebaseResponse &response, const QString &dbPath)
+{
+    if(response.error != FirebaseError::NoError)
+        emit errorOcurred(response.errorString, response.error, dbPath);
+}
+
+#ifdef FIREBASE_HAS_COROUTINES
+/*
+    Coroutine counterparts of the slots for C++ callers. Parameters are taken by value because they must stay alive
+    in the coroutine frame until the request completes. Listening to events stays signal based since it is a stream.
+*/
+FirebaseTask<FirebaseResponse> FirebaseDatabase::requestAsync(QByteArray verb, QString dbPath, QString idToken, QByteArray body,
+                                                              FirebaseRequestOptions options, FirebaseTransport::Options transportOptions)
+{
+    co_return co_await FirebaseRequestAwaiter(m_transport, this, [&](FirebaseTransport::Callback done) {
+        return sendRequest(verb, dbPath, idToken, body, done, transportOptions);
+    }, options);
+}
+
+FirebaseTask<FirebaseResponse> FirebaseDatabase::getValueAsync(QString dbPath, QString idToken, FirebaseRequestOptions options)
+{
+    return requestAsync("GET", dbPath, idToken, QByteArray(), options);
+}
+
+FirebaseTask<FirebaseResponse> FirebaseDatabase::writeValueAsync(QString dbPath, QByteArray jsonData, QString idToken, FirebaseRequestOptions options)
+{
+    return requestAsync("PUT", dbPath, idToken, jsonData, options);
+}
+
+FirebaseTask<FirebaseResponse> FirebaseDatabase::updateValueAsync(QString dbPath, QByteArray jsonData, QString idToken, FirebaseRequestOptions options)
+{
+    return requestAsync("PATCH", dbPath, idToken, jsonData, options);
+}
+
+// Written with a retry safe PUT to a local key, the response carries the key in "name" like the answer to a POST
+FirebaseTask<FirebaseResponse> FirebaseDatabase::pushValueAsync(QString dbPath, QByteArray jsonData, QString idToken, FirebaseRequestOptions options)
+{
+    const QString key = pushId();
+    FirebaseResponse response = co_await requestAsync("PUT", DatabaseUtils::childPath(dbPath, key), idToken, jsonData, options);
+    if(response.error == FirebaseError::NoError)
+        response.body = DatabaseUtils::serialize(QJsonObject {{"name", key}});
+
+    co_return response;
+}
+
+FirebaseTask<FirebaseResponse> FirebaseDatabase::deleteValueAsync(QString dbPath, QString idToken, FirebaseRequestOptions options)
+{
+    return requestAsync("DELETE", dbPath, idToken, QByteArray(), options);
+}
+#endif
@@ -1,51 +1,164 @@
-#ifndef FIREBASEDATABASE_H
-#define FIREBASEDATABASE_H
-
-#include <QObject>
-#include <QNetworkAccessManager>
-#include <QJSValue>
-
-class FirebaseDatabase : public QObject
-{
-    Q_OBJECT
-    Q_PROPERTY(QString apiKey READ apiKey WRITE setApiKey REQUIRED)
-    Q_PROPERTY(QString databaseUrl READ databaseUrl WRITE setDatabaseUrl REQUIRED)
-
-public:
-    explicit FirebaseDatabase(QObject *parent = nullptr);
-
-public slots:
-    void listenEvents(QString dbPath, QString idToken, int requestCode, bool ignoreFirstEvent = true, bool recursive = false);
-    void pushValueWithUniqueKey(QString dbPath, QString jsonData, QString idToken);
-    void writeValue(QString dbPath, QString jsonData, QString idToken);
-    void updateValue(QString dbPath, QString jsonData, QString idToken);
-    void getValue(QString dbPath, QString idToken, int requestCode);
-    void deleteValue(QString dbPath, QString idToken);
-
-signals:
-    void dataRetrieved(QByteArray data, int requestCode);
-    void dataEvent(QByteArray data, int requestCode);
-
-    // Signals for when operations are finished
-    void getValueFinished();
-    void updateValueFinished();
-    void writeValueFinished();
-    void pushValueFinished();
-    void deleteValueFinished();
-
-private:
-    QString apiKey() const;
-    void setApiKey(const QString &apiKey);
-
-    QString databaseUrl() const;
-    void setDatabaseUrl(const QString &databaseUrl);
-
-
-private:
-    QString m_apiKey;
-    QString m_databaseUrl;
-    QNetworkAccessManager m_manager;
-
-};
-
-#endif // FIREBASEDATABASE_H
+#ifndef FIREBASEDATABASE_H
+#define FIREBASEDATABASE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVariantMap>
+#include <QQueue>
+#include "firebasetransport.h"
+#include "firebasesessionpool.h"
+#include "firebasetask.h"
+#include "firebasedatasnapshot.h"
+
+namespace DatabaseUtils {
+class LocalView;
+class EventQueue;
+struct Event;
+}
+
+class FirebaseDatabase : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString apiKey READ apiKey WRITE setApiKey REQUIRED)
+    Q_PROPERTY(QString databaseUrl READ databaseUrl WRITE setDatabaseUrl REQUIRED)
+    Q_PROPERTY(FirebaseSessionPool* sessionPool READ sessionPool WRITE setSessionPool NOTIFY sessionPoolChanged)
+    Q_PROPERTY(bool cacheEnabled READ cacheEnabled WRITE setCacheEnabled NOTIFY cacheEnabledChanged)
+    Q_PROPERTY(bool optimisticWrites READ optimisticWrites WRITE setOptimisticWrites NOTIFY optimisticWritesChanged)
+    Q_PROPERTY(int eventInterval READ eventInterval WRITE setEventInterval NOTIFY eventIntervalChanged)
+    Q_PROPERTY(int dispatchBudget READ dispatchBudget WRITE setDispatchBudget NOTIFY dispatchBudgetChanged)
+
+public:
+    explicit FirebaseDatabase(QObject *parent = nullptr);
+    ~FirebaseDatabase();
+
+    QString apiKey() const;
+    void setApiKey(const QString &apiKey);
+
+    QString databaseUrl() const;
+    void setDatabaseUrl(const QString &databaseUrl);
+
+    FirebaseSessionPool *sessionPool() const;
+    void setSessionPool(FirebaseSessionPool *sessionPool);
+
+    bool cacheEnabled() const;
+    void setCacheEnabled(bool cacheEnabled);
+
+    bool optimisticWrites() const;
+    void setOptimisticWrites(bool optimisticWrites);
+
+    int eventInterval() const;
+    void setEventInterval(int eventInterval);
+
+    int dispatchBudget() const;
+    void setDispatchBudget(int dispatchBudget);
+
+    Q_INVOKABLE void setListenerPriority(int requestCode, int priority);
+    Q_INVOKABLE QString pushId() const;
+    Q_INVOKABLE QVariantMap eventStatistics() const;
+    Q_INVOKABLE void clearCache();
+    Q_INVOKABLE void setCacheLimits(qint64 maxSize, int maxEntries);
+
+#ifdef FIREBASE_HAS_COROUTINES
+    // Awaitable one shot operations, they report through the returned response only and emit no signals
+    FirebaseTask<FirebaseResponse> getValueAsync(QString dbPath, QString idToken, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> writeValueAsync(QString dbPath, QByteArray jsonData, QString idToken, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> updateValueAsync(QString dbPath, QByteArray jsonData, QString idToken, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> pushValueAsync(QString dbPath, QByteArray jsonData, QString idToken, FirebaseRequestOptions options = {});
+    FirebaseTask<FirebaseResponse> deleteValueAsync(QString dbPath, QString idToken, FirebaseRequestOptions options = {});
+#endif
+
+public slots:
+    void listenEvents(QString dbPath, QString idToken, int requestCode, bool ignoreFirstEvent = true, bool recursive = false);
+    void stopListening(int requestCode);
+    QString pushValueWithUniqueKey(QString dbPath, QString jsonData, QString idToken);
+    void writeValue(QString dbPath, QString jsonData, QString idToken);
+    void updateValue(QString dbPath, QString jsonData, QString idToken);
+    void getValue(QString dbPath, QString idToken, int requestCode);
+    void deleteValue(QString dbPath, QString idToken);
+
+signals:
+    void dataRetrieved(QByteArray data, int requestCode);
+    void dataRetrievedToFile(QString filePath, qint64 size, int requestCode);
+    void dataEvent(QByteArray data, int requestCode);
+    void dataSnapshotRetrieved(FirebaseDataSnapshot snapshot, int requestCode);
+    void dataSnapshotEvent(QString event, QString path, FirebaseDataSnapshot snapshot, int requestCode);
+    void errorOcurred(QString error, FirebaseError::Code code, QString dbPath);
+    void sessionPoolChanged();
+    void cacheEnabledChanged();
+    void optimisticWritesChanged();
+    void eventIntervalChanged();
+    void dispatchBudgetChanged();
+    void writeConfirmed(QString dbPath);
+    void writeRolledBack(QString dbPath, QString error, FirebaseError::Code code);
+
+    // Signals for when operations are finished
+    void getValueFinished();
+    void updateValueFinished();
+    void writeValueFinished();
+    void pushValueFinished();
+    void deleteValueFinished();
+
+private:
+    QUrl requestUrl(const QString &dbPath, const QString &sessionOrToken) const;
+    quint64 sendRequest(const QByteArray &verb, const QString &dbPath, const QString &idToken, const QByteArray &body,
+                        FirebaseTransport::Callback callback, FirebaseTransport::Options options = FirebaseTransport::Idempotent);
+    struct Listener {
+        QString location;
+        int requestCode;
+        bool operator==(const Listener &other) const { return location == other.location && requestCode == other.requestCode; }
+    };
+
+    void addListener(const QString &location, int requestCode);
+    void removeListener(const QString &location, int requestCode);
+    void trackServerData(const QString &location, const QByteArray &event, const QString &path, const QJsonValue &data);
+    quint64 applyLocally(const QByteArray &verb, const QString &dbPath, const QByteArray &body);
+    void settleLocally(quint64 id, const QString &dbPath, const FirebaseResponse &response);
+    void notifyListeners(const QByteArray &event, const QString &path, const QJsonValue &data);
+    QString cacheKeyOf(const QString &dbPath, const QString &idToken) const;
+    void updateCache(const QByteArray &verb, const QString &dbPath, const QString &idToken, const FirebaseResponse &response);
+    void listenMemory(const QString &dbPath, int requestCode, bool ignoreFirstEvent, const QSharedPointer<bool> &active);
+    void deliverEvent(const QString &location, const QByteArray &event, const QString &path, const QJsonValue &data, int requestCode);
+    void flushEvents();
+    void dispatchEvents(const QList<DatabaseUtils::Event> &events, int requestCode);
+    void drainDispatch();
+    void emitEvents(const QList<DatabaseUtils::Event> &events, int requestCode);
+    void emitRetrieved(const QByteArray &data, int requestCode);
+    void reportError(const FirebaseResponse &response, const QString &dbPath);
+#ifdef FIREBASE_HAS_COROUTINES
+    FirebaseTask<FirebaseResponse> requestAsync(QByteArray verb, QString dbPath, QString idToken, QByteArray body,
+                                                FirebaseRequestOptions options, FirebaseTransport::Options transportOptions = FirebaseTransport::Idempotent);
+#endif
+
+private:
+    QString m_apiKey;
+    QString m_databaseUrl;
+    FirebaseTransport *m_transport;
+    QPointer<FirebaseSessionPool> m_sessionPool;
+    bool m_cacheEnabled = false;
+    bool m_optimisticWrites = false;
+    QSharedPointer<DatabaseUtils::LocalView> m_localView;
+    quint64 m_lastLocalWrite = 0;
+    QList<Listener> m_listeners;
+    QMultiHash<int, QPointer<QNetworkReply>> m_listenerReplies;
+    QMultiHash<int, QMetaObject::Connection> m_memoryListeners;
+    QHash<int, QSharedPointer<bool>> m_activeListeners;
+
+    int m_eventInterval = 0;
+    QTimer m_eventTimer;
+    QHash<QPair<QString, int>, QSharedPointer<DatabaseUtils::EventQueue>> m_pendingEvents;
+    qint64 m_eventsDelivered = 0;
+    qint64 m_eventsMerged = 0;
+    qint64 m_earlyFlushes = 0;
+
+    struct Dispatch;
+    int m_dispatchBudget = 0;
+    QTimer m_dispatchTimer;
+    QHash<int, QQueue<Dispatch>> m_dispatchQueues;
+    QHash<int, int> m_listenerPriorities;
+    quint64 m_nextDispatch = 0;
+    qint64 m_dispatchYields = 0;
+
+};
+
+#endif // FIREBASEDATABASE_H
@@ -0,0 +1,309 @@
+#include <QCborMap>
+#include <QCborValue>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadStorage>
+#include "firebasedatacache.h"
+#include "utils/DatabaseUtils.h"
+
+namespace {
+
+const int saveDelay = 500;
+const int maxMemoryEntries = 64;
+const qint64 defaultMaxSize = 32 * 1024 * 1024;
+const int defaultMaxEntries = 1000;
+
+}
+
+/*
+    Every location is stored in its own file, named after the hash of its key, as a CBOR map holding the key, the time
+    it was saved and the value. At startup a file is memory mapped and decoded straight from the mapping, no copy of
+    the raw data is made. The maxMemoryEntries most recently used values stay in memory, and changes are written back
+    after a short delay so a stream of events is saved at most every saveDelay ms. The size of every file is tracked from
+    a single listing of the directory, and only once the directory exceeds maxSize bytes or maxEntries files the least
+    recently saved files are removed until it is within both again.
+*/
+FirebaseDataCache::FirebaseDataCache(QObject *parent) : QObject(parent),
+    m_maxSize(defaultMaxSize),
+    m_maxEntries(defaultMaxEntries)
+{
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(saveDelay);
+    connect(&m_saveTimer, &QTimer::timeout, this, &FirebaseDataCache::save);
+
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if(!cacheDir.isEmpty())
+        m_directory = cacheDir + "/firebase/database";
+}
+
+// Cache shared by all FirebaseDatabase objects living in the calling thread
+FirebaseDataCache *FirebaseDataCache::shared()
+{
+    static QThreadStorage<FirebaseDataCache *> caches;
+    if(!caches.hasLocalData())
+        caches.setLocalData(new FirebaseDataCache);
+
+    return caches.localData();
+}
+
+FirebaseDataCache::~FirebaseDataCache()
+{
+    if(m_saveTimer.isActive())
+        save();
+}
+
+QString FirebaseDataCache::directory() const
+{
+    return m_directory;
+}
+
+void FirebaseDataCache::setDirectory(const QString &directory)
+{
+    if(m_saveTimer.isActive())
+        save();
+
+    m_directory = directory;
+    m_values.clear();
+    m_recent.clear();
+    m_fileSizes.clear();
+    m_totalSize = 0;
+    m_indexed = false;
+}
+
+qint64 FirebaseDataCache::maxSize() const
+{
+    return m_maxSize;
+}
+
+void FirebaseDataCache::setMaxSize(qint64 maxSize)
+{
+    m_maxSize = qMax<qint64>(0, maxSize);
+    prune();
+}
+
+int FirebaseDataCache::maxEntries() const
+{
+    return m_maxEntries;
+}
+
+void FirebaseDataCache::setMaxEntries(int maxEntries)
+{
+    m_maxEntries = qMax(0, maxEntries);
+    prune();
+}
+
+// Last known value of the location key, i.e the user id, the database URL and the location
+bool FirebaseDataCache::find(const QString &key, QJsonValue *value)
+{
+    const auto it = m_values.constFind(key);
+    if(it != m_values.cend()) {
+        *value = *it;
+        touch(key);
+        return true;
+    }
+
+    if(!load(key, value))
+        return false;
+
+    m_values.insert(key, *value);
+    touch(key);
+    return true;
+}
+
+void FirebaseDataCache::store(const QString &key, const QJsonValue &value)
+{
+    m_values.insert(key, value);
+    m_dirty.insert(key);
+    touch(key);
+    scheduleSave();
+}
+
+// Applies a put or patch event of a listener on key to the cached value, if there is one
+void FirebaseDataCache::apply(const QString &key, const QByteArray &event, const QString &path, const QJsonValue &data)
+{
+    QJsonValue value;
+    const bool cached = find(key, &value);
+
+    if(event == "put") {
+        // A put on the root replaces everything, which is how listeners start
+        if(!cached && path != "/")
+            return;
+        store(key, DatabaseUtils::setAt(value, path, data));
+    } else if(event == "patch" && cached) {
+        store(key, DatabaseUtils::patchAt(value, path, data.toObject()));
+    }
+}
+
+void FirebaseDataCache::remove(const QString &key)
+{
+    m_values.remove(key);
+    m_dirty.remove(key);
+    m_recent.removeOne(key);
+    if(!m_directory.isEmpty() && QFile::remove(fileName(key)))
+        track(entryName(key), -1);
+}
+
+// Forgets every cached value, in memory and on disk
+void FirebaseDataCache::clear()
+{
+    m_saveTimer.stop();
+    m_values.clear();
+    m_dirty.clear();
+    m_recent.clear();
+    m_fileSizes.clear();
+    m_totalSize = 0;
+
+    if(m_directory.isEmpty())
+        return;
+
+    QDir dir(m_directory);
+    for(const QString &name : dir.entryList({QStringLiteral("*.cbor")}, QDir::Files))
+        dir.remove(name);
+    m_indexed = true;
+}
+
+QString FirebaseDataCache::entryName(const QString &key)
+{
+    return QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex() + ".cbor";
+}
+
+QString FirebaseDataCache::fileName(const QString &key) const
+{
+    return m_directory + "/" + entryName(key);
+}
+
+bool FirebaseDataCache::load(const QString &key, QJsonValue *value) const
+{
+    if(m_directory.isEmpty())
+        return false;
+
+    QFile file(fileName(key));
+    if(!file.open(QIODevice::ReadOnly) || file.size() == 0)
+        return false;
+
+    uchar *mapped = file.map(0, file.size());
+    const QByteArray data = mapped ? QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), static_cast<int>(file.size()))
+                                   : file.readAll();
+
+    // Decoding copies what it keeps, the mapping is not needed afterwards
+    const QCborMap entry = QCborValue::fromCbor(data).toMap();
+    if(mapped)
+        file.unmap(mapped);
+
+    if(entry.value(QStringLiteral("k")).toString() != key)
+        return false;
+
+    *value = entry.value(QStringLiteral("v")).toJsonValue();
+    return true;
+}
+
+// Marks key as the most recently used value and drops the least recently used ones from memory, unless still unsaved
+void FirebaseDataCache::touch(const QString &key)
+{
+    m_recent.removeOne(key);
+    m_recent.append(key);
+
+    for(int i = 0; m_recent.size() > maxMemoryEntries && i < m_recent.size();) {
+        const QString &oldest = m_recent.at(i);
+        if(m_dirty.contains(oldest)) {
+            ++i;
+            continue;
+        }
+        m_values.remove(oldest);
+        m_recent.removeAt(i);
+    }
+}
+
+void FirebaseDataCache::scheduleSave()
+{
+    if(!m_directory.isEmpty() && !m_saveTimer.isActive())
+        m_saveTimer.start();
+}
+
+void FirebaseDataCache::save()
+{
+    m_saveTimer.stop();
+    if(m_directory.isEmpty())
+        return;
+
+    QDir().mkpath(m_directory);
+    index();
+
+    for(const QString &key : qAsConst(m_dirty)) {
+        QCborMap entry;
+        entry.insert(QStringLiteral("k"), key);
+        entry.insert(QStringLiteral("t"), QDateTime::currentMSecsSinceEpoch());
+        entry.insert(QStringLiteral("v"), QCborValue::fromJsonValue(m_values.value(key)));
+
+        const QByteArray data = entry.toCborValue().toCbor();
+        QSaveFile file(fileName(key));
+        if(file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit())
+            track(entryName(key), data.size());
+    }
+
+    m_dirty.clear();
+    prune();
+
+    // Values kept only because they were unsaved can go now
+    if(!m_recent.isEmpty())
+        touch(m_recent.constLast());
+}
+
+// Sizes of the files already on disk, listed once per directory so that saving does not have to list it again
+void FirebaseDataCache::index()
+{
+    if(m_indexed || m_directory.isEmpty())
+        return;
+
+    m_indexed = true;
+    m_fileSizes.clear();
+    m_totalSize = 0;
+    for(const QFileInfo &file : QDir(m_directory).entryInfoList({QStringLiteral("*.cbor")}, QDir::Files))
+        track(file.fileName(), file.size());
+}
+
+// Records the new size of the file name, -1 if it was removed
+void FirebaseDataCache::track(const QString &name, qint64 size)
+{
+    if(!m_indexed)
+        return;
+
+    m_totalSize -= m_fileSizes.value(name);
+    if(size < 0) {
+        m_fileSizes.remove(name);
+    } else {
+        m_fileSizes.insert(name, size);
+        m_totalSize += size;
+    }
+}
+
+void FirebaseDataCache::prune()
+{
+    if(m_directory.isEmpty())
+        return;
+
+    index();
+    if(m_totalSize <= m_maxSize && m_fileSizes.size() <= m_maxEntries)
+        return;
+
+    QDir dir(m_directory);
+    const QFileInfoList files = dir.entryInfoList({QStringLiteral("*.cbor")}, QDir::Files, QDir::Time);
+
+    // Newest first, everything past the limits goes. The listing also corrects the tracked sizes
+    m_fileSizes.clear();
+    m_totalSize = 0;
+    qint64 size = 0;
+    for(int i = 0; i < files.size(); ++i) {
+        const QFileInfo &file = files.at(i);
+        size += file.size();
+        if(i >= m_maxEntries || size > m_maxSize)
+            dir.remove(file.fileName());
+        else
+            track(file.fileName(), file.size());
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef FIREBASEDATACACHE_H
+#define FIREBASEDATACACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QTimer>
+#include <QJsonValue>
+
+// Last known data of database locations, kept on disk in CBOR so it can be shown before the server answers
+class FirebaseDataCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FirebaseDataCache(QObject *parent = nullptr);
+    ~FirebaseDataCache();
+
+    static FirebaseDataCache *shared();
+
+    QString directory() const;
+    void setDirectory(const QString &directory);
+
+    bool find(const QString &key, QJsonValue *value);
+    void store(const QString &key, const QJsonValue &value);
+    void apply(const QString &key, const QByteArray &event, const QString &path, const QJsonValue &data);
+    void remove(const QString &key);
+    void clear();
+
+    qint64 maxSize() const;
+    void setMaxSize(qint64 maxSize);
+    int maxEntries() const;
+    void setMaxEntries(int maxEntries);
+
+private:
+    static QString entryName(const QString &key);
+    QString fileName(const QString &key) const;
+    bool load(const QString &key, QJsonValue *value) const;
+    void touch(const QString &key);
+    void scheduleSave();
+    void save();
+    void index();
+    void track(const QString &name, qint64 size);
+    void prune();
+
+    QString m_directory;
+    QHash<QString, QJsonValue> m_values;
+    QSet<QString> m_dirty;
+    QList<QString> m_recent;
+    QHash<QString, qint64> m_fileSizes;     // Size of every file in the directory by name, once indexed
+    qint64 m_totalSize = 0;
+    bool m_indexed = false;
+    qint64 m_maxSize;
+    int m_maxEntries;
+    QTimer m_saveTimer;
+};
+
+#endif // FIREBASEDATACACHE_H
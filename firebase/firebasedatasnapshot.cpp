@@ -0,0 +1,182 @@
+#include <QJsonObject>
+#include <QJsonArray>
+#include "firebasedatasnapshot.h"
+#include "utils/DatabaseUtils.h"
+#include "utils/JsonUtils.h"
+
+/*!
+    \qmltype FirebaseDataSnapshot
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Immutable, parsed value of a database location.
+
+    Snapshots are delivered by \l FirebaseDatabase::dataSnapshotRetrieved() and \l FirebaseDatabase::dataSnapshotEvent().
+    The response is parsed once; every receiver gets a reference to the same tree, and \l child() only points into it
+    without copying. Plain JavaScript values are only built when \l value or \l toVariant() is accessed.
+
+    Large responses and events are not even turned into a tree: only the positions of their values in the received
+    text are recorded, using SIMD instructions where available. \l child(), \l keys() and \l childrenCount then work
+    on the text, and only the parts that are actually read are converted.
+
+    \code
+    FirebaseDatabase {
+        onDataSnapshotRetrieved: {
+            for(const key of snapshot.keys())
+                console.log(key, snapshot.child(key + "/name").value)
+        }
+    }
+    \endcode
+
+    \sa FirebaseDatabase
+*/
+FirebaseDataSnapshot::FirebaseDataSnapshot(const QString &key, const QJsonValue &value) : m_key(key), m_value(value)
+{
+}
+
+// The data of another snapshot under key, sharing its tree or text
+FirebaseDataSnapshot::FirebaseDataSnapshot(const QString &key, const FirebaseDataSnapshot &data) : FirebaseDataSnapshot(data)
+{
+    m_key = key;
+}
+
+// Parses a database response, which unlike a JSON document may also be a bare value such as null or "text"
+FirebaseDataSnapshot FirebaseDataSnapshot::fromJson(const QByteArray &json, const QString &key)
+{
+    if(json.size() >= JsonUtils::minTapeSize) {
+        FirebaseDataSnapshot snapshot;
+        snapshot.m_key = key;
+        snapshot.m_document = JsonUtils::Document::parse(json);
+        if(snapshot.m_document)
+            return snapshot;
+    }
+
+    return FirebaseDataSnapshot(key, DatabaseUtils::parse(json));
+}
+
+/*!
+    \qmlproperty string FirebaseDataSnapshot::key
+
+    Last segment of the path of this snapshot, empty for the root of a response.
+ */
+QString FirebaseDataSnapshot::key() const
+{
+    return m_key;
+}
+
+/*!
+    \qmlproperty bool FirebaseDataSnapshot::exists
+
+    False if the location holds no data.
+ */
+bool FirebaseDataSnapshot::exists() const
+{
+    if(m_document)
+        return m_document->type(m_node) != JsonUtils::Null;
+    return !m_value.isNull() && !m_value.isUndefined();
+}
+
+/*!
+    \qmlproperty int FirebaseDataSnapshot::childrenCount
+
+    Number of direct children.
+ */
+int FirebaseDataSnapshot::childrenCount() const
+{
+    if(m_document)
+        return m_document->count(m_node);
+    if(m_value.isObject())
+        return m_value.toObject().size();
+    if(m_value.isArray())
+        return m_value.toArray().size();
+    return 0;
+}
+
+QJsonValue FirebaseDataSnapshot::json() const
+{
+    if(m_document)
+        return m_document->toJsonValue(m_node);
+    return m_value;
+}
+
+/*!
+    \qmlmethod FirebaseDataSnapshot FirebaseDataSnapshot::child(string path)
+
+    Snapshot of the location \a path relative to this one, e.g \c "users/alice/name". It shares the data of this snapshot.
+ */
+FirebaseDataSnapshot FirebaseDataSnapshot::child(const QString &path) const
+{
+    const QStringList segments = path.split('/', Qt::SkipEmptyParts);
+    const QString key = segments.isEmpty() ? m_key : segments.last();
+
+    if(m_document) {
+        int node = m_node;
+        for(const QString &segment : segments) {
+            node = m_document->child(node, segment);
+            if(node < 0)
+                return FirebaseDataSnapshot(key, QJsonValue::Null);
+        }
+
+        FirebaseDataSnapshot snapshot(*this);
+        snapshot.m_key = key;
+        snapshot.m_node = node;
+        return snapshot;
+    }
+
+    return FirebaseDataSnapshot(key, DatabaseUtils::valueAt(m_value, path));
+}
+
+/*!
+    \qmlmethod bool FirebaseDataSnapshot::hasChild(string path)
+
+    Returns true if there is data at \a path relative to this snapshot.
+ */
+bool FirebaseDataSnapshot::hasChild(const QString &path) const
+{
+    return child(path).exists();
+}
+
+/*!
+    \qmlmethod list<string> FirebaseDataSnapshot::keys()
+
+    Keys of the direct children. Arrays, as the database returns them for numeric keys, have the indexes as keys.
+ */
+QStringList FirebaseDataSnapshot::keys() const
+{
+    if(m_document)
+        return m_document->keys(m_node);
+    if(m_value.isObject())
+        return m_value.toObject().keys();
+
+    QStringList keys;
+    if(m_value.isArray()) {
+        const int count = m_value.toArray().size();
+        keys.reserve(count);
+        for(int i = 0; i < count; ++i)
+            keys.append(QString::number(i));
+    }
+    return keys;
+}
+
+/*!
+    \qmlmethod var FirebaseDataSnapshot::toVariant()
+
+    Converts the data into plain values, objects and lists. This copies the data, prefer \l child() for single values.
+ */
+QVariant FirebaseDataSnapshot::toVariant() const
+{
+    if(m_document)
+        return m_document->toVariant(m_node);
+    return m_value.toVariant();
+}
+
+/*!
+    \qmlmethod string FirebaseDataSnapshot::toJson()
+
+    Serializes the data back into compact JSON. Large data is returned as received from the server.
+ */
+QString FirebaseDataSnapshot::toJson() const
+{
+    if(m_document)
+        return QString::fromUtf8(m_document->raw(m_node));
+    return QString::fromUtf8(DatabaseUtils::serialize(m_value));
+}
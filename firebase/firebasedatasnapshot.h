@@ -0,0 +1,52 @@
+#ifndef FIREBASEDATASNAPSHOT_H
+#define FIREBASEDATASNAPSHOT_H
+
+#include <QMetaType>
+#include <QJsonValue>
+#include <QStringList>
+#include <QVariant>
+#include <QSharedPointer>
+
+namespace JsonUtils {
+class Document;
+}
+
+// Immutable, parsed view of database data. Copies share the parsed tree, so it is parsed once however many receivers get it
+class FirebaseDataSnapshot
+{
+    Q_GADGET
+    Q_PROPERTY(QString key READ key CONSTANT)
+    Q_PROPERTY(bool exists READ exists CONSTANT)
+    Q_PROPERTY(int childrenCount READ childrenCount CONSTANT)
+    Q_PROPERTY(QVariant value READ toVariant CONSTANT)
+
+public:
+    FirebaseDataSnapshot() = default;
+    FirebaseDataSnapshot(const QString &key, const QJsonValue &value);
+    FirebaseDataSnapshot(const QString &key, const FirebaseDataSnapshot &data);
+
+    static FirebaseDataSnapshot fromJson(const QByteArray &json, const QString &key = QString());
+
+    QString key() const;
+    bool exists() const;
+    int childrenCount() const;
+    QJsonValue json() const;
+
+    Q_INVOKABLE FirebaseDataSnapshot child(const QString &path) const;
+    Q_INVOKABLE bool hasChild(const QString &path) const;
+    Q_INVOKABLE QStringList keys() const;
+    Q_INVOKABLE QVariant toVariant() const;
+    Q_INVOKABLE QString toJson() const;
+
+private:
+    QString m_key;
+    QJsonValue m_value = QJsonValue::Null;
+
+    // Large responses are kept as parsed text and only converted on demand, m_node is the position in m_document
+    QSharedPointer<const JsonUtils::Document> m_document;
+    int m_node = 0;
+};
+
+Q_DECLARE_METATYPE(FirebaseDataSnapshot)
+
+#endif // FIREBASEDATASNAPSHOT_H
@@ -0,0 +1,170 @@
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "firebaseerror.h"
+
+/*!
+    \qmltype FirebaseError
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Error codes reported by \l FirebaseAuth and \l FirebaseDatabase.
+
+    Every error emitted by the library carries one of the FirebaseError codes next to its human readable message,
+    so applications can react to specific failures without comparing strings:
+
+    \code
+    FirebaseAuth {
+        onErrorOcurred: {
+            if(code === FirebaseError.InvalidPassword)
+                passwordField.highlight()
+        }
+    }
+    \endcode
+
+    Requests failing with a transient error (network failures, server errors and \c TooManyAttempts) are retried
+    automatically with exponential backoff before the error is reported.
+ */
+
+// Maps the error messages of the Auth REST API and the Realtime Database onto error codes
+FirebaseError::Code FirebaseError::fromServerMessage(const QString &message)
+{
+    static const QHash<QString, Code> codes {
+        {"TOKEN_EXPIRED", TokenExpired},
+        {"USER_DISABLED", UserDisabled},
+        {"USER_NOT_FOUND", UserNotFound},
+        {"INVALID_REFRESH_TOKEN", InvalidRefreshToken},
+        {"INVALID_GRANT_TYPE", InvalidGrantType},
+        {"MISSING_REFRESH_TOKEN", MissingRefreshToken},
+        {"EMAIL_EXISTS", EmailExists},
+        {"OPERATION_NOT_ALLOWED", OperationNotAllowed},
+        {"TOO_MANY_ATTEMPTS_TRY_LATER", TooManyAttempts},
+        {"EMAIL_NOT_FOUND", EmailNotFound},
+        {"INVALID_EMAIL", InvalidEmail},
+        {"INVALID_PASSWORD", InvalidPassword},
+        {"INVALID_LOGIN_CREDENTIALS", InvalidPassword},
+        {"INVALID_ID_TOKEN", InvalidIdToken},
+        {"CREDENTIAL_TOO_OLD_LOGIN_AGAIN", TokenExpired},
+        {"WEAK_PASSWORD", WeakPassword},
+        {"Permission denied", PermissionDenied},
+        {"Auth token is expired", TokenExpired},
+        {"Could not parse auth token.", InvalidIdToken}
+    };
+
+    // Auth messages may carry details after the code, e.g "WEAK_PASSWORD : Password should be at least 6 characters"
+    const int separator = message.indexOf(" : ");
+    return codes.value(separator < 0 ? message : message.left(separator), UnknownError);
+}
+
+FirebaseError::Code FirebaseError::fromHttpStatus(int status)
+{
+    if(status < 400)
+        return NoError;
+    if(status == 401)
+        return InvalidIdToken;
+    if(status == 403)
+        return PermissionDenied;
+    if(status == 404)
+        return NotFound;
+    if(status == 408)
+        return TimeoutError;
+    if(status == 429)
+        return TooManyAttempts;
+    if(status >= 500)
+        return ServerError;
+
+    return BadRequest;
+}
+
+FirebaseError::Code FirebaseError::fromNetworkError(QNetworkReply::NetworkError error)
+{
+    switch(error) {
+    case QNetworkReply::NoError:
+        return NoError;
+    case QNetworkReply::TimeoutError:
+        return TimeoutError;
+    case QNetworkReply::OperationCanceledError:
+        // Someone called abort(), sending the request again would override that decision
+        return Cancelled;
+    case QNetworkReply::ContentAccessDenied:
+    case QNetworkReply::AuthenticationRequiredError:
+        return PermissionDenied;
+    case QNetworkReply::ContentNotFoundError:
+        return NotFound;
+    default:
+        return NetworkError;
+    }
+}
+
+// Classifies a finished reply, preferring the error reported in the body over the HTTP status
+FirebaseError::Code FirebaseError::fromReply(QNetworkReply::NetworkError networkError, int status, const QByteArray &body, QString *serverMessage)
+{
+    if(status == 0)
+        return fromNetworkError(networkError);
+
+    if(status < 400)
+        return NoError;
+
+    const QJsonValue error = QJsonDocument::fromJson(body).object()["error"];
+    const QString message = error.isObject() ? error.toObject()["message"].toString() : error.toString();
+    if(serverMessage)
+        *serverMessage = message;
+
+    const Code code = fromServerMessage(message);
+    return code == UnknownError ? fromHttpStatus(status) : code;
+}
+
+FirebaseError::Category FirebaseError::category(Code code)
+{
+    switch(code) {
+    case NetworkError:
+    case TimeoutError:
+    case ServerError:
+    case TooManyAttempts:
+        return Retryable;
+    case TokenExpired:
+    case InvalidIdToken:
+        return AuthRefreshable;
+    default:
+        return Fatal;
+    }
+}
+
+// For showing a clearer message to the user, fallback is returned for codes without a specific message
+QString FirebaseError::message(Code code, const QString &fallback)
+{
+    switch(code) {
+    case NoError:
+        return QString();
+    case TokenExpired:
+    case InvalidIdToken:
+        return "User credential not valid, sign in again";
+    case UserDisabled:
+        return "User account disabled, contact administrator";
+    case UserNotFound:
+        return "User with the corresponding refreshToken not found";
+    case InvalidRefreshToken:
+        return "Invalid refresh token was provided";
+    case InvalidGrantType:
+    case MissingRefreshToken:
+        return "No refresh token provided";
+    case EmailExists:
+        return "Email already exists, please use another";
+    case OperationNotAllowed:
+        return "Password sign-in disabled for this project";
+    case TooManyAttempts:
+        return "Too many attempts, try again later";
+    case EmailNotFound:
+    case InvalidEmail:
+        return "Email was not found, verify if it is correct";
+    case InvalidPassword:
+        return "Password is invalid";
+    case WeakPassword:
+        return "Password must be 6 characters long or more";
+    case PermissionDenied:
+        return "Permission denied";
+    case Cancelled:
+        return "Request was cancelled";
+    default:
+        return fallback.isEmpty() ? "Unknown error" : fallback;
+    }
+}
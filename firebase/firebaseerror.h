@@ -0,0 +1,63 @@
+#ifndef FIREBASEERROR_H
+#define FIREBASEERROR_H
+
+#include <QObject>
+#include <QNetworkReply>
+
+class FirebaseError
+{
+    Q_GADGET
+
+public:
+    enum Code {
+        NoError,
+
+        // Transport level
+        NetworkError,
+        TimeoutError,
+        ServerError,
+        TooManyAttempts,
+
+        // Credentials
+        TokenExpired,
+        InvalidIdToken,
+        InvalidRefreshToken,
+        MissingRefreshToken,
+        InvalidGrantType,
+        PermissionDenied,
+
+        // Accounts
+        UserDisabled,
+        UserNotFound,
+        EmailExists,
+        EmailNotFound,
+        InvalidEmail,
+        InvalidPassword,
+        WeakPassword,
+        OperationNotAllowed,
+
+        // Requests
+        BadRequest,
+        NotFound,
+        Cancelled,
+        UnknownError
+    };
+    Q_ENUM(Code)
+
+    enum Category {
+        Retryable,          // Transient, the same request may succeed later
+        AuthRefreshable,    // Succeeds after exchanging the refresh token for a new ID token
+        Fatal
+    };
+    Q_ENUM(Category)
+
+    static Code fromServerMessage(const QString &message);
+    static Code fromHttpStatus(int status);
+    static Code fromNetworkError(QNetworkReply::NetworkError error);
+    static Code fromReply(QNetworkReply::NetworkError networkError, int status, const QByteArray &body, QString *serverMessage = nullptr);
+
+    static Category category(Code code);
+    static QString message(Code code, const QString &fallback = QString());
+};
+
+#endif // FIREBASEERROR_H
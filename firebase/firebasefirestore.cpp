@@ -0,0 +1,264 @@
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QSharedPointer>
+#include "firebasefirestore.h"
+#include "utils/FirestoreUtils.h"
+
+Q_LOGGING_CATEGORY(lcFirebaseFirestore, "firebase.firestore", QtWarningMsg)
+
+/*!
+    \qmltype FirebaseFirestore
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Type that reads, writes and queries documents of Cloud Firestore.
+
+    FirebaseFirestore talks to the Firestore database of the project given by \l projectId, usually taken from
+    \l FirebaseApp. Requests are authenticated with the ID token of the current user of \l auth.
+
+    Documents are addressed by their path relative to the database, e.g \c "users/alice". Document data is exchanged
+    as plain JSON, the typed Firestore values are converted in both directions. Many documents are read with one
+    \l batchGet() call, several writes are applied atomically with \l commit(), and the results of \l runQuery() are
+    delivered one by one while the response is still arriving:
+
+    \code
+    FirebaseFirestore {
+        id: firestore
+        projectId: fbApp.projectId
+        auth: fbAuth
+        onQueryDocument: devices.append(JSON.parse(document))
+    }
+
+    firestore.runQuery("", { from: [{ collectionId: "devices" }], where: { fieldFilter: {
+        field: { fieldPath: "online" }, op: "EQUAL", value: { booleanValue: true } } } }, 1)
+
+    firestore.commit([ { set: "devices/cam-1", data: { online: true, seen: Date.now() } },
+                       { delete: "devices/cam-2" } ], 2)
+    \endcode
+
+    \sa FirebaseApp, FirebaseAuth
+*/
+FirebaseFirestore::FirebaseFirestore(QObject *parent) : QObject(parent), m_transport(FirebaseTransport::shared())
+{
+}
+
+/*!
+    \qmlsignal FirebaseFirestore::documentsRetrieved(string data, int requestCode)
+
+    Emitted with the result of \l batchGet(). \a data is a JSON object with the array \c documents, each holding
+    \c path, \c id, \c data, \c createTime and \c updateTime, and the array \c missing with the paths that do not exist.
+ */
+
+/*!
+    \qmlsignal FirebaseFirestore::queryDocument(string document, int requestCode)
+
+    Emitted for every document matching the query started by \l runQuery(), as soon as it has been received.
+ */
+
+/*!
+    \qmlproperty string FirebaseFirestore::projectId
+
+    This property holds the id of the Firebase project, obtained from \l FirebaseApp.
+ */
+QString FirebaseFirestore::projectId() const
+{
+    return m_projectId;
+}
+
+void FirebaseFirestore::setProjectId(const QString &projectId)
+{
+    m_projectId = projectId;
+}
+
+/*!
+    \qmlproperty string FirebaseFirestore::databaseId
+
+    Id of the Firestore database in the project. Default is \c "(default)".
+ */
+QString FirebaseFirestore::databaseId() const
+{
+    return m_databaseId;
+}
+
+void FirebaseFirestore::setDatabaseId(const QString &databaseId)
+{
+    if(m_databaseId == databaseId)
+        return;
+
+    m_databaseId = databaseId;
+    emit databaseIdChanged();
+}
+
+/*!
+    \qmlproperty FirebaseAuth FirebaseFirestore::auth
+
+    Authentication whose current user's ID token is sent with every request. Without it, requests are unauthenticated.
+ */
+FirebaseAuth *FirebaseFirestore::auth() const
+{
+    return m_auth;
+}
+
+void FirebaseFirestore::setAuth(FirebaseAuth *auth)
+{
+    if(m_auth == auth)
+        return;
+
+    m_auth = auth;
+    emit authChanged();
+}
+
+/*!
+    \qmlmethod void FirebaseFirestore::batchGet(list<string> documentPaths, int requestCode)
+
+    Reads all documents in \a documentPaths with a single request and emits \l documentsRetrieved().
+ */
+void FirebaseFirestore::batchGet(QStringList documentPaths, int requestCode)
+{
+    QJsonArray documents;
+    for(const QString &documentPath : documentPaths)
+        documents.append(documentName(documentPath));
+
+    const QByteArray body = QJsonDocument(QJsonObject {{"documents", documents}}).toJson(QJsonDocument::Compact);
+    m_transport->send("POST", request(":batchGet"), body, this, [this, requestCode](const FirebaseResponse &response) {
+        if(response.error != FirebaseError::NoError) {
+            emit errorOcurred(response.errorString, response.error, requestCode);
+            return;
+        }
+
+        QJsonArray documents, missing;
+        for(const QJsonValue &result : QJsonDocument::fromJson(response.body).array()) {
+            const QJsonObject object = result.toObject();
+            if(object.contains("found"))
+                documents.append(FirestoreUtils::fromDocument(object["found"].toObject()));
+            else if(object.contains("missing"))
+                missing.append(FirestoreUtils::fromDocument(QJsonObject {{"name", object["missing"]}}).value("path"));
+        }
+
+        emit documentsRetrieved(QJsonDocument(QJsonObject {{"documents", documents}, {"missing", missing}}).toJson(QJsonDocument::Compact), requestCode);
+    });
+}
+
+/*!
+    \qmlmethod void FirebaseFirestore::commit(list<object> writes, int requestCode)
+
+    Applies all \a writes atomically: either every write succeeds or none is applied. Each write is an object with one of
+    \list
+        \li \c set: document path, replaces the document with \c data
+        \li \c update: document path, changes only the top level fields present in \c data
+        \li \c delete: document path, deletes the document
+    \endlist
+    and optionally \c exists, which makes the commit fail unless the document exists (or does not exist).
+    Emits \l committed() with the commit time. At most 500 writes can be committed at once.
+ */
+void FirebaseFirestore::commit(QJsonArray writes, int requestCode)
+{
+    if(writes.size() > FirestoreUtils::maxWritesPerCommit) {
+        emit errorOcurred("Too many writes in one commit", FirebaseError::BadRequest, requestCode);
+        return;
+    }
+
+    QJsonArray converted;
+    for(const QJsonValue &write : writes) {
+        QJsonObject result;
+        if(!toWrite(write.toObject(), &result)) {
+            emit errorOcurred("Invalid write", FirebaseError::BadRequest, requestCode);
+            return;
+        }
+        converted.append(result);
+    }
+
+    // A commit applied by the server must not be applied twice, so it is only resent if it certainly did not arrive
+    const QByteArray body = QJsonDocument(QJsonObject {{"writes", converted}}).toJson(QJsonDocument::Compact);
+    m_transport->send("POST", request(":commit"), body, this, [this, requestCode](const FirebaseResponse &response) {
+        if(response.error != FirebaseError::NoError) {
+            emit errorOcurred(response.errorString, response.error, requestCode);
+            return;
+        }
+
+        emit committed(QJsonDocument::fromJson(response.body).object()["commitTime"].toString(), requestCode);
+    }, FirebaseTransport::NoOptions);
+}
+
+/*!
+    \qmlmethod void FirebaseFirestore::runQuery(string parentPath, object structuredQuery, int requestCode)
+
+    Runs \a structuredQuery, in the Firestore REST format, on the collections below \a parentPath (empty for the root).
+    The response is parsed while it arrives and \l queryDocument() is emitted for each document, so large results never
+    have to be held in memory at once. \l queryFinished() is emitted with the number of documents at the end.
+ */
+void FirebaseFirestore::runQuery(QString parentPath, QJsonObject structuredQuery, int requestCode)
+{
+    const QString path = parentPath.isEmpty() ? QString(":runQuery") : "/" + parentPath + ":runQuery";
+    const QByteArray body = QJsonDocument(QJsonObject {{"structuredQuery", structuredQuery}}).toJson(QJsonDocument::Compact);
+
+    QSharedPointer<FirestoreUtils::ArrayStream> stream(new FirestoreUtils::ArrayStream);
+    QSharedPointer<int> count(new int(0));
+
+    // A query only reads, so it may be resent as long as none of its documents were emitted
+    m_transport->stream("POST", request(path), body, this, [this, stream, count, requestCode](const FirebaseResponse &, const QByteArray &data) {
+        for(const QByteArray &element : stream->feed(data)) {
+            const QJsonObject result = QJsonDocument::fromJson(element).object();
+            if(!result.contains("document"))
+                continue;
+
+            ++*count;
+            emit queryDocument(QJsonDocument(FirestoreUtils::fromDocument(result["document"].toObject())).toJson(QJsonDocument::Compact), requestCode);
+        }
+    }, [this, count, requestCode](const FirebaseResponse &response) {
+        if(response.error != FirebaseError::NoError) {
+            qCWarning(lcFirebaseFirestore) << "Query failed:" << response.errorString;
+            emit errorOcurred(response.errorString, response.error, requestCode);
+            return;
+        }
+
+        emit queryFinished(*count, requestCode);
+    });
+}
+
+QString FirebaseFirestore::databaseName() const
+{
+    return "projects/" + m_projectId + "/databases/" + m_databaseId;
+}
+
+QString FirebaseFirestore::documentName(const QString &documentPath) const
+{
+    return databaseName() + "/documents/" + documentPath;
+}
+
+QNetworkRequest FirebaseFirestore::request(const QString &path) const
+{
+    QNetworkRequest request(QUrl(FirestoreUtils::endpoint_documents + databaseName() + "/documents" + path));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+
+    // Firestore accepts the Firebase ID token as OAuth bearer token
+    if(m_auth && m_auth->currentUser() && !m_auth->currentUser()->idToken().isEmpty())
+        request.setRawHeader("Authorization", "Bearer " + m_auth->currentUser()->idToken().toUtf8());
+
+    return request;
+}
+
+bool FirebaseFirestore::toWrite(const QJsonObject &write, QJsonObject *result) const
+{
+    const QJsonObject data = write["data"].toObject();
+
+    if(write.contains("set") || write.contains("update")) {
+        const bool update = write.contains("update");
+        QJsonObject document;
+        document["name"] = documentName(write[update ? "update" : "set"].toString());
+        document["fields"] = FirestoreUtils::toFields(data);
+        (*result)["update"] = document;
+
+        // Without a mask the whole document is replaced
+        if(update)
+            (*result)["updateMask"] = QJsonObject {{"fieldPaths", QJsonArray::fromStringList(FirestoreUtils::fieldPaths(data.keys()))}};
+    } else if(write.contains("delete")) {
+        (*result)["delete"] = documentName(write["delete"].toString());
+    } else {
+        return false;
+    }
+
+    if(write.contains("exists"))
+        (*result)["currentDocument"] = QJsonObject {{"exists", write["exists"].toBool()}};
+
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef FIREBASEFIRESTORE_H
+#define FIREBASEFIRESTORE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QStringList>
+#include "firebasetransport.h"
+#include "firebaseauth.h"
+
+class FirebaseFirestore : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString projectId READ projectId WRITE setProjectId REQUIRED)
+    Q_PROPERTY(QString databaseId READ databaseId WRITE setDatabaseId NOTIFY databaseIdChanged)
+    Q_PROPERTY(FirebaseAuth* auth READ auth WRITE setAuth NOTIFY authChanged)
+
+public:
+    explicit FirebaseFirestore(QObject *parent = nullptr);
+
+    QString projectId() const;
+    void setProjectId(const QString &projectId);
+
+    QString databaseId() const;
+    void setDatabaseId(const QString &databaseId);
+
+    FirebaseAuth *auth() const;
+    void setAuth(FirebaseAuth *auth);
+
+public slots:
+    void batchGet(QStringList documentPaths, int requestCode);
+    void commit(QJsonArray writes, int requestCode);
+    void runQuery(QString parentPath, QJsonObject structuredQuery, int requestCode);
+
+signals:
+    void databaseIdChanged();
+    void authChanged();
+
+    void documentsRetrieved(QByteArray data, int requestCode);
+    void committed(QString commitTime, int requestCode);
+    void queryDocument(QByteArray document, int requestCode);
+    void queryFinished(int count, int requestCode);
+    void errorOcurred(QString error, FirebaseError::Code code, int requestCode);
+
+private:
+    QString databaseName() const;
+    QString documentName(const QString &documentPath) const;
+    QNetworkRequest request(const QString &path) const;
+    bool toWrite(const QJsonObject &write, QJsonObject *result) const;
+
+    QString m_projectId;
+    QString m_databaseId = "(default)";
+    QPointer<FirebaseAuth> m_auth;
+    FirebaseTransport *m_transport;
+};
+
+#endif // FIREBASEFIRESTORE_H
@@ -0,0 +1,139 @@
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include "firebasememorybackend.h"
+#include "utils/DatabaseUtils.h"
+
+Q_LOGGING_CATEGORY(lcFirebaseMemoryBackend, "firebase.memorybackend", QtWarningMsg)
+
+namespace {
+
+const QString scheme("memory://");
+
+FirebaseResponse jsonResponse(const QByteArray &body)
+{
+    FirebaseResponse response;
+    response.status = 200;
+    response.body = body;
+    response.attempts = 1;
+    return response;
+}
+
+FirebaseResponse errorResponse(FirebaseError::Code code, int status, const QString &message)
+{
+    FirebaseResponse response;
+    response.status = status;
+    response.error = code;
+    response.errorString = FirebaseError::message(code, message);
+    response.attempts = 1;
+    return response;
+}
+
+}
+
+/*
+    Every database name, the host part of a memory:// URL, is one JSON tree guarded by a mutex. Requests are answered
+    synchronously with the same bodies the REST API sends, and every write is announced through changed(), from which
+    listeners in any thread derive their server-sent events. changed() is emitted with the mutex held, so its receivers,
+    which are all queued, get the writes in the order they were made. Every write also gets the next revision number,
+    which lets a listener skip the writes already contained in the value it started from.
+*/
+FirebaseMemoryBackend::FirebaseMemoryBackend(QObject *parent) : QObject(parent)
+{
+}
+
+FirebaseMemoryBackend *FirebaseMemoryBackend::instance()
+{
+    static FirebaseMemoryBackend *backend = new FirebaseMemoryBackend(QCoreApplication::instance());
+    return backend;
+}
+
+bool FirebaseMemoryBackend::handles(const QString &databaseUrl)
+{
+    return databaseUrl.startsWith(scheme, Qt::CaseInsensitive);
+}
+
+// Serves a REST request: GET, PUT, PATCH, POST and DELETE on the location of dbPath
+FirebaseResponse FirebaseMemoryBackend::request(const QString &databaseUrl, const QByteArray &verb, const QString &dbPath, const QByteArray &body)
+{
+    const QString database = databaseName(databaseUrl);
+    const QString location = DatabaseUtils::location(dbPath);
+
+    // Wrapped in an array, bare values and containers are parsed alike and anything malformed is an error
+    QJsonValue data;
+    if(!body.isEmpty()) {
+        QJsonParseError error;
+        const QJsonDocument wrapped = QJsonDocument::fromJson('[' + body + ']', &error);
+        if(error.error != QJsonParseError::NoError || wrapped.array().size() != 1)
+            return errorResponse(FirebaseError::BadRequest, 400, "Invalid data; couldn't parse JSON object, array, or value.");
+        data = wrapped.array().first();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    QJsonValue &root = m_roots[database];
+
+    if(verb == "GET")
+        return jsonResponse(DatabaseUtils::serialize(DatabaseUtils::valueAt(root, location)));
+
+    QByteArray event = "put";
+    QString path = location;
+    QByteArray answer;
+
+    if(verb == "PUT") {
+        root = DatabaseUtils::setAt(root, location, data);
+        answer = body;
+    } else if(verb == "PATCH") {
+        if(!data.isObject())
+            return errorResponse(FirebaseError::BadRequest, 400, "Invalid data; couldn't parse JSON object.");
+        root = DatabaseUtils::patchAt(root, location, data.toObject());
+        event = "patch";
+        answer = body;
+    } else if(verb == "POST") {
+        const QString key = pushKey();
+        path = location == "/" ? "/" + key : location + "/" + key;
+        root = DatabaseUtils::setAt(root, path, data);
+        answer = DatabaseUtils::serialize(QJsonObject {{"name", key}});
+    } else if(verb == "DELETE") {
+        root = DatabaseUtils::setAt(root, location, QJsonValue::Null);
+        data = QJsonValue::Null;
+        answer = "null";
+    } else {
+        return errorResponse(FirebaseError::BadRequest, 405, "Method not allowed");
+    }
+
+    qCDebug(lcFirebaseMemoryBackend) << verb << database << path;
+    emit changed(database, event, path, data, root, ++m_revision);
+    return jsonResponse(answer);
+}
+
+// Current value at location, and the revision of the last write it contains
+QJsonValue FirebaseMemoryBackend::value(const QString &databaseUrl, const QString &location, quint64 *revision) const
+{
+    QMutexLocker locker(&m_mutex);
+    if(revision)
+        *revision = m_revision;
+    return DatabaseUtils::valueAt(m_roots.value(databaseName(databaseUrl)), location);
+}
+
+// Empties the database, e.g between test runs. Listeners are told as if the root was deleted
+void FirebaseMemoryBackend::clear(const QString &databaseUrl)
+{
+    const QString database = databaseName(databaseUrl);
+
+    QMutexLocker locker(&m_mutex);
+    m_roots.remove(database);
+    emit changed(database, "put", "/", QJsonValue::Null, QJsonValue::Null, ++m_revision);
+}
+
+QString FirebaseMemoryBackend::databaseName(const QString &databaseUrl)
+{
+    return databaseUrl.mid(scheme.size()).section('/', 0, 0).toLower();
+}
+
+// Keys of POST requests, generated like the server does. Called with the mutex held
+QString FirebaseMemoryBackend::pushKey()
+{
+    return m_pushIds.next(QDateTime::currentMSecsSinceEpoch());
+}
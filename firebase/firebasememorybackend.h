@@ -0,0 +1,42 @@
+#ifndef FIREBASEMEMORYBACKEND_H
+#define FIREBASEMEMORYBACKEND_H
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QJsonValue>
+#include "firebasetransport.h"
+#include "utils/DatabaseUtils.h"
+
+// In process database behind memory:// URLs of FirebaseDatabase, shared by all threads
+class FirebaseMemoryBackend : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FirebaseMemoryBackend *instance();
+
+    static bool handles(const QString &databaseUrl);
+    static QString databaseName(const QString &databaseUrl);
+
+    FirebaseResponse request(const QString &databaseUrl, const QByteArray &verb, const QString &dbPath, const QByteArray &body);
+    QJsonValue value(const QString &databaseUrl, const QString &location, quint64 *revision = nullptr) const;
+    void clear(const QString &databaseUrl);
+
+signals:
+    // Emitted on every write with the event a listener on the root would receive, the new root and the write's revision
+    void changed(const QString &database, const QByteArray &event, const QString &path, const QJsonValue &data, const QJsonValue &root,
+                 quint64 revision);
+
+private:
+    explicit FirebaseMemoryBackend(QObject *parent = nullptr);
+
+    QString pushKey();
+
+    mutable QMutex m_mutex;
+    QHash<QString, QJsonValue> m_roots;
+    quint64 m_revision = 0;
+    DatabaseUtils::PushIdGenerator m_pushIds;
+};
+
+#endif // FIREBASEMEMORYBACKEND_H
@@ -0,0 +1,192 @@
+#include <QLoggingCategory>
+#include "firebasememorybudget.h"
+
+Q_LOGGING_CATEGORY(lcFirebaseMemory, "firebase.memory", QtWarningMsg)
+
+namespace {
+
+// Pressure starts above the high mark and ends below the low mark, so it does not flap around a single value
+const int highWatermarkPercent = 80;
+const int lowWatermarkPercent = 60;
+
+}
+
+/*!
+    \qmltype FirebaseMemoryBudget
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Process wide limit for the memory used by responses in flight.
+
+    By default responses are kept in memory as a whole. On devices with little RAM, a large \l FirebaseDatabase::getValue()
+    or a burst of events can then exhaust memory. Setting a \l limit turns on the budgeted mode:
+
+    \list
+        \li every reply reads at most \l readBufferSize bytes ahead, the network is throttled instead of buffering more;
+        \li response bodies are counted against the budget while they are received;
+        \li bodies larger than \l spillThreshold, or arriving while the budget is used up, are written to a temporary file
+            where the receiver supports it (see \l FirebaseDatabase::dataRetrievedToFile());
+        \li other bodies, e.g of auth, write and Firestore requests, stop reading from the network while the budget is used
+            up, until other responses release their share. A body that is alone in the budget, or replies that would
+            otherwise wait for each other, may go over the limit so they still complete;
+        \li above 80% of the limit \l underPressure becomes true and event listeners stop reading until usage drops below 60%.
+    \endlist
+
+    The budget is shared by all threads and available in QML as \l FirebaseApp::memoryBudget:
+
+    \code
+    FirebaseApp {
+        id: fbApp
+        source: ":/google-services.json"
+        memoryBudget.limit: 32 * 1024 * 1024
+    }
+
+    Connections {
+        target: fbApp.memoryBudget
+        function onPressureChanged(underPressure) { thumbnails.paused = underPressure }
+    }
+    \endcode
+ */
+FirebaseMemoryBudget::FirebaseMemoryBudget(QObject *parent) : QObject(parent), m_limit(0), m_used(0), m_spillThreshold(1024 * 1024),
+    m_readBufferSize(64 * 1024), m_underPressure(0)
+{
+}
+
+FirebaseMemoryBudget *FirebaseMemoryBudget::instance()
+{
+    // Owned by the static rather than the application, so the pointer stays valid as long as the budget exists
+    static FirebaseMemoryBudget budget;
+    return &budget;
+}
+
+bool FirebaseMemoryBudget::isEnabled() const
+{
+    return m_limit.loadAcquire() > 0;
+}
+
+/*!
+    \qmlproperty int FirebaseMemoryBudget::limit
+
+    Maximum number of bytes held by responses in flight. 0 (default) disables the budget.
+ */
+qint64 FirebaseMemoryBudget::limit() const
+{
+    return m_limit.loadAcquire();
+}
+
+void FirebaseMemoryBudget::setLimit(qint64 limit)
+{
+    limit = qMax<qint64>(0, limit);
+    if(m_limit.loadAcquire() == limit)
+        return;
+
+    m_limit.storeRelease(limit);
+    emit limitChanged();
+    updatePressure();
+}
+
+/*!
+    \qmlproperty int FirebaseMemoryBudget::spillThreshold
+
+    Response bodies growing beyond this number of bytes are moved to a temporary file. Default is 1 MiB.
+ */
+qint64 FirebaseMemoryBudget::spillThreshold() const
+{
+    return m_spillThreshold.loadAcquire();
+}
+
+void FirebaseMemoryBudget::setSpillThreshold(qint64 spillThreshold)
+{
+    if(m_spillThreshold.loadAcquire() == spillThreshold)
+        return;
+
+    m_spillThreshold.storeRelease(spillThreshold);
+    emit spillThresholdChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseMemoryBudget::readBufferSize
+
+    Number of bytes each reply may buffer before its connection is throttled. Default is 64 KiB.
+ */
+int FirebaseMemoryBudget::readBufferSize() const
+{
+    return m_readBufferSize.loadAcquire();
+}
+
+void FirebaseMemoryBudget::setReadBufferSize(int readBufferSize)
+{
+    readBufferSize = qMax(4096, readBufferSize);
+    if(m_readBufferSize.loadAcquire() == readBufferSize)
+        return;
+
+    m_readBufferSize.storeRelease(readBufferSize);
+    emit readBufferSizeChanged();
+}
+
+/*!
+    \qmlproperty bool FirebaseMemoryBudget::underPressure
+
+    True while usage is close to the \l limit. Listeners pause reading events in this state.
+ */
+bool FirebaseMemoryBudget::underPressure() const
+{
+    return m_underPressure.loadAcquire() != 0;
+}
+
+// Bytes currently reserved by responses in flight
+qint64 FirebaseMemoryBudget::used() const
+{
+    return m_used.loadAcquire();
+}
+
+// Reserves bytes for a response buffer, fails without reserving anything if the limit would be exceeded
+bool FirebaseMemoryBudget::tryReserve(qint64 bytes)
+{
+    const qint64 limit = m_limit.loadAcquire();
+
+    qint64 used = m_used.loadAcquire();
+    do {
+        if(limit > 0 && used + bytes > limit)
+            return false;
+    } while(!m_used.testAndSetOrdered(used, used + bytes, used));
+
+    updatePressure();
+    return true;
+}
+
+// Accounts bytes that are held anyway, e.g by receivers that cannot take a file
+void FirebaseMemoryBudget::reserve(qint64 bytes)
+{
+    m_used.fetchAndAddOrdered(bytes);
+    updatePressure();
+}
+
+void FirebaseMemoryBudget::release(qint64 bytes)
+{
+    if(bytes <= 0)
+        return;
+
+    m_used.fetchAndSubOrdered(bytes);
+    updatePressure();
+}
+
+void FirebaseMemoryBudget::updatePressure()
+{
+    const qint64 limit = m_limit.loadAcquire();
+    const qint64 used = m_used.loadAcquire();
+    const bool wasUnderPressure = m_underPressure.loadAcquire() != 0;
+
+    bool underPressure = wasUnderPressure;
+    if(limit <= 0)
+        underPressure = false;
+    else if(!wasUnderPressure && used * 100 >= limit * highWatermarkPercent)
+        underPressure = true;
+    else if(wasUnderPressure && used * 100 < limit * lowWatermarkPercent)
+        underPressure = false;
+
+    // Only the thread that flips the state emits, receivers in other threads get the signal queued
+    if(underPressure != wasUnderPressure && m_underPressure.testAndSetOrdered(wasUnderPressure, underPressure)) {
+        qCDebug(lcFirebaseMemory) << (underPressure ? "Memory pressure, used" : "Memory pressure relieved, used") << used << "of" << limit;
+        emit pressureChanged(underPressure);
+    }
+}
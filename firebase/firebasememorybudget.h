@@ -0,0 +1,55 @@
+#ifndef FIREBASEMEMORYBUDGET_H
+#define FIREBASEMEMORYBUDGET_H
+
+#include <QObject>
+#include <QAtomicInteger>
+
+class FirebaseMemoryBudget : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(qint64 limit READ limit WRITE setLimit NOTIFY limitChanged)
+    Q_PROPERTY(qint64 spillThreshold READ spillThreshold WRITE setSpillThreshold NOTIFY spillThresholdChanged)
+    Q_PROPERTY(int readBufferSize READ readBufferSize WRITE setReadBufferSize NOTIFY readBufferSizeChanged)
+    Q_PROPERTY(bool underPressure READ underPressure NOTIFY pressureChanged)
+
+public:
+    static FirebaseMemoryBudget *instance();
+
+    bool isEnabled() const;
+
+    qint64 limit() const;
+    void setLimit(qint64 limit);
+
+    qint64 spillThreshold() const;
+    void setSpillThreshold(qint64 spillThreshold);
+
+    int readBufferSize() const;
+    void setReadBufferSize(int readBufferSize);
+
+    bool underPressure() const;
+
+    Q_INVOKABLE qint64 used() const;
+
+    bool tryReserve(qint64 bytes);
+    void reserve(qint64 bytes);
+    void release(qint64 bytes);
+
+signals:
+    void limitChanged();
+    void spillThresholdChanged();
+    void readBufferSizeChanged();
+    void pressureChanged(bool underPressure);
+
+private:
+    explicit FirebaseMemoryBudget(QObject *parent = nullptr);
+
+    void updatePressure();
+
+    QAtomicInteger<qint64> m_limit;
+    QAtomicInteger<qint64> m_used;
+    QAtomicInteger<qint64> m_spillThreshold;
+    QAtomicInt m_readBufferSize;
+    QAtomicInt m_underPressure;
+};
+
+#endif // FIREBASEMEMORYBUDGET_H
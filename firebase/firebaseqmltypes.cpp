@@ -1,17 +1,33 @@
-#include "firebaseapp.h"
-#include "firebaseauth.h"
-#include "firebasedatabase.h"
-#include "firebaseuser.h"
-#include "googlegateway.h"
-#include <QCoreApplication>
-#include <QQmlEngine>
-
-void registerFirebaseTypes() {
-    qmlRegisterType<FirebaseApp>("Firebase", 1,0, "FirebaseApp");
-    qmlRegisterType<FirebaseAuth>("Firebase", 1,0, "FirebaseAuth");
-    qmlRegisterType<FirebaseUser>("Firebase", 1,0, "FirebaseUser");
-    qmlRegisterType<FirebaseDatabase>("Firebase", 1,0, "FirebaseDatabase");
-    qmlRegisterType<GoogleGateway>("Firebase", 1,0, "GoogleGateway");
-}
-
-Q_COREAPP_STARTUP_FUNCTION(registerFirebaseTypes)
+#include "firebaseapp.h"
+#include "firebaseauth.h"
+#include "firebasedatabase.h"
+#include "firebaseuser.h"
+#include "firebaseerror.h"
+#include "firebasesessionpool.h"
+#include "firebasestorage.h"
+#include "firebasefirestore.h"
+#include "firebasememorybudget.h"
+#include "firebasedatasnapshot.h"
+#include "firebasevalue.h"
+#include "firebaseusercache.h"
+#include "googlegateway.h"
+#include <QCoreApplication>
+#include <QQmlEngine>
+
+void registerFirebaseTypes() {
+    qmlRegisterType<FirebaseApp>("Firebase", 1,0, "FirebaseApp");
+    qmlRegisterType<FirebaseAuth>("Firebase", 1,0, "FirebaseAuth");
+    qmlRegisterType<FirebaseUser>("Firebase", 1,0, "FirebaseUser");
+    qmlRegisterType<FirebaseDatabase>("Firebase", 1,0, "FirebaseDatabase");
+    qmlRegisterType<GoogleGateway>("Firebase", 1,0, "GoogleGateway");
+    qmlRegisterType<FirebaseSessionPool>("Firebase", 1,0, "FirebaseSessionPool");
+    qmlRegisterType<FirebaseStorage>("Firebase", 1,0, "FirebaseStorage");
+    qmlRegisterType<FirebaseFirestore>("Firebase", 1,0, "FirebaseFirestore");
+    qmlRegisterType<FirebaseValue>("Firebase", 1,0, "FirebaseValue");
+    qmlRegisterType<FirebaseUserCache>("Firebase", 1,0, "FirebaseUserCache");
+    qmlRegisterUncreatableType<FirebaseMemoryBudget>("Firebase", 1,0, "FirebaseMemoryBudget", "FirebaseMemoryBudget is available as FirebaseApp.memoryBudget");
+    qRegisterMetaType<FirebaseDataSnapshot>();
+    qmlRegisterUncreatableMetaObject(FirebaseError::staticMetaObject, "Firebase", 1,0, "FirebaseError", "FirebaseError only provides error codes");
+}
+
+Q_COREAPP_STARTUP_FUNCTION(registerFirebaseTypes)
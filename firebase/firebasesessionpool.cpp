@@ -0,0 +1,350 @@
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include "firebasesessionpool.h"
+#include "utils/AuthUtils.h"
+
+Q_LOGGING_CATEGORY(lcFirebaseSessionPool, "firebase.sessionpool", QtWarningMsg)
+
+/*!
+    \qmltype FirebaseSessionPool
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Type that keeps many authenticated users signed in at the same time.
+
+    FirebaseSessionPool is meant for gateway processes acting on behalf of many accounts. Instead of one \l FirebaseAuth
+    per account, a single pool holds every session, identified by a session id chosen by the application. All sessions
+    share one network connection pool, and their ID tokens are refreshed automatically before they expire. Refreshes are
+    staggered and limited to \l maxConcurrentRefreshes at a time, so sessions created together do not all refresh at the same moment.
+
+    Setting the pool on a \l FirebaseDatabase lets the session id be passed wherever an idToken is expected, the request is then
+    sent with the current token of that session:
+
+    \code
+    FirebaseSessionPool {
+        id: sessions
+        apiKey: fbApp.apiKey
+        onSessionSignedIn: fbDb.listenEvents("/Devices/" + sessionId + ".json", sessionId, 1, true, true)
+    }
+
+    FirebaseDatabase {
+        id: fbDb
+        databaseUrl: fbApp.databaseUrl
+        sessionPool: sessions
+    }
+
+    Component.onCompleted: sessions.restoreSession("device-42", storedRefreshToken)
+    \endcode
+
+    \sa FirebaseAuth, FirebaseDatabase::sessionPool
+ */
+FirebaseSessionPool::FirebaseSessionPool(QObject *parent) : QObject(parent), m_transport(FirebaseTransport::shared())
+{
+    m_refreshTimer.setSingleShot(true);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &FirebaseSessionPool::processRefreshes);
+}
+
+/*!
+    \qmlproperty string FirebaseSessionPool::apiKey
+
+    This property holds the API Key of the Firebase project, passed from \l FirebaseApp.
+ */
+QString FirebaseSessionPool::apiKey() const
+{
+    return m_apiKey;
+}
+
+void FirebaseSessionPool::setApiKey(const QString &apiKey)
+{
+    if(m_apiKey == apiKey)
+        return;
+
+    m_apiKey = apiKey;
+    emit apiKeyChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseSessionPool::refreshMargin
+
+    Number of seconds before expiry at which the ID token of a session is refreshed. Refreshes are spread over the
+    first half of this window. Default is 300.
+ */
+int FirebaseSessionPool::refreshMargin() const
+{
+    return m_refreshMargin;
+}
+
+void FirebaseSessionPool::setRefreshMargin(int refreshMargin)
+{
+    if(m_refreshMargin == refreshMargin)
+        return;
+
+    m_refreshMargin = refreshMargin;
+    emit refreshMarginChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseSessionPool::maxConcurrentRefreshes
+
+    Maximum number of token refresh requests in flight at the same time. Default is 8.
+ */
+int FirebaseSessionPool::maxConcurrentRefreshes() const
+{
+    return m_maxConcurrentRefreshes;
+}
+
+void FirebaseSessionPool::setMaxConcurrentRefreshes(int maxConcurrentRefreshes)
+{
+    maxConcurrentRefreshes = qMax(1, maxConcurrentRefreshes);
+    if(m_maxConcurrentRefreshes == maxConcurrentRefreshes)
+        return;
+
+    m_maxConcurrentRefreshes = maxConcurrentRefreshes;
+    emit maxConcurrentRefreshesChanged();
+    processRefreshes();
+}
+
+/*!
+    \qmlproperty int FirebaseSessionPool::count
+
+    Number of sessions in the pool.
+ */
+int FirebaseSessionPool::count() const
+{
+    return m_sessions.size();
+}
+
+/*!
+    \qmlproperty list<string> FirebaseSessionPool::sessionIds
+
+    Ids of all sessions in the pool.
+ */
+QStringList FirebaseSessionPool::sessionIds() const
+{
+    return m_sessions.keys();
+}
+
+/*!
+    \qmlmethod bool FirebaseSessionPool::contains(string sessionId)
+
+    Returns true if the pool has a session with \a sessionId.
+ */
+bool FirebaseSessionPool::contains(const QString &sessionId) const
+{
+    return m_sessions.contains(sessionId);
+}
+
+/*!
+    \qmlmethod FirebaseUser FirebaseSessionPool::user(string sessionId)
+
+    Returns the user of the session \a sessionId, or null if there is no such session.
+ */
+FirebaseUser *FirebaseSessionPool::user(const QString &sessionId) const
+{
+    return m_sessions.value(sessionId).user;
+}
+
+/*!
+    \qmlmethod string FirebaseSessionPool::idToken(string sessionId)
+
+    Returns the current ID token of the session \a sessionId.
+ */
+QString FirebaseSessionPool::idToken(const QString &sessionId) const
+{
+    const FirebaseUser *user = m_sessions.value(sessionId).user;
+    return user ? user->idToken() : QString();
+}
+
+/*!
+    \qmlmethod void FirebaseSessionPool::signIn(string sessionId, string email, string password)
+
+    Signs in with \a email and \a password and stores the result in the session \a sessionId, creating it if necessary.
+    Emits \l sessionSignedIn() on success or \l sessionError() otherwise.
+ */
+void FirebaseSessionPool::signIn(const QString &sessionId, const QString &email, const QString &password)
+{
+    session(sessionId);
+    sendRequest(sessionId, AuthUtils::request_signIn, AuthUtils::payload_signIn(email, password));
+}
+
+/*!
+    \qmlmethod void FirebaseSessionPool::restoreSession(string sessionId, string refreshToken)
+
+    Creates the session \a sessionId from a previously stored \a refreshToken and immediately exchanges it for an ID token.
+ */
+void FirebaseSessionPool::restoreSession(const QString &sessionId, const QString &refreshToken)
+{
+    session(sessionId).user->setRefreshToken(refreshToken);
+    enqueueRefresh(sessionId);
+}
+
+/*!
+    \qmlmethod void FirebaseSessionPool::refreshSession(string sessionId)
+
+    Exchanges the refresh token of \a sessionId for a new ID token as soon as possible, regardless of the refresh schedule.
+    The refresh waits for a free slot if \l maxConcurrentRefreshes refreshes are already in flight.
+ */
+void FirebaseSessionPool::refreshSession(const QString &sessionId)
+{
+    if(m_sessions.contains(sessionId))
+        enqueueRefresh(sessionId);
+}
+
+/*!
+    \qmlmethod void FirebaseSessionPool::removeSession(string sessionId)
+
+    Removes the session \a sessionId from the pool and stops refreshing its token.
+ */
+void FirebaseSessionPool::removeSession(const QString &sessionId)
+{
+    auto it = m_sessions.find(sessionId);
+    if(it == m_sessions.end())
+        return;
+
+    // A refresh in flight keeps its slot until it is answered, its answer is then ignored
+    it->user->deleteLater();
+    m_sessions.erase(it);
+    emit countChanged();
+}
+
+FirebaseSessionPool::Session &FirebaseSessionPool::session(const QString &sessionId)
+{
+    auto it = m_sessions.find(sessionId);
+    if(it == m_sessions.end()) {
+        it = m_sessions.insert(sessionId, Session());
+        it->user = new FirebaseUser(this);
+        emit countChanged();
+    }
+
+    return *it;
+}
+
+void FirebaseSessionPool::sendRequest(const QString &sessionId, const AuthUtils::Request &request, const QByteArray &data, quint64 refresh)
+{
+    QNetworkRequest networkRequest(QUrl(request.endpoint + m_apiKey));
+    networkRequest.setHeader(QNetworkRequest::ContentTypeHeader, request.contentType);
+
+    const AuthUtils::Request *spec = &request;
+    m_transport->send("POST", networkRequest, data, this, [this, sessionId, spec, refresh](const FirebaseResponse &response) {
+        handleReply(sessionId, *spec, response, refresh);
+    }, request.sideEffects ? FirebaseTransport::NoOptions : FirebaseTransport::Idempotent);
+}
+
+void FirebaseSessionPool::handleReply(const QString &sessionId, const AuthUtils::Request &request, const FirebaseResponse &response, quint64 refresh)
+{
+    if(refresh)
+        m_refreshesInFlight.remove(refresh);
+
+    // The session may have been removed, or removed and created again, while the refresh was in flight
+    auto it = m_sessions.find(sessionId);
+    if(it == m_sessions.end() || (refresh && it->refresh != refresh)) {
+        startRefreshes();
+        return;
+    }
+
+    if(refresh) {
+        it->refreshing = false;
+        it->refresh = 0;
+    }
+
+    if(response.error != FirebaseError::NoError) {
+        qCWarning(lcFirebaseSessionPool) << "Session" << sessionId << "failed:" << response.errorString;
+
+        // Transient failures were already retried by the transport. Keep trying with backoff, also once the token has
+        // expired or when a restored session never had one, so the session recovers when the outage ends
+        if(refresh && FirebaseError::category(response.error) == FirebaseError::Retryable) {
+            const int delay = qMin(60 << qMin(it->failures, 5), 1800);
+            const int jitter = static_cast<int>(qHash(sessionId) % static_cast<uint>(delay / 4 + 1));
+            it->nextRefresh = QDateTime::currentDateTimeUtc().addSecs(delay + jitter);
+            ++it->failures;
+        }
+
+        emit sessionError(sessionId, response.errorString, response.error);
+        processRefreshes();
+        return;
+    }
+
+    AuthUtils::applyFields(request, QJsonDocument::fromJson(response.body).object(), it->user);
+    it->failures = 0;
+    scheduleRefresh(sessionId);
+
+    if(refresh)
+        emit sessionRefreshed(sessionId);
+    else
+        emit sessionSignedIn(sessionId);
+
+    processRefreshes();
+}
+
+// Plans the next refresh inside the refresh margin, offset per session so refreshes of many sessions are spread out
+void FirebaseSessionPool::scheduleRefresh(const QString &sessionId)
+{
+    Session &session = m_sessions[sessionId];
+
+    const QDateTime expiration = session.user->expirationTime();
+    if(!expiration.isValid()) {
+        session.nextRefresh = QDateTime();
+        return;
+    }
+
+    const int window = qMax(1, m_refreshMargin / 2);
+    const int stagger = static_cast<int>(qHash(sessionId) % static_cast<uint>(window));
+    session.nextRefresh = expiration.addSecs(-m_refreshMargin + stagger);
+}
+
+// Puts the session in the due queue, refreshes are only started from there so the concurrency limit always applies
+void FirebaseSessionPool::enqueueRefresh(const QString &sessionId)
+{
+    Session &session = m_sessions[sessionId];
+    session.nextRefresh = QDateTime();
+    if(!session.refreshing && !session.queued) {
+        session.queued = true;
+        m_due.enqueue(sessionId);
+    }
+
+    startRefreshes();
+}
+
+void FirebaseSessionPool::startRefreshes()
+{
+    while(m_refreshesInFlight.size() < m_maxConcurrentRefreshes && !m_due.isEmpty()) {
+        // Removed sessions leave their id behind
+        auto it = m_sessions.find(m_due.dequeue());
+        if(it == m_sessions.end() || !it->queued)
+            continue;
+
+        it->queued = false;
+        it->refreshing = true;
+        it->refresh = ++m_lastRefresh;
+        m_refreshesInFlight.insert(it->refresh);
+
+        sendRequest(it.key(), AuthUtils::request_refreshToken, AuthUtils::payload_refreshToken(it->user->refreshToken()), it->refresh);
+    }
+}
+
+void FirebaseSessionPool::processRefreshes()
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    QDateTime next;
+    QStringList due;
+
+    for(auto it = m_sessions.cbegin(); it != m_sessions.cend(); ++it) {
+        if(it->refreshing || it->queued || !it->nextRefresh.isValid())
+            continue;
+
+        if(it->nextRefresh <= now)
+            due.append(it.key());
+        else if(!next.isValid() || it->nextRefresh < next)
+            next = it->nextRefresh;
+    }
+
+    // Sessions over the concurrency limit wait in the queue and are started when a refresh completes
+    for(const QString &sessionId : qAsConst(due))
+        enqueueRefresh(sessionId);
+    startRefreshes();
+
+    if(next.isValid())
+        m_refreshTimer.start(static_cast<int>(qBound<qint64>(0, now.msecsTo(next), 24 * 3600 * 1000)));
+    else
+        m_refreshTimer.stop();
+}
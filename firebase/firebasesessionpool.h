@@ -0,0 +1,89 @@
+#ifndef FIREBASESESSIONPOOL_H
+#define FIREBASESESSIONPOOL_H
+
+#include <QObject>
+#include <QHash>
+#include <QQueue>
+#include <QSet>
+#include <QTimer>
+#include <QDateTime>
+#include <QStringList>
+#include "firebaseuser.h"
+#include "firebasetransport.h"
+
+namespace AuthUtils { struct Request; }
+
+class FirebaseSessionPool : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString apiKey READ apiKey WRITE setApiKey NOTIFY apiKeyChanged)
+    Q_PROPERTY(int refreshMargin READ refreshMargin WRITE setRefreshMargin NOTIFY refreshMarginChanged)
+    Q_PROPERTY(int maxConcurrentRefreshes READ maxConcurrentRefreshes WRITE setMaxConcurrentRefreshes NOTIFY maxConcurrentRefreshesChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(QStringList sessionIds READ sessionIds NOTIFY countChanged)
+
+public:
+    explicit FirebaseSessionPool(QObject *parent = nullptr);
+
+    QString apiKey() const;
+    void setApiKey(const QString &apiKey);
+
+    int refreshMargin() const;
+    void setRefreshMargin(int refreshMargin);
+
+    int maxConcurrentRefreshes() const;
+    void setMaxConcurrentRefreshes(int maxConcurrentRefreshes);
+
+    int count() const;
+    QStringList sessionIds() const;
+
+    Q_INVOKABLE bool contains(const QString &sessionId) const;
+    Q_INVOKABLE FirebaseUser *user(const QString &sessionId) const;
+    Q_INVOKABLE QString idToken(const QString &sessionId) const;
+
+public slots:
+    void signIn(const QString &sessionId, const QString &email, const QString &password);
+    void restoreSession(const QString &sessionId, const QString &refreshToken);
+    void refreshSession(const QString &sessionId);
+    void removeSession(const QString &sessionId);
+
+signals:
+    void apiKeyChanged();
+    void refreshMarginChanged();
+    void maxConcurrentRefreshesChanged();
+    void countChanged();
+
+    void sessionSignedIn(QString sessionId);
+    void sessionRefreshed(QString sessionId);
+    void sessionError(QString sessionId, QString error, FirebaseError::Code code);
+
+private:
+    struct Session {
+        FirebaseUser *user = nullptr;
+        QDateTime nextRefresh;
+        bool refreshing = false;
+        bool queued = false;        // Waiting in the due queue for a free refresh slot
+        quint64 refresh = 0;        // Refresh request whose answer the session waits for
+        int failures = 0;           // Consecutive transient refresh failures, for the backoff
+    };
+
+    Session &session(const QString &sessionId);
+    void sendRequest(const QString &sessionId, const AuthUtils::Request &request, const QByteArray &data, quint64 refresh = 0);
+    void handleReply(const QString &sessionId, const AuthUtils::Request &request, const FirebaseResponse &response, quint64 refresh);
+    void scheduleRefresh(const QString &sessionId);
+    void enqueueRefresh(const QString &sessionId);
+    void startRefreshes();
+    void processRefreshes();
+
+    QString m_apiKey;
+    int m_refreshMargin = 300;
+    int m_maxConcurrentRefreshes = 8;
+    quint64 m_lastRefresh = 0;
+    QSet<quint64> m_refreshesInFlight;     // Counted per request, answers of removed sessions still hold their slot
+    QQueue<QString> m_due;
+    QHash<QString, Session> m_sessions;
+    QTimer m_refreshTimer;
+    FirebaseTransport *m_transport;
+};
+
+#endif // FIREBASESESSIONPOOL_H
@@ -0,0 +1,1010 @@
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QMimeDatabase>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include "firebasestorage.h"
+
+Q_LOGGING_CATEGORY(lcFirebaseStorage, "firebase.storage", QtWarningMsg)
+
+namespace {
+
+const char storageEndpoint[] = "https://firebasestorage.googleapis.com/v0/b/";
+const int maxResumeAttempts = 5;
+
+const qint64 minRangeSize = 1024 * 1024;
+
+}
+
+/*!
+    \qmltype FirebaseStorage
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Type that uploads files to and downloads files from Firebase Storage.
+
+    FirebaseStorage uploads files to the bucket given by \l FirebaseApp::storageBucket using the resumable upload
+    protocol. Files are streamed from disk in chunks of \l chunkSize bytes, so memory use stays the same for any file
+    size. Up to \l maxConcurrentUploads files are uploaded in parallel, further uploads wait in a queue.
+
+    When a chunk fails, the upload asks the server how many bytes it already has and continues from there. The upload
+    session of every unfinished file is kept on disk, so uploads interrupted by a restart continue with \l resumeUploads():
+
+    \code
+    FirebaseStorage {
+        id: fbStorage
+        storageBucket: fbApp.storageBucket
+        onUploadProgress: console.log(storagePath, bytesSent, "/", bytesTotal)
+        onUploadFinished: console.log("Uploaded", storagePath)
+    }
+
+    Connections {
+        target: fbAuth
+        function onSignedIn() {
+            fbStorage.resumeUploads(fbAuth.currentUser.idToken)
+            fbStorage.upload("/var/log/device.log", "logs/" + fbAuth.currentUser.userId + "/device.log", fbAuth.currentUser.idToken)
+        }
+    }
+    \endcode
+
+    Downloads of large objects are split into up to \l maxParallelRanges HTTP range requests that are written straight
+    to disk. Downloaded objects are kept in a disk cache of \l cacheSize bytes, keyed by their content hash. A cached
+    object is used without contacting the server for \l cacheMaxAge seconds, afterwards its generation is compared with
+    the server metadata and the object is only downloaded again if it changed:
+
+    \code
+    FirebaseStorage {
+        id: fbStorage
+        storageBucket: fbApp.storageBucket
+        onDownloadFinished: image.source = "file://" + filePath
+    }
+
+    Component.onCompleted: fbStorage.download("media/intro.mp4", fbAuth.currentUser.idToken)
+    \endcode
+
+    \sa FirebaseApp
+*/
+FirebaseStorage::FirebaseStorage(QObject *parent) : QObject(parent), m_transport(FirebaseTransport::shared()), m_cache(FirebaseStorageCache::shared())
+{
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if(!dataDir.isEmpty())
+        m_stateFile = dataDir + "/firebase/storage_uploads.json";
+}
+
+/*!
+    \qmlsignal FirebaseStorage::uploadProgress(string storagePath, int bytesSent, int bytesTotal)
+
+    Emitted every time a chunk of the file uploaded to \a storagePath has been stored by the server.
+ */
+
+/*!
+    \qmlsignal FirebaseStorage::uploadFinished(string storagePath, string metadata)
+
+    Emitted when the last chunk has been uploaded, \a metadata holds the JSON metadata of the new object.
+ */
+
+/*!
+    \qmlsignal FirebaseStorage::errorOcurred(string error, FirebaseError code, string storagePath)
+
+    Emitted when the upload to \a storagePath fails. Uploads failing because of the network are kept and can be
+    continued later with \l resumeUploads().
+ */
+
+/*!
+    \qmlproperty string FirebaseStorage::storageBucket
+
+    This property holds the bucket of the Firebase project, obtained from \l FirebaseApp.
+ */
+QString FirebaseStorage::storageBucket() const
+{
+    return m_storageBucket;
+}
+
+void FirebaseStorage::setStorageBucket(const QString &storageBucket)
+{
+    m_storageBucket = storageBucket.startsWith("gs://") ? storageBucket.mid(5) : storageBucket;
+}
+
+/*!
+    \qmlproperty FirebaseSessionPool FirebaseStorage::sessionPool
+
+    Optional pool of authenticated sessions. When set, the idToken argument may be the id of a session in the pool and
+    each chunk is sent with the current ID token of that session, so uploads longer than the token lifetime keep working.
+ */
+FirebaseSessionPool *FirebaseStorage::sessionPool() const
+{
+    return m_sessionPool;
+}
+
+void FirebaseStorage::setSessionPool(FirebaseSessionPool *sessionPool)
+{
+    if(m_sessionPool == sessionPool)
+        return;
+
+    m_sessionPool = sessionPool;
+    emit sessionPoolChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseStorage::maxConcurrentUploads
+
+    Maximum number of files uploaded at the same time. Default is 2.
+ */
+int FirebaseStorage::maxConcurrentUploads() const
+{
+    return m_maxConcurrentUploads;
+}
+
+void FirebaseStorage::setMaxConcurrentUploads(int maxConcurrentUploads)
+{
+    maxConcurrentUploads = qMax(1, maxConcurrentUploads);
+    if(m_maxConcurrentUploads == maxConcurrentUploads)
+        return;
+
+    m_maxConcurrentUploads = maxConcurrentUploads;
+    emit maxConcurrentUploadsChanged();
+    processQueue();
+}
+
+/*!
+    \qmlproperty int FirebaseStorage::chunkSize
+
+    Number of bytes sent per request, rounded down to the granularity required by the server (256 KiB).
+    Each active upload holds one chunk in memory. Default is 2 MiB.
+ */
+int FirebaseStorage::chunkSize() const
+{
+    return m_chunkSize;
+}
+
+void FirebaseStorage::setChunkSize(int chunkSize)
+{
+    if(m_chunkSize == chunkSize)
+        return;
+
+    m_chunkSize = chunkSize;
+    emit chunkSizeChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseStorage::activeUploads
+
+    Number of uploads currently transferring data.
+ */
+int FirebaseStorage::activeUploads() const
+{
+    return m_activeUploads;
+}
+
+/*!
+    \qmlproperty int FirebaseStorage::maxParallelRanges
+
+    Maximum number of range requests used to download one object. Objects are split in ranges of at least 1 MiB.
+    Default is 4.
+ */
+int FirebaseStorage::maxParallelRanges() const
+{
+    return m_maxParallelRanges;
+}
+
+void FirebaseStorage::setMaxParallelRanges(int maxParallelRanges)
+{
+    maxParallelRanges = qMax(1, maxParallelRanges);
+    if(m_maxParallelRanges == maxParallelRanges)
+        return;
+
+    m_maxParallelRanges = maxParallelRanges;
+    emit maxParallelRangesChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseStorage::cacheSize
+
+    Maximum size in bytes of the download cache, shared by all FirebaseStorage objects. The least recently used objects
+    are removed when it is exceeded. 0 disables the cache, downloads then need a destination file. Default is 256 MiB.
+ */
+qint64 FirebaseStorage::cacheSize() const
+{
+    return m_cache->maxSize();
+}
+
+void FirebaseStorage::setCacheSize(qint64 cacheSize)
+{
+    if(m_cache->maxSize() == cacheSize)
+        return;
+
+    m_cache->setMaxSize(qMax<qint64>(0, cacheSize));
+    emit cacheSizeChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseStorage::cacheMaxAge
+
+    Number of seconds a cached object is used without asking the server whether it changed. Default is 3600.
+ */
+int FirebaseStorage::cacheMaxAge() const
+{
+    return m_cacheMaxAge;
+}
+
+void FirebaseStorage::setCacheMaxAge(int cacheMaxAge)
+{
+    if(m_cacheMaxAge == cacheMaxAge)
+        return;
+
+    m_cacheMaxAge = cacheMaxAge;
+    emit cacheMaxAgeChanged();
+}
+
+// File keeping the upload sessions of unfinished uploads, an empty path disables resuming after a restart
+QString FirebaseStorage::stateFile() const
+{
+    return m_stateFile;
+}
+
+void FirebaseStorage::setStateFile(const QString &stateFile)
+{
+    m_stateFile = stateFile;
+    m_stateLoaded = false;
+    m_state = QJsonObject();
+}
+
+/*!
+    \qmlmethod void FirebaseStorage::upload(string filePath, string storagePath, string idToken, string contentType)
+
+    Uploads the local file \a filePath to \a storagePath in the bucket, authenticated with \a idToken. The content type
+    is guessed from the file name if \a contentType is empty. An unfinished upload to the same \a storagePath is replaced.
+ */
+void FirebaseStorage::upload(QString filePath, QString storagePath, QString idToken, QString contentType)
+{
+    const QFileInfo info(filePath);
+    if(!info.isFile() || !info.isReadable()) {
+        emit errorOcurred("Cannot read " + filePath, FirebaseError::NotFound, storagePath);
+        return;
+    }
+
+    if(m_uploads.contains(storagePath))
+        cancelUpload(storagePath);
+
+    Upload upload;
+    upload.storagePath = storagePath;
+    upload.filePath = info.absoluteFilePath();
+    upload.contentType = contentType.isEmpty() ? QMimeDatabase().mimeTypeForFile(info).name() : contentType;
+    upload.idToken = idToken;
+    upload.size = info.size();
+    upload.modified = info.lastModified();
+    enqueue(upload);
+}
+
+/*!
+    \qmlmethod void FirebaseStorage::cancelUpload(string storagePath)
+
+    Stops the upload to \a storagePath and discards its upload session.
+ */
+void FirebaseStorage::cancelUpload(QString storagePath)
+{
+    auto it = m_uploads.find(storagePath);
+    if(it == m_uploads.end())
+        return;
+
+    const quint64 requestId = it->requestId;
+    const QUrl sessionUrl = it->sessionUrl;
+    const QString idToken = it->idToken;
+
+    removeUpload(storagePath);
+    forgetState(storagePath);
+
+    if(requestId)
+        m_transport->cancel(requestId);
+
+    // Let the server drop what it has received so far, nobody waits for the answer
+    if(sessionUrl.isValid()) {
+        QNetworkRequest request(sessionUrl);
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
+        request.setRawHeader("X-Goog-Upload-Protocol", "resumable");
+        request.setRawHeader("X-Goog-Upload-Command", "cancel");
+        const QString token = authorization(idToken);
+        if(!token.isEmpty())
+            request.setRawHeader("Authorization", "Firebase " + token.toUtf8());
+        m_transport->send("POST", request, QByteArray(), this, [](const FirebaseResponse &) {}, FirebaseTransport::NoOptions);
+    }
+
+    processQueue();
+}
+
+/*!
+    \qmlmethod void FirebaseStorage::resumeUploads(string idToken)
+
+    Continues the uploads that were interrupted before the application stopped, authenticated with \a idToken.
+    Uploads whose local file changed in the meantime are discarded.
+ */
+void FirebaseStorage::resumeUploads(QString idToken)
+{
+    loadState();
+
+    const QStringList storagePaths = m_state.keys();
+    for(const QString &storagePath : storagePaths) {
+        if(m_uploads.contains(storagePath))
+            continue;
+
+        const QJsonObject saved = m_state.value(storagePath).toObject();
+        const QFileInfo info(saved["file"].toString());
+        const qint64 size = static_cast<qint64>(saved["size"].toDouble());
+        const qint64 modified = static_cast<qint64>(saved["modified"].toDouble());
+
+        if(!info.isFile() || info.size() != size || info.lastModified().toMSecsSinceEpoch() != modified) {
+            qCDebug(lcFirebaseStorage) << "Discarding upload of changed file" << info.filePath();
+            forgetState(storagePath);
+            continue;
+        }
+
+        Upload upload;
+        upload.storagePath = storagePath;
+        upload.filePath = info.absoluteFilePath();
+        upload.contentType = saved["contentType"].toString();
+        upload.idToken = idToken;
+        upload.size = size;
+        upload.modified = info.lastModified();
+        upload.sessionUrl = QUrl(saved["sessionUrl"].toString());
+        enqueue(upload);
+    }
+}
+
+/*!
+    \qmlmethod void FirebaseStorage::download(string storagePath, string idToken, string filePath)
+
+    Downloads the object at \a storagePath, authenticated with \a idToken, and emits \l downloadFinished() with the
+    local file. If \a filePath is empty the file is the cache entry, which stays valid until the cache evicts it,
+    otherwise the object is copied to \a filePath. Several downloads of the same object share one transfer.
+
+    \sa downloadProgress()
+ */
+void FirebaseStorage::download(QString storagePath, QString idToken, QString filePath)
+{
+    auto it = m_downloads.find(storagePath);
+    if(it != m_downloads.end()) {
+        it->destinations.append(filePath);
+        return;
+    }
+
+    if(m_cache->maxSize() <= 0 && filePath.isEmpty()) {
+        emit errorOcurred("No destination file while the cache is disabled", FirebaseError::BadRequest, storagePath);
+        return;
+    }
+
+    Download &download = m_downloads[storagePath];
+    download.storagePath = storagePath;
+    download.idToken = idToken;
+    download.destinations.append(filePath);
+    download.serial = m_nextSerial++;
+
+    if(m_cache->maxSize() > 0) {
+        qint64 validatedAt = 0;
+        download.cachedFile = m_cache->find(cacheName(storagePath), &download.cachedGeneration, &validatedAt);
+
+        // Recently validated copies are used without any network access
+        if(!download.cachedFile.isEmpty() && QDateTime::currentSecsSinceEpoch() - validatedAt < m_cacheMaxAge) {
+            const QString file = download.cachedFile;
+            const quint64 serial = download.serial;
+            QTimer::singleShot(0, this, [this, storagePath, serial, file]() {
+                deliver(storagePath, serial, file, true);
+            });
+            return;
+        }
+    }
+
+    fetchMetadata(download);
+}
+
+/*!
+    \qmlmethod void FirebaseStorage::cancelDownload(string storagePath)
+
+    Stops downloading the object at \a storagePath, no signal is emitted for it.
+ */
+void FirebaseStorage::cancelDownload(QString storagePath)
+{
+    auto it = m_downloads.find(storagePath);
+    if(it == m_downloads.end())
+        return;
+
+    const quint64 requestId = it->requestId;
+    stopRanges(*it);
+    m_downloads.erase(it);
+
+    if(requestId)
+        m_transport->cancel(requestId);
+}
+
+FirebaseStorage::Download *FirebaseStorage::findDownload(const QString &storagePath, quint64 serial)
+{
+    auto it = m_downloads.find(storagePath);
+    return it != m_downloads.end() && it->serial == serial ? &*it : nullptr;
+}
+
+// The metadata tells the size, generation and content hash, which decide whether the cache can be used
+void FirebaseStorage::fetchMetadata(Download &download)
+{
+    QNetworkRequest request(objectPathUrl(download.storagePath, false));
+    const QString token = authorization(download.idToken);
+    if(!token.isEmpty())
+        request.setRawHeader("Authorization", "Firebase " + token.toUtf8());
+
+    const QString storagePath = download.storagePath;
+    const quint64 serial = download.serial;
+    download.requestId = m_transport->send("GET", request, QByteArray(), this, [this, storagePath, serial](const FirebaseResponse &response) {
+        Download *download = findDownload(storagePath, serial);
+        if(!download)
+            return;
+        download->requestId = 0;
+
+        if(response.error != FirebaseError::NoError) {
+            // Offline, an outdated copy is better than nothing
+            if(!download->cachedFile.isEmpty() && FirebaseError::category(response.error) == FirebaseError::Retryable)
+                deliver(storagePath, serial, download->cachedFile, true);
+            else
+                failDownload(storagePath, response.error, response.errorString);
+            return;
+        }
+
+        const QJsonObject metadata = QJsonDocument::fromJson(response.body).object();
+        download->size = metadata["size"].toString().toLongLong();
+        download->generation = metadata["generation"].toString();
+        download->md5 = QByteArray::fromBase64(metadata["md5Hash"].toString().toLatin1());
+
+        // Composite objects have no MD5, their key is derived from the object identity instead
+        download->key = !download->md5.isEmpty() ? QString::fromLatin1(download->md5.toHex())
+                                                 : QString::fromLatin1(QCryptographicHash::hash((m_storageBucket + "/" + storagePath + "#" + download->generation).toUtf8(),
+                                                                                                QCryptographicHash::Sha1).toHex());
+
+        if(m_cache->maxSize() > 0) {
+            QString cached = download->cachedGeneration == download->generation ? download->cachedFile : QString();
+            if(cached.isEmpty())
+                cached = m_cache->findContent(download->key);
+
+            if(!cached.isEmpty()) {
+                m_cache->link(cacheName(storagePath), download->generation, download->key);
+                deliver(storagePath, serial, cached, true);
+                return;
+            }
+        }
+
+        const int rangeCount = download->size < 2 * minRangeSize ? 1 : static_cast<int>(qMin<qint64>(m_maxParallelRanges, download->size / minRangeSize));
+        startTransfer(*download, rangeCount);
+    });
+}
+
+// Splits the object into ranges written at their offset of a preallocated file, so no range is buffered in memory
+void FirebaseStorage::startTransfer(Download &download, int rangeCount)
+{
+    stopRanges(download);
+
+    download.tempFile = m_cache->maxSize() > 0 ? m_cache->temporaryFile(download.key) : download.destinations.first() + ".part";
+    download.file.reset(new QFile(download.tempFile));
+    download.received = 0;
+
+    if(!download.file->open(QIODevice::WriteOnly | QIODevice::Truncate) || !download.file->resize(download.size)) {
+        failDownload(download.storagePath, FirebaseError::UnknownError, "Cannot write " + download.tempFile);
+        return;
+    }
+
+    download.ranges.clear();
+    const qint64 span = download.size / rangeCount;
+    for(int i = 0; i < rangeCount; ++i) {
+        Range range;
+        range.start = i * span;
+        range.end = i == rangeCount - 1 ? download.size - 1 : (i + 1) * span - 1;
+        range.position = range.start;
+        download.ranges.append(range);
+    }
+
+    if(download.size == 0) {
+        completeTransfer(download);
+        return;
+    }
+
+    qCDebug(lcFirebaseStorage) << "Downloading" << download.storagePath << download.size << "bytes in" << rangeCount << "ranges";
+    for(int i = 0; i < rangeCount; ++i)
+        startRange(download, i);
+}
+
+void FirebaseStorage::startRange(Download &download, int index)
+{
+    Range &range = download.ranges[index];
+
+    QNetworkRequest request(objectPathUrl(download.storagePath, true));
+    const QString token = authorization(download.idToken);
+    if(!token.isEmpty())
+        request.setRawHeader("Authorization", "Firebase " + token.toUtf8());
+
+    range.ranged = download.ranges.size() > 1 || range.position > 0;
+    if(range.ranged)
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(range.position) + "-" + QByteArray::number(range.end));
+
+    // The id is only known once stream() returns, the callbacks find it in a shared slot
+    const QString storagePath = download.storagePath;
+    const quint64 serial = download.serial;
+    QSharedPointer<quint64> requestId(new quint64(0));
+    *requestId = m_transport->stream("GET", request, QByteArray(), this, [this, storagePath, serial, index, requestId](const FirebaseResponse &response, const QByteArray &data) {
+        readRange(storagePath, serial, index, *requestId, response, data);
+    }, [this, storagePath, serial, index, requestId](const FirebaseResponse &response) {
+        rangeFinished(storagePath, serial, index, *requestId, response);
+    });
+    range.requestId = *requestId;
+}
+
+void FirebaseStorage::readRange(const QString &storagePath, quint64 serial, int index, quint64 requestId, const FirebaseResponse &response, const QByteArray &data)
+{
+    Download *download = findDownload(storagePath, serial);
+    if(!download || download->ranges.value(index).requestId != requestId)
+        return;
+
+    // The server ignored the Range header and sends the whole object, continue with that single stream
+    Range &range = download->ranges[index];
+    if(range.ranged && response.status != 206) {
+        qCDebug(lcFirebaseStorage) << "Range requests not honoured for" << storagePath;
+        startTransfer(*download, 1);
+        return;
+    }
+
+    const QByteArray part = data.left(static_cast<int>(qMin<qint64>(data.size(), range.end + 1 - range.position)));
+    if(part.isEmpty())
+        return;
+
+    if(!download->file->seek(range.position) || download->file->write(part) != part.size()) {
+        failDownload(storagePath, FirebaseError::UnknownError, "Cannot write " + download->tempFile);
+        return;
+    }
+
+    range.position += part.size();
+    download->received += part.size();
+    emit downloadProgress(storagePath, download->received, download->size);
+}
+
+void FirebaseStorage::rangeFinished(const QString &storagePath, quint64 serial, int index, quint64 requestId, const FirebaseResponse &response)
+{
+    Download *download = findDownload(storagePath, serial);
+    if(!download || download->ranges.value(index).requestId != requestId)
+        return;
+
+    Range &range = download->ranges[index];
+    range.requestId = 0;
+
+    if(range.position <= range.end) {
+        const FirebaseError::Code code = response.error != FirebaseError::NoError ? response.error : FirebaseError::NetworkError;
+
+        // Continue the range where it stopped, the bytes already on disk are kept
+        if(FirebaseError::category(code) == FirebaseError::Retryable && range.attempts < m_transport->maxRetries()) {
+            const int delay = m_transport->retryDelay(range.attempts++);
+            qCDebug(lcFirebaseStorage) << "Range of" << storagePath << "interrupted at" << range.position << "retrying in" << delay << "ms";
+
+            QTimer::singleShot(delay, this, [this, storagePath, serial, index]() {
+                if(Download *download = findDownload(storagePath, serial))
+                    startRange(*download, index);
+            });
+            return;
+        }
+
+        failDownload(storagePath, code, response.error != FirebaseError::NoError ? response.errorString : FirebaseError::message(code));
+        return;
+    }
+
+    for(const Range &other : qAsConst(download->ranges)) {
+        if(other.position <= other.end)
+            return;
+    }
+
+    completeTransfer(*download);
+}
+
+void FirebaseStorage::stopRanges(Download &download)
+{
+    // Cancelled ranges still report back, their callbacks no longer find their id and do nothing
+    for(Range &range : download.ranges) {
+        if(const quint64 requestId = range.requestId) {
+            range.requestId = 0;
+            m_transport->cancel(requestId);
+        }
+    }
+
+    if(download.file) {
+        download.file->close();
+        download.file.reset();
+    }
+}
+
+void FirebaseStorage::completeTransfer(Download &download)
+{
+    download.file->close();
+    download.file.reset();
+
+    const QString storagePath = download.storagePath;
+    const quint64 serial = download.serial;
+
+    if(!download.md5.isEmpty()) {
+        QFile file(download.tempFile);
+        QCryptographicHash hash(QCryptographicHash::Md5);
+        if(!file.open(QIODevice::ReadOnly) || !hash.addData(&file) || hash.result() != download.md5) {
+            QFile::remove(download.tempFile);
+            failDownload(storagePath, FirebaseError::ServerError, "Downloaded data does not match its MD5 hash");
+            return;
+        }
+    }
+
+    QString file;
+    if(m_cache->maxSize() > 0) {
+        file = m_cache->insert(cacheName(storagePath), download.generation, download.key, download.tempFile);
+    } else {
+        file = download.destinations.first();
+        QFile::remove(file);
+        if(!QFile::rename(download.tempFile, file))
+            file.clear();
+    }
+
+    if(file.isEmpty()) {
+        failDownload(storagePath, FirebaseError::UnknownError, "Cannot store " + download.tempFile);
+        return;
+    }
+
+    deliver(storagePath, serial, file, false);
+}
+
+void FirebaseStorage::deliver(const QString &storagePath, quint64 serial, const QString &file, bool fromCache)
+{
+    Download *download = findDownload(storagePath, serial);
+    if(!download)
+        return;
+
+    const QStringList destinations = download->destinations;
+    m_downloads.remove(storagePath);
+
+    for(const QString &destination : destinations) {
+        if(!destination.isEmpty() && destination != file) {
+            QFile::remove(destination);
+            if(!QFile::copy(file, destination)) {
+                emit errorOcurred("Cannot write " + destination, FirebaseError::UnknownError, storagePath);
+                continue;
+            }
+        }
+
+        emit downloadFinished(storagePath, destination.isEmpty() ? file : destination, fromCache);
+    }
+}
+
+void FirebaseStorage::failDownload(const QString &storagePath, FirebaseError::Code code, const QString &error)
+{
+    auto it = m_downloads.find(storagePath);
+    if(it == m_downloads.end())
+        return;
+
+    stopRanges(*it);
+    if(!it->tempFile.isEmpty())
+        QFile::remove(it->tempFile);
+    m_downloads.erase(it);
+
+    qCWarning(lcFirebaseStorage) << "Download of" << storagePath << "failed:" << error;
+    emit errorOcurred(error, code, storagePath);
+}
+
+void FirebaseStorage::enqueue(const Upload &upload)
+{
+    Upload &queued = m_uploads[upload.storagePath] = upload;
+    queued.serial = m_nextSerial++;
+    m_queue.append(upload.storagePath);
+    processQueue();
+}
+
+void FirebaseStorage::processQueue()
+{
+    while(m_activeUploads < m_maxConcurrentUploads && !m_queue.isEmpty()) {
+        auto it = m_uploads.find(m_queue.takeFirst());
+        if(it == m_uploads.end())
+            continue;
+
+        it->active = true;
+        ++m_activeUploads;
+
+        // A known upload session may already hold part of the file, ask the server where to continue
+        if(it->sessionUrl.isValid())
+            querySession(*it);
+        else
+            startSession(*it);
+
+        emit activeUploadsChanged();
+    }
+}
+
+void FirebaseStorage::startSession(Upload &upload)
+{
+    QJsonObject metadata;
+    metadata["name"] = upload.storagePath;
+    metadata["contentType"] = upload.contentType;
+
+    const QList<QNetworkReply::RawHeaderPair> headers {
+        {"Content-Type", "application/json; charset=utf-8"},
+        {"X-Goog-Upload-Header-Content-Length", QByteArray::number(upload.size)},
+        {"X-Goog-Upload-Header-Content-Type", upload.contentType.toUtf8()}
+    };
+
+    sendUploadRequest(upload, objectUrl(upload.storagePath), "start", headers, QJsonDocument(metadata).toJson(QJsonDocument::Compact),
+                      FirebaseTransport::Idempotent, [this](Upload &upload, const FirebaseResponse &response) {
+        if(response.error != FirebaseError::NoError) {
+            interrupted(upload, response);
+            return;
+        }
+
+        upload.sessionUrl = QUrl(QString::fromUtf8(response.header("X-Goog-Upload-URL")));
+        const qint64 granularity = response.header("X-Goog-Upload-Chunk-Granularity").toLongLong();
+        if(granularity > 0)
+            upload.granularity = granularity;
+
+        if(!upload.sessionUrl.isValid()) {
+            FirebaseResponse invalid = response;
+            invalid.error = FirebaseError::ServerError;
+            invalid.errorString = "No upload session was created";
+            failUpload(upload, invalid, false);
+            return;
+        }
+
+        saveState(upload);
+        sendChunk(upload);
+    });
+}
+
+// Reads only the next chunk from disk, so an upload never holds more than one chunk in memory
+void FirebaseStorage::sendChunk(Upload &upload)
+{
+    const qint64 chunk = qMax(upload.granularity, m_chunkSize / upload.granularity * upload.granularity);
+    const qint64 length = qMin(chunk, upload.size - upload.offset);
+
+    QFile file(upload.filePath);
+    QByteArray data;
+    if(file.open(QIODevice::ReadOnly) && file.size() == upload.size && file.seek(upload.offset))
+        data = file.read(length);
+
+    if(data.size() != length) {
+        FirebaseResponse response;
+        response.error = FirebaseError::NotFound;
+        response.errorString = "File changed during upload: " + upload.filePath;
+        failUpload(upload, response, false);
+        return;
+    }
+
+    const bool last = upload.offset + length >= upload.size;
+    const QList<QNetworkReply::RawHeaderPair> headers { {"X-Goog-Upload-Offset", QByteArray::number(upload.offset)} };
+
+    // Chunks are not resent blindly, after a failure the server is asked how much it received
+    sendUploadRequest(upload, upload.sessionUrl, last ? "upload, finalize" : "upload", headers, data, FirebaseTransport::NoOptions,
+                      [this, length, last](Upload &upload, const FirebaseResponse &response) {
+        if(response.error != FirebaseError::NoError) {
+            interrupted(upload, response);
+            return;
+        }
+
+        upload.offset += length;
+        upload.resumeAttempts = 0;
+
+        const QString storagePath = upload.storagePath;
+        const quint64 serial = upload.serial;
+        emit uploadProgress(storagePath, upload.offset, upload.size);
+
+        // Handlers of the progress signal may have cancelled the upload
+        auto it = m_uploads.find(storagePath);
+        if(it == m_uploads.end() || it->serial != serial)
+            return;
+
+        if(last)
+            finishUpload(*it, response.body);
+        else
+            sendChunk(*it);
+    });
+}
+
+void FirebaseStorage::querySession(Upload &upload)
+{
+    sendUploadRequest(upload, upload.sessionUrl, "query", {}, QByteArray(), FirebaseTransport::Idempotent,
+                      [this](Upload &upload, const FirebaseResponse &response) {
+        if(response.error != FirebaseError::NoError) {
+            interrupted(upload, response);
+            return;
+        }
+
+        if(response.header("X-Goog-Upload-Status") == "final") {
+            finishUpload(upload, response.body);
+            return;
+        }
+
+        upload.offset = qBound<qint64>(0, response.header("X-Goog-Upload-Size-Received").toLongLong(), upload.size);
+        qCDebug(lcFirebaseStorage) << "Resuming" << upload.storagePath << "at" << upload.offset << "of" << upload.size;
+        sendChunk(upload);
+    });
+}
+
+void FirebaseStorage::interrupted(Upload &upload, const FirebaseResponse &response)
+{
+    if(upload.resumeAttempts >= maxResumeAttempts) {
+        failUpload(upload, response, FirebaseError::category(response.error) != FirebaseError::Fatal);
+        return;
+    }
+
+    ++upload.resumeAttempts;
+
+    // Upload sessions expire after a week, start over with a new one
+    if(upload.sessionUrl.isValid() && (response.error == FirebaseError::NotFound || response.status == 410)) {
+        qCDebug(lcFirebaseStorage) << "Upload session of" << upload.storagePath << "expired, starting again";
+        upload.sessionUrl = QUrl();
+        upload.offset = 0;
+        startSession(upload);
+        return;
+    }
+
+    if(FirebaseError::category(response.error) == FirebaseError::Fatal) {
+        failUpload(upload, response, false);
+        return;
+    }
+
+    // The transport already retried the request, wait a little longer before asking where to continue
+    const QString storagePath = upload.storagePath;
+    const quint64 serial = upload.serial;
+    const int delay = m_transport->retryDelay(upload.resumeAttempts + m_transport->maxRetries());
+    qCDebug(lcFirebaseStorage) << "Upload of" << storagePath << "interrupted, resuming in" << delay << "ms";
+
+    QTimer::singleShot(delay, this, [this, storagePath, serial]() {
+        auto it = m_uploads.find(storagePath);
+        if(it == m_uploads.end() || it->serial != serial)
+            return;
+
+        if(it->sessionUrl.isValid())
+            querySession(*it);
+        else
+            startSession(*it);
+    });
+}
+
+void FirebaseStorage::finishUpload(Upload &upload, const QByteArray &metadata)
+{
+    const QString storagePath = upload.storagePath;
+    forgetState(storagePath);
+    removeUpload(storagePath);
+
+    emit uploadFinished(storagePath, metadata);
+    processQueue();
+}
+
+void FirebaseStorage::failUpload(Upload &upload, const FirebaseResponse &response, bool keepState)
+{
+    const QString storagePath = upload.storagePath;
+    if(!keepState)
+        forgetState(storagePath);
+    removeUpload(storagePath);
+
+    qCWarning(lcFirebaseStorage) << "Upload of" << storagePath << "failed:" << response.errorString;
+    emit errorOcurred(response.errorString, response.error, storagePath);
+    processQueue();
+}
+
+void FirebaseStorage::removeUpload(const QString &storagePath)
+{
+    auto it = m_uploads.find(storagePath);
+    if(it == m_uploads.end())
+        return;
+
+    const bool active = it->active;
+    m_uploads.erase(it);
+    m_queue.removeAll(storagePath);
+
+    if(active) {
+        --m_activeUploads;
+        emit activeUploadsChanged();
+    }
+}
+
+quint64 FirebaseStorage::sendUploadRequest(Upload &upload, const QUrl &url, const QByteArray &command, const QList<QNetworkReply::RawHeaderPair> &headers,
+                                           const QByteArray &body, FirebaseTransport::Options options,
+                                           std::function<void(Upload &upload, const FirebaseResponse &response)> callback)
+{
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
+    request.setRawHeader("X-Goog-Upload-Protocol", "resumable");
+    request.setRawHeader("X-Goog-Upload-Command", command);
+    for(const QNetworkReply::RawHeaderPair &header : headers)
+        request.setRawHeader(header.first, header.second);
+
+    const QString token = authorization(upload.idToken);
+    if(!token.isEmpty())
+        request.setRawHeader("Authorization", "Firebase " + token.toUtf8());
+
+    // Answers to a cancelled or replaced upload are dropped
+    const QString storagePath = upload.storagePath;
+    const quint64 serial = upload.serial;
+    upload.requestId = m_transport->send("POST", request, body, this, [this, storagePath, serial, callback](const FirebaseResponse &response) {
+        auto it = m_uploads.find(storagePath);
+        if(it == m_uploads.end() || it->serial != serial)
+            return;
+
+        it->requestId = 0;
+        callback(*it, response);
+    }, options);
+
+    return upload.requestId;
+}
+
+QString FirebaseStorage::authorization(const QString &sessionOrToken) const
+{
+    return m_sessionPool && m_sessionPool->contains(sessionOrToken) ? m_sessionPool->idToken(sessionOrToken) : sessionOrToken;
+}
+
+QUrl FirebaseStorage::objectUrl(const QString &storagePath) const
+{
+    QUrl url(storageEndpoint + m_storageBucket + "/o");
+    url.setQuery("name=" + QString::fromLatin1(QUrl::toPercentEncoding(storagePath)), QUrl::StrictMode);
+    return url;
+}
+
+// URL of the object itself, with media set it returns the content instead of the metadata
+QUrl FirebaseStorage::objectPathUrl(const QString &storagePath, bool media) const
+{
+    QByteArray url = QByteArray(storageEndpoint) + m_storageBucket.toUtf8() + "/o/" + QUrl::toPercentEncoding(storagePath);
+    if(media)
+        url += "?alt=media";
+    return QUrl::fromEncoded(url, QUrl::StrictMode);
+}
+
+// The cache is shared by the objects of every bucket, so entries are named by bucket and path
+QString FirebaseStorage::cacheName(const QString &storagePath) const
+{
+    return "gs://" + m_storageBucket + "/" + storagePath;
+}
+
+void FirebaseStorage::loadState()
+{
+    if(m_stateLoaded)
+        return;
+    m_stateLoaded = true;
+
+    QFile file(m_stateFile);
+    if(!m_stateFile.isEmpty() && file.open(QIODevice::ReadOnly))
+        m_state = QJsonDocument::fromJson(file.readAll()).object();
+}
+
+// Only the session is stored, the received size is asked from the server when resuming
+void FirebaseStorage::saveState(const Upload &upload)
+{
+    loadState();
+
+    QJsonObject saved;
+    saved["file"] = upload.filePath;
+    saved["size"] = static_cast<double>(upload.size);
+    saved["modified"] = static_cast<double>(upload.modified.toMSecsSinceEpoch());
+    saved["contentType"] = upload.contentType;
+    saved["sessionUrl"] = upload.sessionUrl.toString();
+    m_state[upload.storagePath] = saved;
+    writeState();
+}
+
+void FirebaseStorage::forgetState(const QString &storagePath)
+{
+    loadState();
+
+    if(!m_state.contains(storagePath))
+        return;
+
+    m_state.remove(storagePath);
+    writeState();
+}
+
+void FirebaseStorage::writeState()
+{
+    if(m_stateFile.isEmpty())
+        return;
+
+    QDir().mkpath(QFileInfo(m_stateFile).absolutePath());
+    QSaveFile file(m_stateFile);
+    if(file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(m_state).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
@@ -0,0 +1,179 @@
+#ifndef FIREBASESTORAGE_H
+#define FIREBASESTORAGE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QVector>
+#include <QFile>
+#include "firebasetransport.h"
+#include "firebasesessionpool.h"
+#include "firebasestoragecache.h"
+
+class FirebaseStorage : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString storageBucket READ storageBucket WRITE setStorageBucket REQUIRED)
+    Q_PROPERTY(FirebaseSessionPool* sessionPool READ sessionPool WRITE setSessionPool NOTIFY sessionPoolChanged)
+    Q_PROPERTY(int maxConcurrentUploads READ maxConcurrentUploads WRITE setMaxConcurrentUploads NOTIFY maxConcurrentUploadsChanged)
+    Q_PROPERTY(int chunkSize READ chunkSize WRITE setChunkSize NOTIFY chunkSizeChanged)
+    Q_PROPERTY(int activeUploads READ activeUploads NOTIFY activeUploadsChanged)
+    Q_PROPERTY(int maxParallelRanges READ maxParallelRanges WRITE setMaxParallelRanges NOTIFY maxParallelRangesChanged)
+    Q_PROPERTY(qint64 cacheSize READ cacheSize WRITE setCacheSize NOTIFY cacheSizeChanged)
+    Q_PROPERTY(int cacheMaxAge READ cacheMaxAge WRITE setCacheMaxAge NOTIFY cacheMaxAgeChanged)
+
+public:
+    explicit FirebaseStorage(QObject *parent = nullptr);
+
+    QString storageBucket() const;
+    void setStorageBucket(const QString &storageBucket);
+
+    FirebaseSessionPool *sessionPool() const;
+    void setSessionPool(FirebaseSessionPool *sessionPool);
+
+    int maxConcurrentUploads() const;
+    void setMaxConcurrentUploads(int maxConcurrentUploads);
+
+    int chunkSize() const;
+    void setChunkSize(int chunkSize);
+
+    int activeUploads() const;
+
+    int maxParallelRanges() const;
+    void setMaxParallelRanges(int maxParallelRanges);
+
+    qint64 cacheSize() const;
+    void setCacheSize(qint64 cacheSize);
+
+    int cacheMaxAge() const;
+    void setCacheMaxAge(int cacheMaxAge);
+
+    QString stateFile() const;
+    void setStateFile(const QString &stateFile);
+
+public slots:
+    void upload(QString filePath, QString storagePath, QString idToken, QString contentType = QString());
+    void cancelUpload(QString storagePath);
+    void resumeUploads(QString idToken);
+
+    void download(QString storagePath, QString idToken, QString filePath = QString());
+    void cancelDownload(QString storagePath);
+
+signals:
+    void sessionPoolChanged();
+    void maxConcurrentUploadsChanged();
+    void chunkSizeChanged();
+    void activeUploadsChanged();
+    void maxParallelRangesChanged();
+    void cacheSizeChanged();
+    void cacheMaxAgeChanged();
+
+    void uploadProgress(QString storagePath, qint64 bytesSent, qint64 bytesTotal);
+    void uploadFinished(QString storagePath, QByteArray metadata);
+    void downloadProgress(QString storagePath, qint64 bytesReceived, qint64 bytesTotal);
+    void downloadFinished(QString storagePath, QString filePath, bool fromCache);
+    void errorOcurred(QString error, FirebaseError::Code code, QString storagePath);
+
+private:
+    struct Upload {
+        QString storagePath;
+        QString filePath;
+        QString contentType;
+        QString idToken;
+        qint64 size = 0;
+        QDateTime modified;
+        QUrl sessionUrl;
+        qint64 offset = 0;
+        qint64 granularity = 256 * 1024;
+        quint64 serial = 0;
+        quint64 requestId = 0;
+        int resumeAttempts = 0;
+        bool active = false;
+    };
+
+    struct Range {
+        qint64 start = 0;
+        qint64 end = 0;             // Inclusive
+        qint64 position = 0;
+        int attempts = 0;
+        bool ranged = false;        // Sent with a Range header, the answer must be 206
+        quint64 requestId = 0;
+    };
+
+    struct Download {
+        QString storagePath;
+        QString idToken;
+        QStringList destinations;
+        QString cachedFile;         // Possibly outdated copy, used when the server cannot be reached
+        QString cachedGeneration;
+        QString key;
+        QString generation;
+        QByteArray md5;
+        qint64 size = 0;
+        qint64 received = 0;
+        QString tempFile;
+        QSharedPointer<QFile> file;
+        QVector<Range> ranges;
+        quint64 serial = 0;
+        quint64 requestId = 0;
+    };
+
+    void enqueue(const Upload &upload);
+    void processQueue();
+    void startSession(Upload &upload);
+    void sendChunk(Upload &upload);
+    void querySession(Upload &upload);
+    void interrupted(Upload &upload, const FirebaseResponse &response);
+    void finishUpload(Upload &upload, const QByteArray &metadata);
+    void failUpload(Upload &upload, const FirebaseResponse &response, bool keepState);
+    void removeUpload(const QString &storagePath);
+
+    quint64 sendUploadRequest(Upload &upload, const QUrl &url, const QByteArray &command, const QList<QNetworkReply::RawHeaderPair> &headers,
+                              const QByteArray &body, FirebaseTransport::Options options,
+                              std::function<void(Upload &upload, const FirebaseResponse &response)> callback);
+    Download *findDownload(const QString &storagePath, quint64 serial);
+    void fetchMetadata(Download &download);
+    void startTransfer(Download &download, int rangeCount);
+    void startRange(Download &download, int index);
+    void readRange(const QString &storagePath, quint64 serial, int index, quint64 requestId, const FirebaseResponse &response, const QByteArray &data);
+    void rangeFinished(const QString &storagePath, quint64 serial, int index, quint64 requestId, const FirebaseResponse &response);
+    void stopRanges(Download &download);
+    void completeTransfer(Download &download);
+    void deliver(const QString &storagePath, quint64 serial, const QString &file, bool fromCache);
+    void failDownload(const QString &storagePath, FirebaseError::Code code, const QString &error);
+
+    QString authorization(const QString &sessionOrToken) const;
+    QUrl objectUrl(const QString &storagePath) const;
+    QUrl objectPathUrl(const QString &storagePath, bool media) const;
+    QString cacheName(const QString &storagePath) const;
+
+    void loadState();
+    void saveState(const Upload &upload);
+    void forgetState(const QString &storagePath);
+    void writeState();
+
+    QString m_storageBucket;
+    QPointer<FirebaseSessionPool> m_sessionPool;
+    FirebaseTransport *m_transport;
+    int m_maxConcurrentUploads = 2;
+    int m_chunkSize = 2 * 1024 * 1024;
+    int m_activeUploads = 0;
+    quint64 m_nextSerial = 1;
+    QHash<QString, Upload> m_uploads;
+    QStringList m_queue;
+
+    FirebaseStorageCache *m_cache;
+    int m_maxParallelRanges = 4;
+    int m_cacheMaxAge = 3600;
+    QHash<QString, Download> m_downloads;
+
+    QString m_stateFile;
+    QJsonObject m_state;
+    bool m_stateLoaded = false;
+};
+
+#endif // FIREBASESTORAGE_H
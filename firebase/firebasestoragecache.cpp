@@ -0,0 +1,351 @@
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadStorage>
+#include <QVector>
+#include <QPair>
+#include <QSet>
+#include <algorithm>
+#include "firebasestoragecache.h"
+
+namespace {
+
+const int saveDelay = 1000;
+
+/*
+    Directories owned by live caches. Each cache cleans up tmp/, rewrites index.json and evicts files of its directory
+    as if it was alone, so a directory already in use, e.g by the cache of another thread, gets a numbered sibling.
+*/
+QMutex directoriesMutex;
+
+QSet<QString> &directoriesInUse()
+{
+    static QSet<QString> directories;
+    return directories;
+}
+
+QString claimDirectory(const QString &directory)
+{
+    if(directory.isEmpty())
+        return directory;
+
+    QMutexLocker locker(&directoriesMutex);
+    QString claimed = directory;
+    for(int n = 2; directoriesInUse().contains(claimed); ++n)
+        claimed = directory + '-' + QString::number(n);
+
+    directoriesInUse().insert(claimed);
+    return claimed;
+}
+
+void releaseDirectory(const QString &directory)
+{
+    QMutexLocker locker(&directoriesMutex);
+    directoriesInUse().remove(directory);
+}
+
+}
+
+/*
+    Objects are stored once per content key (the MD5 hash reported by Storage), several storage paths with the same
+    content share one file. The index maps object names to a key and the generation it was downloaded at, which is
+    compared with the server metadata before reusing it. Names must tell apart objects of different buckets. Once the total size exceeds maxSize, the least recently used
+    content is removed.
+*/
+FirebaseStorageCache::FirebaseStorageCache(QObject *parent) : QObject(parent)
+{
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(saveDelay);
+    connect(&m_saveTimer, &QTimer::timeout, this, &FirebaseStorageCache::save);
+
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if(!cacheDir.isEmpty())
+        m_directory = claimDirectory(cacheDir + "/firebase/storage");
+}
+
+// Cache shared by all FirebaseStorage objects living in the calling thread, so they see each other's downloads. The
+// caches of other threads get directories of their own
+FirebaseStorageCache *FirebaseStorageCache::shared()
+{
+    static QThreadStorage<FirebaseStorageCache *> caches;
+    if(!caches.hasLocalData())
+        caches.setLocalData(new FirebaseStorageCache);
+
+    return caches.localData();
+}
+
+FirebaseStorageCache::~FirebaseStorageCache()
+{
+    if(m_saveTimer.isActive())
+        save();
+
+    releaseDirectory(m_directory);
+}
+
+// The directory actually used, which is numbered if another cache already uses the requested one
+QString FirebaseStorageCache::directory() const
+{
+    return m_directory;
+}
+
+void FirebaseStorageCache::setDirectory(const QString &directory)
+{
+    if(m_saveTimer.isActive())
+        save();
+
+    releaseDirectory(m_directory);
+    m_directory = claimDirectory(directory);
+    m_loaded = false;
+    m_entries.clear();
+    m_objects.clear();
+    m_size = 0;
+}
+
+qint64 FirebaseStorageCache::maxSize() const
+{
+    return m_maxSize;
+}
+
+void FirebaseStorageCache::setMaxSize(qint64 maxSize)
+{
+    m_maxSize = maxSize;
+    if(m_loaded)
+        evict(QString());
+}
+
+qint64 FirebaseStorageCache::size() const
+{
+    return m_size;
+}
+
+// Cached file of storagePath with the generation it had when it was downloaded or last validated
+QString FirebaseStorageCache::find(const QString &storagePath, QString *generation, qint64 *validatedAt)
+{
+    load();
+
+    const auto it = m_objects.constFind(storagePath);
+    if(it == m_objects.cend())
+        return QString();
+
+    const QString file = findContent(it->key);
+    if(file.isEmpty()) {
+        m_objects.remove(storagePath);
+        scheduleSave();
+        return QString();
+    }
+
+    if(generation)
+        *generation = it->generation;
+    if(validatedAt)
+        *validatedAt = it->validatedAt;
+    return file;
+}
+
+QString FirebaseStorageCache::findContent(const QString &key)
+{
+    load();
+
+    if(!m_entries.contains(key))
+        return QString();
+
+    const QString file = contentFile(key);
+    if(!QFile::exists(file)) {
+        m_size -= m_entries.take(key).size;
+        scheduleSave();
+        return QString();
+    }
+
+    touch(key);
+    return file;
+}
+
+// Records that storagePath at generation has the content key, validated now
+void FirebaseStorageCache::link(const QString &storagePath, const QString &generation, const QString &key)
+{
+    load();
+
+    Object &object = m_objects[storagePath];
+    object.key = key;
+    object.generation = generation;
+    object.validatedAt = QDateTime::currentSecsSinceEpoch();
+    scheduleSave();
+}
+
+// Moves a completely downloaded file into the cache and returns its new location
+QString FirebaseStorageCache::insert(const QString &storagePath, const QString &generation, const QString &key, const QString &file)
+{
+    load();
+
+    const QString target = contentFile(key);
+    if(m_entries.contains(key))
+        m_size -= m_entries.take(key).size;
+    QFile::remove(target);
+
+    if(!QFile::rename(file, target))
+        return QString();
+
+    Entry &entry = m_entries[key];
+    entry.size = QFileInfo(target).size();
+    m_size += entry.size;
+    touch(key);
+    link(storagePath, generation, key);
+
+    evict(key);
+    return target;
+}
+
+void FirebaseStorageCache::remove(const QString &storagePath)
+{
+    load();
+
+    if(m_objects.remove(storagePath))
+        scheduleSave();
+}
+
+// A new file for every transfer, downloads of the same content may run at the same time
+QString FirebaseStorageCache::temporaryFile(const QString &key)
+{
+    load();
+
+    QDir().mkpath(m_directory + "/tmp");
+    return m_directory + "/tmp/" + key + "-" + QString::number(++m_temporaryCount) + ".part";
+}
+
+QString FirebaseStorageCache::contentFile(const QString &key) const
+{
+    return m_directory + "/" + key;
+}
+
+void FirebaseStorageCache::touch(const QString &key)
+{
+    m_entries[key].lastUsed = QDateTime::currentMSecsSinceEpoch();
+    scheduleSave();
+}
+
+// Removes the least recently used content until the cache fits, keep is never removed
+void FirebaseStorageCache::evict(const QString &keep)
+{
+    if(m_size <= m_maxSize)
+        return;
+
+    QVector<QPair<qint64, QString>> byAge;
+    byAge.reserve(m_entries.size());
+    for(auto it = m_entries.cbegin(); it != m_entries.cend(); ++it)
+        byAge.append(qMakePair(it->lastUsed, it.key()));
+    std::sort(byAge.begin(), byAge.end());
+
+    for(const auto &candidate : byAge) {
+        if(m_size <= m_maxSize)
+            break;
+        if(candidate.second == keep)
+            continue;
+
+        QFile::remove(contentFile(candidate.second));
+        m_size -= m_entries.take(candidate.second).size;
+    }
+
+    // Paths pointing to removed content are forgotten
+    for(auto it = m_objects.begin(); it != m_objects.end();) {
+        if(m_entries.contains(it->key))
+            ++it;
+        else
+            it = m_objects.erase(it);
+    }
+
+    scheduleSave();
+}
+
+void FirebaseStorageCache::load()
+{
+    if(m_loaded)
+        return;
+    m_loaded = true;
+
+    if(m_directory.isEmpty())
+        return;
+
+    QDir().mkpath(m_directory);
+
+    // Partial downloads of a previous run cannot be trusted
+    QDir(m_directory + "/tmp").removeRecursively();
+
+    QFile file(m_directory + "/index.json");
+    if(!file.open(QIODevice::ReadOnly))
+        return;
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+
+    const QJsonObject entries = root["entries"].toObject();
+    for(auto it = entries.begin(); it != entries.end(); ++it) {
+        const QFileInfo info(contentFile(it.key()));
+        if(!info.isFile())
+            continue;
+
+        Entry entry;
+        entry.size = info.size();
+        entry.lastUsed = static_cast<qint64>(it.value().toObject()["lastUsed"].toDouble());
+        m_entries.insert(it.key(), entry);
+        m_size += entry.size;
+    }
+
+    const QJsonObject objects = root["objects"].toObject();
+    for(auto it = objects.begin(); it != objects.end(); ++it) {
+        const QJsonObject saved = it.value().toObject();
+
+        Object object;
+        object.key = saved["key"].toString();
+        object.generation = saved["generation"].toString();
+        object.validatedAt = static_cast<qint64>(saved["validatedAt"].toDouble());
+        if(m_entries.contains(object.key))
+            m_objects.insert(it.key(), object);
+    }
+
+    evict(QString());
+}
+
+// Access times change on every hit, so the index is written once things settle
+void FirebaseStorageCache::scheduleSave()
+{
+    if(!m_directory.isEmpty())
+        m_saveTimer.start();
+}
+
+void FirebaseStorageCache::save()
+{
+    m_saveTimer.stop();
+    if(m_directory.isEmpty())
+        return;
+
+    QJsonObject entries;
+    for(auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        QJsonObject entry;
+        entry["size"] = static_cast<double>(it->size);
+        entry["lastUsed"] = static_cast<double>(it->lastUsed);
+        entries[it.key()] = entry;
+    }
+
+    QJsonObject objects;
+    for(auto it = m_objects.cbegin(); it != m_objects.cend(); ++it) {
+        QJsonObject object;
+        object["key"] = it->key;
+        object["generation"] = it->generation;
+        object["validatedAt"] = static_cast<double>(it->validatedAt);
+        objects[it.key()] = object;
+    }
+
+    QJsonObject root;
+    root["entries"] = entries;
+    root["objects"] = objects;
+
+    QDir().mkpath(m_directory);
+    QSaveFile file(m_directory + "/index.json");
+    if(file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
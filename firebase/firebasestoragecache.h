@@ -0,0 +1,65 @@
+#ifndef FIREBASESTORAGECACHE_H
+#define FIREBASESTORAGECACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QJsonObject>
+
+// Content addressed, size bounded LRU cache of downloaded Storage objects, used by FirebaseStorage
+class FirebaseStorageCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FirebaseStorageCache(QObject *parent = nullptr);
+    ~FirebaseStorageCache();
+
+    static FirebaseStorageCache *shared();
+
+    QString directory() const;
+    void setDirectory(const QString &directory);
+
+    qint64 maxSize() const;
+    void setMaxSize(qint64 maxSize);
+
+    qint64 size() const;
+
+    QString find(const QString &storagePath, QString *generation = nullptr, qint64 *validatedAt = nullptr);
+    QString findContent(const QString &key);
+    void link(const QString &storagePath, const QString &generation, const QString &key);
+    QString insert(const QString &storagePath, const QString &generation, const QString &key, const QString &file);
+    void remove(const QString &storagePath);
+
+    QString temporaryFile(const QString &key);
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        qint64 lastUsed = 0;
+    };
+
+    struct Object {
+        QString key;
+        QString generation;
+        qint64 validatedAt = 0;
+    };
+
+    QString contentFile(const QString &key) const;
+    void touch(const QString &key);
+    void evict(const QString &keep);
+    void load();
+    void scheduleSave();
+    void save();
+
+    QString m_directory;
+    qint64 m_maxSize = 256 * 1024 * 1024;
+    qint64 m_size = 0;
+    QHash<QString, Entry> m_entries;
+    QHash<QString, Object> m_objects;
+    bool m_loaded = false;
+    quint64 m_temporaryCount = 0;
+    QTimer m_saveTimer;
+};
+
+#endif // FIREBASESTORAGECACHE_H
@@ -0,0 +1,408 @@
+#ifndef FIREBASETASK_H
+#define FIREBASETASK_H
+
+// The awaitable API needs C++20 coroutines, e.g CONFIG += c++2a (and QMAKE_CXXFLAGS += -fcoroutines on GCC 10)
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define FIREBASE_HAS_COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <QCoreApplication>
+#include "firebasetransport.h"
+
+namespace FirebaseTaskDetail {
+class RequestState;
+}
+
+// Cancels every awaitable operation it was passed to, it must outlive the operations
+class FirebaseCancellation
+{
+public:
+    FirebaseCancellation() = default;
+    FirebaseCancellation(const FirebaseCancellation &) = delete;
+    FirebaseCancellation &operator=(const FirebaseCancellation &) = delete;
+
+    bool isCancelled() const { return m_cancelled; }
+
+    void cancel()
+    {
+        if(m_cancelled)
+            return;
+        m_cancelled = true;
+
+        // Callbacks may unsubscribe while running, so iterate over a snapshot
+        const auto callbacks = m_callbacks;
+        for(const auto &callback : callbacks) {
+            if(m_callbacks.count(callback.first))
+                callback.second();
+        }
+        m_callbacks.clear();
+    }
+
+private:
+    friend class FirebaseTaskDetail::RequestState;
+
+    int subscribe(std::function<void()> callback)
+    {
+        m_callbacks.emplace_back(++m_lastId, std::move(callback));
+        return m_lastId;
+    }
+
+    void unsubscribe(int id)
+    {
+        for(auto it = m_callbacks.begin(); it != m_callbacks.end(); ++it) {
+            if(it->first == id) {
+                m_callbacks.erase(it);
+                return;
+            }
+        }
+    }
+
+    struct Callbacks : std::vector<std::pair<int, std::function<void()>>> {
+        int count(int id) const
+        {
+            for(const auto &callback : *this) {
+                if(callback.first == id)
+                    return 1;
+            }
+            return 0;
+        }
+    };
+
+    Callbacks m_callbacks;
+    bool m_cancelled = false;
+    int m_lastId = 0;
+};
+
+struct FirebaseRequestOptions
+{
+    int timeout = 0;                                    // Milliseconds, 0 waits until the transport gives up
+    FirebaseCancellation *cancellation = nullptr;
+};
+
+template<typename T>
+class FirebaseTask;
+
+namespace FirebaseTaskDetail {
+
+/*
+    Everything a suspended request needs in a single allocation living in the awaiting thread: the timeout timer, the
+    queued resume and the watch on the context. It outlives the awaiter until the transport callback has run or was
+    dropped together with the context, so late responses, e.g of memory:// requests that timed out, find it.
+*/
+class RequestState : public QObject
+{
+public:
+    RequestState(FirebaseTransport *transport, QObject *context, std::coroutine_handle<> handle, const FirebaseRequestOptions &options)
+        : m_transport(transport), m_handle(handle), m_cancellation(options.cancellation)
+    {
+        // The transport drops the callback of a request whose context is destroyed, the coroutine would never resume
+        connect(context, &QObject::destroyed, this, &RequestState::contextDestroyed);
+
+        if(options.timeout > 0)
+            m_timerId = startTimer(options.timeout);
+        if(m_cancellation)
+            m_subscription = m_cancellation->subscribe([this]() { abandon(FirebaseError::Cancelled); });
+    }
+
+    void started(quint64 requestId) { m_requestId = requestId; }
+
+    // The final response from the transport, also when the request was cancelled through it
+    void respond(const FirebaseResponse &response)
+    {
+        m_callbackPending = false;
+        finish(response);
+        releaseIfDone();
+    }
+
+    // The awaiter is destroyed, normally right after resuming
+    void detach()
+    {
+        m_handle = nullptr;
+        abandon(FirebaseError::Cancelled);
+    }
+
+    FirebaseResponse takeResponse() { return std::move(m_response); }
+
+protected:
+    void timerEvent(QTimerEvent *) override { abandon(FirebaseError::TimeoutError); }
+
+    void customEvent(QEvent *) override
+    {
+        if(const std::coroutine_handle<> handle = std::exchange(m_handle, nullptr))
+            handle.resume();
+        m_resumed = true;
+        releaseIfDone();
+    }
+
+private:
+    void contextDestroyed()
+    {
+        m_callbackPending = false;
+        abandon(FirebaseError::Cancelled);
+        releaseIfDone();
+    }
+
+    // Cancelling completes the call through the transport callback. Requests without an id, such as memory:// ones,
+    // cannot be cancelled and are completed here; their response is dropped when it arrives
+    void abandon(FirebaseError::Code reason)
+    {
+        if(m_finished)
+            return;
+
+        if(m_requestId)
+            m_transport->cancel(m_requestId, reason);
+
+        if(!m_finished) {
+            FirebaseResponse response;
+            response.error = reason;
+            response.errorString = FirebaseError::message(reason);
+            finish(response);
+        }
+    }
+
+    void finish(const FirebaseResponse &response)
+    {
+        if(m_finished)
+            return;
+
+        m_finished = true;
+        m_response = response;
+        if(m_timerId) {
+            killTimer(m_timerId);
+            m_timerId = 0;
+        }
+        if(m_subscription) {
+            m_cancellation->unsubscribe(m_subscription);
+            m_subscription = 0;
+        }
+
+        // Resumed from customEvent(), never inside the transport callback or a timer event
+        QCoreApplication::postEvent(this, new QEvent(QEvent::User));
+    }
+
+    void releaseIfDone()
+    {
+        if(m_resumed && !m_callbackPending)
+            deleteLater();
+    }
+
+    FirebaseTransport *m_transport;
+    std::coroutine_handle<> m_handle;
+    FirebaseCancellation *m_cancellation;
+    quint64 m_requestId = 0;
+    int m_timerId = 0;
+    int m_subscription = 0;
+    bool m_callbackPending = true;
+    bool m_finished = false;
+    bool m_resumed = false;
+    FirebaseResponse m_response;
+};
+
+}
+
+/*
+    Awaitable for a single request sent through FirebaseTransport. The awaiting coroutine is resumed from the
+    Qt event loop when the final response arrives, or when the request times out, is cancelled or its context,
+    the object passed to the transport, is destroyed. Resuming is always queued, so the coroutine never continues
+    inside the transport callback or a timer event. The starter is called once with the transport callback and
+    returns the request id; it is kept by value, so capturing lambdas cost no allocation of their own.
+*/
+template<typename Starter>
+class FirebaseRequestAwaiter
+{
+public:
+    FirebaseRequestAwaiter(FirebaseTransport *transport, QObject *context, Starter starter, FirebaseRequestOptions options)
+        : m_transport(transport), m_context(context), m_starter(std::move(starter)), m_options(options)
+    {
+    }
+
+    ~FirebaseRequestAwaiter()
+    {
+        if(m_state)
+            m_state->detach();
+    }
+
+    FirebaseRequestAwaiter(const FirebaseRequestAwaiter &) = delete;
+    FirebaseRequestAwaiter &operator=(const FirebaseRequestAwaiter &) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        if(m_options.cancellation && m_options.cancellation->isCancelled()) {
+            m_response.error = FirebaseError::Cancelled;
+            m_response.errorString = FirebaseError::message(FirebaseError::Cancelled);
+            return false;
+        }
+
+        FirebaseTaskDetail::RequestState *state = new FirebaseTaskDetail::RequestState(m_transport, m_context, handle, m_options);
+        m_state = state;
+
+        // Only a pointer is captured, which fits into std::function without allocating
+        state->started(m_starter(FirebaseTransport::Callback([state](const FirebaseResponse &response) {
+            state->respond(response);
+        })));
+        return true;
+    }
+
+    FirebaseResponse await_resume() { return m_state ? m_state->takeResponse() : std::move(m_response); }
+
+private:
+    FirebaseTransport *m_transport;
+    QObject *m_context;
+    Starter m_starter;
+    FirebaseRequestOptions m_options;
+    FirebaseTaskDetail::RequestState *m_state = nullptr;
+    FirebaseResponse m_response;
+};
+
+namespace FirebaseTaskDetail {
+
+template<typename Promise>
+struct FinalAwaiter
+{
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+    {
+        Promise &promise = handle.promise();
+        if(promise.continuation)
+            return promise.continuation;
+
+        // Nobody holds the task anymore, release the frame now that the result is not needed
+        if(promise.detached)
+            handle.destroy();
+        return std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+template<typename T>
+struct Promise;
+
+// Everything but how the result is stored, shared by tasks with and without a result
+template<typename T>
+struct PromiseBase
+{
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+    bool detached = false;
+
+    FirebaseTask<T> get_return_object();
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    FinalAwaiter<Promise<T>> final_suspend() noexcept { return {}; }
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    void rethrow() const
+    {
+        if(exception)
+            std::rethrow_exception(exception);
+    }
+};
+
+template<typename T>
+struct Promise : PromiseBase<T>
+{
+    std::optional<T> value;
+
+    template<typename U>
+    void return_value(U &&result) { value.emplace(std::forward<U>(result)); }
+    T result()
+    {
+        this->rethrow();
+        return std::move(*value);
+    }
+};
+
+template<>
+struct Promise<void> : PromiseBase<void>
+{
+    void return_void() {}
+    void result() { rethrow(); }
+};
+
+}
+
+/*
+    Coroutine type returned by the awaitable API. Tasks start running immediately, so several operations can be
+    started first and awaited afterwards to run them concurrently. A task may be dropped without awaiting it.
+*/
+template<typename T>
+class FirebaseTask
+{
+public:
+    using promise_type = FirebaseTaskDetail::Promise<T>;
+
+    FirebaseTask(FirebaseTask &&other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+    FirebaseTask &operator=(FirebaseTask &&other) noexcept
+    {
+        if(this != &other) {
+            release();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+    ~FirebaseTask() { release(); }
+
+    bool isFinished() const { return !m_handle || m_handle.done(); }
+
+    auto operator co_await() noexcept
+    {
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept { return handle.done(); }
+            void await_suspend(std::coroutine_handle<> awaiting) noexcept { handle.promise().continuation = awaiting; }
+            T await_resume() { return handle.promise().result(); }
+        };
+        return Awaiter{m_handle};
+    }
+
+private:
+    friend struct FirebaseTaskDetail::PromiseBase<T>;
+
+    explicit FirebaseTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+    void release()
+    {
+        if(!m_handle)
+            return;
+
+        if(m_handle.done())
+            m_handle.destroy();
+        else
+            m_handle.promise().detached = true;
+        m_handle = nullptr;
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+template<typename T>
+FirebaseTask<T> FirebaseTaskDetail::PromiseBase<T>::get_return_object()
+{
+    return FirebaseTask<T>(std::coroutine_handle<Promise<T>>::from_promise(static_cast<Promise<T> &>(*this)));
+}
+
+// Awaits all tasks, which are already running concurrently, and returns their results in order
+template<typename T>
+FirebaseTask<std::vector<T>> firebaseWhenAll(std::vector<FirebaseTask<T>> tasks)
+{
+    std::vector<T> results;
+    results.reserve(tasks.size());
+    for(FirebaseTask<T> &task : tasks)
+        results.push_back(co_await task);
+
+    co_return results;
+}
+
+#endif
+
+#endif // FIREBASETASK_H
@@ -0,0 +1,406 @@
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkReply>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+#include "firebasetokenverifier.h"
+#include "utils/JwtUtils.h"
+
+namespace {
+
+// Minimal arbitrary precision arithmetic needed to verify RS256 signatures. Numbers are stored as
+// little-endian 32-bit limbs and exponentiation uses Montgomery multiplication, so only the public
+// key operation (s^e mod n) is implemented.
+using Limbs = QVector<quint32>;
+
+Limbs limbsFromBigEndian(const QByteArray &bytes, int limbCount)
+{
+    Limbs result(limbCount, 0);
+    const int size = bytes.size();
+    for(int i = 0; i < size && i / 4 < limbCount; ++i) {
+        const quint32 byte = static_cast<quint8>(bytes.at(size - 1 - i));
+        result[i / 4] |= byte << (8 * (i % 4));
+    }
+    return result;
+}
+
+QByteArray limbsToBigEndian(const Limbs &limbs, int length)
+{
+    QByteArray result(length, '\0');
+    for(int i = 0; i < length && i / 4 < limbs.size(); ++i)
+        result[length - 1 - i] = static_cast<char>(limbs.at(i / 4) >> (8 * (i % 4)));
+    return result;
+}
+
+// Returns true if a >= b, both with the same number of limbs
+bool greaterOrEqual(const Limbs &a, const Limbs &b)
+{
+    for(int i = a.size() - 1; i >= 0; --i) {
+        if(a.at(i) != b.at(i))
+            return a.at(i) > b.at(i);
+    }
+    return true;
+}
+
+void subtractInPlace(Limbs &a, const Limbs &b)
+{
+    quint64 borrow = 0;
+    for(int i = 0; i < a.size(); ++i) {
+        const quint64 diff = quint64(a.at(i)) - b.at(i) - borrow;
+        a[i] = static_cast<quint32>(diff);
+        borrow = (diff >> 32) & 1;
+    }
+}
+
+class Montgomery
+{
+public:
+    explicit Montgomery(const Limbs &modulus) : m_n(modulus), m_k(modulus.size())
+    {
+        // -n^-1 mod 2^32 by Newton iteration
+        quint32 inv = 1;
+        for(int i = 0; i < 5; ++i)
+            inv *= 2 - m_n.at(0) * inv;
+        m_n0inv = ~inv + 1;
+
+        // R^2 mod n by repeated doubling, R = 2^(32k)
+        m_r2 = Limbs(m_k, 0);
+        m_r2[0] = 1;
+        for(int i = 0; i < 64 * m_k; ++i) {
+            quint32 carry = 0;
+            for(int j = 0; j < m_k; ++j) {
+                const quint32 next = m_r2.at(j) >> 31;
+                m_r2[j] = (m_r2.at(j) << 1) | carry;
+                carry = next;
+            }
+            if(carry || greaterOrEqual(m_r2, m_n))
+                subtractInPlace(m_r2, m_n);
+        }
+    }
+
+    Limbs multiply(const Limbs &a, const Limbs &b) const
+    {
+        QVector<quint32> t(m_k + 2, 0);
+        for(int i = 0; i < m_k; ++i) {
+            quint64 carry = 0;
+            for(int j = 0; j < m_k; ++j) {
+                const quint64 sum = quint64(t.at(j)) + quint64(a.at(j)) * b.at(i) + carry;
+                t[j] = static_cast<quint32>(sum);
+                carry = sum >> 32;
+            }
+            quint64 sum = quint64(t.at(m_k)) + carry;
+            t[m_k] = static_cast<quint32>(sum);
+            t[m_k + 1] = static_cast<quint32>(sum >> 32);
+
+            const quint32 m = t.at(0) * m_n0inv;
+            carry = (quint64(t.at(0)) + quint64(m) * m_n.at(0)) >> 32;
+            for(int j = 1; j < m_k; ++j) {
+                sum = quint64(t.at(j)) + quint64(m) * m_n.at(j) + carry;
+                t[j - 1] = static_cast<quint32>(sum);
+                carry = sum >> 32;
+            }
+            sum = quint64(t.at(m_k)) + carry;
+            t[m_k - 1] = static_cast<quint32>(sum);
+            t[m_k] = t.at(m_k + 1) + static_cast<quint32>(sum >> 32);
+        }
+
+        Limbs result(t.begin(), t.begin() + m_k);
+        if(t.at(m_k) || greaterOrEqual(result, m_n))
+            subtractInPlace(result, m_n);
+        return result;
+    }
+
+    Limbs power(const Limbs &base, const QByteArray &exponent) const
+    {
+        Limbs one(m_k, 0);
+        one[0] = 1;
+
+        const Limbs b = multiply(base, m_r2);
+        Limbs result = multiply(one, m_r2);
+        for(const char byte : exponent) {
+            for(int bit = 7; bit >= 0; --bit) {
+                result = multiply(result, result);
+                if((static_cast<quint8>(byte) >> bit) & 1)
+                    result = multiply(result, b);
+            }
+        }
+        return multiply(result, one);
+    }
+
+private:
+    Limbs m_n, m_r2;
+    int m_k;
+    quint32 m_n0inv;
+};
+
+// RSASSA-PKCS1-v1_5 verification with SHA-256 (RFC 8017, section 8.2.2)
+bool verifyRs256(const QByteArray &signedData, const QByteArray &signature, const QByteArray &modulus, const QByteArray &exponent)
+{
+    QByteArray n = modulus;
+    while(n.startsWith('\0'))
+        n.remove(0, 1);
+
+    const int length = n.size();
+    if(length < 128 || signature.size() != length || !(static_cast<quint8>(n.at(length - 1)) & 1))
+        return false;
+
+    const int limbCount = (length + 3) / 4;
+    const Limbs nLimbs = limbsFromBigEndian(n, limbCount);
+    const Limbs s = limbsFromBigEndian(signature, limbCount);
+    if(greaterOrEqual(s, nLimbs))
+        return false;
+
+    const QByteArray encoded = limbsToBigEndian(Montgomery(nLimbs).power(s, exponent), length);
+
+    static const QByteArray digestInfo = QByteArray::fromHex("3031300d060960864801650304020105000420");
+    const QByteArray hash = QCryptographicHash::hash(signedData, QCryptographicHash::Sha256);
+    const QByteArray suffix = digestInfo + hash;
+
+    QByteArray expected(length, char(0xff));
+    expected[0] = 0x00;
+    expected[1] = 0x01;
+    expected[length - suffix.size() - 1] = 0x00;
+    expected.replace(length - suffix.size(), suffix.size(), suffix);
+
+    return encoded == expected;
+}
+
+// Extracts the freshness lifetime from the Cache-Control or Expires headers of the key endpoint
+QDateTime keysExpiry(QNetworkReply *reply)
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+
+    static const QRegularExpression maxAge("max-age\\s*=\\s*(\\d+)");
+    const QRegularExpressionMatch match = maxAge.match(QString::fromLatin1(reply->rawHeader("Cache-Control")));
+    if(match.hasMatch())
+        return now.addSecs(match.captured(1).toLongLong());
+
+    const QDateTime expires = QDateTime::fromString(QString::fromLatin1(reply->rawHeader("Expires")), Qt::RFC2822Date);
+    if(expires.isValid())
+        return expires.toUTC();
+
+    return now.addSecs(3600);
+}
+
+}
+
+/*
+    FirebaseTokenVerifier checks the RS256 signature of Firebase ID tokens against Google's public keys.
+    The keys are cached in memory and on disk and are only downloaded again once the lifetime given by
+    the server cache headers has elapsed, so most verifications happen without any network access.
+*/
+FirebaseTokenVerifier::FirebaseTokenVerifier(QObject *parent) : QObject(parent)
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if(!cacheDir.isEmpty())
+        m_cacheFile = cacheDir + "/firebase/securetoken_keys.json";
+}
+
+FirebaseTokenVerifier *FirebaseTokenVerifier::instance()
+{
+    static FirebaseTokenVerifier *verifier = new FirebaseTokenVerifier(QCoreApplication::instance());
+    return verifier;
+}
+
+QString FirebaseTokenVerifier::cacheFile() const
+{
+    return m_cacheFile;
+}
+
+void FirebaseTokenVerifier::setCacheFile(const QString &cacheFile)
+{
+    m_cacheFile = cacheFile;
+}
+
+// Verifies the signature and standard claims of idToken, the callback is invoked once the result is known
+void FirebaseTokenVerifier::verify(const QString &idToken, const QString &projectId, QObject *context, Callback callback)
+{
+    // Any Firebase project issues validly signed tokens, only the audience tells whether one is meant for us
+    if(projectId.isEmpty()) {
+        callback(false, "No project id to check the ID token audience against");
+        return;
+    }
+
+    if(JwtUtils::splitToken(idToken).isEmpty()) {
+        callback(false, "Malformed ID token");
+        return;
+    }
+
+    if(!keysValid())
+        loadCachedKeys();
+
+    // An unknown key id usually means Google rotated its keys before our cached copy expired
+    const bool knownKey = m_keys.contains(JwtUtils::header(idToken)["kid"].toString());
+
+    if(keysValid() && knownKey) {
+        QString error;
+        const bool valid = checkToken(idToken, projectId, &error);
+        callback(valid, error);
+        return;
+    }
+
+    if(keysValid() && m_keysRefetched) {
+        callback(false, "ID token was signed with an unknown key");
+        return;
+    }
+
+    m_keysRefetched = keysValid();
+    m_pending.append({idToken, projectId, context, callback});
+    fetchKeys();
+}
+
+bool FirebaseTokenVerifier::keysValid() const
+{
+    return !m_keys.isEmpty() && m_keysExpiry > QDateTime::currentDateTimeUtc();
+}
+
+bool FirebaseTokenVerifier::loadCachedKeys()
+{
+    QFile file(m_cacheFile);
+    if(m_cacheFile.isEmpty() || !file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    const QDateTime expiry = QDateTime::fromSecsSinceEpoch(static_cast<qint64>(root["expires"].toDouble()), Qt::UTC);
+    if(expiry <= QDateTime::currentDateTimeUtc())
+        return false;
+
+    parseKeys(QJsonDocument(root["jwks"].toObject()).toJson(QJsonDocument::Compact), expiry);
+    return keysValid();
+}
+
+void FirebaseTokenVerifier::fetchKeys()
+{
+    if(m_fetching)
+        return;
+    m_fetching = true;
+
+    QNetworkReply *reply = m_manager.get(QNetworkRequest(QUrl(JwtUtils::endpoint_publicKeys)));
+
+    connect(reply, &QNetworkReply::finished, this, [=]() {
+        m_fetching = false;
+
+        if(reply->error() != QNetworkReply::NoError) {
+            finishPending(reply->errorString());
+            reply->deleteLater();
+            return;
+        }
+
+        const QByteArray data = reply->readAll();
+        const QDateTime expiry = keysExpiry(reply);
+        parseKeys(data, expiry);
+
+        // Persist the keys so that the next start does not need to download them again
+        if(!m_cacheFile.isEmpty() && keysValid()) {
+            QDir().mkpath(QFileInfo(m_cacheFile).absolutePath());
+            QSaveFile file(m_cacheFile);
+            if(file.open(QIODevice::WriteOnly)) {
+                QJsonObject root;
+                root["expires"] = static_cast<double>(expiry.toSecsSinceEpoch());
+                root["jwks"] = QJsonDocument::fromJson(data).object();
+                file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+                file.commit();
+            }
+        }
+
+        finishPending(keysValid() ? QString() : "Could not parse Firebase public keys");
+        reply->deleteLater();
+    });
+}
+
+void FirebaseTokenVerifier::parseKeys(const QByteArray &data, const QDateTime &expiry)
+{
+    QHash<QString, PublicKey> keys;
+    const QJsonArray array = QJsonDocument::fromJson(data).object()["keys"].toArray();
+    for(const QJsonValue &value : array) {
+        const QJsonObject key = value.toObject();
+        if(key["kty"].toString() != "RSA")
+            continue;
+
+        keys.insert(key["kid"].toString(), {JwtUtils::decodeBase64Url(key["n"].toString().toLatin1()),
+                                            JwtUtils::decodeBase64Url(key["e"].toString().toLatin1())});
+    }
+
+    m_keys = keys;
+    m_keysExpiry = expiry;
+}
+
+bool FirebaseTokenVerifier::checkToken(const QString &idToken, const QString &projectId, QString *error) const
+{
+    const QVector<QByteArray> parts = JwtUtils::splitToken(idToken);
+    if(parts.isEmpty()) {
+        *error = "Malformed ID token";
+        return false;
+    }
+
+    const QJsonObject header = JwtUtils::decodeSegment(parts.at(0));
+    const QJsonObject claims = JwtUtils::decodeSegment(parts.at(1));
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+
+    // Allow some clock skew between the device and the token issuer
+    const int skew = 300;
+
+    if(header["alg"].toString() != "RS256") {
+        *error = "Unexpected ID token algorithm";
+        return false;
+    }
+    if(JwtUtils::numericDate(claims, "exp") <= now) {
+        *error = "ID token has expired";
+        return false;
+    }
+    if(JwtUtils::numericDate(claims, "iat") > now.addSecs(skew)) {
+        *error = "ID token was issued in the future";
+        return false;
+    }
+
+    const QString audience = claims["aud"].toString();
+    if(projectId.isEmpty() || audience != projectId || claims["iss"].toString() != JwtUtils::issuerPrefix + audience) {
+        *error = "ID token was issued for another project";
+        return false;
+    }
+    if(claims["sub"].toString().isEmpty()) {
+        *error = "ID token has no subject";
+        return false;
+    }
+
+    const auto key = m_keys.constFind(header["kid"].toString());
+    if(key == m_keys.constEnd()) {
+        *error = "ID token was signed with an unknown key";
+        return false;
+    }
+
+    if(!verifyRs256(parts.at(0) + '.' + parts.at(1), JwtUtils::decodeBase64Url(parts.at(2)), key->modulus, key->exponent)) {
+        *error = "ID token signature is invalid";
+        return false;
+    }
+
+    return true;
+}
+
+void FirebaseTokenVerifier::finishPending(const QString &fetchError)
+{
+    const QList<PendingVerification> pending = m_pending;
+    m_pending.clear();
+
+    for(const PendingVerification &verification : pending) {
+        if(!verification.context)
+            continue;
+
+        if(!fetchError.isEmpty()) {
+            verification.callback(false, fetchError);
+            continue;
+        }
+
+        QString error;
+        const bool valid = checkToken(verification.idToken, verification.projectId, &error);
+        verification.callback(valid, error);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef FIREBASETOKENVERIFIER_H
+#define FIREBASETOKENVERIFIER_H
+
+#include <QObject>
+#include <QHash>
+#include <QDateTime>
+#include <QNetworkAccessManager>
+#include <QPointer>
+#include <functional>
+
+class FirebaseTokenVerifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(bool valid, const QString &error)>;
+
+    explicit FirebaseTokenVerifier(QObject *parent = nullptr);
+
+    static FirebaseTokenVerifier *instance();
+
+    void verify(const QString &idToken, const QString &projectId, QObject *context, Callback callback);
+
+    QString cacheFile() const;
+    void setCacheFile(const QString &cacheFile);
+
+private:
+    struct PublicKey {
+        QByteArray modulus;
+        QByteArray exponent;
+    };
+
+    struct PendingVerification {
+        QString idToken;
+        QString projectId;
+        QPointer<QObject> context;
+        Callback callback;
+    };
+
+    bool keysValid() const;
+    bool loadCachedKeys();
+    void fetchKeys();
+    void parseKeys(const QByteArray &data, const QDateTime &expiry);
+    bool checkToken(const QString &idToken, const QString &projectId, QString *error) const;
+    void finishPending(const QString &fetchError);
+
+    QHash<QString, PublicKey> m_keys;
+    QDateTime m_keysExpiry;
+    QString m_cacheFile;
+    QList<PendingVerification> m_pending;
+    bool m_fetching = false;
+    bool m_keysRefetched = false;
+    QNetworkAccessManager m_manager;
+};
+
+#endif // FIREBASETOKENVERIFIER_H
@@ -0,0 +1,474 @@
+#include <QCborArray>
+#include <QCborStreamReader>
+#include <QCborValue>
+#include <QLoggingCategory>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QTimer>
+#include <QUrlQuery>
+#include "firebasetrace.h"
+#include "utils/AuthUtils.h"
+
+Q_LOGGING_CATEGORY(lcFirebaseTrace, "firebase.trace", QtWarningMsg)
+
+namespace {
+
+// Larger bodies are captured as their size only and replayed as that many zero bytes
+const qint64 maxCapturedBody = 4 * 1024 * 1024;
+
+const QList<QNetworkRequest::Attribute> capturedAttributes {
+    QNetworkRequest::HttpStatusCodeAttribute,
+    QNetworkRequest::HttpReasonPhraseAttribute,
+    QNetworkRequest::RedirectionTargetAttribute,
+    QNetworkRequest::ConnectionEncryptedAttribute,
+    QNetworkRequest::Http2WasUsedAttribute
+};
+
+// Resumable upload sessions are handed out as URLs whose upload_id grants access to the upload
+const QList<QByteArray> urlHeaders { "X-Goog-Upload-URL", "Location" };
+
+QString redactHeader(const QByteArray &name, const QByteArray &value)
+{
+    for(const QByteArray &header : urlHeaders) {
+        if(qstricmp(name.constData(), header.constData()) == 0)
+            return FirebaseTraceManager::redact(QUrl::fromEncoded(value));
+    }
+    return QString::fromLatin1(value);
+}
+
+QByteArray verbOf(QNetworkAccessManager::Operation operation, const QNetworkRequest &request)
+{
+    switch(operation) {
+    case QNetworkAccessManager::HeadOperation:
+        return "HEAD";
+    case QNetworkAccessManager::GetOperation:
+        return "GET";
+    case QNetworkAccessManager::PutOperation:
+        return "PUT";
+    case QNetworkAccessManager::PostOperation:
+        return "POST";
+    case QNetworkAccessManager::DeleteOperation:
+        return "DELETE";
+    default:
+        return request.attribute(QNetworkRequest::CustomVerbAttribute).toByteArray();
+    }
+}
+
+/*
+    Reply handed to the caller while capturing or replaying. While capturing, it reads the real reply, records what
+    arrives and passes it on unchanged; while replaying, the recorded events are delivered to it on timers.
+*/
+class TraceReply : public QNetworkReply
+{
+public:
+    TraceReply(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, QObject *parent)
+        : QNetworkReply(parent)
+    {
+        setOperation(operation);
+        setRequest(request);
+        setUrl(request.url());
+        open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+
+    void capture(QNetworkReply *source, FirebaseTraceManager *manager, quint64 exchange)
+    {
+        m_source = source;
+        m_manager = manager;
+        m_exchange = exchange;
+        source->setParent(this);
+
+        connect(source, &QNetworkReply::metaDataChanged, this, [this]() {
+            copyMetaData();
+
+            QCborArray headers;
+            for(const RawHeaderPair &pair : m_source->rawHeaderPairs())
+                headers.append(QCborArray {QString::fromLatin1(pair.first), redactHeader(pair.first, pair.second)});
+
+            m_stream = m_source->header(QNetworkRequest::ContentTypeHeader).toString().contains("text/event-stream");
+            m_manager->record({{"id", static_cast<qint64>(m_exchange)}, {"k", "response"},
+                               {"status", m_source->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt()},
+                               {"headers", headers}});
+            emit metaDataChanged();
+        });
+        connect(source, &QNetworkReply::readyRead, this, [this]() {
+            pull(false);
+        });
+        connect(source, &QNetworkReply::downloadProgress, this, &QNetworkReply::downloadProgress);
+        connect(source, &QNetworkReply::uploadProgress, this, &QNetworkReply::uploadProgress);
+#ifndef QT_NO_SSL
+        connect(source, &QNetworkReply::encrypted, this, &QNetworkReply::encrypted);
+#endif
+        connect(source, &QNetworkReply::finished, this, [this]() {
+            pull(true);
+            copyMetaData();
+
+            if(!m_stream && m_bodySize > 0) {
+                if(m_bodySize <= maxCapturedBody)
+                    m_manager->record({{"id", static_cast<qint64>(m_exchange)}, {"k", "data"}, {"data", FirebaseTraceManager::redact(m_body)}});
+                else
+                    m_manager->record({{"id", static_cast<qint64>(m_exchange)}, {"k", "size"}, {"size", m_bodySize}});
+                m_body.clear();
+            }
+
+            m_manager->record({{"id", static_cast<qint64>(m_exchange)}, {"k", "finished"},
+                               {"error", static_cast<int>(m_source->error())}, {"message", m_source->errorString()}});
+            finish(m_source->error(), m_source->errorString());
+        });
+    }
+
+    void deliverMetaData(const QCborMap &event)
+    {
+        if(isFinished())
+            return;
+
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, event.value("status").toInteger());
+        for(const QCborValue &header : event.value("headers").toArray()) {
+            const QCborArray pair = header.toArray();
+            setRawHeader(pair.at(0).toString().toLatin1(), pair.at(1).toString().toLatin1());
+        }
+        emit metaDataChanged();
+    }
+
+    void deliverData(const QByteArray &data)
+    {
+        if(isFinished() || data.isEmpty())
+            return;
+
+        m_buffer.append(data);
+        emit readyRead();
+    }
+
+    void finish(NetworkError error, const QString &errorString)
+    {
+        if(isFinished())
+            return;
+
+        if(error != NoError) {
+            setError(error, errorString);
+            emit errorOccurred(error);
+        }
+        setFinished(true);
+        emit finished();
+    }
+
+    void abort() override
+    {
+        if(m_source)
+            m_source->abort();
+        else
+            finish(OperationCanceledError, "Operation canceled");
+    }
+
+    qint64 bytesAvailable() const override
+    {
+        return m_buffer.size() + QNetworkReply::bytesAvailable();
+    }
+
+    // The limit applies to the real reply too, so a slow reader still holds back the download
+    void setReadBufferSize(qint64 size) override
+    {
+        QNetworkReply::setReadBufferSize(size);
+        if(m_source)
+            m_source->setReadBufferSize(size);
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        if(m_buffer.isEmpty())
+            return isFinished() ? -1 : 0;
+
+        const qint64 size = qMin<qint64>(maxSize, m_buffer.size());
+        memcpy(data, m_buffer.constData(), static_cast<size_t>(size));
+        m_buffer.remove(0, static_cast<int>(size));
+
+        // Data held back by the read buffer limit is fetched once the caller made room for it
+        if(m_source && m_source->bytesAvailable() > 0)
+            QMetaObject::invokeMethod(this, [this]() { pull(false); }, Qt::QueuedConnection);
+
+        return size;
+    }
+
+#ifndef QT_NO_SSL
+    void sslConfigurationImplementation(QSslConfiguration &configuration) const override
+    {
+        if(m_source)
+            configuration = m_source->sslConfiguration();
+    }
+#endif
+
+private:
+    void copyMetaData()
+    {
+        for(QNetworkRequest::Attribute attribute : capturedAttributes)
+            setAttribute(attribute, m_source->attribute(attribute));
+        for(const RawHeaderPair &pair : m_source->rawHeaderPairs())
+            setRawHeader(pair.first, pair.second);
+    }
+
+    void pull(bool all)
+    {
+        if(!m_source)
+            return;
+
+        qint64 room = m_source->bytesAvailable();
+        if(!all && readBufferSize() > 0)
+            room = qMin(room, readBufferSize() - m_buffer.size());
+        if(room <= 0)
+            return;
+
+        const QByteArray data = m_source->read(room);
+        if(m_stream) {
+            m_manager->record({{"id", static_cast<qint64>(m_exchange)}, {"k", "data"}, {"data", FirebaseTraceManager::redact(data)}});
+        } else {
+            m_bodySize += data.size();
+            if(m_bodySize <= maxCapturedBody)
+                m_body.append(data);
+            else
+                m_body.clear();
+        }
+
+        deliverData(data);
+    }
+
+    QPointer<QNetworkReply> m_source;
+    FirebaseTraceManager *m_manager = nullptr;
+    quint64 m_exchange = 0;
+    bool m_stream = false;
+    QByteArray m_body;
+    qint64 m_bodySize = 0;
+    QByteArray m_buffer;
+};
+
+}
+
+FirebaseTraceManager::FirebaseTraceManager(QObject *parent) : QNetworkAccessManager(parent)
+{
+}
+
+FirebaseTraceManager::~FirebaseTraceManager()
+{
+    stopCapture();
+}
+
+/*
+    Appends every request sent from now on and the events of its response to fileName. The trace is a sequence of
+    CBOR maps, each with the milliseconds since the capture started (t), the exchange it belongs to (id) and its
+    kind (k): the request with its verb, url and body, the response status and headers, body data (every chunk of
+    event streams, so the timing of events is kept), and the end of the exchange with its error.
+
+    Tokens, API keys, passwords and upload session IDs are replaced in URLs, URL headers and JSON or form bodies before
+    anything is written.
+*/
+bool FirebaseTraceManager::startCapture(const QString &fileName)
+{
+    stopCapture();
+
+    m_capture.setFileName(fileName);
+    if(!m_capture.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(lcFirebaseTrace) << "Cannot capture to" << fileName << m_capture.errorString();
+        return false;
+    }
+
+    m_clock.start();
+    return true;
+}
+
+void FirebaseTraceManager::stopCapture()
+{
+    if(m_capture.isOpen())
+        m_capture.close();
+}
+
+bool FirebaseTraceManager::isCapturing() const
+{
+    return m_capture.isOpen();
+}
+
+/*
+    Answers requests from the trace in fileName instead of the network, with the response events at their captured
+    offsets from the request divided by speed. A speed of 0 replays without any delay. Requests are matched by verb
+    and redacted URL, in the order they were captured; requests whose URL differs only in the query, or the last
+    path segment (such as locally generated push IDs), fall back to the oldest unanswered request of the same verb
+    and path. Requests missing from the trace fail with ContentNotFoundError.
+*/
+bool FirebaseTraceManager::startReplay(const QString &fileName, double speed)
+{
+    stopReplay();
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        qCWarning(lcFirebaseTrace) << "Cannot replay" << fileName << file.errorString();
+        return false;
+    }
+
+    struct Pending {
+        QString key;
+        qint64 sentAt = 0;
+        Exchange exchange;
+    };
+    QHash<qint64, Pending> pending;
+    QList<qint64> order;
+
+    QCborStreamReader reader(&file);
+    while(reader.isValid()) {
+        const QCborMap entry = QCborValue::fromCbor(reader).toMap();
+        if(reader.lastError() != QCborError::NoError)
+            break;
+
+        const qint64 id = entry.value("id").toInteger();
+        const qint64 time = entry.value("t").toInteger();
+        if(entry.value("k").toString() == "request") {
+            Pending &request = pending[id];
+            request.key = entry.value("verb").toString() + " " + entry.value("url").toString();
+            request.sentAt = time;
+            order.append(id);
+        } else if(pending.contains(id)) {
+            Pending &request = pending[id];
+            QCborMap event = entry;
+            event.insert(QStringLiteral("t"), time - request.sentAt);
+            request.exchange.events.append(event);
+        }
+    }
+
+    for(qint64 id : order) {
+        const Pending &request = pending[id];
+        m_exchanges[request.key].enqueue(request.exchange);
+    }
+
+    qCDebug(lcFirebaseTrace) << "Replaying" << order.size() << "requests from" << fileName;
+    m_replaying = true;
+    m_speed = speed;
+    return true;
+}
+
+void FirebaseTraceManager::stopReplay()
+{
+    m_replaying = false;
+    m_exchanges.clear();
+}
+
+bool FirebaseTraceManager::isReplaying() const
+{
+    return m_replaying;
+}
+
+void FirebaseTraceManager::record(QCborMap entry)
+{
+    if(!m_capture.isOpen())
+        return;
+
+    entry.insert(QStringLiteral("t"), m_clock.elapsed());
+    m_capture.write(QCborValue(entry).toCbor());
+}
+
+quint64 FirebaseTraceManager::nextExchange()
+{
+    return m_nextExchange++;
+}
+
+// Replaces the values of credential fields of JSON or form-encoded text, binary data is returned unchanged
+QByteArray FirebaseTraceManager::redact(QByteArray data)
+{
+    static const QString fields = AuthUtils::secretFields.join('|');
+    static const QRegularExpression jsonCredentials("(\"(?:" + fields + ")\"\\s*:\\s*\")(?:[^\"\\\\]|\\\\.)*\"");
+    static const QRegularExpression formCredentials("((?:^|&)(?:" + fields + ")=)[^&]*");
+    static const QRegularExpression formBody("^[^\\s\"{}\\[\\]]+=[^\\s\"]*$");
+
+    const QString text = QString::fromUtf8(data);
+    if(text.toUtf8() != data)
+        return data;
+
+    // Token endpoint requests, e.g grant_type=refresh_token&refresh_token=..., are form-encoded
+    if(formBody.match(text.trimmed()).hasMatch())
+        return QString(text).replace(formCredentials, "\\1REDACTED").toUtf8();
+
+    return QString(text).replace(jsonCredentials, "\\1REDACTED\"").toUtf8();
+}
+
+QString FirebaseTraceManager::redact(const QUrl &url)
+{
+    static const QStringList secrets = AuthUtils::secretFields + QStringList {"auth", "key", "upload_id"};
+
+    QUrlQuery query(url);
+    for(const QString &secret : secrets) {
+        if(query.hasQueryItem(secret)) {
+            query.removeAllQueryItems(secret);
+            query.addQueryItem(secret, "REDACTED");
+        }
+    }
+
+    QUrl redacted(url);
+    redacted.setQuery(query);
+    return redacted.toString(QUrl::FullyEncoded);
+}
+
+QNetworkReply *FirebaseTraceManager::createRequest(Operation operation, const QNetworkRequest &request, QIODevice *outgoingData)
+{
+    const QByteArray verb = verbOf(operation, request);
+    if(m_replaying)
+        return replay(verb, request);
+
+    if(!m_capture.isOpen())
+        return QNetworkAccessManager::createRequest(operation, request, outgoingData);
+
+    const quint64 exchange = nextExchange();
+    QCborMap entry {{"id", static_cast<qint64>(exchange)}, {"k", "request"}, {"verb", QString::fromLatin1(verb)},
+                    {"url", redact(request.url())}};
+
+    // Bodies of sequential devices cannot be read without taking them from the request
+    if(outgoingData && !outgoingData->isSequential() && outgoingData->size() <= maxCapturedBody)
+        entry.insert(QStringLiteral("body"), redact(outgoingData->peek(outgoingData->size())));
+    record(entry);
+
+    TraceReply *reply = new TraceReply(operation, request, this);
+    reply->capture(QNetworkAccessManager::createRequest(operation, request, outgoingData), this, exchange);
+    return reply;
+}
+
+QNetworkReply *FirebaseTraceManager::replay(const QByteArray &verb, const QNetworkRequest &request)
+{
+    const QNetworkAccessManager::Operation operation = verb == "GET" ? GetOperation : verb == "PUT" ? PutOperation
+                                                     : verb == "POST" ? PostOperation : verb == "DELETE" ? DeleteOperation
+                                                     : verb == "HEAD" ? HeadOperation : CustomOperation;
+    TraceReply *reply = new TraceReply(operation, request, this);
+
+    QString key = QString::fromLatin1(verb) + " " + redact(request.url());
+    if(m_exchanges.value(key).isEmpty()) {
+        const QString resource = key.section('?', 0, 0);
+        const QString parent = resource.section('/', 0, -2);
+        for(auto it = m_exchanges.cbegin(); it != m_exchanges.cend(); ++it) {
+            const QString candidate = it.key().section('?', 0, 0);
+            if(!it->isEmpty() && (candidate == resource || candidate.section('/', 0, -2) == parent)) {
+                key = it.key();
+                break;
+            }
+        }
+    }
+
+    if(m_exchanges.value(key).isEmpty()) {
+        qCWarning(lcFirebaseTrace) << "Request not in trace:" << key;
+        QTimer::singleShot(0, reply, [reply]() {
+            reply->finish(QNetworkReply::ContentNotFoundError, "Request not in trace");
+        });
+        return reply;
+    }
+
+    const Exchange exchange = m_exchanges[key].dequeue();
+    for(const QCborMap &event : exchange.events) {
+        const int delay = m_speed > 0.0 ? qRound(event.value("t").toInteger() / m_speed) : 0;
+        QTimer::singleShot(delay, reply, [reply, event]() {
+            const QString kind = event.value("k").toString();
+            if(kind == "response")
+                reply->deliverMetaData(event);
+            else if(kind == "data")
+                reply->deliverData(event.value("data").toByteArray());
+            else if(kind == "size")
+                reply->deliverData(QByteArray(static_cast<int>(event.value("size").toInteger()), '\0'));
+            else if(kind == "finished")
+                reply->finish(static_cast<QNetworkReply::NetworkError>(event.value("error").toInteger()), event.value("message").toString());
+        });
+    }
+
+    return reply;
+}
@@ -0,0 +1,55 @@
+#ifndef FIREBASETRACE_H
+#define FIREBASETRACE_H
+
+#include <QNetworkAccessManager>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QQueue>
+#include <QCborMap>
+
+/*
+    Network access manager of FirebaseTransport that can capture the traffic going through it into a trace file, or
+    answer requests from a captured trace instead of the network. Without either, it is a plain QNetworkAccessManager.
+*/
+class FirebaseTraceManager : public QNetworkAccessManager
+{
+public:
+    explicit FirebaseTraceManager(QObject *parent = nullptr);
+    ~FirebaseTraceManager();
+
+    bool startCapture(const QString &fileName);
+    void stopCapture();
+    bool isCapturing() const;
+
+    bool startReplay(const QString &fileName, double speed = 1.0);
+    void stopReplay();
+    bool isReplaying() const;
+
+    void record(QCborMap entry);
+    quint64 nextExchange();
+
+    static QByteArray redact(QByteArray data);
+    static QString redact(const QUrl &url);
+
+protected:
+    QNetworkReply *createRequest(Operation operation, const QNetworkRequest &request, QIODevice *outgoingData = nullptr) override;
+
+private:
+    // A captured request with the events of its response, offsets in milliseconds from sending the request
+    struct Exchange {
+        QList<QCborMap> events;
+    };
+
+    QNetworkReply *replay(const QByteArray &verb, const QNetworkRequest &request);
+
+    QFile m_capture;
+    QElapsedTimer m_clock;
+    quint64 m_nextExchange = 1;
+
+    bool m_replaying = false;
+    double m_speed = 1.0;
+    QHash<QString, QQueue<Exchange>> m_exchanges;
+};
+
+#endif // FIREBASETRACE_H
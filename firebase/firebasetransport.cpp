@@ -0,0 +1,763 @@
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadStorage>
+#include <QTimer>
+#include <QtMath>
+#include "firebasetransport.h"
+#include "firebasememorybudget.h"
+
+Q_LOGGING_CATEGORY(lcFirebaseTransport, "firebase.transport", QtWarningMsg)
+
+namespace {
+
+const int baseRetryDelay = 500;
+const int maxRetryDelay = 30000;
+
+const double retryTokensMax = 10.0;
+const double retryTokensPerSuccess = 0.1;
+
+// Starting point and bounds of the adaptive limits, generous enough that a single client never waits on them
+const double initialRate = 20.0;
+const double minRate = 0.5;
+const double defaultMaxRate = 200.0;
+const int defaultBurst = 20;
+const double initialWindow = 8.0;
+const int defaultMaxConcurrency = 64;
+
+// Latency this many times the baseline means requests are queueing at the server
+const int congestionFactor = 3;
+
+// Replies throttled by the memory budget try to read again this often, in milliseconds
+const int throttleInterval = 20;
+const int maxThrottleStalls = 5;
+
+// Streamed bodies are handed over as they arrive, the reply holds at most this much of them
+const qint64 streamReadBufferSize = 256 * 1024;
+
+const quint32 sessionCacheVersion = 1;
+const int sessionSaveDelay = 2000;
+
+}
+
+/*
+    FirebaseTransport sends the REST requests of FirebaseAuth and FirebaseDatabase. Failures are classified with
+    FirebaseError and the retryable ones are sent again with exponential backoff and jitter, as long as the retry
+    budget allows it. The budget stops a fleet of clients from multiplying the load on a struggling backend.
+
+    Requests are also paced per host. A token bucket limits the request rate and a window limits the requests in
+    flight; both grow additively while responses are fast and are halved when the server throttles (429, 503 or
+    TOO_MANY_ATTEMPTS_TRY_LATER), at most once per round trip. When many devices reconnect at once each of them
+    backs off, so the fleet settles at the rate the backend sustains instead of tripping its quotas.
+*/
+FirebaseTransport::FirebaseTransport(QObject *parent) : QObject(parent), m_retryTokens(retryTokensMax), m_maxRate(defaultMaxRate),
+    m_burst(defaultBurst), m_maxConcurrency(defaultMaxConcurrency)
+{
+    m_clock.start();
+
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if(!cacheDir.isEmpty())
+        m_sessionCacheFile = cacheDir + "/firebase/tls_sessions.dat";
+
+    m_throttleTimer.setSingleShot(true);
+    m_throttleTimer.setInterval(throttleInterval);
+    connect(&m_throttleTimer, &QTimer::timeout, this, &FirebaseTransport::resumeThrottled);
+
+#ifndef QT_NO_SSL
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(sessionSaveDelay);
+    connect(&m_saveTimer, &QTimer::timeout, this, &FirebaseTransport::saveSessionTickets);
+#endif
+}
+
+/*
+    Transport shared by all Firebase objects living in the calling thread. Sharing one QNetworkAccessManager lets
+    every object reuse the same pool of keep-alive connections and the same retry budget.
+*/
+FirebaseTransport *FirebaseTransport::shared()
+{
+    static QThreadStorage<FirebaseTransport *> transports;
+    if(!transports.hasLocalData())
+        transports.setLocalData(new FirebaseTransport);
+
+    return transports.localData();
+}
+
+QNetworkAccessManager *FirebaseTransport::manager()
+{
+    return &m_manager;
+}
+
+/*
+    Sends the request and invokes callback once with the final response, after any retries. The callback is
+    dropped if context is destroyed first. The returned id can be passed to cancel().
+*/
+quint64 FirebaseTransport::send(const QByteArray &verb, const QNetworkRequest &request, const QByteArray &body, QObject *context, Callback callback, Options options)
+{
+    return stream(verb, request, body, context, DataCallback(), callback, options);
+}
+
+/*
+    Like send(), but the body of a successful response is passed to dataCallback piece by piece as it arrives instead
+    of being collected, so results of any size can be processed without holding them in memory. The response given
+    with each piece has the status and headers. Error bodies are still collected and come with the final callback.
+    A stream is only resent while none of its body was handed over, the receiver cannot take pieces back.
+*/
+quint64 FirebaseTransport::stream(const QByteArray &verb, const QNetworkRequest &request, const QByteArray &body, QObject *context,
+                                  DataCallback dataCallback, Callback callback, Options options)
+{
+    QSharedPointer<Call> call(new Call);
+    call->id = m_nextId++;
+    call->verb = verb;
+    call->request = request;
+    call->body = body;
+    call->context = context;
+    call->callback = callback;
+    call->dataCallback = dataCallback;
+    call->options = options;
+
+    m_calls.insert(call->id, call);
+    admit(call);
+    return call->id;
+}
+
+// Stops the request, its callback is invoked right away with reason as error
+void FirebaseTransport::cancel(quint64 requestId, FirebaseError::Code reason)
+{
+    const QSharedPointer<Call> call = m_calls.value(requestId);
+    if(!call)
+        return;
+
+    call->cancelReason = reason;
+
+    // Aborting emits finished, otherwise the call is waiting for a retry
+    if(call->reply) {
+        call->reply->abort();
+        return;
+    }
+
+    FirebaseResponse response;
+    response.attempts = call->attempt;
+    response.error = reason;
+    response.errorString = FirebaseError::message(reason);
+    complete(call, response);
+}
+
+int FirebaseTransport::maxRetries() const
+{
+    return m_maxRetries;
+}
+
+void FirebaseTransport::setMaxRetries(int maxRetries)
+{
+    m_maxRetries = maxRetries;
+}
+
+// Exponential backoff with full jitter, a Retry-After given by the server takes precedence
+int FirebaseTransport::retryDelay(int attempt, int retryAfterSeconds) const
+{
+    if(retryAfterSeconds > 0)
+        return qMin(retryAfterSeconds * 1000, maxRetryDelay);
+
+    const int ceiling = qMin(maxRetryDelay, baseRetryDelay << qMin(attempt, 6));
+    return ceiling / 2 + QRandomGenerator::global()->bounded(ceiling / 2 + 1);
+}
+
+/*
+    Opens the connection to the host of url in the background, so DNS lookup, TCP and TLS handshakes are done by the
+    time the first request is sent. Connections to different hosts are established in parallel and end up in the
+    connection pool of manager(). Each host is only pre-connected once.
+*/
+void FirebaseTransport::preconnect(const QUrl &url)
+{
+    const QString host = url.host();
+    if(host.isEmpty())
+        return;
+
+    // Replayed requests never reach the network
+    if(m_manager.isReplaying())
+        return;
+
+    HostMetrics &metrics = m_hostMetrics[host];
+    if(metrics.preconnectedAt >= 0 || metrics.firstRequestAt >= 0)
+        return;
+
+    metrics.preconnectedAt = m_clock.elapsed();
+    qCDebug(lcFirebaseTransport) << "Pre-connecting to" << host;
+
+#ifndef QT_NO_SSL
+    if(url.scheme() == "https") {
+        m_manager.connectToHostEncrypted(host, static_cast<quint16>(url.port(443)), sslConfiguration(host));
+        return;
+    }
+#endif
+    m_manager.connectToHost(host, static_cast<quint16>(url.port(80)));
+}
+
+// Sets up TLS session resumption on a request that is sent directly with manager(), send() does this itself
+void FirebaseTransport::prepare(QNetworkRequest &request)
+{
+#ifndef QT_NO_SSL
+    if(request.url().scheme() == "https")
+        request.setSslConfiguration(sslConfiguration(request.url().host()));
+#else
+    Q_UNUSED(request)
+#endif
+}
+
+/*
+    Startup metrics per host: whether it was pre-connected and how long before the first request (the handshake
+    time hidden behind startup), whether a persisted TLS session was offered, the latency of the first request
+    and the average latency of all requests. A first request close to the average means no connection setup was paid.
+*/
+QVariantMap FirebaseTransport::connectionMetrics() const
+{
+    QVariantMap result;
+    for(auto it = m_hostMetrics.cbegin(); it != m_hostMetrics.cend(); ++it) {
+        const HostMetrics &metrics = it.value();
+
+        QVariantMap host;
+        host["preconnected"] = metrics.preconnectedAt >= 0;
+        host["preconnectLead"] = metrics.preconnectedAt >= 0 && metrics.firstRequestAt >= 0 ? metrics.firstRequestAt - metrics.preconnectedAt : -1;
+        host["sessionTicketOffered"] = metrics.sessionTicketOffered;
+        host["firstRequestTime"] = metrics.firstRequestTime;
+        host["averageRequestTime"] = metrics.requests > 0 ? metrics.totalRequestTime / metrics.requests : -1;
+        host["requests"] = metrics.requests;
+
+        const auto limiter = m_limiters.constFind(it.key());
+        if(limiter != m_limiters.cend()) {
+            host["concurrencyLimit"] = limiter->window;
+            host["rateLimit"] = limiter->rate;
+            host["queued"] = limiter->waiting.size();
+            host["throttled"] = limiter->throttled;
+        }
+
+        result[it.key()] = host;
+    }
+
+    return result;
+}
+
+/*
+    File where TLS session tickets are kept between runs, so that the first connection after a restart can resume
+    the previous session instead of doing a full handshake. An empty path disables persistence.
+*/
+QString FirebaseTransport::sessionCacheFile() const
+{
+    return m_sessionCacheFile;
+}
+
+void FirebaseTransport::setSessionCacheFile(const QString &sessionCacheFile)
+{
+    m_sessionCacheFile = sessionCacheFile;
+    m_sessionTicketsLoaded = false;
+    m_sessionTickets.clear();
+}
+
+// Every request of the objects using this transport, streaming listeners included, is captured or replayed
+bool FirebaseTransport::startCapture(const QString &fileName)
+{
+    return m_manager.startCapture(fileName);
+}
+
+void FirebaseTransport::stopCapture()
+{
+    m_manager.stopCapture();
+}
+
+bool FirebaseTransport::startReplay(const QString &fileName, double speed)
+{
+    return m_manager.startReplay(fileName, speed);
+}
+
+void FirebaseTransport::stopReplay()
+{
+    m_manager.stopReplay();
+}
+
+// Maximum sustained rate and burst per host, the adaptive rate stays below it
+void FirebaseTransport::setRateLimit(double requestsPerSecond, int burst)
+{
+    m_maxRate = qMax(minRate, requestsPerSecond);
+    m_burst = qMax(1, burst);
+
+    for(auto it = m_limiters.begin(); it != m_limiters.end(); ++it) {
+        it->rate = qMin(it->rate, m_maxRate);
+        it->tokens = qMin(it->tokens, static_cast<double>(m_burst));
+    }
+}
+
+void FirebaseTransport::setMaxConcurrency(int maxConcurrency)
+{
+    m_maxConcurrency = qMax(1, maxConcurrency);
+
+    for(auto it = m_limiters.begin(); it != m_limiters.end(); ++it)
+        it->window = qMin(it->window, static_cast<double>(m_maxConcurrency));
+}
+
+FirebaseTransport::HostLimiter &FirebaseTransport::limiter(const QString &host)
+{
+    auto it = m_limiters.find(host);
+    if(it == m_limiters.end()) {
+        it = m_limiters.insert(host, HostLimiter());
+        it->rate = qMin(initialRate, m_maxRate);
+        it->tokens = m_burst;
+        it->window = qMin(initialWindow, static_cast<double>(m_maxConcurrency));
+        it->refilledAt = m_clock.elapsed();
+    }
+    return *it;
+}
+
+void FirebaseTransport::admit(const QSharedPointer<Call> &call)
+{
+    const QString host = call->request.url().host();
+    limiter(host).waiting.enqueue(call);
+    dispatch(host);
+}
+
+// Starts waiting calls of host as far as the window and the token bucket allow
+void FirebaseTransport::dispatch(const QString &host)
+{
+    HostLimiter &limiter = this->limiter(host);
+
+    const qint64 now = m_clock.elapsed();
+    limiter.tokens = qMin(static_cast<double>(m_burst), limiter.tokens + (now - limiter.refilledAt) * limiter.rate / 1000.0);
+    limiter.refilledAt = now;
+
+    while(!limiter.waiting.isEmpty() && limiter.inFlight < qMax(1, static_cast<int>(limiter.window))) {
+        // Cancelled calls and calls whose context is gone are dropped from the queue
+        const QSharedPointer<Call> call = limiter.waiting.head();
+        if(!m_calls.contains(call->id) || !call->context) {
+            limiter.waiting.dequeue();
+            m_calls.remove(call->id);
+            continue;
+        }
+
+        if(limiter.tokens < 1.0) {
+            if(!limiter.dispatchScheduled) {
+                limiter.dispatchScheduled = true;
+                const int delay = qCeil((1.0 - limiter.tokens) * 1000.0 / limiter.rate);
+                QTimer::singleShot(delay, this, [this, host]() {
+                    m_limiters[host].dispatchScheduled = false;
+                    dispatch(host);
+                });
+            }
+            return;
+        }
+
+        limiter.waiting.dequeue();
+        limiter.tokens -= 1.0;
+        ++limiter.inFlight;
+        start(call);
+    }
+}
+
+/*
+    AIMD: a fast success adds 1/window to the window and about one request per second to the rate per second of
+    traffic. Throttling halves both, and so does latency far above the baseline, which shows the server is queueing.
+    Decreases are applied at most once per round trip, since the responses of one burst report the same condition.
+*/
+void FirebaseTransport::adapt(HostLimiter &limiter, const FirebaseResponse &response, qint64 latency, bool measurable)
+{
+    const qint64 now = m_clock.elapsed();
+    const bool throttled = response.error == FirebaseError::TooManyAttempts || response.status == 429 || response.status == 503;
+
+    // Transfers of large bodies take long for reasons other than queueing, only small requests measure latency
+    if(measurable && (response.error == FirebaseError::NoError || throttled)) {
+        if(limiter.baselineLatency < 0 || latency < limiter.baselineLatency)
+            limiter.baselineLatency = latency;
+        else
+            limiter.baselineLatency += (latency - limiter.baselineLatency) / 64;
+    }
+
+    const bool congested = measurable && limiter.baselineLatency > 0 && latency > congestionFactor * qMax<qint64>(limiter.baselineLatency, 10);
+
+    if(throttled || (response.error == FirebaseError::NoError && congested)) {
+        if(limiter.decreasedAt >= 0 && now - limiter.decreasedAt < qMax<qint64>(latency, 100))
+            return;
+
+        limiter.decreasedAt = now;
+        limiter.window = qMax(1.0, limiter.window / 2);
+        limiter.rate = qMax(minRate, limiter.rate / 2);
+        if(throttled)
+            ++limiter.throttled;
+
+        qCDebug(lcFirebaseTransport) << (throttled ? "Throttled" : "Congested") << "- window" << limiter.window << "rate" << limiter.rate;
+        return;
+    }
+
+    if(response.error == FirebaseError::NoError) {
+        limiter.window = qMin(static_cast<double>(m_maxConcurrency), limiter.window + 1.0 / limiter.window);
+        limiter.rate = qMin(m_maxRate, limiter.rate + qMin(1.0, 1.0 / limiter.rate));
+    }
+}
+
+void FirebaseTransport::start(const QSharedPointer<Call> &call)
+{
+    prepare(call->request);
+    call->sentAt = m_clock.elapsed();
+
+    QNetworkReply *reply;
+    if(call->verb == "GET")
+        reply = m_manager.get(call->request);
+    else if(call->verb == "POST")
+        reply = m_manager.post(call->request, call->body);
+    else if(call->verb == "PUT")
+        reply = m_manager.put(call->request, call->body);
+    else if(call->verb == "DELETE")
+        reply = m_manager.deleteResource(call->request);
+    else
+        reply = m_manager.sendCustomRequest(call->request, call->verb, call->body);
+
+    call->reply = reply;
+
+    // Streamed bodies belong to the receiver and do not count against the budget, the reply only buffers a little
+    if(call->dataCallback) {
+        const bool budget = FirebaseMemoryBudget::instance()->isEnabled();
+        reply->setReadBufferSize(budget ? qMin<qint64>(streamReadBufferSize, FirebaseMemoryBudget::instance()->readBufferSize()) : streamReadBufferSize);
+        connect(reply, &QNetworkReply::readyRead, this, [this, call, reply]() {
+            deliver(call, reply);
+        });
+    } else if(FirebaseMemoryBudget::instance()->isEnabled()) {
+        // With a memory budget the body is read as it arrives, so the reply never buffers more than readBufferSize
+        reply->setReadBufferSize(FirebaseMemoryBudget::instance()->readBufferSize());
+        connect(reply, &QNetworkReply::readyRead, this, [this, call, reply]() {
+            consume(call, reply, false);
+        });
+    }
+
+    connect(reply, &QNetworkReply::finished, this, [this, call, reply]() {
+        finish(call, reply);
+    });
+}
+
+void FirebaseTransport::finish(const QSharedPointer<Call> &call, QNetworkReply *reply)
+{
+    reply->deleteLater();
+
+    // The rest of a streamed body, the receiver may cancel the call while taking it
+    if(call->dataCallback)
+        deliver(call, reply);
+    call->reply = nullptr;
+
+    recordMetrics(*call);
+#ifndef QT_NO_SSL
+    storeSessionTicket(call->request.url().host(), reply);
+#endif
+
+    FirebaseResponse response;
+    response.status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    response.attempts = call->attempt + 1;
+    response.headers = reply->rawHeaderPairs();
+
+    // What is left is read regardless of the budget, the receiver takes the body right away
+    m_throttled.removeAll(call);
+    if(call->reserved > 0 || call->spill)
+        consume(call, reply, true);
+
+    if(call->spill) {
+        call->spill->flush();
+        call->spill->seek(0);
+        response.bodyFile = call->spill;
+    } else {
+        response.body = call->buffer.isEmpty() ? reply->readAll() : call->buffer;
+    }
+
+    // The receiver owns the body from here on, only bodies in flight count against the budget
+    FirebaseMemoryBudget::instance()->release(call->reserved);
+    call->reserved = 0;
+    call->buffer.clear();
+    call->spill.reset();
+
+    QString serverMessage;
+    const QByteArray errorBody = response.bodyFile ? response.bodyFile->peek(64 * 1024) : response.body;
+    response.error = call->cancelReason != FirebaseError::NoError ? call->cancelReason
+                                                                  : FirebaseError::fromReply(reply->error(), response.status, errorBody, &serverMessage);
+
+    // The slot is free again, the next waiting call may go
+    const QString host = call->request.url().host();
+    HostLimiter &limiter = this->limiter(host);
+    --limiter.inFlight;
+    if(call->cancelReason == FirebaseError::NoError)
+        adapt(limiter, response, m_clock.elapsed() - call->sentAt, call->body.size() + call->delivered + response.body.size() < 64 * 1024 && !response.bodyFile);
+    dispatch(host);
+
+    if(response.error == FirebaseError::NoError) {
+        m_retryTokens = qMin(retryTokensMax, m_retryTokens + retryTokensPerSuccess);
+    } else {
+        response.errorString = FirebaseError::message(response.error, serverMessage.isEmpty() ? reply->errorString() : serverMessage);
+
+        if(shouldRetry(*call, response, reply->error())) {
+            const int delay = retryDelay(call->attempt, reply->rawHeader("Retry-After").toInt());
+            ++call->attempt;
+            m_retryTokens -= 1.0;
+
+            qCDebug(lcFirebaseTransport) << "Retrying" << call->verb << call->request.url().path()
+                                         << "in" << delay << "ms, error" << response.error;
+
+            QTimer::singleShot(delay, this, [this, call]() {
+                if(!m_calls.contains(call->id))
+                    return;
+
+                if(call->context)
+                    admit(call);
+                else
+                    m_calls.remove(call->id);
+            });
+            return;
+        }
+
+        qCWarning(lcFirebaseTransport) << call->verb << call->request.url().path() << "failed:" << response.errorString;
+    }
+
+    complete(call, response);
+}
+
+void FirebaseTransport::complete(const QSharedPointer<Call> &call, const FirebaseResponse &response)
+{
+    m_calls.remove(call->id);
+
+    if(call->context)
+        call->callback(response);
+}
+
+bool FirebaseTransport::shouldRetry(const Call &call, const FirebaseResponse &response, QNetworkReply::NetworkError networkError)
+{
+    if(!call.context || call.cancelReason != FirebaseError::NoError || call.attempt >= m_maxRetries || m_retryTokens < 1.0 || call.delivered > 0)
+        return false;
+
+    if(FirebaseError::category(response.error) != FirebaseError::Retryable)
+        return false;
+
+    if(call.options & Idempotent)
+        return true;
+
+    // Non idempotent requests are only resent if the server certainly did not process them
+    return response.error == FirebaseError::TooManyAttempts
+            || networkError == QNetworkReply::ConnectionRefusedError
+            || networkError == QNetworkReply::HostNotFoundError;
+}
+
+/*
+    Reads what the reply received so far into the call, counted against the memory budget. Bodies that cannot go to a
+    file are capped: while the budget is used up their data stays in the reply, whose read buffer is then full, so the
+    connection stops reading from the network until other responses release their share.
+*/
+void FirebaseTransport::consume(const QSharedPointer<Call> &call, QNetworkReply *reply, bool force)
+{
+    const qint64 available = reply->bytesAvailable();
+    if(available <= 0)
+        return;
+
+    if(call->spill) {
+        call->spill->write(reply->readAll());
+        return;
+    }
+
+    FirebaseMemoryBudget *budget = FirebaseMemoryBudget::instance();
+
+    // Large bodies, and any body once the budget is used up, continue on disk if the caller can take a file
+    if(call->options & SpillToFile) {
+        const bool reserved = call->buffer.size() + available <= budget->spillThreshold() && budget->tryReserve(available);
+        const QByteArray data = reply->read(available);
+        if(!reserved && spill(*call, data))
+            return;
+        if(!reserved)
+            budget->reserve(data.size());
+
+        call->reserved += data.size();
+        call->buffer.append(data);
+        return;
+    }
+
+    // A body that is alone in the budget always goes on, waiting would not free anything
+    const bool alone = budget->used() <= call->reserved;
+    if(!force && !alone && !budget->tryReserve(available)) {
+        if(!m_throttled.contains(call))
+            m_throttled.append(call);
+        if(!m_throttleTimer.isActive())
+            m_throttleTimer.start();
+        return;
+    }
+    if(force || alone)
+        budget->reserve(available);
+
+    call->reserved += available;
+    call->buffer.append(reply->read(available));
+}
+
+// Passes what a streaming call received so far to its receiver, error bodies stay in the reply for finish()
+void FirebaseTransport::deliver(const QSharedPointer<Call> &call, QNetworkReply *reply)
+{
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if(!call->context || call->cancelReason != FirebaseError::NoError || status < 200 || status >= 300 || reply->bytesAvailable() <= 0)
+        return;
+
+    FirebaseResponse response;
+    response.status = status;
+    response.attempts = call->attempt + 1;
+    response.headers = reply->rawHeaderPairs();
+
+    const QByteArray data = reply->readAll();
+    call->delivered += data.size();
+    call->dataCallback(response, data);
+}
+
+/*
+    Lets throttled replies read again once the budget has room. Replies that hold parts of the budget and all wait for
+    more would wait for each other forever, so after a few rounds without progress the oldest one goes over the limit.
+*/
+void FirebaseTransport::resumeThrottled()
+{
+    const QList<QSharedPointer<Call>> throttled = m_throttled;
+    m_throttled.clear();
+
+    bool progressed = false;
+    for(const QSharedPointer<Call> &call : throttled) {
+        if(!call->reply)
+            continue;
+
+        const qint64 reserved = call->reserved;
+        consume(call, call->reply, false);
+        progressed = progressed || call->reserved > reserved;
+    }
+
+    m_throttleStalls = progressed ? 0 : m_throttleStalls + 1;
+    if(m_throttleStalls >= maxThrottleStalls && !m_throttled.isEmpty()) {
+        const QSharedPointer<Call> oldest = m_throttled.takeFirst();
+        qCDebug(lcFirebaseTransport) << "Memory budget stalled, letting" << oldest->request.url().path() << "go over the limit";
+        consume(oldest, oldest->reply, true);
+        m_throttleStalls = 0;
+    }
+
+    if(!m_throttled.isEmpty())
+        m_throttleTimer.start();
+}
+
+bool FirebaseTransport::spill(Call &call, const QByteArray &data)
+{
+    QSharedPointer<QTemporaryFile> file(new QTemporaryFile);
+    if(!file->open() || file->write(call.buffer) != call.buffer.size() || file->write(data) != data.size()) {
+        qCWarning(lcFirebaseTransport) << "Could not spill response to disk, keeping it in memory";
+        return false;
+    }
+
+    qCDebug(lcFirebaseTransport) << "Spilling response of" << call.request.url().path() << "to" << file->fileName();
+
+    FirebaseMemoryBudget::instance()->release(call.reserved);
+    call.reserved = 0;
+    call.buffer.clear();
+    call.spill = file;
+    return true;
+}
+
+void FirebaseTransport::recordMetrics(const Call &call)
+{
+    HostMetrics &metrics = m_hostMetrics[call.request.url().host()];
+    const qint64 elapsed = m_clock.elapsed() - call.sentAt;
+
+    if(metrics.firstRequestAt < 0) {
+        metrics.firstRequestAt = call.sentAt;
+        metrics.firstRequestTime = elapsed;
+        qCDebug(lcFirebaseTransport) << "First request to" << call.request.url().host() << "took" << elapsed << "ms"
+                                     << (metrics.preconnectedAt >= 0 ? "(pre-connected)" : "(cold)");
+    }
+
+    ++metrics.requests;
+    metrics.totalRequestTime += elapsed;
+}
+
+#ifndef QT_NO_SSL
+// TLS configuration with session persistence enabled and the ticket of a previous session to resume, if any
+QSslConfiguration FirebaseTransport::sslConfiguration(const QString &host)
+{
+    loadSessionTickets();
+
+    QSslConfiguration config = QSslConfiguration::defaultConfiguration();
+    config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+    const auto it = m_sessionTickets.constFind(host);
+    if(it != m_sessionTickets.cend() && it->expires > QDateTime::currentSecsSinceEpoch()) {
+        config.setSessionTicket(it->ticket);
+
+        HostMetrics &metrics = m_hostMetrics[host];
+        if(metrics.firstRequestAt < 0)
+            metrics.sessionTicketOffered = true;
+    }
+
+    return config;
+}
+
+void FirebaseTransport::storeSessionTicket(const QString &host, QNetworkReply *reply)
+{
+    const QSslConfiguration config = reply->sslConfiguration();
+    const QByteArray ticket = config.sessionTicket();
+    if(ticket.isEmpty() || m_sessionCacheFile.isEmpty() || m_sessionTickets.value(host).ticket == ticket)
+        return;
+
+    // Servers give a lifetime hint, without it the ticket is assumed to be valid for a day
+    const int lifetime = config.sessionTicketLifeTimeHint() > 0 ? config.sessionTicketLifeTimeHint() : 24 * 3600;
+
+    SessionTicket &stored = m_sessionTickets[host];
+    stored.ticket = ticket;
+    stored.expires = QDateTime::currentSecsSinceEpoch() + lifetime;
+
+    // Tickets arrive in bursts at startup, write them once things settle
+    m_saveTimer.start();
+}
+
+void FirebaseTransport::loadSessionTickets()
+{
+    if(m_sessionTicketsLoaded)
+        return;
+    m_sessionTicketsLoaded = true;
+
+    QFile file(m_sessionCacheFile);
+    if(m_sessionCacheFile.isEmpty() || !file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    quint32 version, count;
+    stream >> version >> count;
+    if(version != sessionCacheVersion)
+        return;
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString host;
+        SessionTicket ticket;
+        stream >> host >> ticket.ticket >> ticket.expires;
+        if(stream.status() == QDataStream::Ok && ticket.expires > now)
+            m_sessionTickets.insert(host, ticket);
+    }
+}
+
+// Session tickets allow resuming the TLS session, so the file is only readable by the owner
+void FirebaseTransport::saveSessionTickets()
+{
+    if(m_sessionCacheFile.isEmpty())
+        return;
+
+    QDir().mkpath(QFileInfo(m_sessionCacheFile).absolutePath());
+    QSaveFile file(m_sessionCacheFile);
+    if(!file.open(QIODevice::WriteOnly))
+        return;
+
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    QDataStream stream(&file);
+    stream << sessionCacheVersion << static_cast<quint32>(m_sessionTickets.size());
+    for(auto it = m_sessionTickets.cbegin(); it != m_sessionTickets.cend(); ++it)
+        stream << it.key() << it->ticket << it->expires;
+
+    if(!file.commit())
+        qCWarning(lcFirebaseTransport) << "Could not write" << m_sessionCacheFile;
+}
+#endif
@@ -0,0 +1,187 @@
+#ifndef FIREBASETRANSPORT_H
+#define FIREBASETRANSPORT_H
+
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSslConfiguration>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVariantMap>
+#include <QTemporaryFile>
+#include <QQueue>
+#include <functional>
+#include "firebaseerror.h"
+#include "firebasetrace.h"
+
+struct FirebaseResponse
+{
+    int status = 0;
+    QByteArray body;
+    FirebaseError::Code error = FirebaseError::NoError;
+    QString errorString;
+    int attempts = 0;
+    QList<QNetworkReply::RawHeaderPair> headers;
+    QSharedPointer<QTemporaryFile> bodyFile;    // Holds the body instead of body if it was spilled to disk
+
+    // Value of a response header, matched case insensitively
+    QByteArray header(const QByteArray &name) const
+    {
+        for(const QNetworkReply::RawHeaderPair &pair : headers) {
+            if(qstricmp(pair.first.constData(), name.constData()) == 0)
+                return pair.second;
+        }
+        return QByteArray();
+    }
+};
+
+class FirebaseTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(const FirebaseResponse &response)>;
+    using DataCallback = std::function<void(const FirebaseResponse &response, const QByteArray &data)>;
+
+    enum Option {
+        NoOptions = 0x0,
+        Idempotent = 0x1,   // Safe to resend after the request may have reached the server
+        SpillToFile = 0x2   // The caller accepts large bodies in bodyFile when a memory budget is set
+    };
+    Q_DECLARE_FLAGS(Options, Option)
+
+    explicit FirebaseTransport(QObject *parent = nullptr);
+
+    static FirebaseTransport *shared();
+
+    QNetworkAccessManager *manager();
+
+    quint64 send(const QByteArray &verb, const QNetworkRequest &request, const QByteArray &body, QObject *context, Callback callback, Options options = Idempotent);
+    quint64 stream(const QByteArray &verb, const QNetworkRequest &request, const QByteArray &body, QObject *context, DataCallback dataCallback,
+                   Callback callback, Options options = Idempotent);
+    void cancel(quint64 requestId, FirebaseError::Code reason = FirebaseError::Cancelled);
+
+    int maxRetries() const;
+    void setMaxRetries(int maxRetries);
+
+    int retryDelay(int attempt, int retryAfterSeconds = 0) const;
+
+    void setRateLimit(double requestsPerSecond, int burst);
+    void setMaxConcurrency(int maxConcurrency);
+
+    void preconnect(const QUrl &url);
+    void prepare(QNetworkRequest &request);
+    QVariantMap connectionMetrics() const;
+
+    QString sessionCacheFile() const;
+    void setSessionCacheFile(const QString &sessionCacheFile);
+
+    bool startCapture(const QString &fileName);
+    void stopCapture();
+    bool startReplay(const QString &fileName, double speed = 1.0);
+    void stopReplay();
+
+private:
+    struct Call {
+        quint64 id;
+        QByteArray verb;
+        QNetworkRequest request;
+        QByteArray body;
+        QPointer<QObject> context;
+        Callback callback;
+        DataCallback dataCallback;
+        Options options;
+        int attempt = 0;
+        QPointer<QNetworkReply> reply;
+        FirebaseError::Code cancelReason = FirebaseError::NoError;
+        qint64 sentAt = 0;
+        QByteArray buffer;
+        QSharedPointer<QTemporaryFile> spill;
+        qint64 reserved = 0;
+        qint64 delivered = 0;
+    };
+
+    // Connection setup timings of one host, reported by connectionMetrics()
+    struct HostMetrics {
+        qint64 preconnectedAt = -1;
+        qint64 firstRequestAt = -1;
+        qint64 firstRequestTime = -1;
+        bool sessionTicketOffered = false;
+        int requests = 0;
+        qint64 totalRequestTime = 0;
+    };
+
+    // Client side limits of one host: a token bucket for the request rate and a window for requests in flight
+    struct HostLimiter {
+        double tokens = 0.0;
+        double rate = 0.0;
+        qint64 refilledAt = 0;
+        double window = 0.0;
+        int inFlight = 0;
+        qint64 baselineLatency = -1;
+        qint64 decreasedAt = -1;
+        bool dispatchScheduled = false;
+        QQueue<QSharedPointer<Call>> waiting;
+        int throttled = 0;
+    };
+
+    struct SessionTicket {
+        QByteArray ticket;
+        qint64 expires = 0;
+    };
+
+    void admit(const QSharedPointer<Call> &call);
+    void dispatch(const QString &host);
+    void adapt(HostLimiter &limiter, const FirebaseResponse &response, qint64 latency, bool measurable);
+    HostLimiter &limiter(const QString &host);
+    void start(const QSharedPointer<Call> &call);
+    void finish(const QSharedPointer<Call> &call, QNetworkReply *reply);
+    void complete(const QSharedPointer<Call> &call, const FirebaseResponse &response);
+    bool shouldRetry(const Call &call, const FirebaseResponse &response, QNetworkReply::NetworkError networkError);
+    void recordMetrics(const Call &call);
+    void consume(const QSharedPointer<Call> &call, QNetworkReply *reply, bool force);
+    void deliver(const QSharedPointer<Call> &call, QNetworkReply *reply);
+    void resumeThrottled();
+    bool spill(Call &call, const QByteArray &data);
+
+#ifndef QT_NO_SSL
+    QSslConfiguration sslConfiguration(const QString &host);
+    void storeSessionTicket(const QString &host, QNetworkReply *reply);
+    void loadSessionTickets();
+    void saveSessionTickets();
+#endif
+
+    FirebaseTraceManager m_manager;
+    QHash<quint64, QSharedPointer<Call>> m_calls;
+    quint64 m_nextId = 1;
+    int m_maxRetries = 3;
+
+    // Retry budget: each success earns a fraction of a retry, each retry spends one
+    double m_retryTokens;
+
+    QElapsedTimer m_clock;
+    QHash<QString, HostMetrics> m_hostMetrics;
+
+    // Replies that stopped reading because the memory budget is used up
+    QList<QSharedPointer<Call>> m_throttled;
+    QTimer m_throttleTimer;
+    int m_throttleStalls = 0;
+
+    QHash<QString, HostLimiter> m_limiters;
+    double m_maxRate;
+    int m_burst;
+    int m_maxConcurrency;
+
+    QString m_sessionCacheFile;
+    QHash<QString, SessionTicket> m_sessionTickets;
+    bool m_sessionTicketsLoaded = false;
+    QTimer m_saveTimer;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(FirebaseTransport::Options)
+
+#endif // FIREBASETRANSPORT_H
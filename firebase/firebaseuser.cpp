@@ -1,156 +1,289 @@
-#include "firebaseuser.h"
-
-
-/*!
-    \qmltype FirebaseUser
-    \inqmlmodule Firebase
-    \ingroup Firebase
-    \brief Type that encapsulate user data for easy access.
-
-    FirebaseUser simply holds data about the users authenticated in the firebase. This type is used by \l FirebaseAuth to hold a reference
-    to the user currently authenticated and can also be used to create models/lists of all available users in the \l FirebaseDatabase.
-*/
-FirebaseUser::FirebaseUser(QObject *parent) : QObject(parent)
-{
-}
-
-/*!
-    \qmlproperty string FirebaseUser::email
-
-    Specifies the user's email.
- */
-QString FirebaseUser::email() const
-{
-    return m_email;
-}
-
-void FirebaseUser::setEmail(const QString &email)
-{
-    if(m_email == email)
-        return;
-
-    m_email = email;
-    emit emailChanged();
-}
-
-/*!
-    \qmlproperty string FirebaseUser::idToken
-
-    Specifies the users \a idToken, often used for actions that require authentication such as writing/reading data from the \l FirebaseDatabase or managing the user profile with \l FirebaseAuth.
-    This token expires after 1 hour and should be refreshed using the \l refreshToken.
-
-    \note for more information about use, see \l FirebaseAuth::currentUser
- */
-QString FirebaseUser::idToken() const
-{
-    return m_idToken;
-}
-
-void FirebaseUser::setIdToken(const QString &idToken)
-{
-    if(m_idToken == idToken)
-        return;
-
-    m_idToken = idToken;
-    emit idTokenChanged();
-}
-
-
-/*!
-    \qmlproperty string FirebaseUser::refreshToken
-
-    Returns the refresh token, tipically used to refresh the \l idToken after it expires.
-
-    \note for more information about use, see \l FirebaseAuth::exchangeRefreshToken
- */
-QString FirebaseUser::refreshToken() const
-{
-    return m_refreshToken;
-}
-
-void FirebaseUser::setRefreshToken(const QString &refreshToken)
-{
-    if(m_refreshToken == refreshToken)
-        return;
-
-    m_refreshToken = refreshToken;
-    emit refreshTokenChanged();
-}
-
-/*!
-    \qmlproperty string FirebaseUser::userId
-
-    Specifies the unique identifier of the user in the entire Firebase project.
-
-    \warning this identifier will change if the email of the user is altered.
- */
-QString FirebaseUser::userId() const
-{
-    return m_userId;
-}
-
-void FirebaseUser::setUserId(const QString &userId)
-{
-    if(m_userId == userId)
-        return;
-
-    m_userId = userId;
-    emit userIdChanged();
-}
-
-/*!
-    \qmlproperty string FirebaseUser::name
-
-    Returns the \a name of the user.
- */
-QString FirebaseUser::name() const
-{
-    return m_name;
-}
-
-void FirebaseUser::setName(const QString &name)
-{
-    if(m_name == name)
-        return;
-
-    m_name = name;
-    emit nameChanged();
-}
-
-/*!
-    \qmlproperty bool FirebaseUser::emailVerified
-
-    Specifies if the email of this user has already been verified. A verification email can be sent using \l FirebaseAuth::sendEmailVerification()
- */
-bool FirebaseUser::emailVerified() const
-{
-    return m_emailVerified;
-}
-
-void FirebaseUser::setEmailVerified(bool emailVerified)
-{
-    if(m_emailVerified == emailVerified)
-        return;
-
-    m_emailVerified = emailVerified;
-    emit emailVerifiedChanged();
-}
-
-/*!
-    \qmlproperty string FirebaseUser::photoUrl
-
-    Url that holds the profile picture of the user.
- */
-QString FirebaseUser::photoUrl() const
-{
-    return m_photoUrl;
-}
-
-void FirebaseUser::setPhotoUrl(const QString &photoUrl)
-{
-    if(m_photoUrl == photoUrl)
-        return;
-
-    m_photoUrl = photoUrl;
-    emit photoUrlChanged();
-}
+#include "firebaseuser.h"
+#include "firebasetokenverifier.h"
+#include "utils/JwtUtils.h"
+
+
+/*!
+    \qmltype FirebaseUser
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Type that encapsulate user data for easy access.
+
+    FirebaseUser simply holds data about the users authenticated in the firebase. This type is used by \l FirebaseAuth to hold a reference
+    to the user currently authenticated and can also be used to create models/lists of all available users in the \l FirebaseDatabase.
+*/
+FirebaseUser::FirebaseUser(QObject *parent) : QObject(parent)
+{
+}
+
+/*!
+    \qmlproperty string FirebaseUser::email
+
+    Specifies the user's email.
+ */
+QString FirebaseUser::email() const
+{
+    return m_email;
+}
+
+void FirebaseUser::setEmail(const QString &email)
+{
+    if(m_email == email)
+        return;
+
+    m_email = email;
+    emit emailChanged();
+}
+
+/*!
+    \qmlproperty string FirebaseUser::idToken
+
+    Specifies the users \a idToken, often used for actions that require authentication such as writing/reading data from the \l FirebaseDatabase or managing the user profile with \l FirebaseAuth.
+    This token expires after 1 hour and should be refreshed using the \l refreshToken.
+
+    The token is a JWT that is decoded locally whenever it changes: \l claims, \l expirationTime and the profile fields it carries
+    (\l userId, \l email, \l emailVerified, \l name and \l photoUrl) are updated without a call to \l FirebaseAuth::getUserData().
+
+    \note for more information about use, see \l FirebaseAuth::currentUser
+ */
+QString FirebaseUser::idToken() const
+{
+    return m_idToken;
+}
+
+void FirebaseUser::setIdToken(const QString &idToken)
+{
+    if(m_idToken == idToken)
+        return;
+
+    m_idToken = idToken;
+    m_claims = JwtUtils::payload(idToken);
+    setTokenVerified(false);
+
+    // Most of the profile is already inside the token, so fill it in without a network round trip
+    if(m_claims.contains("user_id"))
+        setUserId(m_claims["user_id"].toString());
+    if(m_claims.contains("email"))
+        setEmail(m_claims["email"].toString());
+    if(m_claims.contains("email_verified"))
+        setEmailVerified(m_claims["email_verified"].toBool());
+    if(m_claims.contains("name"))
+        setName(m_claims["name"].toString());
+    if(m_claims.contains("picture"))
+        setPhotoUrl(m_claims["picture"].toString());
+
+    emit idTokenChanged();
+}
+
+/*!
+    \qmlproperty var FirebaseUser::claims
+
+    Holds all claims of the decoded \l idToken, including custom claims set through the Admin SDK. The token is only decoded, not verified,
+    use \l verifyIdToken() if the claims must be trusted.
+
+    \code
+    FirebaseAuth {
+        id: fbAuth
+        onSignedIn: {
+            if(currentUser.claims.admin)
+                console.log("Signed in as administrator")
+        }
+    }
+    \endcode
+ */
+QVariantMap FirebaseUser::claims() const
+{
+    return m_claims.toVariantMap();
+}
+
+/*!
+    \qmlproperty date FirebaseUser::expirationTime
+
+    Time at which the \l idToken expires, read from its \c exp claim.
+
+    \sa isTokenExpired()
+ */
+QDateTime FirebaseUser::expirationTime() const
+{
+    return JwtUtils::numericDate(m_claims, "exp");
+}
+
+/*!
+    \qmlproperty date FirebaseUser::issuedAtTime
+
+    Time at which the \l idToken was issued, read from its \c iat claim.
+ */
+QDateTime FirebaseUser::issuedAtTime() const
+{
+    return JwtUtils::numericDate(m_claims, "iat");
+}
+
+/*!
+    \qmlproperty string FirebaseUser::signInProvider
+
+    Provider used to obtain the \l idToken, e.g \c password or \c google.com.
+ */
+QString FirebaseUser::signInProvider() const
+{
+    return m_claims["firebase"].toObject()["sign_in_provider"].toString();
+}
+
+/*!
+    \qmlmethod bool FirebaseUser::isTokenExpired(int marginSeconds)
+
+    Returns true if the \l idToken is missing or expires within \a marginSeconds from now.
+ */
+bool FirebaseUser::isTokenExpired(int marginSeconds) const
+{
+    const QDateTime expiration = expirationTime();
+    return !expiration.isValid() || expiration <= QDateTime::currentDateTimeUtc().addSecs(marginSeconds);
+}
+
+/*!
+    \qmlproperty bool FirebaseUser::tokenVerified
+
+    True if the signature of the current \l idToken was successfully verified with \l verifyIdToken().
+ */
+bool FirebaseUser::tokenVerified() const
+{
+    return m_tokenVerified;
+}
+
+void FirebaseUser::setTokenVerified(bool tokenVerified)
+{
+    if(m_tokenVerified == tokenVerified)
+        return;
+
+    m_tokenVerified = tokenVerified;
+    emit tokenVerifiedChanged();
+}
+
+/*!
+    \qmlmethod void FirebaseUser::verifyIdToken(string projectId)
+
+    Verifies the signature of the \l idToken against Google's public keys, as well as its expiry, issuer and audience. The token must
+    have been issued for \a projectId, e.g \l FirebaseApp::projectId.
+
+    The public keys are cached on disk and only downloaded again when the lifetime announced by Google expires, so most verifications
+    do not need network access. On success \l tokenVerified becomes true, otherwise \l tokenVerificationFailed() is emitted.
+ */
+void FirebaseUser::verifyIdToken(const QString &projectId)
+{
+    const QString token = m_idToken;
+
+    FirebaseTokenVerifier::instance()->verify(token, projectId, this, [this, token](bool valid, const QString &error) {
+        // Ignore results for tokens that were replaced in the meantime
+        if(token != m_idToken)
+            return;
+
+        setTokenVerified(valid);
+        if(!valid)
+            emit tokenVerificationFailed(error);
+    });
+}
+
+/*!
+    \qmlsignal FirebaseUser::tokenVerificationFailed(string error)
+
+    Emitted when \l verifyIdToken() rejects the current \l idToken, with the reason in \a error.
+ */
+
+
+/*!
+    \qmlproperty string FirebaseUser::refreshToken
+
+    Returns the refresh token, tipically used to refresh the \l idToken after it expires.
+
+    \note for more information about use, see \l FirebaseAuth::exchangeRefreshToken
+ */
+QString FirebaseUser::refreshToken() const
+{
+    return m_refreshToken;
+}
+
+void FirebaseUser::setRefreshToken(const QString &refreshToken)
+{
+    if(m_refreshToken == refreshToken)
+        return;
+
+    m_refreshToken = refreshToken;
+    emit refreshTokenChanged();
+}
+
+/*!
+    \qmlproperty string FirebaseUser::userId
+
+    Specifies the unique identifier of the user in the entire Firebase project.
+
+    \warning this identifier will change if the email of the user is altered.
+ */
+QString FirebaseUser::userId() const
+{
+    return m_userId;
+}
+
+void FirebaseUser::setUserId(const QString &userId)
+{
+    if(m_userId == userId)
+        return;
+
+    m_userId = userId;
+    emit userIdChanged();
+}
+
+/*!
+    \qmlproperty string FirebaseUser::name
+
+    Returns the \a name of the user.
+ */
+QString FirebaseUser::name() const
+{
+    return m_name;
+}
+
+void FirebaseUser::setName(const QString &name)
+{
+    if(m_name == name)
+        return;
+
+    m_name = name;
+    emit nameChanged();
+}
+
+/*!
+    \qmlproperty bool FirebaseUser::emailVerified
+
+    Specifies if the email of this user has already been verified. A verification email can be sent using \l FirebaseAuth::sendEmailVerification()
+ */
+bool FirebaseUser::emailVerified() const
+{
+    return m_emailVerified;
+}
+
+void FirebaseUser::setEmailVerified(bool emailVerified)
+{
+    if(m_emailVerified == emailVerified)
+        return;
+
+    m_emailVerified = emailVerified;
+    emit emailVerifiedChanged();
+}
+
+/*!
+    \qmlproperty string FirebaseUser::photoUrl
+
+    Url that holds the profile picture of the user.
+ */
+QString FirebaseUser::photoUrl() const
+{
+    return m_photoUrl;
+}
+
+void FirebaseUser::setPhotoUrl(const QString &photoUrl)
+{
+    if(m_photoUrl == photoUrl)
+        return;
+
+    m_photoUrl = photoUrl;
+    emit photoUrlChanged();
+}
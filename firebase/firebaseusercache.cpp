@@ -0,0 +1,492 @@
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QRunnable>
+#include <QStandardPaths>
+#include <QThread>
+#include "firebaseusercache.h"
+#include "utils/AuthUtils.h"
+
+Q_LOGGING_CATEGORY(lcFirebaseUserCache, "firebase.usercache", QtWarningMsg)
+
+namespace {
+
+// Lookups requested within this time go out as one request
+const int batchDelay = 10;
+
+// Decoded thumbnails kept in memory, in KiB
+const int thumbnailMemory = 16 * 1024;
+
+QString contentKey(const QByteArray &data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+}
+
+}
+
+/*!
+    \qmltype FirebaseUserCache
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Type that caches the profiles and profile photos of other users.
+
+    FirebaseUserCache returns the profile of a user by id right away if it is known, and fetches it otherwise. Profiles
+    are maps with the property names of \l FirebaseUser: \c userId, \c name, \c email, \c emailVerified and
+    \c photoUrl. \l profileChanged() is emitted when a profile arrives or changes.
+
+    Profiles older than \l timeToLive are still returned, and refreshed in the background. All profiles requested
+    within a few milliseconds, e.g by the delegates of a list being created, are looked up with a single request of up
+    to 100 users. Looking up other users needs the \l projectId and an OAuth \l accessToken with access to that project;
+    without them, profiles can be provided with \l insert(), e.g from the database.
+
+    Profile photos are downloaded as soon as a profile is known, and scaled to \l thumbnailSize while decoding, on a
+    worker thread. \l thumbnail() returns the local file of the thumbnail, so an \c Image only loads a few kilobytes.
+    Profiles and thumbnails are kept on disk in a least recently used cache of at most \l maxDiskSize bytes, and the
+    latest \l maxProfiles profiles in memory.
+
+    \code
+    FirebaseUserCache {
+        id: users
+        projectId: fbApp.projectId
+        accessToken: backOfficeToken
+    }
+
+    ListView {
+        model: memberIds
+        delegate: Row {
+            property var profile: users.profile(modelData)
+            Connections {
+                target: users
+                function onProfileChanged(userId) { if(userId === modelData) profile = users.profile(modelData) }
+                function onThumbnailReady(userId, url) { if(userId === modelData) photo.source = url }
+            }
+            Image { id: photo; source: users.thumbnail(modelData) }
+            Text { text: profile.name || "" }
+        }
+    }
+    \endcode
+
+    \sa FirebaseUser
+*/
+FirebaseUserCache::FirebaseUserCache(QObject *parent) : QObject(parent), m_transport(FirebaseTransport::shared())
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    m_disk.setDirectory(cacheDir.isEmpty() ? QString() : cacheDir + "/firebase/users");
+    m_disk.setMaxSize(32 * 1024 * 1024);
+
+    m_profiles.setMaxCost(1000);
+    m_thumbnails.setMaxCost(thumbnailMemory);
+
+    m_batchTimer.setSingleShot(true);
+    connect(&m_batchTimer, &QTimer::timeout, this, &FirebaseUserCache::lookup);
+}
+
+// Decodes still running post their result to this object, so they are waited for before it goes away
+FirebaseUserCache::~FirebaseUserCache()
+{
+    m_decoders.clear();
+    m_decoders.waitForDone();
+}
+
+/*!
+    \qmlsignal FirebaseUserCache::profileChanged(string userId)
+
+    Emitted when the profile of \a userId has been received or has changed.
+ */
+
+/*!
+    \qmlsignal FirebaseUserCache::thumbnailReady(string userId, url url)
+
+    Emitted when the thumbnail of the profile photo of \a userId has been stored at \a url.
+ */
+
+/*!
+    \qmlproperty string FirebaseUserCache::accessToken
+
+    OAuth 2.0 access token used to look up users, e.g of a service account with the Firebase Authentication Admin role.
+ */
+QString FirebaseUserCache::accessToken() const
+{
+    return m_accessToken;
+}
+
+void FirebaseUserCache::setAccessToken(const QString &accessToken)
+{
+    if(m_accessToken == accessToken)
+        return;
+
+    m_accessToken = accessToken;
+    emit accessTokenChanged();
+}
+
+/*!
+    \qmlproperty string FirebaseUserCache::projectId
+
+    This property holds the ID of the Firebase project the users belong to, passed from \l FirebaseApp.
+ */
+QString FirebaseUserCache::projectId() const
+{
+    return m_projectId;
+}
+
+void FirebaseUserCache::setProjectId(const QString &projectId)
+{
+    if(m_projectId == projectId)
+        return;
+
+    m_projectId = projectId;
+    emit projectIdChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseUserCache::timeToLive
+
+    Seconds after which a profile is fetched again. Default is one hour.
+ */
+int FirebaseUserCache::timeToLive() const
+{
+    return m_timeToLive;
+}
+
+void FirebaseUserCache::setTimeToLive(int timeToLive)
+{
+    if(m_timeToLive == timeToLive)
+        return;
+
+    m_timeToLive = timeToLive;
+    emit timeToLiveChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseUserCache::thumbnailSize
+
+    Size in pixels of the longer side of thumbnails. Default is 96.
+ */
+int FirebaseUserCache::thumbnailSize() const
+{
+    return m_thumbnailSize;
+}
+
+void FirebaseUserCache::setThumbnailSize(int thumbnailSize)
+{
+    if(m_thumbnailSize == thumbnailSize)
+        return;
+
+    m_thumbnailSize = thumbnailSize;
+    m_thumbnails.clear();
+    emit thumbnailSizeChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseUserCache::maxProfiles
+
+    Number of profiles kept in memory. Default is 1000.
+ */
+int FirebaseUserCache::maxProfiles() const
+{
+    return m_profiles.maxCost();
+}
+
+void FirebaseUserCache::setMaxProfiles(int maxProfiles)
+{
+    if(m_profiles.maxCost() == maxProfiles)
+        return;
+
+    m_profiles.setMaxCost(maxProfiles);
+    emit maxProfilesChanged();
+}
+
+/*!
+    \qmlproperty int FirebaseUserCache::maxDiskSize
+
+    Maximum size in bytes of the profiles and thumbnails kept on disk. Default is 32 MiB.
+ */
+qint64 FirebaseUserCache::maxDiskSize() const
+{
+    return m_disk.maxSize();
+}
+
+void FirebaseUserCache::setMaxDiskSize(qint64 maxDiskSize)
+{
+    if(m_disk.maxSize() == maxDiskSize)
+        return;
+
+    m_disk.setMaxSize(maxDiskSize);
+    emit maxDiskSizeChanged();
+}
+
+/*!
+    \qmlmethod object FirebaseUserCache::profile(string userId)
+
+    Returns the known profile of \a userId, or an empty object. Missing and expired profiles are fetched, and
+    \l profileChanged() is emitted once they arrive.
+ */
+QVariantMap FirebaseUserCache::profile(const QString &userId)
+{
+    const Profile *profile = find(userId);
+    if(!profile || QDateTime::currentMSecsSinceEpoch() - profile->fetchedAt > m_timeToLive * qint64(1000))
+        request(userId);
+
+    return profile ? profile->data : QVariantMap();
+}
+
+/*!
+    \qmlmethod url FirebaseUserCache::thumbnail(string userId)
+
+    Returns the local file of the thumbnail of the profile photo of \a userId, or an empty url if it is not there yet.
+    In that case it is fetched and \l thumbnailReady() is emitted once it is stored.
+ */
+QUrl FirebaseUserCache::thumbnail(const QString &userId)
+{
+    const QString photoUrl = profile(userId).value("photoUrl").toString();
+    if(photoUrl.isEmpty())
+        return QUrl();
+
+    const QString file = thumbnailFile(userId, photoUrl);
+    if(file.isEmpty()) {
+        fetchThumbnail(userId, photoUrl);
+        return QUrl();
+    }
+
+    return QUrl::fromLocalFile(file);
+}
+
+/*!
+    \qmlmethod void FirebaseUserCache::prefetch(list<string> userIds)
+
+    Fetches the profiles and thumbnails of \a userIds that are missing or expired, e.g for the rows of a list that are
+    about to become visible.
+ */
+void FirebaseUserCache::prefetch(const QStringList &userIds)
+{
+    for(const QString &userId : userIds)
+        thumbnail(userId);
+}
+
+/*!
+    \qmlmethod void FirebaseUserCache::insert(string userId, object profile)
+
+    Stores \a profile for \a userId as if it had just been fetched, e.g a profile read from the database.
+ */
+void FirebaseUserCache::insert(const QString &userId, const QVariantMap &profile)
+{
+    store(userId, profile, QDateTime::currentMSecsSinceEpoch());
+}
+
+/*!
+    \qmlmethod void FirebaseUserCache::invalidate(string userId)
+
+    Forgets the profile of \a userId, so it is fetched again the next time it is needed.
+ */
+void FirebaseUserCache::invalidate(const QString &userId)
+{
+    m_profiles.remove(userId);
+    m_disk.remove("profile/" + userId);
+}
+
+/*
+    Decoded thumbnail for C++ users such as image providers, read from disk if it is not in memory. Image providers
+    are called on threads of their own, while the caches may only be used in the thread of this object, so calls from
+    other threads wait for it to answer.
+*/
+QImage FirebaseUserCache::thumbnailImage(const QString &userId)
+{
+    if(QThread::currentThread() != thread()) {
+        QImage image;
+        QMetaObject::invokeMethod(this, [this, &image, &userId]() {
+            image = thumbnailImage(userId);
+        }, Qt::BlockingQueuedConnection);
+        return image;
+    }
+
+    if(const QImage *image = m_thumbnails.object(userId))
+        return *image;
+
+    const QUrl url = thumbnail(userId);
+    if(url.isEmpty())
+        return QImage();
+
+    const QImage image(url.toLocalFile());
+    if(!image.isNull())
+        m_thumbnails.insert(userId, new QImage(image), qMax(1, static_cast<int>(image.sizeInBytes() / 1024)));
+    return image;
+}
+
+FirebaseUserCache::Profile *FirebaseUserCache::find(const QString &userId)
+{
+    if(Profile *profile = m_profiles.object(userId))
+        return profile;
+
+    QString generation;
+    const QString file = m_disk.find("profile/" + userId, &generation);
+    QFile saved(file);
+    if(file.isEmpty() || !saved.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    Profile *profile = new Profile;
+    profile->data = QJsonDocument::fromJson(saved.readAll()).object().toVariantMap();
+    profile->fetchedAt = generation.toLongLong();
+    m_profiles.insert(userId, profile);
+    return m_profiles.object(userId);
+}
+
+// Profiles are stored by content, the generation holds the time they were fetched at
+void FirebaseUserCache::store(const QString &userId, const QVariantMap &data, qint64 fetchedAt)
+{
+    const Profile *previous = find(userId);
+    const bool changed = !previous || previous->data != data;
+
+    Profile *profile = new Profile;
+    profile->data = data;
+    profile->fetchedAt = fetchedAt;
+    m_profiles.insert(userId, profile);
+
+    const QByteArray json = QJsonDocument(QJsonObject::fromVariantMap(data)).toJson(QJsonDocument::Compact);
+    const QString key = contentKey(json);
+    const QString temporary = m_disk.temporaryFile(key);
+    QFile file(temporary);
+    if(file.open(QIODevice::WriteOnly) && file.write(json) == json.size()) {
+        file.close();
+        m_disk.insert("profile/" + userId, QString::number(fetchedAt), key, temporary);
+    }
+
+    if(changed)
+        emit profileChanged(userId);
+
+    // Photos are fetched ahead, so they are there by the time a delegate asks for them
+    const QString photoUrl = data.value("photoUrl").toString();
+    if(!photoUrl.isEmpty() && thumbnailFile(userId, photoUrl).isEmpty())
+        fetchThumbnail(userId, photoUrl);
+}
+
+void FirebaseUserCache::request(const QString &userId)
+{
+    if(m_accessToken.isEmpty() || m_projectId.isEmpty() || userId.isEmpty() || m_requested.contains(userId))
+        return;
+
+    m_requested.insert(userId);
+    m_queued.append(userId);
+
+    if(m_queued.size() >= AuthUtils::maxUsersPerLookup)
+        m_batchTimer.start(0);
+    else if(!m_batchTimer.isActive())
+        m_batchTimer.start(batchDelay);
+}
+
+// Looks up the next batch of queued users with one request, users the server does not know get an empty profile
+void FirebaseUserCache::lookup()
+{
+    const QStringList userIds = m_queued.mid(0, AuthUtils::maxUsersPerLookup);
+    m_queued = m_queued.mid(userIds.size());
+    if(!m_queued.isEmpty())
+        m_batchTimer.start(0);
+    if(userIds.isEmpty())
+        return;
+
+    qCDebug(lcFirebaseUserCache) << "Looking up" << userIds.size() << "users";
+
+    QNetworkRequest request(QUrl(AuthUtils::endpoint_lookupUsers));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setRawHeader("Authorization", "Bearer " + m_accessToken.toUtf8());
+
+    m_transport->send("POST", request, AuthUtils::payload_lookupUsers(userIds, m_projectId), this, [this, userIds](const FirebaseResponse &response) {
+        for(const QString &userId : userIds)
+            m_requested.remove(userId);
+
+        if(response.error != FirebaseError::NoError) {
+            emit errorOcurred(response.errorString, response.error);
+            return;
+        }
+
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        QSet<QString> missing(userIds.cbegin(), userIds.cend());
+        for(const QJsonValue &value : QJsonDocument::fromJson(response.body).object()["users"].toArray()) {
+            const QJsonObject user = value.toObject();
+            const QString userId = user["localId"].toString();
+            missing.remove(userId);
+
+            QVariantMap profile;
+            profile["userId"] = userId;
+            profile["name"] = user["displayName"].toString();
+            profile["email"] = user["email"].toString();
+            profile["emailVerified"] = user["emailVerified"].toBool();
+            profile["photoUrl"] = user["photoUrl"].toString();
+            store(userId, profile, now);
+        }
+
+        for(const QString &userId : missing)
+            store(userId, QVariantMap(), now);
+    });
+}
+
+/*
+    Downloads a profile photo and decodes it on a worker thread. Decoding with a scaled size lets formats such
+    as JPEG skip most of the work, and only the small thumbnail is written to disk and handed back.
+*/
+void FirebaseUserCache::fetchThumbnail(const QString &userId, const QString &photoUrl)
+{
+    if(m_fetchingThumbnails.contains(userId))
+        return;
+    m_fetchingThumbnails.insert(userId);
+
+    m_transport->send("GET", QNetworkRequest(QUrl(photoUrl)), QByteArray(), this, [this, userId, photoUrl](const FirebaseResponse &response) {
+        if(response.error != FirebaseError::NoError) {
+            m_fetchingThumbnails.remove(userId);
+            qCWarning(lcFirebaseUserCache) << "Cannot fetch photo of" << userId << response.errorString;
+            return;
+        }
+
+        // Users may share a photo URL, each gets a file of its own so their decodes never write the same file
+        const QString generation = photoUrl + "@" + QString::number(m_thumbnailSize);
+        const QString key = contentKey((userId + "|" + generation).toUtf8());
+        const QString file = m_disk.temporaryFile(key);
+        const int size = m_thumbnailSize;
+        const QByteArray data = response.body;
+
+        m_decoders.start(QRunnable::create([=]() {
+            QBuffer buffer;
+            buffer.setData(data);
+            buffer.open(QIODevice::ReadOnly);
+
+            QImageReader reader(&buffer);
+            const QSize original = reader.size();
+            if(original.isValid())
+                reader.setScaledSize(original.scaled(size, size, Qt::KeepAspectRatio));
+
+            QImage image = reader.read();
+            if(!image.isNull() && qMax(image.width(), image.height()) > size)
+                image = image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            const bool saved = !image.isNull() && image.save(file, "PNG");
+
+            // The destructor waits for the decoders, so this is still alive, and a result it did not take is dropped
+            QMetaObject::invokeMethod(this, [=]() {
+                m_fetchingThumbnails.remove(userId);
+                if(!saved) {
+                    qCWarning(lcFirebaseUserCache) << "Cannot decode photo of" << userId;
+                    return;
+                }
+
+                const QString stored = m_disk.insert("thumbnail/" + userId, generation, key, file);
+                if(stored.isEmpty())
+                    return;
+
+                m_thumbnails.insert(userId, new QImage(image), qMax(1, static_cast<int>(image.sizeInBytes() / 1024)));
+                emit thumbnailReady(userId, QUrl::fromLocalFile(stored));
+            }, Qt::QueuedConnection);
+        }));
+    });
+}
+
+// Stored thumbnail of userId if it was made from photoUrl at the current size
+QString FirebaseUserCache::thumbnailFile(const QString &userId, const QString &photoUrl)
+{
+    QString generation;
+    const QString file = m_disk.find("thumbnail/" + userId, &generation);
+    return generation == photoUrl + "@" + QString::number(m_thumbnailSize) ? file : QString();
+}
@@ -0,0 +1,97 @@
+#ifndef FIREBASEUSERCACHE_H
+#define FIREBASEUSERCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QImage>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+#include <QVariantMap>
+#include "firebasetransport.h"
+#include "firebasestoragecache.h"
+
+class FirebaseUserCache : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(QString projectId READ projectId WRITE setProjectId NOTIFY projectIdChanged)
+    Q_PROPERTY(int timeToLive READ timeToLive WRITE setTimeToLive NOTIFY timeToLiveChanged)
+    Q_PROPERTY(int thumbnailSize READ thumbnailSize WRITE setThumbnailSize NOTIFY thumbnailSizeChanged)
+    Q_PROPERTY(int maxProfiles READ maxProfiles WRITE setMaxProfiles NOTIFY maxProfilesChanged)
+    Q_PROPERTY(qint64 maxDiskSize READ maxDiskSize WRITE setMaxDiskSize NOTIFY maxDiskSizeChanged)
+
+public:
+    explicit FirebaseUserCache(QObject *parent = nullptr);
+    ~FirebaseUserCache() override;
+
+    QString accessToken() const;
+    void setAccessToken(const QString &accessToken);
+
+    QString projectId() const;
+    void setProjectId(const QString &projectId);
+
+    int timeToLive() const;
+    void setTimeToLive(int timeToLive);
+
+    int thumbnailSize() const;
+    void setThumbnailSize(int thumbnailSize);
+
+    int maxProfiles() const;
+    void setMaxProfiles(int maxProfiles);
+
+    qint64 maxDiskSize() const;
+    void setMaxDiskSize(qint64 maxDiskSize);
+
+    Q_INVOKABLE QVariantMap profile(const QString &userId);
+    Q_INVOKABLE QUrl thumbnail(const QString &userId);
+    Q_INVOKABLE void prefetch(const QStringList &userIds);
+    Q_INVOKABLE void insert(const QString &userId, const QVariantMap &profile);
+    Q_INVOKABLE void invalidate(const QString &userId);
+
+    QImage thumbnailImage(const QString &userId);
+
+signals:
+    void accessTokenChanged();
+    void projectIdChanged();
+    void timeToLiveChanged();
+    void thumbnailSizeChanged();
+    void maxProfilesChanged();
+    void maxDiskSizeChanged();
+
+    void profileChanged(QString userId);
+    void thumbnailReady(QString userId, QUrl url);
+    void errorOcurred(QString error, FirebaseError::Code code);
+
+private:
+    struct Profile {
+        QVariantMap data;
+        qint64 fetchedAt = 0;
+    };
+
+    Profile *find(const QString &userId);
+    void store(const QString &userId, const QVariantMap &data, qint64 fetchedAt);
+    void request(const QString &userId);
+    void lookup();
+    void fetchThumbnail(const QString &userId, const QString &photoUrl);
+    QString thumbnailFile(const QString &userId, const QString &photoUrl);
+
+    QString m_accessToken;
+    QString m_projectId;
+    int m_timeToLive = 3600;
+    int m_thumbnailSize = 96;
+
+    FirebaseTransport *m_transport;
+    FirebaseStorageCache m_disk;
+    QCache<QString, Profile> m_profiles;
+    QCache<QString, QImage> m_thumbnails;
+
+    QStringList m_queued;
+    QSet<QString> m_requested;
+    QSet<QString> m_fetchingThumbnails;
+    QTimer m_batchTimer;
+    QThreadPool m_decoders;
+};
+
+#endif // FIREBASEUSERCACHE_H
@@ -0,0 +1,329 @@
+#include <QLoggingCategory>
+#include <algorithm>
+#include "firebasevalue.h"
+#include "utils/DatabaseUtils.h"
+#include "utils/JwtUtils.h"
+
+Q_LOGGING_CATEGORY(lcFirebaseValue, "firebase.value", QtWarningMsg)
+
+namespace {
+
+// Request codes of the shared listeners, far away from the ones applications pick
+const int firstRequestCode = -1000000;
+
+// Path of location relative to the listened location
+QString relativePath(const QString &listened, const QString &location)
+{
+    if(location == listened)
+        return "/";
+    return listened == "/" ? location : location.mid(listened.size());
+}
+
+bool overlaps(const QString &a, const QString &b)
+{
+    return DatabaseUtils::covers(a, b) || DatabaseUtils::covers(b, a);
+}
+
+}
+
+/*!
+    \qmltype FirebaseValue
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Type that keeps the value at a database path up to date.
+
+    FirebaseValue listens to \l path of \l database and holds its current value in \l value, so it can be used in
+    bindings without handling any events:
+
+    \code
+    FirebaseValue {
+        id: temperature
+        database: fbDatabase
+        path: "/sensors/kitchen/temperature"
+        idToken: fbAuth.currentUser.idToken
+    }
+
+    Text { text: temperature.loaded ? temperature.value + " °C" : "…" }
+    \endcode
+
+    All FirebaseValue objects of one database share the listeners: a value whose path lies below the path of another one
+    uses its listener instead of opening a new connection, and the listener of a path is closed when its last
+    FirebaseValue is destroyed or moves elsewhere. When data changes, \l valueChanged() is emitted only by the values
+    whose path is affected by the change and whose value is actually different.
+
+    \sa FirebaseDatabase
+*/
+FirebaseValue::FirebaseValue(QObject *parent) : QObject(parent)
+{
+}
+
+FirebaseValue::~FirebaseValue()
+{
+    unsubscribe();
+}
+
+/*!
+    \qmlproperty FirebaseDatabase FirebaseValue::database
+
+    The database the value is read from.
+ */
+FirebaseDatabase *FirebaseValue::database() const
+{
+    return m_database;
+}
+
+void FirebaseValue::setDatabase(FirebaseDatabase *database)
+{
+    if(m_database == database)
+        return;
+
+    m_database = database;
+    emit databaseChanged();
+    scheduleSubscribe();
+}
+
+/*!
+    \qmlproperty string FirebaseValue::path
+
+    Path of the value in the database, e.g \c "/users/alice/name".
+ */
+QString FirebaseValue::path() const
+{
+    return m_path;
+}
+
+void FirebaseValue::setPath(const QString &path)
+{
+    if(m_path == path)
+        return;
+
+    m_path = path;
+    emit pathChanged();
+    scheduleSubscribe();
+}
+
+/*!
+    \qmlproperty string FirebaseValue::idToken
+
+    ID token sent when listening, empty for unauthenticated access. Values share a listener only with the same token.
+
+    A refreshed token of the same user moves the value to a listener with the new token while \l value and \l loaded
+    are kept. A token of another user, or no token, resets them until the data of the new listener arrives.
+ */
+QString FirebaseValue::idToken() const
+{
+    return m_idToken;
+}
+
+void FirebaseValue::setIdToken(const QString &idToken)
+{
+    if(m_idToken == idToken)
+        return;
+
+    m_idToken = idToken;
+    emit idTokenChanged();
+    scheduleSubscribe();
+}
+
+/*!
+    \qmlproperty var FirebaseValue::value
+
+    Current value at \l path, undefined until it has been \l loaded. A path without data has the value \c null.
+ */
+QVariant FirebaseValue::value() const
+{
+    return m_value;
+}
+
+/*!
+    \qmlproperty bool FirebaseValue::loaded
+
+    True once \l value holds data received from the database for the current \l path.
+ */
+bool FirebaseValue::loaded() const
+{
+    return m_loaded;
+}
+
+// Properties are usually set one after the other, so the listener is chosen once they are all known
+void FirebaseValue::scheduleSubscribe()
+{
+    if(m_subscribePending)
+        return;
+
+    m_subscribePending = true;
+    QMetaObject::invokeMethod(this, &FirebaseValue::subscribe, Qt::QueuedConnection);
+}
+
+void FirebaseValue::subscribe()
+{
+    m_subscribePending = false;
+    unsubscribe();
+
+    // Only a new token of the same user for the same data keeps what was loaded, the new listener's data follows
+    const QString userId = JwtUtils::payload(m_idToken)["sub"].toString();
+    const bool sameData = m_database == m_subscribedDatabase && m_path == m_subscribedPath && userId == m_subscribedUser;
+    m_subscribedDatabase = m_database;
+    m_subscribedPath = m_path;
+    m_subscribedUser = userId;
+
+    if(m_loaded && !sameData) {
+        m_loaded = false;
+        m_json = QJsonValue::Null;
+        m_value.clear();
+        emit loadedChanged();
+        emit valueChanged();
+    }
+
+    if(!m_database || m_path.isEmpty())
+        return;
+
+    m_hub = FirebaseValueHub::of(m_database);
+    m_hub->subscribe(this);
+}
+
+void FirebaseValue::unsubscribe()
+{
+    if(m_hub)
+        m_hub->unsubscribe(this);
+    m_hub.clear();
+}
+
+void FirebaseValue::update(const QJsonValue &value)
+{
+    if(m_loaded && value == m_json)
+        return;
+
+    m_json = value;
+    m_value = value.toVariant();
+    emit valueChanged();
+
+    if(!m_loaded) {
+        m_loaded = true;
+        emit loadedChanged();
+    }
+}
+
+FirebaseValueHub::FirebaseValueHub(FirebaseDatabase *database) : QObject(database), m_database(database),
+    m_nextRequestCode(firstRequestCode)
+{
+    connect(database, &FirebaseDatabase::dataSnapshotEvent, this, &FirebaseValueHub::onEvent);
+}
+
+FirebaseValueHub *FirebaseValueHub::of(FirebaseDatabase *database)
+{
+    FirebaseValueHub *hub = database->findChild<FirebaseValueHub *>(QString(), Qt::FindDirectChildrenOnly);
+    return hub ? hub : new FirebaseValueHub(database);
+}
+
+// Attaches value to a listener on its path or above it, and starts one if there is none
+void FirebaseValueHub::subscribe(FirebaseValue *value)
+{
+    const QString location = DatabaseUtils::location(value->path());
+
+    for(auto it = m_listeners.begin(); it != m_listeners.end(); ++it) {
+        if(it->idToken != value->idToken() || !DatabaseUtils::covers(it->location, location))
+            continue;
+
+        it->values.append(value);
+        if(it->loaded)
+            deliver(*it, value);
+        return;
+    }
+
+    const int requestCode = m_nextRequestCode--;
+    Listener &listener = m_listeners[requestCode];
+    listener.location = location;
+    listener.idToken = value->idToken();
+    listener.values.append(value);
+
+    qCDebug(lcFirebaseValue) << "Listening to" << location << "for" << requestCode;
+    m_database->listenEvents(location == "/" ? QString("/.json") : location + ".json", value->idToken(), requestCode, false, true);
+}
+
+void FirebaseValueHub::unsubscribe(FirebaseValue *value)
+{
+    for(auto it = m_listeners.begin(); it != m_listeners.end(); ++it) {
+        if(it->values.removeOne(value)) {
+            if(it->values.isEmpty())
+                release(it.key());
+            return;
+        }
+    }
+}
+
+void FirebaseValueHub::release(int requestCode)
+{
+    qCDebug(lcFirebaseValue) << "Closing listener" << requestCode;
+    m_listeners.remove(requestCode);
+    m_database->stopListening(requestCode);
+}
+
+/*
+    Applies an event to the copy of the listened tree and hands the new values to the values depending on the changed
+    paths only. A put replaces path, a patch replaces some of its children, so for a patch only the paths of those
+    children matter: a value next to them is left alone.
+*/
+void FirebaseValueHub::onEvent(const QString &event, const QString &path, const FirebaseDataSnapshot &snapshot, int requestCode)
+{
+    const auto it = m_listeners.find(requestCode);
+    if(it == m_listeners.end())
+        return;
+
+    QStringList changed;
+    if(event == "put") {
+        it->root = DatabaseUtils::setAt(it->root, path, snapshot.json());
+        changed.append(path);
+    } else if(event == "patch") {
+        const QJsonObject children = snapshot.json().toObject();
+        it->root = DatabaseUtils::patchAt(it->root, path, children);
+        for(auto child = children.begin(); child != children.end(); ++child)
+            changed.append(path == "/" ? "/" + child.key() : path + "/" + child.key());
+    } else {
+        return;
+    }
+
+    const bool first = !it->loaded;
+    it->loaded = true;
+
+    const Listener listener = *it;
+    for(FirebaseValue *value : listener.values) {
+        const QString relative = relativePath(listener.location, DatabaseUtils::location(value->path()));
+        const bool affected = first || std::any_of(changed.cbegin(), changed.cend(), [&](const QString &changedPath) {
+            return overlaps(changedPath, relative);
+        });
+        if(affected)
+            deliver(listener, value);
+    }
+
+    if(first)
+        adopt(requestCode);
+}
+
+// Once a listener has data, the values of listeners below it move to it and those listeners are closed
+void FirebaseValueHub::adopt(int requestCode)
+{
+    const Listener parent = m_listeners.value(requestCode);
+
+    QList<int> adopted;
+    for(auto it = m_listeners.cbegin(); it != m_listeners.cend(); ++it) {
+        if(it.key() != requestCode && it->idToken == parent.idToken && DatabaseUtils::covers(parent.location, it->location))
+            adopted.append(it.key());
+    }
+
+    for(int code : adopted) {
+        const QList<FirebaseValue *> values = m_listeners.value(code).values;
+        release(code);
+
+        Listener &listener = m_listeners[requestCode];
+        listener.values.append(values);
+        for(FirebaseValue *value : values)
+            deliver(listener, value);
+    }
+}
+
+void FirebaseValueHub::deliver(const Listener &listener, FirebaseValue *value) const
+{
+    const QString relative = relativePath(listener.location, DatabaseUtils::location(value->path()));
+    value->update(DatabaseUtils::valueAt(listener.root, relative));
+}
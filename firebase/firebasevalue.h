@@ -0,0 +1,98 @@
+#ifndef FIREBASEVALUE_H
+#define FIREBASEVALUE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QJsonValue>
+#include <QVariant>
+#include "firebasedatabase.h"
+
+class FirebaseValueHub;
+
+class FirebaseValue : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(FirebaseDatabase* database READ database WRITE setDatabase NOTIFY databaseChanged)
+    Q_PROPERTY(QString path READ path WRITE setPath NOTIFY pathChanged)
+    Q_PROPERTY(QString idToken READ idToken WRITE setIdToken NOTIFY idTokenChanged)
+    Q_PROPERTY(QVariant value READ value NOTIFY valueChanged)
+    Q_PROPERTY(bool loaded READ loaded NOTIFY loadedChanged)
+
+public:
+    explicit FirebaseValue(QObject *parent = nullptr);
+    ~FirebaseValue();
+
+    FirebaseDatabase *database() const;
+    void setDatabase(FirebaseDatabase *database);
+
+    QString path() const;
+    void setPath(const QString &path);
+
+    QString idToken() const;
+    void setIdToken(const QString &idToken);
+
+    QVariant value() const;
+    bool loaded() const;
+
+signals:
+    void databaseChanged();
+    void pathChanged();
+    void idTokenChanged();
+    void valueChanged();
+    void loadedChanged();
+
+private:
+    friend class FirebaseValueHub;
+
+    void scheduleSubscribe();
+    void subscribe();
+    void unsubscribe();
+    void update(const QJsonValue &value);
+
+    QPointer<FirebaseDatabase> m_database;
+    QString m_path;
+    QString m_idToken;
+    QJsonValue m_json = QJsonValue::Null;
+    QVariant m_value;
+    bool m_loaded = false;
+    bool m_subscribePending = false;
+    QPointer<FirebaseValueHub> m_hub;
+    QPointer<FirebaseDatabase> m_subscribedDatabase;
+    QString m_subscribedPath;
+    QString m_subscribedUser;
+};
+
+// Listeners shared by the FirebaseValue objects of one FirebaseDatabase, a child of that database
+class FirebaseValueHub : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FirebaseValueHub *of(FirebaseDatabase *database);
+
+    void subscribe(FirebaseValue *value);
+    void unsubscribe(FirebaseValue *value);
+
+private:
+    explicit FirebaseValueHub(FirebaseDatabase *database);
+
+    struct Listener {
+        QString location;
+        QString idToken;
+        QJsonValue root = QJsonValue::Null;
+        bool loaded = false;
+        QList<FirebaseValue *> values;
+    };
+
+    void onEvent(const QString &event, const QString &path, const FirebaseDataSnapshot &snapshot, int requestCode);
+    void adopt(int requestCode);
+    void deliver(const Listener &listener, FirebaseValue *value) const;
+    void release(int requestCode);
+
+    FirebaseDatabase *m_database;
+    QHash<int, Listener> m_listeners;
+    int m_nextRequestCode;
+};
+
+#endif // FIREBASEVALUE_H
@@ -1,161 +1,357 @@
-#include "googlegateway.h"
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QString>
-#include <QFile>
-#include <QDir>
-#include <QUrl>
-#include <QOAuthHttpServerReplyHandler>
-#include <QDesktopServices>
-
-
-
-/*!
-    \qmltype GoogleGateway
-    \inqmlmodule Firebase
-    \ingroup Firebase
-    \brief Helper for authenticating using a google account.
-
-    This type allows the user to authenticate on the firebase using a google account. By calling the \l fetchGoogleToken()
-    a browser window will be opened and the user can log in. After the login is complete, if successful an \l authToken
-    will be retrieved which can be used with \l FirebaseAuth::signInWithOAuthCredential. See example below:
-
-    \code
-    FirebaseApp {
-        id: fbApp
-        apiKey: "insert-key"
-        databaseUrl: "insert-url"
-    }
-
-    FirebaseAuth {
-        id: fbAuth
-        apiKey: fbApp.apiKey
-        onSignedIn: ...
-    }
-
-    GoogleSignInHelper {
-        id: googleSignIn
-
-        onAuthTokenChanged: {
-            console.log("Token granted:  \n" + authToken)
-            fbAuth.signInWithOAuthCredential(authToken, "google.com")
-        }
-    }
-
-    Button {
-        text: "Google login"
-        onClicked: googleSignIn.fetchGoogleToken()
-    }
-    \endcode
-
-    \sa FirebaseAuth, FirebaseApp
-
- */
-GoogleGateway::GoogleGateway(QObject *parent) : QObject(parent)
-{
-}
-
-
-/*!
-    \qmlproperty string GoogleGateway::authToken
-
-    Token that can be used for authenticating on the firebase.
- */
-QString GoogleGateway::authToken() const
-{
-    return m_authToken;
-}
-
-void GoogleGateway::setAuthToken(const QString &authToken)
-{
-    if(m_authToken == authToken)
-        return;
-
-    m_authToken = authToken;
-    emit authTokenChanged();
-}
-
-/*!
-    \qmlmethod void GoogleGateway::fetchGoogleToken()
-
-    Opens a browser window to sign in with google. If successful, updates the \l authToken.
- */
-void GoogleGateway::fetchGoogleToken()
-{
-    m_google->grant();
-}
-
-void GoogleGateway::parseClientSecret()
-{
-   if(!m_google)
-        m_google = new QOAuth2AuthorizationCodeFlow(this);
-
-    m_google->setScope("email profile");
-
-    qDebug() << clientSecretPath;
-
-    QByteArray val;
-    QFile file;
-    file.setFileName(clientSecretPath);
-    if(file.open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        val = file.readAll();
-        file.close();
-    }
-    else {
-        qDebug() << "Google login error, no client_secret file found";
-    }
-
-
-    QJsonDocument document = QJsonDocument::fromJson(val);
-    QJsonObject object = document.object();
-    const auto settingsObject = object["web"].toObject();
-    const QUrl authUri(settingsObject["auth_uri"].toString());
-    const auto clientId = settingsObject["client_id"].toString();
-    const QUrl tokenUri(settingsObject["token_uri"].toString());
-    const auto clientSecret(settingsObject["client_secret"].toString());
-
-    const auto redirectUris = settingsObject["redirect_uris"].toArray();
-
-    // Change the index to the one of http://localhost:xxxx in client_secret.json
-    const QUrl redirectUri(redirectUris[1].toString());
-    const auto port = static_cast<quint16>(redirectUri.port());
-
-    m_google->setAuthorizationUrl(authUri);
-    m_google->setClientIdentifier(clientId);
-    m_google->setAccessTokenUrl(tokenUri);
-    m_google->setClientIdentifierSharedKey(clientSecret);
-
-    if(m_replyhandler)
-        delete m_replyhandler;
-
-    m_replyhandler = new QOAuthHttpServerReplyHandler(port, this);
-    m_google->setReplyHandler(m_replyhandler);
-
-    m_google->setModifyParametersFunction([](QAbstractOAuth::Stage stage, QVariantMap* parameters) {
-        // Percent-decode the "code" parameter so Google can match it
-        if (stage == QAbstractOAuth::Stage::RequestingAccessToken) {
-            QByteArray code = parameters->value("code").toByteArray();
-            (*parameters)["code"] = QUrl::fromPercentEncoding(code);
-        }
-    });
-
-    connect(m_google, &QOAuth2AuthorizationCodeFlow::authorizeWithBrowser, &QDesktopServices::openUrl);
-
-    connect(m_google, &QOAuth2AuthorizationCodeFlow::granted, [this](){
-        qDebug() << "Access Granted!";
-        setAuthToken(m_google->token());
-    });
-}
-
-/*!
-    \qmlproperty string GoogleGateway::clientSecretPath
-
-    Sets the path where the class can find the client_secret.json file to parse information such as client ID, token and redirect URIs, etc.
- */
-void GoogleGateway::setClientSecretPath(const QString &value)
-{
-    clientSecretPath = value;
-    parseClientSecret();
-}
+#include "googlegateway.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QString>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QUrl>
+#include <QOAuthHttpServerReplyHandler>
+#include <QDesktopServices>
+#include <QLoggingCategory>
+#include <QNetworkAccessManager>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+Q_LOGGING_CATEGORY(lcGoogleGateway, "firebase.google", QtWarningMsg)
+
+namespace {
+
+// A refresh that has not come back by then is given up for the browser flow
+const int refreshTimeout = 10000;
+
+// Cached access tokens are not handed out when they expire within this margin
+const qint64 expiryMargin = 60;
+
+}
+
+/*!
+    \qmltype GoogleGateway
+    \inqmlmodule Firebase
+    \ingroup Firebase
+    \brief Helper for authenticating using a google account.
+
+    This type allows the user to authenticate on the firebase using a google account. By calling the \l fetchGoogleToken()
+    a browser window will be opened and the user can log in. After the login is complete, if successful an \l authToken
+    will be retrieved which can be used with \l FirebaseAuth::signInWithOAuthCredential.
+
+    The access and refresh tokens granted by Google are kept in \l tokenCachePath. Later calls of \l fetchGoogleToken(),
+    in this or a later run, hand out the cached access token while it is valid and otherwise renew it with the refresh
+    token in one background request. The browser only opens again when there is no refresh token or Google rejects it.
+    See example below:
+
+    \code
+    FirebaseApp {
+        id: fbApp
+        apiKey: "insert-key"
+        databaseUrl: "insert-url"
+    }
+
+    FirebaseAuth {
+        id: fbAuth
+        apiKey: fbApp.apiKey
+        onSignedIn: ...
+    }
+
+    GoogleSignInHelper {
+        id: googleSignIn
+
+        onAuthTokenChanged: {
+            console.log("Token granted:  \n" + authToken)
+            fbAuth.signInWithOAuthCredential(authToken, "google.com")
+        }
+    }
+
+    Button {
+        text: "Google login"
+        onClicked: googleSignIn.fetchGoogleToken()
+    }
+    \endcode
+
+    \sa FirebaseAuth, FirebaseApp
+
+ */
+GoogleGateway::GoogleGateway(QObject *parent) : QObject(parent), m_google(new QOAuth2AuthorizationCodeFlow(this))
+{
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if(!dataDir.isEmpty())
+        m_tokenCachePath = dataDir + "/firebase/googletokens.json";
+
+    m_google->setScope("email profile");
+
+    m_google->setModifyParametersFunction([](QAbstractOAuth::Stage stage, QVariantMap* parameters) {
+        // Ask for a refresh token, Google only hands one out with an explicit consent
+        if (stage == QAbstractOAuth::Stage::RequestingAuthorization) {
+            (*parameters)["access_type"] = "offline";
+            (*parameters)["prompt"] = "consent";
+        }
+
+        // Percent-decode the "code" parameter so Google can match it
+        if (stage == QAbstractOAuth::Stage::RequestingAccessToken) {
+            QByteArray code = parameters->value("code").toByteArray();
+            (*parameters)["code"] = QUrl::fromPercentEncoding(code);
+        }
+    });
+
+    // Connected once here, parsing another client secret only reconfigures the flow
+    connect(m_google, &QOAuth2AuthorizationCodeFlow::authorizeWithBrowser, &QDesktopServices::openUrl);
+    connect(m_google, &QOAuth2AuthorizationCodeFlow::granted, this, &GoogleGateway::onGranted);
+    connect(m_google, &QOAuth2AuthorizationCodeFlow::error, this, [this](const QString &error, const QString &description) {
+        if(!m_refreshTimeout.isActive())
+            return;
+
+        qCWarning(lcGoogleGateway) << "Google token refresh rejected:" << error << description;
+        m_refreshTimeout.stop();
+        grantWithBrowser();
+    });
+
+    // The reply handler only logs a failed refresh request and the flow stays in RefreshingToken, so its reply is
+    // watched here: an error status or no connection goes to the browser right away
+    connect(m_google->networkAccessManager(), &QNetworkAccessManager::finished, this, [this](QNetworkReply *reply) {
+        if(!m_refreshTimeout.isActive() || reply->url() != m_google->accessTokenUrl() || reply->error() == QNetworkReply::NoError)
+            return;
+
+        qCWarning(lcGoogleGateway) << "Google token refresh failed:" << reply->errorString();
+        m_refreshTimeout.stop();
+        grantWithBrowser();
+    });
+
+    // Safety net for a refresh that never comes back
+    m_refreshTimeout.setSingleShot(true);
+    m_refreshTimeout.setInterval(refreshTimeout);
+    connect(&m_refreshTimeout, &QTimer::timeout, this, [this]() {
+        qCWarning(lcGoogleGateway) << "Google token refresh timed out";
+        grantWithBrowser();
+    });
+}
+
+
+/*!
+    \qmlproperty string GoogleGateway::authToken
+
+    Token that can be used for authenticating on the firebase.
+ */
+QString GoogleGateway::authToken() const
+{
+    return m_authToken;
+}
+
+void GoogleGateway::setAuthToken(const QString &authToken)
+{
+    if(m_authToken == authToken)
+        return;
+
+    m_authToken = authToken;
+    emit authTokenChanged();
+}
+
+/*!
+    \qmlmethod void GoogleGateway::fetchGoogleToken()
+
+    Updates the \l authToken, and emits authTokenChanged() even if the token did not change. A cached access token is
+    used while it is valid, then the refresh token is used in the background. Opens a browser window to sign in with
+    google only if neither works.
+ */
+void GoogleGateway::fetchGoogleToken()
+{
+    if(m_refreshTimeout.isActive())
+        return;
+
+    if(!m_cachedToken.isEmpty() && m_expiresAt.isValid() && QDateTime::currentDateTimeUtc().addSecs(expiryMargin) < m_expiresAt) {
+        if(m_authToken == m_cachedToken)
+            emit authTokenChanged();
+        else
+            setAuthToken(m_cachedToken);
+        return;
+    }
+
+    if(m_refreshToken.isEmpty()) {
+        grantWithBrowser();
+        return;
+    }
+
+    qCDebug(lcGoogleGateway) << "Refreshing Google token";
+    m_google->setRefreshToken(m_refreshToken);
+    m_refreshTimeout.start();
+    m_google->refreshAccessToken();
+}
+
+/*!
+    \qmlmethod void GoogleGateway::forgetTokens()
+
+    Removes the cached tokens of the current client, e.g when another user takes over a shared device. The next
+    \l fetchGoogleToken() opens the browser.
+ */
+void GoogleGateway::forgetTokens()
+{
+    m_cachedToken.clear();
+    m_refreshToken.clear();
+    m_expiresAt = QDateTime();
+    m_google->setRefreshToken(QString());
+    saveTokens();
+}
+
+void GoogleGateway::grantWithBrowser()
+{
+    m_refreshToken.clear();
+    m_google->setRefreshToken(QString());
+    m_google->grant();
+}
+
+void GoogleGateway::onGranted()
+{
+    qCDebug(lcGoogleGateway) << "Access Granted!";
+    m_refreshTimeout.stop();
+
+    // Google leaves the refresh token out of refresh responses, the one used stays valid
+    if(!m_google->refreshToken().isEmpty())
+        m_refreshToken = m_google->refreshToken();
+    m_cachedToken = m_google->token();
+    m_expiresAt = m_google->expirationAt().toUTC();
+    saveTokens();
+
+    if(m_authToken == m_cachedToken)
+        emit authTokenChanged();
+    else
+        setAuthToken(m_cachedToken);
+}
+
+// Tokens are kept per client identifier, so several client secrets can share one file
+void GoogleGateway::loadTokens()
+{
+    m_cachedToken.clear();
+    m_refreshToken.clear();
+    m_expiresAt = QDateTime();
+
+    QFile file(m_tokenCachePath);
+    if(m_tokenCachePath.isEmpty() || m_google->clientIdentifier().isEmpty() || !file.open(QIODevice::ReadOnly))
+        return;
+
+    const QJsonObject tokens = QJsonDocument::fromJson(file.readAll()).object()[m_google->clientIdentifier()].toObject();
+    m_cachedToken = tokens["accessToken"].toString();
+    m_refreshToken = tokens["refreshToken"].toString();
+    if(tokens.contains("expiresAt"))
+        m_expiresAt = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(tokens["expiresAt"].toDouble()), Qt::UTC);
+}
+
+void GoogleGateway::saveTokens()
+{
+    if(m_tokenCachePath.isEmpty() || m_google->clientIdentifier().isEmpty())
+        return;
+
+    QJsonObject all;
+    QFile previous(m_tokenCachePath);
+    if(previous.open(QIODevice::ReadOnly))
+        all = QJsonDocument::fromJson(previous.readAll()).object();
+    previous.close();
+
+    if(m_refreshToken.isEmpty() && m_cachedToken.isEmpty()) {
+        all.remove(m_google->clientIdentifier());
+    } else {
+        QJsonObject tokens;
+        tokens["accessToken"] = m_cachedToken;
+        tokens["refreshToken"] = m_refreshToken;
+        if(m_expiresAt.isValid())
+            tokens["expiresAt"] = static_cast<double>(m_expiresAt.toMSecsSinceEpoch());
+        all[m_google->clientIdentifier()] = tokens;
+    }
+
+    QDir().mkpath(QFileInfo(m_tokenCachePath).absolutePath());
+    QSaveFile file(m_tokenCachePath);
+    if(!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcGoogleGateway) << "Cannot write Google tokens to" << m_tokenCachePath;
+        return;
+    }
+
+    // The refresh token grants access until it is revoked, only the owner may read it
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    file.write(QJsonDocument(all).toJson(QJsonDocument::Compact));
+    file.commit();
+}
+
+void GoogleGateway::parseClientSecret()
+{
+    qCDebug(lcGoogleGateway) << clientSecretPath;
+
+    QByteArray val;
+    QFile file;
+    file.setFileName(clientSecretPath);
+    if(file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        val = file.readAll();
+        file.close();
+    }
+    else {
+        qCWarning(lcGoogleGateway) << "Google login error, no client_secret file found";
+    }
+
+
+    QJsonDocument document = QJsonDocument::fromJson(val);
+    QJsonObject object = document.object();
+    const auto settingsObject = object["web"].toObject();
+    const QUrl authUri(settingsObject["auth_uri"].toString());
+    const auto clientId = settingsObject["client_id"].toString();
+    const QUrl tokenUri(settingsObject["token_uri"].toString());
+    const auto clientSecret(settingsObject["client_secret"].toString());
+
+    const auto redirectUris = settingsObject["redirect_uris"].toArray();
+
+    // Change the index to the one of http://localhost:xxxx in client_secret.json
+    const QUrl redirectUri(redirectUris[1].toString());
+    const auto port = static_cast<quint16>(redirectUri.port());
+
+    m_google->setAuthorizationUrl(authUri);
+    m_google->setClientIdentifier(clientId);
+    m_google->setAccessTokenUrl(tokenUri);
+    m_google->setClientIdentifierSharedKey(clientSecret);
+
+    // One reply handler stays alive and only moves when the redirect port changes
+    if(!m_replyhandler) {
+        m_replyhandler = new QOAuthHttpServerReplyHandler(port, this);
+        m_google->setReplyHandler(m_replyhandler);
+    } else if(m_replyhandler->port() != port) {
+        m_replyhandler->close();
+        m_replyhandler->listen(QHostAddress::Any, port);
+    }
+
+    loadTokens();
+}
+
+/*!
+    \qmlproperty string GoogleGateway::clientSecretPath
+
+    Sets the path where the class can find the client_secret.json file to parse information such as client ID, token and redirect URIs, etc.
+ */
+void GoogleGateway::setClientSecretPath(const QString &value)
+{
+    if(clientSecretPath == value)
+        return;
+
+    clientSecretPath = value;
+    parseClientSecret();
+    emit clientSecretPathChanged();
+}
+
+/*!
+    \qmlproperty string GoogleGateway::tokenCachePath
+
+    File where the granted Google tokens are kept between runs. Defaults to \c firebase/googletokens.json in the
+    application data directory. An empty path disables persistence, tokens are then only reused within the run.
+ */
+QString GoogleGateway::tokenCachePath() const
+{
+    return m_tokenCachePath;
+}
+
+void GoogleGateway::setTokenCachePath(const QString &tokenCachePath)
+{
+    if(m_tokenCachePath == tokenCachePath)
+        return;
+
+    m_tokenCachePath = tokenCachePath;
+    if(!m_tokenCachePath.isEmpty())
+        loadTokens();
+    emit tokenCachePathChanged();
+}
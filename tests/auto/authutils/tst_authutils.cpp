@@ -0,0 +1,24 @@
+#include <QtTest>
+#include "utils/AuthUtils.h"
+
+class tst_AuthUtils : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void lookupPayload();
+};
+
+// Lookups made with an OAuth access token are refused by the server without the project of the users
+void tst_AuthUtils::lookupPayload()
+{
+    const QStringList userIds {"alice", "bob"};
+    const QJsonObject payload = QJsonDocument::fromJson(AuthUtils::payload_lookupUsers(userIds, "my-project")).object();
+
+    QCOMPARE(payload["localId"].toArray(), QJsonArray::fromStringList(userIds));
+    QCOMPARE(payload["targetProjectId"].toString(), QString("my-project"));
+}
+
+QTEST_GUILESS_MAIN(tst_AuthUtils)
+
+#include "tst_authutils.moc"
@@ -0,0 +1,22 @@
+TEMPLATE = subdirs
+SUBDIRS = \
+    authutils \
+    databaseutils \
+    datacache \
+    datasnapshot \
+    firebaseapp \
+    firebaseerror \
+    firebasetask \
+    firebasevalue \
+    firestoreutils \
+    googlegateway \
+    jsonutils \
+    memorybackend \
+    memorybudget \
+    sessionpool \
+    storage \
+    storagecache \
+    tokenverifier \
+    trace \
+    transport \
+    usercache
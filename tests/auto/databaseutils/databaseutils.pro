@@ -0,0 +1,9 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase console
+CONFIG -= app_bundle
+TARGET = tst_databaseutils
+
+INCLUDEPATH += ../../..
+
+SOURCES += tst_databaseutils.cpp
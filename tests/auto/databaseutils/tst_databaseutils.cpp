@@ -0,0 +1,370 @@
+#include <QtTest>
+#include "utils/DatabaseUtils.h"
+
+class tst_DatabaseUtils : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void location_data();
+    void location();
+    void parseAndSerialize_data();
+    void parseAndSerialize();
+    void valueAt();
+    void setAt_data();
+    void setAt();
+    void patchAt();
+    void childPath_data();
+    void childPath();
+    void pushIdFormat();
+    void pushIdsSortByTime();
+    void pushIdsOfOneMillisecondKeepOrder();
+    void eventFor_data();
+    void eventFor();
+    void localViewConfirmAndReject();
+    void localViewKeepsLaterWrites();
+    void covers_data();
+    void covers();
+    void eventQueueMergesIntoPut();
+    void eventQueuePutReplacesBelow();
+    void eventQueueMergesPatches();
+    void eventQueueKeepsOverlappingOrder();
+};
+
+void tst_DatabaseUtils::location_data()
+{
+    QTest::addColumn<QString>("dbPath");
+    QTest::addColumn<QString>("location");
+
+    QTest::newRow("root") << "/.json" << "/";
+    QTest::newRow("empty") << "" << "/";
+    QTest::newRow("child") << "/users/alice.json" << "/users/alice";
+    QTest::newRow("trailing slash") << "/users/alice/.json" << "/users/alice";
+    QTest::newRow("query") << "/users.json?shallow=true" << "/users";
+    QTest::newRow("double slashes") << "//users//alice" << "/users/alice";
+}
+
+void tst_DatabaseUtils::location()
+{
+    QFETCH(QString, dbPath);
+    QFETCH(QString, location);
+
+    QCOMPARE(DatabaseUtils::location(dbPath), location);
+}
+
+void tst_DatabaseUtils::parseAndSerialize_data()
+{
+    QTest::addColumn<QByteArray>("json");
+    QTest::addColumn<QJsonValue>("value");
+
+    QTest::newRow("null") << QByteArray("null") << QJsonValue(QJsonValue::Null);
+    QTest::newRow("string") << QByteArray("\"text\"") << QJsonValue("text");
+    QTest::newRow("number") << QByteArray("1.5") << QJsonValue(1.5);
+    QTest::newRow("bool") << QByteArray("true") << QJsonValue(true);
+    QTest::newRow("object") << QByteArray("{\"a\":{\"b\":1}}") << QJsonValue(QJsonObject {{"a", QJsonObject {{"b", 1}}}});
+    QTest::newRow("array") << QByteArray("[1,\"x\"]") << QJsonValue(QJsonArray {1, "x"});
+}
+
+// The server sends bare values, which must survive a round trip as well as containers
+void tst_DatabaseUtils::parseAndSerialize()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(QJsonValue, value);
+
+    QCOMPARE(DatabaseUtils::parse(json), value);
+    QCOMPARE(DatabaseUtils::parse(" " + json + "\n"), value);
+    QCOMPARE(DatabaseUtils::serialize(value), json);
+}
+
+void tst_DatabaseUtils::valueAt()
+{
+    const QJsonValue root = DatabaseUtils::parse("{\"users\":{\"alice\":{\"age\":30}},\"list\":[\"a\",\"b\"]}");
+
+    QCOMPARE(DatabaseUtils::valueAt(root, "/"), root);
+    QCOMPARE(DatabaseUtils::valueAt(root, "/users/alice/age"), QJsonValue(30));
+    QCOMPARE(DatabaseUtils::valueAt(root, "/list/1"), QJsonValue("b"));
+    QCOMPARE(DatabaseUtils::valueAt(root, "/users/bob"), QJsonValue(QJsonValue::Null));
+    QCOMPARE(DatabaseUtils::valueAt(root, "/users/alice/age/deeper"), QJsonValue(QJsonValue::Null));
+    QCOMPARE(DatabaseUtils::valueAt(root, "/list/x"), QJsonValue(QJsonValue::Null));
+}
+
+void tst_DatabaseUtils::setAt_data()
+{
+    QTest::addColumn<QByteArray>("root");
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<QByteArray>("value");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("replace root") << QByteArray("{\"a\":1}") << "/" << QByteArray("{\"b\":2}") << QByteArray("{\"b\":2}");
+    QTest::newRow("create path") << QByteArray("null") << "/a/b" << QByteArray("1") << QByteArray("{\"a\":{\"b\":1}}");
+    QTest::newRow("replace scalar") << QByteArray("{\"a\":\"x\"}") << "/a/b" << QByteArray("1") << QByteArray("{\"a\":{\"b\":1}}");
+    QTest::newRow("sibling kept") << QByteArray("{\"a\":{\"b\":1}}") << "/a/c" << QByteArray("2") << QByteArray("{\"a\":{\"b\":1,\"c\":2}}");
+    QTest::newRow("null deletes") << QByteArray("{\"a\":{\"b\":1},\"c\":2}") << "/a/b" << QByteArray("null") << QByteArray("{\"c\":2}");
+    QTest::newRow("last child deletes root") << QByteArray("{\"a\":1}") << "/a" << QByteArray("null") << QByteArray("null");
+    QTest::newRow("array keyed by index") << QByteArray("{\"l\":[\"x\",null,\"z\"]}") << "/l/1" << QByteArray("\"y\"")
+                                          << QByteArray("{\"l\":{\"0\":\"x\",\"1\":\"y\",\"2\":\"z\"}}");
+}
+
+void tst_DatabaseUtils::setAt()
+{
+    QFETCH(QByteArray, root);
+    QFETCH(QString, path);
+    QFETCH(QByteArray, value);
+    QFETCH(QByteArray, expected);
+
+    QCOMPARE(DatabaseUtils::setAt(DatabaseUtils::parse(root), path, DatabaseUtils::parse(value)), DatabaseUtils::parse(expected));
+}
+
+void tst_DatabaseUtils::patchAt()
+{
+    const QJsonValue root = DatabaseUtils::parse("{\"u\":{\"name\":\"Al\",\"age\":30,\"tags\":{\"a\":true}}}");
+    const QJsonObject children = DatabaseUtils::parse("{\"age\":31,\"tags\":{\"b\":true},\"name\":null,\"x/y\":1}").toObject();
+
+    // Children are replaced as a whole, null removes them and multi-path keys reach deeper
+    QCOMPARE(DatabaseUtils::patchAt(root, "/u", children),
+             DatabaseUtils::parse("{\"u\":{\"age\":31,\"tags\":{\"b\":true},\"x\":{\"y\":1}}}"));
+}
+
+void tst_DatabaseUtils::childPath_data()
+{
+    QTest::addColumn<QString>("dbPath");
+    QTest::addColumn<QString>("childPath");
+
+    QTest::newRow("root") << "/.json" << "/k.json";
+    QTest::newRow("location") << "/messages/.json" << "/messages/k.json";
+    QTest::newRow("query kept") << "/messages.json?print=silent" << "/messages/k.json?print=silent";
+}
+
+void tst_DatabaseUtils::childPath()
+{
+    QFETCH(QString, dbPath);
+    QFETCH(QString, childPath);
+
+    QCOMPARE(DatabaseUtils::childPath(dbPath, "k"), childPath);
+}
+
+void tst_DatabaseUtils::pushIdFormat()
+{
+    static const QRegularExpression format("^[-0-9A-Z_a-z]{20}$");
+
+    DatabaseUtils::PushIdGenerator generator;
+    const QString id = generator.next(0);
+    QVERIFY2(format.match(id).hasMatch(), qPrintable(id));
+    QVERIFY(id.startsWith("--------"));
+
+    // The timestamp part only depends on the time
+    DatabaseUtils::PushIdGenerator other;
+    const qint64 now = 1700000000123;
+    QCOMPARE(generator.next(now).left(8), other.next(now).left(8));
+}
+
+void tst_DatabaseUtils::pushIdsSortByTime()
+{
+    DatabaseUtils::PushIdGenerator generator;
+    QString previous = generator.next(1);
+    for(qint64 now = 2; now < 1LL << 42; now = now * 3 + 1) {
+        const QString id = generator.next(now);
+        QVERIFY2(previous < id, qPrintable(previous + " " + id));
+        previous = id;
+    }
+}
+
+void tst_DatabaseUtils::pushIdsOfOneMillisecondKeepOrder()
+{
+    DatabaseUtils::PushIdGenerator generator;
+    const qint64 now = 1700000000123;
+
+    QString previous = generator.next(now);
+    for(int i = 0; i < 5000; ++i) {
+        const QString id = generator.next(now);
+        QCOMPARE(id.left(8), previous.left(8));
+        QVERIFY2(previous < id, qPrintable(previous + " " + id));
+        previous = id;
+    }
+}
+
+void tst_DatabaseUtils::eventFor_data()
+{
+    QTest::addColumn<QString>("location");
+    QTest::addColumn<QByteArray>("event");
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<bool>("seen");
+    QTest::addColumn<QByteArray>("expectedEvent");
+    QTest::addColumn<QString>("expectedPath");
+    QTest::addColumn<QByteArray>("expectedData");
+
+    QTest::newRow("at location") << "/users/alice" << QByteArray("put") << "/users/alice" << QByteArray("{\"age\":31}")
+                                 << true << QByteArray("put") << "/" << QByteArray("{\"age\":31}");
+    QTest::newRow("below location") << "/users/alice" << QByteArray("patch") << "/users/alice/tags" << QByteArray("{\"a\":true}")
+                                    << true << QByteArray("patch") << "/tags" << QByteArray("{\"a\":true}");
+    QTest::newRow("root listener") << "/" << QByteArray("put") << "/users/bob" << QByteArray("1")
+                                   << true << QByteArray("put") << "/users/bob" << QByteArray("1");
+    QTest::newRow("put above") << "/users/alice" << QByteArray("put") << "/users" << QByteArray("{}")
+                               << true << QByteArray("put") << "/" << QByteArray("{\"age\":31,\"name\":\"Al\"}");
+    QTest::newRow("patch above touching") << "/users/alice" << QByteArray("patch") << "/users" << QByteArray("{\"alice/age\":31}")
+                                          << true << QByteArray("put") << "/" << QByteArray("{\"age\":31,\"name\":\"Al\"}");
+    QTest::newRow("patch above elsewhere") << "/users/alice" << QByteArray("patch") << "/users" << QByteArray("{\"bob\":1}")
+                                           << false << QByteArray() << QString() << QByteArray();
+    QTest::newRow("sibling with common prefix") << "/users/al" << QByteArray("put") << "/users/alice" << QByteArray("1")
+                                                << false << QByteArray() << QString() << QByteArray();
+    QTest::newRow("unrelated") << "/users/alice" << QByteArray("put") << "/rooms" << QByteArray("1")
+                               << false << QByteArray() << QString() << QByteArray();
+}
+
+// The root is the database after the write, which is where writes above the location take its new value from
+void tst_DatabaseUtils::eventFor()
+{
+    QFETCH(QString, location);
+    QFETCH(QByteArray, event);
+    QFETCH(QString, path);
+    QFETCH(QByteArray, data);
+    QFETCH(bool, seen);
+
+    const QJsonValue root = DatabaseUtils::parse("{\"users\":{\"alice\":{\"age\":31,\"name\":\"Al\"},\"bob\":1}}");
+    QJsonValue value = DatabaseUtils::parse(data);
+    QCOMPARE(DatabaseUtils::eventFor(location, root, &event, &path, &value), seen);
+    if(!seen)
+        return;
+
+    QFETCH(QByteArray, expectedEvent);
+    QFETCH(QString, expectedPath);
+    QFETCH(QByteArray, expectedData);
+    QCOMPARE(event, expectedEvent);
+    QCOMPARE(path, expectedPath);
+    QCOMPARE(value, DatabaseUtils::parse(expectedData));
+}
+
+void tst_DatabaseUtils::localViewConfirmAndReject()
+{
+    DatabaseUtils::LocalView view;
+    view.serverData("/", "put", DatabaseUtils::parse("{\"a\":1}"));
+
+    const quint64 put = view.addWrite("PUT", "/b", 2);
+    QCOMPARE(view.root(), DatabaseUtils::parse("{\"a\":1,\"b\":2}"));
+
+    // Server data arriving meanwhile keeps the pending write on top
+    view.serverData("/", "patch", DatabaseUtils::parse("{\"a\":5}"));
+    QCOMPARE(view.root(), DatabaseUtils::parse("{\"a\":5,\"b\":2}"));
+
+    view.reject(put);
+    QCOMPARE(view.root(), DatabaseUtils::parse("{\"a\":5}"));
+
+    const quint64 patch = view.addWrite("PATCH", "/", DatabaseUtils::parse("{\"c\":3}"));
+    const quint64 remove = view.addWrite("DELETE", "/a", QJsonValue());
+    QCOMPARE(view.root(), DatabaseUtils::parse("{\"c\":3}"));
+
+    view.confirm(patch);
+    QCOMPARE(view.root(), DatabaseUtils::parse("{\"c\":3}"));
+
+    // The confirmed patch is part of the server data now, so it stays when the delete is rejected
+    view.reject(remove);
+    QCOMPARE(view.root(), DatabaseUtils::parse("{\"a\":5,\"c\":3}"));
+
+    // Unknown ids change nothing
+    QVERIFY(!view.confirm(remove));
+    QVERIFY(!view.reject(12345));
+    QCOMPARE(view.root(), DatabaseUtils::parse("{\"a\":5,\"c\":3}"));
+
+    // A view replacing this one does not take over its ids
+    DatabaseUtils::LocalView next(view.lastId());
+    QVERIFY(next.addWrite("PUT", "/d", 4) > remove);
+    QVERIFY(!next.confirm(patch));
+}
+
+void tst_DatabaseUtils::localViewKeepsLaterWrites()
+{
+    DatabaseUtils::LocalView view;
+    const quint64 first = view.addWrite("PUT", "/x", 1);
+    view.addWrite("PUT", "/x/y", 2);
+    QCOMPARE(view.root(), DatabaseUtils::parse("{\"x\":{\"y\":2}}"));
+
+    view.reject(first);
+    QCOMPARE(view.root(), DatabaseUtils::parse("{\"x\":{\"y\":2}}"));
+}
+
+void tst_DatabaseUtils::covers_data()
+{
+    QTest::addColumn<QString>("location");
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<bool>("covered");
+
+    QTest::newRow("root") << "/" << "/a/b" << true;
+    QTest::newRow("same") << "/a" << "/a" << true;
+    QTest::newRow("below") << "/a" << "/a/b" << true;
+    QTest::newRow("above") << "/a/b" << "/a" << false;
+    QTest::newRow("common prefix") << "/a" << "/ab" << false;
+}
+
+void tst_DatabaseUtils::covers()
+{
+    QFETCH(QString, location);
+    QFETCH(QString, path);
+    QFETCH(bool, covered);
+
+    QCOMPARE(DatabaseUtils::covers(location, path), covered);
+}
+
+void tst_DatabaseUtils::eventQueueMergesIntoPut()
+{
+    DatabaseUtils::EventQueue queue;
+    QVERIFY(!queue.add("put", "/x", DatabaseUtils::parse("{\"a\":1}")));
+    QVERIFY(queue.add("put", "/x/b", 2));
+    QVERIFY(queue.add("patch", "/x/y", DatabaseUtils::parse("{\"c\":1}")));
+    QCOMPARE(queue.size(), 1);
+
+    const QList<DatabaseUtils::Event> events = queue.take();
+    QCOMPARE(events.size(), 1);
+    QCOMPARE(events.first().name, QByteArray("put"));
+    QCOMPARE(events.first().path, QString("/x"));
+    QCOMPARE(events.first().data, DatabaseUtils::parse("{\"a\":1,\"b\":2,\"y\":{\"c\":1}}"));
+    QCOMPARE(queue.size(), 0);
+}
+
+void tst_DatabaseUtils::eventQueuePutReplacesBelow()
+{
+    DatabaseUtils::EventQueue queue;
+    queue.add("patch", "/a", DatabaseUtils::parse("{\"k\":1}"));
+    queue.add("put", "/b", 1);
+    QCOMPARE(queue.size(), 2);
+
+    QVERIFY(queue.add("put", "/", DatabaseUtils::parse("{\"z\":1}")));
+    const QList<DatabaseUtils::Event> events = queue.take();
+    QCOMPARE(events.size(), 1);
+    QCOMPARE(events.first().path, QString("/"));
+    QCOMPARE(events.first().data, DatabaseUtils::parse("{\"z\":1}"));
+}
+
+void tst_DatabaseUtils::eventQueueMergesPatches()
+{
+    DatabaseUtils::EventQueue queue;
+    queue.add("patch", "/p", DatabaseUtils::parse("{\"a\":1,\"b/c\":2}"));
+    queue.add("patch", "/q", DatabaseUtils::parse("{\"a\":1}"));
+
+    // A key replaces the multi-path keys below it
+    QVERIFY(queue.add("patch", "/p", DatabaseUtils::parse("{\"b\":3}")));
+    const QList<DatabaseUtils::Event> events = queue.take();
+    QCOMPARE(events.size(), 2);
+    QCOMPARE(events.at(0).path, QString("/p"));
+    QCOMPARE(events.at(0).data, DatabaseUtils::parse("{\"a\":1,\"b\":3}"));
+    QCOMPARE(events.at(1).path, QString("/q"));
+}
+
+// Merging across an overlapping event would deliver the writes in a different order, so they stay apart
+void tst_DatabaseUtils::eventQueueKeepsOverlappingOrder()
+{
+    DatabaseUtils::EventQueue queue;
+    queue.add("patch", "/a", DatabaseUtils::parse("{\"b\":1}"));
+    queue.add("put", "/a/b", 2);
+    QVERIFY(!queue.add("patch", "/a", DatabaseUtils::parse("{\"b\":3}")));
+
+    const QList<DatabaseUtils::Event> events = queue.take();
+    QCOMPARE(events.size(), 3);
+    QCOMPARE(events.at(0).name, QByteArray("patch"));
+    QCOMPARE(events.at(1).name, QByteArray("put"));
+    QCOMPARE(events.at(2).data, DatabaseUtils::parse("{\"b\":3}"));
+}
+
+QTEST_GUILESS_MAIN(tst_DatabaseUtils)
+
+#include "tst_databaseutils.moc"
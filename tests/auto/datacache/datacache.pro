@@ -0,0 +1,9 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase console
+CONFIG -= app_bundle
+TARGET = tst_datacache
+
+include(../../../QmlFirebaseCore.pri)
+
+SOURCES += tst_datacache.cpp
@@ -0,0 +1,167 @@
+#include <QtTest>
+#include <QCborMap>
+#include <QCborValue>
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include "firebase/firebasedatacache.h"
+
+class tst_DataCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void savedAsCbor();
+    void reloadedFromDisk();
+    void mismatchedKeyIsIgnored();
+    void evictsOldestEntries();
+    void evictsOverSize();
+    void removedEntriesFreeBudget();
+    void existingFilesCount();
+
+private:
+    QString fileName(const QString &key) const;
+    void storeAndSave(FirebaseDataCache &cache, const QString &key, const QJsonValue &value);
+
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+void tst_DataCache::init()
+{
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+}
+
+QString tst_DataCache::fileName(const QString &key) const
+{
+    return m_dir->filePath(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex() + ".cbor");
+}
+
+// Waits for the delayed save, then a little longer so files saved one after another differ in modification time
+void tst_DataCache::storeAndSave(FirebaseDataCache &cache, const QString &key, const QJsonValue &value)
+{
+    const QDateTime before = QFileInfo(fileName(key)).lastModified();
+    cache.store(key, value);
+    QTRY_VERIFY(QFile::exists(fileName(key)) && QFileInfo(fileName(key)).lastModified() != before);
+    QTest::qWait(20);
+}
+
+void tst_DataCache::savedAsCbor()
+{
+    FirebaseDataCache cache;
+    cache.setDirectory(m_dir->path());
+    storeAndSave(cache, "alice|db|/rooms", QJsonObject {{"lobby", QJsonObject {{"topic", "hi"}}}});
+
+    QFile file(fileName("alice|db|/rooms"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QCborMap entry = QCborValue::fromCbor(file.readAll()).toMap();
+    QCOMPARE(entry.value(QStringLiteral("k")).toString(), QString("alice|db|/rooms"));
+    QVERIFY(entry.value(QStringLiteral("t")).toInteger() > 0);
+    QCOMPARE(entry.value(QStringLiteral("v")).toJsonValue(), QJsonValue(QJsonObject {{"lobby", QJsonObject {{"topic", "hi"}}}}));
+}
+
+// A new cache has nothing in memory and decodes the mapped file
+void tst_DataCache::reloadedFromDisk()
+{
+    const QJsonValue value = QJsonObject {{"count", 3}, {"names", QJsonArray {"a", "b"}}};
+    {
+        FirebaseDataCache cache;
+        cache.setDirectory(m_dir->path());
+        cache.store("key", value);
+    }
+    QVERIFY(QFile::exists(fileName("key")));
+
+    FirebaseDataCache cache;
+    cache.setDirectory(m_dir->path());
+    QJsonValue loaded;
+    QVERIFY(cache.find("key", &loaded));
+    QCOMPARE(loaded, value);
+    QVERIFY(!cache.find("other", &loaded));
+}
+
+void tst_DataCache::mismatchedKeyIsIgnored()
+{
+    QFile file(fileName("key"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QCborMap {{QStringLiteral("k"), "another key"}, {QStringLiteral("v"), 1}}.toCborValue().toCbor());
+    file.close();
+
+    FirebaseDataCache cache;
+    cache.setDirectory(m_dir->path());
+    QJsonValue loaded;
+    QVERIFY(!cache.find("key", &loaded));
+}
+
+void tst_DataCache::evictsOldestEntries()
+{
+    FirebaseDataCache cache;
+    cache.setDirectory(m_dir->path());
+    cache.setMaxEntries(2);
+
+    storeAndSave(cache, "a", 1);
+    storeAndSave(cache, "b", 2);
+    storeAndSave(cache, "c", 3);
+
+    QVERIFY(!QFile::exists(fileName("a")));
+    QVERIFY(QFile::exists(fileName("b")));
+    QVERIFY(QFile::exists(fileName("c")));
+}
+
+void tst_DataCache::evictsOverSize()
+{
+    FirebaseDataCache cache;
+    cache.setDirectory(m_dir->path());
+
+    const QString text(1000, QChar('x'));
+    storeAndSave(cache, "a", text);
+    storeAndSave(cache, "b", text);
+    storeAndSave(cache, "c", text);
+    QVERIFY(QFile::exists(fileName("a")));
+
+    // Lowering the limit prunes right away, the newest files that fit stay
+    cache.setMaxSize(2 * QFileInfo(fileName("c")).size());
+    QVERIFY(!QFile::exists(fileName("a")));
+    QVERIFY(QFile::exists(fileName("b")));
+    QVERIFY(QFile::exists(fileName("c")));
+}
+
+void tst_DataCache::removedEntriesFreeBudget()
+{
+    FirebaseDataCache cache;
+    cache.setDirectory(m_dir->path());
+    cache.setMaxEntries(2);
+
+    storeAndSave(cache, "a", 1);
+    storeAndSave(cache, "b", 2);
+    cache.remove("a");
+    storeAndSave(cache, "c", 3);
+
+    QVERIFY(QFile::exists(fileName("b")));
+    QVERIFY(QFile::exists(fileName("c")));
+}
+
+// Files left by an earlier run count against the limits without listing the directory on every save
+void tst_DataCache::existingFilesCount()
+{
+    {
+        FirebaseDataCache cache;
+        cache.setDirectory(m_dir->path());
+        storeAndSave(cache, "a", 1);
+        storeAndSave(cache, "b", 2);
+    }
+
+    FirebaseDataCache cache;
+    cache.setDirectory(m_dir->path());
+    cache.setMaxEntries(2);
+    QVERIFY(QFile::exists(fileName("a")));
+
+    storeAndSave(cache, "c", 3);
+    QVERIFY(!QFile::exists(fileName("a")));
+    QVERIFY(QFile::exists(fileName("b")));
+    QVERIFY(QFile::exists(fileName("c")));
+}
+
+QTEST_GUILESS_MAIN(tst_DataCache)
+
+#include "tst_datacache.moc"
@@ -0,0 +1,9 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase console
+CONFIG -= app_bundle
+TARGET = tst_datasnapshot
+
+include(../../../QmlFirebaseCore.pri)
+
+SOURCES += tst_datasnapshot.cpp
@@ -0,0 +1,120 @@
+#include <QtTest>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "firebase/firebasedatasnapshot.h"
+#include "utils/JsonUtils.h"
+
+/*
+    Small responses are parsed into a QJsonValue tree, large ones are only indexed. Every test runs on both, and the
+    large payload differs from the small one only by a padding child, so both must give the same answers.
+*/
+class tst_DataSnapshot : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void navigation_data();
+    void navigation();
+    void bareValues_data();
+    void bareValues();
+
+private:
+    static QByteArray payload(bool large);
+};
+
+QByteArray tst_DataSnapshot::payload(bool large)
+{
+    QJsonObject root {
+        {"users", QJsonObject {
+            {"alice", QJsonObject {{"name", "Alice"}, {"age", 30}, {"tags", QJsonArray {"a", "b"}}}},
+            {"bob", QJsonObject {{"name", "Bob \"B\""}}}
+        }},
+        {"empty", QJsonObject {}}
+    };
+    if(large)
+        root["padding"] = QString(JsonUtils::minTapeSize, QChar('x'));
+
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+void tst_DataSnapshot::navigation_data()
+{
+    QTest::addColumn<bool>("large");
+
+    QTest::newRow("tree") << false;
+    QTest::newRow("indexed text") << true;
+}
+
+void tst_DataSnapshot::navigation()
+{
+    QFETCH(bool, large);
+
+    const QByteArray json = payload(large);
+    QCOMPARE(json.size() >= JsonUtils::minTapeSize, large);
+
+    const FirebaseDataSnapshot snapshot = FirebaseDataSnapshot::fromJson(json, "root");
+    QCOMPARE(snapshot.key(), QString("root"));
+    QVERIFY(snapshot.exists());
+    QCOMPARE(snapshot.childrenCount(), large ? 3 : 2);
+
+    const FirebaseDataSnapshot users = snapshot.child("users");
+    QCOMPARE(users.key(), QString("users"));
+    QCOMPARE(users.keys(), QStringList({"alice", "bob"}));
+    QCOMPARE(users.childrenCount(), 2);
+
+    const FirebaseDataSnapshot age = snapshot.child("/users/alice/age");
+    QCOMPARE(age.key(), QString("age"));
+    QCOMPARE(age.toVariant().toInt(), 30);
+    QCOMPARE(age.toJson(), QString("30"));
+
+    QCOMPARE(users.child("bob/name").toVariant().toString(), QString("Bob \"B\""));
+    QCOMPARE(users.child("alice/tags").keys(), QStringList({"0", "1"}));
+    QCOMPARE(users.child("alice/tags/1").toVariant().toString(), QString("b"));
+
+    QVERIFY(snapshot.hasChild("users/bob"));
+    QVERIFY(!snapshot.hasChild("users/carol"));
+    QVERIFY(!snapshot.child("users/alice/age/deeper").exists());
+    QCOMPARE(snapshot.child("users/carol").key(), QString("carol"));
+
+    const QVariantMap alice = users.child("alice").toVariant().toMap();
+    QCOMPARE(alice.value("name").toString(), QString("Alice"));
+    QCOMPARE(alice.value("tags").toList().size(), 2);
+    QCOMPARE(users.child("alice").json(), QJsonDocument::fromJson(json).object()["users"].toObject()["alice"]);
+
+    // A copy under another key shares the data
+    const FirebaseDataSnapshot renamed("other", users);
+    QCOMPARE(renamed.key(), QString("other"));
+    QCOMPARE(renamed.keys(), users.keys());
+}
+
+void tst_DataSnapshot::bareValues_data()
+{
+    QTest::addColumn<QByteArray>("json");
+    QTest::addColumn<bool>("exists");
+    QTest::addColumn<QVariant>("value");
+
+    QTest::newRow("null") << QByteArray("null") << false << QVariant();
+    QTest::newRow("string") << QByteArray("\"text\"") << true << QVariant("text");
+    QTest::newRow("number") << QByteArray("2.5") << true << QVariant(2.5);
+    QTest::newRow("bool") << QByteArray("false") << true << QVariant(false);
+}
+
+// The database answers with bare values, which QJsonDocument alone does not parse
+void tst_DataSnapshot::bareValues()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(bool, exists);
+    QFETCH(QVariant, value);
+
+    const FirebaseDataSnapshot snapshot = FirebaseDataSnapshot::fromJson(json);
+    QCOMPARE(snapshot.exists(), exists);
+    QCOMPARE(snapshot.childrenCount(), 0);
+    QVERIFY(snapshot.keys().isEmpty());
+    if(exists)
+        QCOMPARE(snapshot.toVariant(), value);
+    QCOMPARE(snapshot.toJson(), QString::fromUtf8(json));
+}
+
+QTEST_GUILESS_MAIN(tst_DataSnapshot)
+
+#include "tst_datasnapshot.moc"
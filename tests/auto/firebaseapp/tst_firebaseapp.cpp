@@ -0,0 +1,160 @@
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "firebase/firebaseapp.h"
+#include "firebase/firebasetransport.h"
+
+// Answers every request like the start of a resumable upload, with the session URL in a header
+class UploadServer : public QObject
+{
+public:
+    UploadServer()
+    {
+        connect(&m_server, &QTcpServer::newConnection, this, &UploadServer::accept);
+        m_server.listen(QHostAddress::LocalHost);
+    }
+
+    QUrl url(const QString &path) const { return QUrl(QStringLiteral("http://127.0.0.1:%1%2").arg(m_server.serverPort()).arg(path)); }
+    void close() { m_server.close(); }
+
+    int received = 0;
+
+private:
+    void accept()
+    {
+        while(QTcpSocket *socket = m_server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() {
+                if(!socket->peek(socket->bytesAvailable()).contains("\r\n\r\n"))
+                    return;
+                socket->readAll();
+                ++received;
+
+                const QByteArray body = "{\"name\":\"photo.jpg\"}";
+                socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                              "X-Goog-Upload-URL: " + url("/upload?upload_id=SESSION&upload_protocol=resumable").toEncoded() + "\r\n"
+                              "Content-Length: " + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+                socket->disconnectFromHost();
+            });
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+    QTcpServer m_server;
+};
+
+class tst_FirebaseApp : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void preconnectAppliedAfterSource();
+    void memoryDatabaseIsNotPreconnected();
+    void captureThenReplay();
+
+private:
+    QString writeServices(const QString &firebaseUrl);
+    static FirebaseResponse send(const QUrl &url);
+
+    QTemporaryDir m_dir;
+};
+
+void tst_FirebaseApp::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+// Minimal google-services.json as downloaded from the Firebase console
+QString tst_FirebaseApp::writeServices(const QString &firebaseUrl)
+{
+    const QString fileName = m_dir.filePath("google-services.json");
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return QString();
+
+    file.write("{\"project_info\":{\"firebase_url\":\"" + firebaseUrl.toUtf8() + "\",\"project_id\":\"\",\"storage_bucket\":\"\"},"
+               "\"client\":[{\"api_key\":[{\"current_key\":\"key\"}]}]}");
+    return fileName;
+}
+
+// QML assigns properties in declaration order, preconnect: false may well come after source
+void tst_FirebaseApp::preconnectAppliedAfterSource()
+{
+    const QString fileName = writeServices("https://tst-app.firebaseio.com");
+    QVERIFY(!fileName.isEmpty());
+
+    FirebaseApp app;
+    app.setSource(fileName);
+    app.setPreconnect(false);
+    QCOMPARE(app.databaseUrl(), QString("https://tst-app.firebaseio.com/"));
+
+    QCoreApplication::processEvents();
+    QVERIFY(app.connectionMetrics().isEmpty());
+}
+
+void tst_FirebaseApp::memoryDatabaseIsNotPreconnected()
+{
+    const QString fileName = writeServices("memory://tst-app");
+    QVERIFY(!fileName.isEmpty());
+
+    FirebaseApp app;
+    app.setSource(fileName);
+    QCoreApplication::processEvents();
+
+    const QVariantMap metrics = app.connectionMetrics();
+    QVERIFY(metrics.contains("identitytoolkit.googleapis.com"));
+    QVERIFY(!metrics.contains("tst-app"));
+}
+
+FirebaseResponse tst_FirebaseApp::send(const QUrl &url)
+{
+    FirebaseResponse result;
+    bool done = false;
+    QObject context;
+    FirebaseTransport::shared()->send("POST", QNetworkRequest(url), "{\"contentType\":\"image/jpeg\"}", &context,
+                                      [&result, &done](const FirebaseResponse &response) {
+        result = response;
+        done = true;
+    });
+
+    QTest::qWaitFor([&done]() { return done; });
+    return result;
+}
+
+// A captured session answers the same requests again once the server is gone, without secrets in the trace
+void tst_FirebaseApp::captureThenReplay()
+{
+    const QString trace = m_dir.filePath("session.trace");
+    FirebaseApp app;
+    UploadServer server;
+    const QUrl url = server.url("/v0/b/bucket/o?name=photo.jpg&auth=TOKEN");
+
+    QVERIFY(app.startCapture(trace));
+    const FirebaseResponse captured = send(url);
+    app.stopCapture();
+    QCOMPARE(captured.status, 200);
+    QCOMPARE(server.received, 1);
+    QVERIFY(captured.header("X-Goog-Upload-URL").contains("upload_id=SESSION"));
+
+    QFile file(trace);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray recorded = file.readAll();
+    QVERIFY(!recorded.contains("TOKEN"));
+    QVERIFY(!recorded.contains("SESSION"));
+    QVERIFY(recorded.contains("upload_id=REDACTED"));
+
+    server.close();
+    QVERIFY(app.startReplay(trace, 0.0));
+    const FirebaseResponse replayed = send(url);
+    app.stopReplay();
+
+    QCOMPARE(server.received, 1);
+    QCOMPARE(replayed.error, FirebaseError::NoError);
+    QCOMPARE(replayed.status, 200);
+    QCOMPARE(replayed.body, captured.body);
+    QVERIFY(replayed.header("X-Goog-Upload-URL").contains("upload_id=REDACTED"));
+}
+
+QTEST_GUILESS_MAIN(tst_FirebaseApp)
+
+#include "tst_firebaseapp.moc"
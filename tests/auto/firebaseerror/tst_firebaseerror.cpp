@@ -0,0 +1,117 @@
+#include <QtTest>
+#include "firebase/firebaseerror.h"
+
+class tst_FirebaseError : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fromServerMessage_data();
+    void fromServerMessage();
+    void fromReply_data();
+    void fromReply();
+    void category_data();
+    void category();
+};
+
+void tst_FirebaseError::fromServerMessage_data()
+{
+    QTest::addColumn<QString>("message");
+    QTest::addColumn<FirebaseError::Code>("code");
+
+    QTest::newRow("auth code") << QString("TOKEN_EXPIRED") << FirebaseError::TokenExpired;
+    QTest::newRow("auth code with details") << QString("WEAK_PASSWORD : Password should be at least 6 characters") << FirebaseError::WeakPassword;
+    QTest::newRow("login credentials") << QString("INVALID_LOGIN_CREDENTIALS") << FirebaseError::InvalidPassword;
+    QTest::newRow("retry later") << QString("TOO_MANY_ATTEMPTS_TRY_LATER") << FirebaseError::TooManyAttempts;
+    QTest::newRow("database rules") << QString("Permission denied") << FirebaseError::PermissionDenied;
+    QTest::newRow("database token") << QString("Could not parse auth token.") << FirebaseError::InvalidIdToken;
+    QTest::newRow("case matters") << QString("token_expired") << FirebaseError::UnknownError;
+    QTest::newRow("unknown") << QString("SOMETHING_NEW") << FirebaseError::UnknownError;
+    QTest::newRow("empty") << QString() << FirebaseError::UnknownError;
+}
+
+void tst_FirebaseError::fromServerMessage()
+{
+    QFETCH(QString, message);
+    QFETCH(FirebaseError::Code, code);
+
+    QCOMPARE(FirebaseError::fromServerMessage(message), code);
+}
+
+void tst_FirebaseError::fromReply_data()
+{
+    QTest::addColumn<QNetworkReply::NetworkError>("networkError");
+    QTest::addColumn<int>("status");
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<FirebaseError::Code>("code");
+    QTest::addColumn<QString>("serverMessage");
+
+    QTest::newRow("success") << QNetworkReply::NoError << 200 << QByteArray("{}") << FirebaseError::NoError << QString();
+    QTest::newRow("partial content") << QNetworkReply::NoError << 206 << QByteArray("abc") << FirebaseError::NoError << QString();
+    QTest::newRow("auth error object") << QNetworkReply::ProtocolInvalidOperationError << 400
+                                       << QByteArray("{\"error\":{\"code\":400,\"message\":\"EMAIL_EXISTS\"}}")
+                                       << FirebaseError::EmailExists << QString("EMAIL_EXISTS");
+    QTest::newRow("database error string") << QNetworkReply::AuthenticationRequiredError << 401
+                                           << QByteArray("{\"error\":\"Permission denied\"}")
+                                           << FirebaseError::PermissionDenied << QString("Permission denied");
+    QTest::newRow("message before status") << QNetworkReply::ProtocolInvalidOperationError << 400
+                                           << QByteArray("{\"error\":{\"message\":\"TOO_MANY_ATTEMPTS_TRY_LATER\"}}")
+                                           << FirebaseError::TooManyAttempts << QString("TOO_MANY_ATTEMPTS_TRY_LATER");
+    QTest::newRow("unknown message falls back to status") << QNetworkReply::ProtocolInvalidOperationError << 400
+                                                          << QByteArray("{\"error\":{\"message\":\"SOMETHING_NEW\"}}")
+                                                          << FirebaseError::BadRequest << QString("SOMETHING_NEW");
+    QTest::newRow("unauthorized") << QNetworkReply::AuthenticationRequiredError << 401 << QByteArray() << FirebaseError::InvalidIdToken << QString();
+    QTest::newRow("forbidden") << QNetworkReply::ContentAccessDenied << 403 << QByteArray() << FirebaseError::PermissionDenied << QString();
+    QTest::newRow("not found page") << QNetworkReply::ContentNotFoundError << 404 << QByteArray("<html></html>") << FirebaseError::NotFound << QString();
+    QTest::newRow("request timeout") << QNetworkReply::UnknownContentError << 408 << QByteArray() << FirebaseError::TimeoutError << QString();
+    QTest::newRow("throttled") << QNetworkReply::UnknownContentError << 429 << QByteArray() << FirebaseError::TooManyAttempts << QString();
+    QTest::newRow("unavailable") << QNetworkReply::ServiceUnavailableError << 503 << QByteArray() << FirebaseError::ServerError << QString();
+    QTest::newRow("refused") << QNetworkReply::ConnectionRefusedError << 0 << QByteArray() << FirebaseError::NetworkError << QString();
+    QTest::newRow("closed") << QNetworkReply::RemoteHostClosedError << 0 << QByteArray() << FirebaseError::NetworkError << QString();
+    QTest::newRow("timed out") << QNetworkReply::TimeoutError << 0 << QByteArray() << FirebaseError::TimeoutError << QString();
+    QTest::newRow("aborted") << QNetworkReply::OperationCanceledError << 0 << QByteArray() << FirebaseError::Cancelled << QString();
+}
+
+void tst_FirebaseError::fromReply()
+{
+    QFETCH(QNetworkReply::NetworkError, networkError);
+    QFETCH(int, status);
+    QFETCH(QByteArray, body);
+    QFETCH(FirebaseError::Code, code);
+    QFETCH(QString, serverMessage);
+
+    QString message;
+    QCOMPARE(FirebaseError::fromReply(networkError, status, body, &message), code);
+    QCOMPARE(message, serverMessage);
+}
+
+void tst_FirebaseError::category_data()
+{
+    QTest::addColumn<FirebaseError::Code>("code");
+    QTest::addColumn<FirebaseError::Category>("category");
+
+    QTest::newRow("network") << FirebaseError::NetworkError << FirebaseError::Retryable;
+    QTest::newRow("timeout") << FirebaseError::TimeoutError << FirebaseError::Retryable;
+    QTest::newRow("server") << FirebaseError::ServerError << FirebaseError::Retryable;
+    QTest::newRow("too many attempts") << FirebaseError::TooManyAttempts << FirebaseError::Retryable;
+    QTest::newRow("token expired") << FirebaseError::TokenExpired << FirebaseError::AuthRefreshable;
+    QTest::newRow("invalid id token") << FirebaseError::InvalidIdToken << FirebaseError::AuthRefreshable;
+    QTest::newRow("invalid refresh token") << FirebaseError::InvalidRefreshToken << FirebaseError::Fatal;
+    QTest::newRow("permission denied") << FirebaseError::PermissionDenied << FirebaseError::Fatal;
+    QTest::newRow("bad request") << FirebaseError::BadRequest << FirebaseError::Fatal;
+    QTest::newRow("not found") << FirebaseError::NotFound << FirebaseError::Fatal;
+    QTest::newRow("cancelled") << FirebaseError::Cancelled << FirebaseError::Fatal;
+    QTest::newRow("unknown") << FirebaseError::UnknownError << FirebaseError::Fatal;
+}
+
+void tst_FirebaseError::category()
+{
+    QFETCH(FirebaseError::Code, code);
+    QFETCH(FirebaseError::Category, category);
+
+    QCOMPARE(FirebaseError::category(code), category);
+}
+
+QTEST_GUILESS_MAIN(tst_FirebaseError)
+
+#include "tst_firebaseerror.moc"
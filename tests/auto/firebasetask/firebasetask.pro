@@ -0,0 +1,11 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase console c++2a
+CONFIG -= app_bundle
+TARGET = tst_firebasetask
+
+gcc:!clang: QMAKE_CXXFLAGS += -fcoroutines
+
+include(../../../QmlFirebaseCore.pri)
+
+SOURCES += tst_firebasetask.cpp
@@ -0,0 +1,196 @@
+#include <QtTest>
+#include "firebase/firebasedatabase.h"
+#include "firebase/firebasememorybackend.h"
+#include "firebase/firebasetask.h"
+#include "utils/DatabaseUtils.h"
+
+#ifdef FIREBASE_HAS_COROUTINES
+// Awaits a task from a coroutine of its own, so the test can wait for the result with the event loop running
+static FirebaseTask<void> awaitResponse(FirebaseTask<FirebaseResponse> task, FirebaseResponse *response, bool *done)
+{
+    *response = co_await task;
+    *done = true;
+}
+
+static FirebaseTask<void> awaitAll(std::vector<FirebaseTask<FirebaseResponse>> tasks, std::vector<FirebaseResponse> *responses, bool *done)
+{
+    *responses = co_await firebaseWhenAll(std::move(tasks));
+    *done = true;
+}
+#endif
+
+class tst_FirebaseTask : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void writeThenRead();
+    void resumesFromEventLoop();
+    void pushAnswersWithKey();
+    void whenAllKeepsOrder();
+    void cancelledBeforeStart();
+    void cancelledWhilePending();
+    void contextDestroyedWhilePending();
+
+private:
+    const QString m_url = QStringLiteral("memory://tst-task");
+};
+
+void tst_FirebaseTask::initTestCase()
+{
+#ifndef FIREBASE_HAS_COROUTINES
+    QSKIP("Built without C++20 coroutines");
+#endif
+}
+
+void tst_FirebaseTask::init()
+{
+    FirebaseMemoryBackend::instance()->clear(m_url);
+}
+
+#ifdef FIREBASE_HAS_COROUTINES
+void tst_FirebaseTask::writeThenRead()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    FirebaseResponse response;
+    bool done = false;
+    FirebaseTask<void> task = awaitResponse(database.writeValueAsync("/rooms/lobby.json", "{\"topic\":\"hi\"}", QString()), &response, &done);
+    QTRY_VERIFY(done);
+    QCOMPARE(response.error, FirebaseError::NoError);
+    QCOMPARE(response.status, 200);
+
+    done = false;
+    task = awaitResponse(database.getValueAsync("/rooms.json", QString()), &response, &done);
+    QTRY_VERIFY(done);
+    QCOMPARE(response.error, FirebaseError::NoError);
+    QCOMPARE(DatabaseUtils::parse(response.body), DatabaseUtils::parse("{\"lobby\":{\"topic\":\"hi\"}}"));
+}
+
+void tst_FirebaseTask::resumesFromEventLoop()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    FirebaseResponse response;
+    bool done = false;
+    FirebaseTask<void> task = awaitResponse(database.getValueAsync("/.json", QString()), &response, &done);
+
+    // The memory backend answers right away, the coroutine must still only continue from the event loop
+    QVERIFY(!done);
+    QVERIFY(!task.isFinished());
+    QTRY_VERIFY(task.isFinished());
+    QVERIFY(done);
+    QCOMPARE(response.body, QByteArray("null"));
+}
+
+void tst_FirebaseTask::pushAnswersWithKey()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    FirebaseResponse response;
+    bool done = false;
+    FirebaseTask<void> task = awaitResponse(database.pushValueAsync("/messages.json", "\"hello\"", QString()), &response, &done);
+    QTRY_VERIFY(done);
+    QCOMPARE(response.error, FirebaseError::NoError);
+
+    const QString key = DatabaseUtils::parse(response.body).toObject()["name"].toString();
+    QCOMPARE(key.size(), 20);
+    QCOMPARE(FirebaseMemoryBackend::instance()->value(m_url, "/messages/" + key), QJsonValue("hello"));
+}
+
+void tst_FirebaseTask::whenAllKeepsOrder()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+    FirebaseMemoryBackend::instance()->request(m_url, "PUT", "/.json", "{\"a\":1,\"b\":2,\"c\":3}");
+
+    std::vector<FirebaseTask<FirebaseResponse>> tasks;
+    for(const QString &child : {QStringLiteral("c"), QStringLiteral("a"), QStringLiteral("b")})
+        tasks.push_back(database.getValueAsync("/" + child + ".json", QString()));
+
+    std::vector<FirebaseResponse> responses;
+    bool done = false;
+    FirebaseTask<void> task = awaitAll(std::move(tasks), &responses, &done);
+    QTRY_VERIFY(done);
+    QCOMPARE(int(responses.size()), 3);
+    QCOMPARE(responses[0].body.toInt(), 3);
+    QCOMPARE(responses[1].body.toInt(), 1);
+    QCOMPARE(responses[2].body.toInt(), 2);
+}
+
+void tst_FirebaseTask::cancelledBeforeStart()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    FirebaseCancellation cancellation;
+    cancellation.cancel();
+
+    FirebaseRequestOptions options;
+    options.cancellation = &cancellation;
+
+    // Nothing is sent and the coroutine continues without suspending
+    FirebaseResponse response;
+    bool done = false;
+    FirebaseTask<void> task = awaitResponse(database.writeValueAsync("/a.json", "1", QString(), options), &response, &done);
+    QVERIFY(done);
+    QCOMPARE(response.error, FirebaseError::Cancelled);
+    QCOMPARE(FirebaseMemoryBackend::instance()->value(m_url, "/a"), QJsonValue(QJsonValue::Null));
+}
+
+void tst_FirebaseTask::cancelledWhilePending()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    FirebaseCancellation cancellation;
+    FirebaseRequestOptions options;
+    options.cancellation = &cancellation;
+
+    FirebaseResponse response;
+    bool done = false;
+    FirebaseTask<void> task = awaitResponse(database.getValueAsync("/.json", QString(), options), &response, &done);
+    cancellation.cancel();
+    QVERIFY(!done);
+
+    // The cancelled result wins, the response of the memory backend arriving afterwards is dropped
+    QTRY_VERIFY(done);
+    QCOMPARE(response.error, FirebaseError::Cancelled);
+    QTest::qWait(10);
+    QCOMPARE(response.error, FirebaseError::Cancelled);
+}
+
+// The transport drops the callback of a destroyed sender, the awaiting coroutine must continue anyway
+void tst_FirebaseTask::contextDestroyedWhilePending()
+{
+    FirebaseDatabase *database = new FirebaseDatabase;
+    database->setDatabaseUrl(m_url);
+
+    FirebaseResponse response;
+    bool done = false;
+    FirebaseTask<void> task = awaitResponse(database->getValueAsync("/.json", QString()), &response, &done);
+    delete database;
+    QVERIFY(!done);
+
+    QTRY_VERIFY(done);
+    QCOMPARE(response.error, FirebaseError::Cancelled);
+    QVERIFY(task.isFinished());
+}
+#else
+void tst_FirebaseTask::writeThenRead() {}
+void tst_FirebaseTask::resumesFromEventLoop() {}
+void tst_FirebaseTask::pushAnswersWithKey() {}
+void tst_FirebaseTask::whenAllKeepsOrder() {}
+void tst_FirebaseTask::cancelledBeforeStart() {}
+void tst_FirebaseTask::cancelledWhilePending() {}
+void tst_FirebaseTask::contextDestroyedWhilePending() {}
+#endif
+
+QTEST_GUILESS_MAIN(tst_FirebaseTask)
+
+#include "tst_firebasetask.moc"
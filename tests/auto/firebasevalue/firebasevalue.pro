@@ -0,0 +1,9 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase console
+CONFIG -= app_bundle
+TARGET = tst_firebasevalue
+
+include(../../../QmlFirebaseCore.pri)
+
+SOURCES += tst_firebasevalue.cpp
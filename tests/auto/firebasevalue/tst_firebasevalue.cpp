@@ -0,0 +1,182 @@
+#include <QtTest>
+#include <QSet>
+#include "firebase/firebasememorybackend.h"
+#include "firebase/firebasevalue.h"
+
+class tst_FirebaseValue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void valueBelowSharesListener();
+    void listenerAboveAdoptsValues();
+    void siblingWriteDoesNotEmit();
+    void tokenRefreshKeepsValue();
+    void otherUserResetsValue();
+
+private:
+    static QString token(const QString &userId, int issuedAt);
+    void write(const QString &path, const QByteArray &json);
+    QSet<int> listenersOfNextWrite(FirebaseDatabase &database, const QString &path, const QByteArray &json);
+
+    const QString m_url = QStringLiteral("memory://tst-value");
+};
+
+// Unsigned token with the claims FirebaseValue looks at, the memory backend does not check it
+QString tst_FirebaseValue::token(const QString &userId, int issuedAt)
+{
+    const auto segment = [](const QByteArray &json) {
+        return json.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+    };
+    const QByteArray payload = "{\"sub\":\"" + userId.toUtf8() + "\",\"iat\":" + QByteArray::number(issuedAt) + "}";
+    return QString::fromLatin1(segment("{\"alg\":\"none\"}") + "." + segment(payload) + ".c2ln");
+}
+
+void tst_FirebaseValue::write(const QString &path, const QByteArray &json)
+{
+    QCOMPARE(FirebaseMemoryBackend::instance()->request(m_url, "PUT", path + ".json", json).status, 200);
+}
+
+// Request codes of the listeners that received an event for the write
+QSet<int> tst_FirebaseValue::listenersOfNextWrite(FirebaseDatabase &database, const QString &path, const QByteArray &json)
+{
+    QSet<int> listeners;
+    const QMetaObject::Connection connection = connect(&database, &FirebaseDatabase::dataSnapshotEvent, this,
+                                                       [&listeners](QString, QString, FirebaseDataSnapshot, int requestCode) {
+        listeners.insert(requestCode);
+    });
+
+    write(path, json);
+    QTest::qWait(50);
+    disconnect(connection);
+    return listeners;
+}
+
+void tst_FirebaseValue::init()
+{
+    FirebaseMemoryBackend::instance()->clear(m_url);
+    write("/a", "{\"b\":1,\"x\":\"x\",\"y\":\"y\"}");
+}
+
+void tst_FirebaseValue::valueBelowSharesListener()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    FirebaseValue parent;
+    parent.setDatabase(&database);
+    parent.setPath("/a");
+    QTRY_VERIFY(parent.loaded());
+
+    // The value below is served by the listener of the value above, without an event of its own
+    FirebaseValue child;
+    child.setDatabase(&database);
+    child.setPath("/a/b");
+    QTRY_VERIFY(child.loaded());
+    QCOMPARE(child.value(), QVariant(1));
+
+    QCOMPARE(listenersOfNextWrite(database, "/a/b", "2").size(), 1);
+    QCOMPARE(child.value(), QVariant(2));
+    QCOMPARE(parent.value().toMap().value("b"), QVariant(2));
+}
+
+void tst_FirebaseValue::listenerAboveAdoptsValues()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    // The value below comes first and opens a listener of its own, which is closed once the one above has data
+    FirebaseValue child;
+    child.setDatabase(&database);
+    child.setPath("/a/b");
+    QTRY_VERIFY(child.loaded());
+
+    FirebaseValue parent;
+    parent.setDatabase(&database);
+    parent.setPath("/a");
+    QTRY_VERIFY(parent.loaded());
+
+    QCOMPARE(listenersOfNextWrite(database, "/a/b", "3").size(), 1);
+    QCOMPARE(child.value(), QVariant(3));
+}
+
+void tst_FirebaseValue::siblingWriteDoesNotEmit()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    FirebaseValue parent;
+    parent.setDatabase(&database);
+    parent.setPath("/a");
+    FirebaseValue x;
+    x.setDatabase(&database);
+    x.setPath("/a/x");
+    FirebaseValue y;
+    y.setDatabase(&database);
+    y.setPath("/a/y");
+    QTRY_VERIFY(parent.loaded() && x.loaded() && y.loaded());
+
+    QSignalSpy parentChanged(&parent, &FirebaseValue::valueChanged);
+    QSignalSpy xChanged(&x, &FirebaseValue::valueChanged);
+    QSignalSpy yChanged(&y, &FirebaseValue::valueChanged);
+
+    write("/a/y", "\"changed\"");
+    QTRY_COMPARE(yChanged.count(), 1);
+    QCOMPARE(y.value(), QVariant("changed"));
+    QCOMPARE(parentChanged.count(), 1);
+
+    QTest::qWait(50);
+    QCOMPARE(xChanged.count(), 0);
+    QCOMPARE(x.value(), QVariant("x"));
+}
+
+void tst_FirebaseValue::tokenRefreshKeepsValue()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    FirebaseValue value;
+    value.setDatabase(&database);
+    value.setPath("/a/b");
+    value.setIdToken(token("alice", 1));
+    QTRY_VERIFY(value.loaded());
+
+    QSignalSpy loadedChanged(&value, &FirebaseValue::loadedChanged);
+    QSignalSpy valueChanged(&value, &FirebaseValue::valueChanged);
+
+    // The listener with the new token delivers the same data, so nothing is emitted in between or after
+    value.setIdToken(token("alice", 2));
+    QTest::qWait(50);
+    QVERIFY(value.loaded());
+    QCOMPARE(value.value(), QVariant(1));
+    QCOMPARE(loadedChanged.count(), 0);
+    QCOMPARE(valueChanged.count(), 0);
+
+    write("/a/b", "4");
+    QTRY_COMPARE(value.value(), QVariant(4));
+}
+
+void tst_FirebaseValue::otherUserResetsValue()
+{
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    FirebaseValue value;
+    value.setDatabase(&database);
+    value.setPath("/a/b");
+    value.setIdToken(token("alice", 1));
+    QTRY_VERIFY(value.loaded());
+
+    QSignalSpy loadedChanged(&value, &FirebaseValue::loadedChanged);
+
+    // The data of another user is never shown as if it was this user's
+    value.setIdToken(token("bob", 1));
+    QTRY_COMPARE(loadedChanged.count(), 2);
+    QVERIFY(value.loaded());
+    QCOMPARE(value.value(), QVariant(1));
+}
+
+QTEST_GUILESS_MAIN(tst_FirebaseValue)
+
+#include "tst_firebasevalue.moc"
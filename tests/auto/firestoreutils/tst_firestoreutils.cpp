@@ -0,0 +1,116 @@
+#include <QtTest>
+#include "utils/FirestoreUtils.h"
+
+class tst_FirestoreUtils : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void valueRoundTrip_data();
+    void valueRoundTrip();
+    void largeIntegerStaysString();
+    void fieldPath_data();
+    void fieldPath();
+    void fromDocument();
+    void arrayStreamSplitsAnywhere();
+};
+
+void tst_FirestoreUtils::valueRoundTrip_data()
+{
+    QTest::addColumn<QJsonValue>("value");
+    QTest::addColumn<QString>("type");
+
+    QTest::newRow("bool") << QJsonValue(true) << "booleanValue";
+    QTest::newRow("integer") << QJsonValue(42) << "integerValue";
+    QTest::newRow("negative") << QJsonValue(-7) << "integerValue";
+    QTest::newRow("double") << QJsonValue(1.5) << "doubleValue";
+    QTest::newRow("string") << QJsonValue("text") << "stringValue";
+    QTest::newRow("null") << QJsonValue(QJsonValue::Null) << "nullValue";
+    QTest::newRow("array") << QJsonValue(QJsonArray {1, "two", QJsonArray {false}}) << "arrayValue";
+    QTest::newRow("map") << QJsonValue(QJsonObject {{"a", 1}, {"b", QJsonObject {{"c", "d"}}}}) << "mapValue";
+}
+
+void tst_FirestoreUtils::valueRoundTrip()
+{
+    QFETCH(QJsonValue, value);
+    QFETCH(QString, type);
+
+    const QJsonObject typed = FirestoreUtils::toValue(value);
+    QCOMPARE(typed.keys(), QStringList {type});
+    QCOMPARE(FirestoreUtils::fromValue(typed), value);
+}
+
+void tst_FirestoreUtils::largeIntegerStaysString()
+{
+    // 2^53 + 1 cannot be held by a double
+    const QJsonObject typed {{"integerValue", "9007199254740993"}};
+    QCOMPARE(FirestoreUtils::fromValue(typed), QJsonValue("9007199254740993"));
+
+    const QJsonObject small {{"integerValue", "9007199254740992"}};
+    QCOMPARE(FirestoreUtils::fromValue(small), QJsonValue(9007199254740992.0));
+}
+
+void tst_FirestoreUtils::fieldPath_data()
+{
+    QTest::addColumn<QString>("key");
+    QTest::addColumn<QString>("path");
+
+    QTest::newRow("identifier") << "name" << "name";
+    QTest::newRow("underscore") << "_private_1" << "_private_1";
+    QTest::newRow("leading digit") << "1st" << "`1st`";
+    QTest::newRow("dash") << "first-name" << "`first-name`";
+    QTest::newRow("dot") << "a.b" << "`a.b`";
+    QTest::newRow("space") << "full name" << "`full name`";
+    QTest::newRow("backtick") << "a`b" << "`a\\`b`";
+    QTest::newRow("backslash") << "a\\b" << "`a\\\\b`";
+    QTest::newRow("non ascii") << QString::fromUtf8("caf\xc3\xa9") << QString::fromUtf8("`caf\xc3\xa9`");
+    QTest::newRow("empty") << "" << "``";
+}
+
+void tst_FirestoreUtils::fieldPath()
+{
+    QFETCH(QString, key);
+    QFETCH(QString, path);
+
+    QCOMPARE(FirestoreUtils::fieldPath(key), path);
+}
+
+void tst_FirestoreUtils::fromDocument()
+{
+    const QJsonObject document {
+        {"name", "projects/demo/databases/(default)/documents/users/alice"},
+        {"fields", QJsonObject {{"age", QJsonObject {{"integerValue", "30"}}}}},
+        {"createTime", "2024-01-01T00:00:00Z"},
+        {"updateTime", "2024-01-02T00:00:00Z"}
+    };
+
+    const QJsonObject plain = FirestoreUtils::fromDocument(document);
+    QCOMPARE(plain["path"].toString(), QStringLiteral("users/alice"));
+    QCOMPARE(plain["id"].toString(), QStringLiteral("alice"));
+    QCOMPARE(plain["data"].toObject()["age"], QJsonValue(30));
+    QCOMPARE(plain["updateTime"].toString(), QStringLiteral("2024-01-02T00:00:00Z"));
+}
+
+void tst_FirestoreUtils::arrayStreamSplitsAnywhere()
+{
+    // Brackets and escaped quotes inside strings must not end an element
+    const QByteArray stream = "[{\"document\":{\"name\":\"a]\"}},\n"
+                              "{\"document\":{\"name\":\"b\\\"}\"}},\r\n"
+                              "{\"readTime\":\"x\",\"nested\":[{},[]]}]";
+    const QList<QByteArray> expected {
+        "{\"document\":{\"name\":\"a]\"}}",
+        "{\"document\":{\"name\":\"b\\\"}\"}}",
+        "{\"readTime\":\"x\",\"nested\":[{},[]]}"
+    };
+
+    for(int split = 0; split <= stream.size(); ++split) {
+        FirestoreUtils::ArrayStream parser;
+        QList<QByteArray> elements = parser.feed(stream.left(split));
+        elements += parser.feed(stream.mid(split));
+        QCOMPARE(elements, expected);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_FirestoreUtils)
+
+#include "tst_firestoreutils.moc"
@@ -0,0 +1,8 @@
+QT += testlib
+CONFIG += testcase console
+CONFIG -= app_bundle
+TARGET = tst_googlegateway
+
+include(../../../QmlFirebase.pri)
+
+SOURCES += tst_googlegateway.cpp
@@ -0,0 +1,247 @@
+#include <QtTest>
+#include <QDesktopServices>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "firebase/googlegateway.h"
+
+// Token endpoint on the loopback interface, answering every request with the same response
+class TokenServer : public QObject
+{
+public:
+    TokenServer(int status, const QByteArray &body) : m_status(status), m_body(body)
+    {
+        connect(&m_server, &QTcpServer::newConnection, this, &TokenServer::accept);
+        m_server.listen(QHostAddress::LocalHost);
+    }
+
+    QUrl url() const { return QUrl(QStringLiteral("http://127.0.0.1:%1/token").arg(m_server.serverPort())); }
+
+    int received = 0;
+
+private:
+    void accept()
+    {
+        while(QTcpSocket *socket = m_server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() {
+                QByteArray &data = m_data[socket];
+                data += socket->readAll();
+
+                const int headerEnd = data.indexOf("\r\n\r\n");
+                if(headerEnd < 0)
+                    return;
+                int contentLength = 0;
+                for(const QByteArray &line : data.left(headerEnd).split('\n')) {
+                    if(line.toLower().startsWith("content-length:"))
+                        contentLength = line.mid(15).trimmed().toInt();
+                }
+                if(data.size() < headerEnd + 4 + contentLength)
+                    return;
+
+                ++received;
+                m_data.remove(socket);
+                socket->write("HTTP/1.1 " + QByteArray::number(m_status) + " Status\r\nContent-Type: application/json\r\n"
+                              "Content-Length: " + QByteArray::number(m_body.size()) + "\r\nConnection: close\r\n\r\n" + m_body);
+                socket->disconnectFromHost();
+            });
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+    QTcpServer m_server;
+    QHash<QTcpSocket *, QByteArray> m_data;
+    int m_status;
+    QByteArray m_body;
+};
+
+class tst_GoogleGateway : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    // Registered for the authorization URL, so the browser flow is recorded instead of opening a browser
+    void openBrowser(const QUrl &url);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void validTokenIsReusedFromFile();
+    void expiredTokenIsRefreshed();
+    void rejectedRefreshFallsBackToBrowser();
+    void forgetTokensClearsFile();
+
+private:
+    void writeClientSecret(const QUrl &tokenUrl);
+    void writeTokens(const QString &accessToken, const QString &refreshToken, const QDateTime &expiresAt);
+    QJsonObject savedTokens() const;
+
+    QTemporaryDir m_dir;
+    QString m_secretPath;
+    QString m_cachePath;
+    QList<QUrl> m_opened;
+    const QString m_clientId = QStringLiteral("test-client.apps.googleusercontent.com");
+};
+
+void tst_GoogleGateway::openBrowser(const QUrl &url)
+{
+    m_opened.append(url);
+}
+
+void tst_GoogleGateway::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_secretPath = m_dir.filePath("client_secret.json");
+    m_cachePath = m_dir.filePath("tokens/googletokens.json");
+    QDesktopServices::setUrlHandler("http", this, "openBrowser");
+}
+
+void tst_GoogleGateway::cleanupTestCase()
+{
+    QDesktopServices::unsetUrlHandler("http");
+}
+
+void tst_GoogleGateway::init()
+{
+    m_opened.clear();
+    QFile::remove(m_cachePath);
+}
+
+// The redirect port is taken from a server that just released it, so the reply handler of each test can listen on it
+void tst_GoogleGateway::writeClientSecret(const QUrl &tokenUrl)
+{
+    QTcpServer probe;
+    QVERIFY(probe.listen(QHostAddress::LocalHost));
+    const quint16 port = probe.serverPort();
+    probe.close();
+
+    const QJsonObject web {
+        {"auth_uri", "http://127.0.0.1:1/auth"},
+        {"client_id", m_clientId},
+        {"token_uri", tokenUrl.toString()},
+        {"client_secret", "test-secret"},
+        {"redirect_uris", QJsonArray {"urn:ietf:wg:oauth:2.0:oob", QString("http://127.0.0.1:%1").arg(port)}}
+    };
+
+    QFile file(m_secretPath);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QJsonDocument(QJsonObject {{"web", web}}).toJson());
+}
+
+void tst_GoogleGateway::writeTokens(const QString &accessToken, const QString &refreshToken, const QDateTime &expiresAt)
+{
+    const QJsonObject tokens {
+        {"accessToken", accessToken},
+        {"refreshToken", refreshToken},
+        {"expiresAt", static_cast<double>(expiresAt.toMSecsSinceEpoch())}
+    };
+
+    QVERIFY(QDir().mkpath(QFileInfo(m_cachePath).absolutePath()));
+    QFile file(m_cachePath);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QJsonDocument(QJsonObject {{m_clientId, tokens}}).toJson());
+}
+
+QJsonObject tst_GoogleGateway::savedTokens() const
+{
+    QFile file(m_cachePath);
+    if(!file.open(QIODevice::ReadOnly))
+        return QJsonObject();
+    return QJsonDocument::fromJson(file.readAll()).object()[m_clientId].toObject();
+}
+
+void tst_GoogleGateway::validTokenIsReusedFromFile()
+{
+    TokenServer server(500, "{}");
+    writeClientSecret(server.url());
+    writeTokens("cached-access", "cached-refresh", QDateTime::currentDateTimeUtc().addSecs(3600));
+
+    GoogleGateway gateway;
+    gateway.setTokenCachePath(m_cachePath);
+    gateway.setClientSecretPath(m_secretPath);
+    QSignalSpy changed(&gateway, &GoogleGateway::authTokenChanged);
+
+    gateway.fetchGoogleToken();
+    QCOMPARE(gateway.authToken(), QString("cached-access"));
+    QCOMPARE(changed.count(), 1);
+
+    // Asking again announces the same token again, still without a request
+    gateway.fetchGoogleToken();
+    QCOMPARE(changed.count(), 2);
+    QTest::qWait(50);
+    QCOMPARE(server.received, 0);
+    QVERIFY(m_opened.isEmpty());
+}
+
+void tst_GoogleGateway::expiredTokenIsRefreshed()
+{
+    TokenServer server(200, "{\"access_token\":\"fresh-access\",\"expires_in\":3600,\"token_type\":\"Bearer\"}");
+    writeClientSecret(server.url());
+    writeTokens("old-access", "cached-refresh", QDateTime::currentDateTimeUtc().addSecs(-10));
+
+    GoogleGateway gateway;
+    gateway.setTokenCachePath(m_cachePath);
+    gateway.setClientSecretPath(m_secretPath);
+
+    gateway.fetchGoogleToken();
+    QTRY_COMPARE(gateway.authToken(), QString("fresh-access"));
+    QCOMPARE(server.received, 1);
+    QVERIFY(m_opened.isEmpty());
+
+    // Google leaves the refresh token out of the answer, the one used is kept
+    const QJsonObject saved = savedTokens();
+    QCOMPARE(saved["accessToken"].toString(), QString("fresh-access"));
+    QCOMPARE(saved["refreshToken"].toString(), QString("cached-refresh"));
+    QVERIFY(saved["expiresAt"].toDouble() > QDateTime::currentMSecsSinceEpoch());
+
+#ifdef Q_OS_UNIX
+    const QFileDevice::Permissions permissions = QFileInfo(m_cachePath).permissions();
+    QVERIFY(permissions & QFileDevice::ReadOwner);
+    QVERIFY(!(permissions & (QFileDevice::ReadGroup | QFileDevice::ReadOther)));
+#endif
+}
+
+void tst_GoogleGateway::rejectedRefreshFallsBackToBrowser()
+{
+    TokenServer server(400, "{\"error\":\"invalid_grant\",\"error_description\":\"Token has been expired or revoked.\"}");
+    writeClientSecret(server.url());
+    writeTokens("old-access", "revoked-refresh", QDateTime::currentDateTimeUtc().addSecs(-10));
+
+    GoogleGateway gateway;
+    gateway.setTokenCachePath(m_cachePath);
+    gateway.setClientSecretPath(m_secretPath);
+
+    // The browser opens as soon as the refresh is rejected, long before the safety timeout
+    QElapsedTimer timer;
+    timer.start();
+    gateway.fetchGoogleToken();
+    QTRY_COMPARE_WITH_TIMEOUT(m_opened.size(), 1, 3000);
+    QVERIFY2(timer.elapsed() < 3000, qPrintable(QString::number(timer.elapsed())));
+    QCOMPARE(server.received, 1);
+    QCOMPARE(m_opened.first().host(), QString("127.0.0.1"));
+    QCOMPARE(QUrlQuery(m_opened.first()).queryItemValue("client_id"), m_clientId);
+}
+
+void tst_GoogleGateway::forgetTokensClearsFile()
+{
+    TokenServer server(500, "{}");
+    writeClientSecret(server.url());
+    writeTokens("cached-access", "cached-refresh", QDateTime::currentDateTimeUtc().addSecs(3600));
+
+    GoogleGateway gateway;
+    gateway.setTokenCachePath(m_cachePath);
+    gateway.setClientSecretPath(m_secretPath);
+    gateway.forgetTokens();
+    QVERIFY(savedTokens().isEmpty());
+
+    // Without tokens the next fetch goes to the browser
+    gateway.fetchGoogleToken();
+    QTRY_COMPARE(m_opened.size(), 1);
+    QCOMPARE(server.received, 0);
+}
+
+QTEST_GUILESS_MAIN(tst_GoogleGateway)
+
+#include "tst_googlegateway.moc"
@@ -0,0 +1,170 @@
+#include <QtTest>
+#include <QJsonDocument>
+#include "utils/JsonUtils.h"
+
+class tst_JsonUtils : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesQJsonDocument_data();
+    void matchesQJsonDocument();
+    void escapesAcrossBlocks();
+    void invalid_data();
+    void invalid();
+    void navigation();
+    void toVariant();
+    void parallelConversion_data();
+    void parallelConversion();
+
+private:
+    static QJsonValue expected(const QByteArray &json);
+};
+
+// What QJsonDocument makes of json, which only accepts an object or an array at the top
+QJsonValue tst_JsonUtils::expected(const QByteArray &json)
+{
+    const QJsonDocument document = QJsonDocument::fromJson(json);
+    return document.isArray() ? QJsonValue(document.array()) : QJsonValue(document.object());
+}
+
+void tst_JsonUtils::matchesQJsonDocument_data()
+{
+    QTest::addColumn<QByteArray>("json");
+
+    QTest::newRow("empty object") << QByteArray("{}");
+    QTest::newRow("empty array") << QByteArray("[]");
+    QTest::newRow("scalars") << QByteArray("[null,true,false,0,-1.5,2e3,\"s\"]");
+    QTest::newRow("nested") << QByteArray("{\"a\":{\"b\":[1,{\"c\":null}]},\"d\":\"e\",\"f\":[[],{}]}");
+    QTest::newRow("whitespace") << QByteArray(" { \"a\" :\t[ 1 , 2 ]\r\n, \"b\" : true } ");
+    QTest::newRow("unsorted keys") << QByteArray("{\"z\":1,\"a\":2,\"m\":{\"y\":3,\"b\":4}}");
+    QTest::newRow("escapes") << QByteArray("{\"q\":\"say \\\"hi\\\"\",\"b\":\"back\\\\slash\",\"n\":\"line\\nbreak\\t\",\"s\":\"\\/\"}");
+    QTest::newRow("unicode escapes") << QByteArray("[\"\\u00e9\\u20ac\",\"\\ud83d\\ude00\"]");
+    QTest::newRow("utf-8") << QByteArray("{\"gr\xc3\xbc\xc3\x9f\x65\":\"\xe2\x82\xac \xf0\x9f\x98\x80\"}");
+    QTest::newRow("escaped key") << QByteArray("{\"a\\\"b\":1,\"c\\\\\":2}");
+    QTest::newRow("structural characters in strings") << QByteArray("{\"a\":\"{[,:]}\",\"b\":[\"]\",\"}\"]}");
+}
+
+void tst_JsonUtils::matchesQJsonDocument()
+{
+    QFETCH(QByteArray, json);
+
+    const QSharedPointer<const JsonUtils::Document> document = JsonUtils::Document::parse(json);
+    QVERIFY(document);
+    QCOMPARE(document->toJsonValue(0), expected(json));
+}
+
+// Quotes and backslash runs are classified 64 bytes at a time, so they are tried at every position of a block
+void tst_JsonUtils::escapesAcrossBlocks()
+{
+    for(int padding = 0; padding < 70; ++padding) {
+        const QByteArray json = "{\"pad\":\"" + QByteArray(padding, 'x') + "\",\"s\":\"a\\\"b\\\\\\\\\\\"c\\\\\",\"t\":[1,\"]\"]}";
+
+        const QSharedPointer<const JsonUtils::Document> document = JsonUtils::Document::parse(json);
+        QVERIFY2(document, json.constData());
+        QCOMPARE(document->toJsonValue(0), expected(json));
+    }
+}
+
+void tst_JsonUtils::invalid_data()
+{
+    QTest::addColumn<QByteArray>("json");
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("unclosed object") << QByteArray("{\"a\":1");
+    QTest::newRow("unclosed array") << QByteArray("[1,2");
+    QTest::newRow("unterminated string") << QByteArray("[\"abc]");
+    QTest::newRow("missing colon") << QByteArray("{\"a\" 1}");
+    QTest::newRow("missing value") << QByteArray("{\"a\":}");
+    QTest::newRow("trailing comma") << QByteArray("[1,]");
+    QTest::newRow("missing comma") << QByteArray("[1 2]");
+    QTest::newRow("bad literal") << QByteArray("[tru]");
+    QTest::newRow("extra close") << QByteArray("{\"a\":1}}");
+    QTest::newRow("unquoted key") << QByteArray("{a:1}");
+}
+
+void tst_JsonUtils::invalid()
+{
+    QFETCH(QByteArray, json);
+
+    QVERIFY(!JsonUtils::Document::parse(json));
+}
+
+void tst_JsonUtils::navigation()
+{
+    const QByteArray json("{\"users\":{\"bob\":{\"age\":42},\"alice\":{\"name\":\"Al\\\"ice\"}},\"list\":[10,20,30],\"dup\":1,\"dup\":2}");
+    const QSharedPointer<const JsonUtils::Document> document = JsonUtils::Document::parse(json);
+    QVERIFY(document);
+
+    QCOMPARE(document->type(0), JsonUtils::Object);
+    QCOMPARE(document->keys(0), QStringList({"dup", "list", "users"}));
+
+    const int users = document->child(0, "users");
+    QCOMPARE(document->type(users), JsonUtils::Object);
+    QCOMPARE(document->count(users), 2);
+    QCOMPARE(document->keys(users), QStringList({"alice", "bob"}));
+
+    const int name = document->child(document->child(users, "alice"), "name");
+    QCOMPARE(document->type(name), JsonUtils::String);
+    QCOMPARE(document->string(name), QString("Al\"ice"));
+    QCOMPARE(document->raw(name), QByteArray("\"Al\\\"ice\""));
+    QCOMPARE(document->raw(document->child(users, "bob")), QByteArray("{\"age\":42}"));
+
+    const int list = document->child(0, "list");
+    QCOMPARE(document->type(list), JsonUtils::Array);
+    QCOMPARE(document->keys(list), QStringList({"0", "1", "2"}));
+    QCOMPARE(document->raw(document->child(list, "2")), QByteArray("30"));
+    QCOMPARE(document->child(list, "3"), -1);
+    QCOMPARE(document->child(list, "x"), -1);
+
+    QCOMPARE(document->child(0, "missing"), -1);
+    QCOMPARE(document->child(name, "anything"), -1);
+
+    // Like QJsonObject, the last of duplicate keys wins
+    QCOMPARE(document->raw(document->child(0, "dup")), QByteArray("2"));
+}
+
+void tst_JsonUtils::toVariant()
+{
+    const QByteArray json("{\"a\":[1,\"two\",null,{\"b\":false}],\"c\":{\"d\":\"e\\u00e9\"},\"f\":2.5}");
+    const QSharedPointer<const JsonUtils::Document> document = JsonUtils::Document::parse(json);
+    QVERIFY(document);
+
+    QCOMPARE(document->toVariant(0), document->toJsonValue(0).toVariant());
+    QCOMPARE(document->toVariant(0), expected(json).toVariant());
+}
+
+void tst_JsonUtils::parallelConversion_data()
+{
+    QTest::addColumn<QByteArray>("json");
+
+    // Children of very different sizes and keys out of order, as the pool hands them out unevenly
+    QJsonArray array;
+    QByteArray object = "{";
+    for(int i = 0; i < 6000; ++i) {
+        QJsonObject child {{"index", i}, {"text", QString(i % 97 == 0 ? 20000 : 120, QChar('a' + i % 26))}};
+        array.append(child);
+        object += "\"k" + QByteArray::number((i * 7919) % 6000) + "\":" + QJsonDocument(child).toJson(QJsonDocument::Compact) + ",";
+    }
+    object += "\"last\":null}";
+
+    QTest::newRow("array") << QJsonDocument(array).toJson(QJsonDocument::Compact);
+    QTest::newRow("object") << object;
+}
+
+void tst_JsonUtils::parallelConversion()
+{
+    QFETCH(QByteArray, json);
+    QVERIFY(json.size() >= JsonUtils::minParallelSize);
+
+    const QSharedPointer<const JsonUtils::Document> document = JsonUtils::Document::parse(json);
+    QVERIFY(document);
+
+    const QJsonValue parallel = document->toJsonValue(0);
+    QCOMPARE(parallel, document->toJsonValueSequential(0));
+    QCOMPARE(parallel, expected(json));
+}
+
+QTEST_GUILESS_MAIN(tst_JsonUtils)
+
+#include "tst_jsonutils.moc"
@@ -0,0 +1,146 @@
+#include <QtTest>
+#include <QThread>
+#include "firebase/firebasememorybackend.h"
+#include "utils/DatabaseUtils.h"
+
+class tst_MemoryBackend : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void restVerbs();
+    void invalidBody();
+    void databasesAreSeparate();
+    void changesCarryRevisions();
+    void concurrentWritesAnnouncedInOrder();
+
+private:
+    const QString m_url = QStringLiteral("memory://tst-backend");
+};
+
+void tst_MemoryBackend::init()
+{
+    FirebaseMemoryBackend::instance()->clear(m_url);
+}
+
+void tst_MemoryBackend::restVerbs()
+{
+    FirebaseMemoryBackend *backend = FirebaseMemoryBackend::instance();
+
+    FirebaseResponse response = backend->request(m_url, "PUT", "/users/alice.json", "{\"name\":\"Alice\",\"age\":30}");
+    QCOMPARE(response.status, 200);
+    QCOMPARE(response.body, QByteArray("{\"name\":\"Alice\",\"age\":30}"));
+
+    response = backend->request(m_url, "PATCH", "/users/alice.json", "{\"age\":31}");
+    QCOMPARE(response.status, 200);
+    QCOMPARE(DatabaseUtils::parse(backend->request(m_url, "GET", "/users/alice.json", QByteArray()).body),
+             DatabaseUtils::parse("{\"name\":\"Alice\",\"age\":31}"));
+
+    // POST answers with the generated key, which is a push id
+    response = backend->request(m_url, "POST", "/messages.json", "\"hi\"");
+    const QString key = DatabaseUtils::parse(response.body).toObject()["name"].toString();
+    QCOMPARE(key.size(), 20);
+    QCOMPARE(backend->value(m_url, "/messages/" + key), QJsonValue("hi"));
+
+    response = backend->request(m_url, "DELETE", "/users/alice.json", QByteArray());
+    QCOMPARE(response.body, QByteArray("null"));
+    QCOMPARE(backend->value(m_url, "/users"), QJsonValue(QJsonValue::Null));
+    QCOMPARE(backend->request(m_url, "GET", "/.json", QByteArray()).body,
+             DatabaseUtils::serialize(QJsonObject {{"messages", QJsonObject {{key, "hi"}}}}));
+}
+
+void tst_MemoryBackend::invalidBody()
+{
+    FirebaseMemoryBackend *backend = FirebaseMemoryBackend::instance();
+
+    const FirebaseResponse response = backend->request(m_url, "PUT", "/a.json", "{broken");
+    QCOMPARE(response.status, 400);
+    QCOMPARE(response.error, FirebaseError::BadRequest);
+
+    QCOMPARE(backend->request(m_url, "PATCH", "/a.json", "1").status, 400);
+    QCOMPARE(backend->request(m_url, "HEAD", "/a.json", QByteArray()).status, 405);
+    QCOMPARE(backend->value(m_url, "/a"), QJsonValue(QJsonValue::Null));
+}
+
+void tst_MemoryBackend::databasesAreSeparate()
+{
+    FirebaseMemoryBackend *backend = FirebaseMemoryBackend::instance();
+    const QString other("memory://TST-Backend-Other/");
+    backend->clear(other);
+
+    backend->request(m_url, "PUT", "/k.json", "1");
+    backend->request(other, "PUT", "/k.json", "2");
+    QCOMPARE(backend->value(m_url, "/k"), QJsonValue(1));
+    QCOMPARE(backend->value(other, "/k"), QJsonValue(2));
+    QCOMPARE(FirebaseMemoryBackend::databaseName(other), QString("tst-backend-other"));
+}
+
+void tst_MemoryBackend::changesCarryRevisions()
+{
+    FirebaseMemoryBackend *backend = FirebaseMemoryBackend::instance();
+    QSignalSpy spy(backend, &FirebaseMemoryBackend::changed);
+
+    backend->request(m_url, "PUT", "/a.json", "{\"b\":1}");
+    backend->request(m_url, "PATCH", "/a.json", "{\"c\":2}");
+    backend->request(m_url, "GET", "/a.json", QByteArray());
+    QCOMPARE(spy.count(), 2);
+
+    QCOMPARE(spy.at(0).at(0).toString(), QString("tst-backend"));
+    QCOMPARE(spy.at(0).at(1).toByteArray(), QByteArray("put"));
+    QCOMPARE(spy.at(1).at(1).toByteArray(), QByteArray("patch"));
+    QCOMPARE(spy.at(1).at(2).toString(), QString("/a"));
+    QCOMPARE(spy.at(1).at(4).value<QJsonValue>(), DatabaseUtils::parse("{\"a\":{\"b\":1,\"c\":2}}"));
+
+    // The value read afterwards contains both writes, so a listener starting from it skips them
+    const quint64 first = spy.at(0).at(5).toULongLong();
+    const quint64 second = spy.at(1).at(5).toULongLong();
+    QVERIFY(second > first);
+
+    quint64 revision = 0;
+    backend->value(m_url, "/a", &revision);
+    QCOMPARE(revision, second);
+}
+
+// Writers in several threads: the announcements must come in the order the writes were applied
+void tst_MemoryBackend::concurrentWritesAnnouncedInOrder()
+{
+    FirebaseMemoryBackend *backend = FirebaseMemoryBackend::instance();
+
+    // Direct connection, the slot runs in the writing thread while the backend holds its lock
+    QList<quint64> revisions;
+    QJsonValue lastRoot;
+    const QMetaObject::Connection connection = connect(backend, &FirebaseMemoryBackend::changed, this,
+                                                       [&](const QString &, const QByteArray &, const QString &, const QJsonValue &,
+                                                           const QJsonValue &root, quint64 revision) {
+        revisions.append(revision);
+        lastRoot = root;
+    }, Qt::DirectConnection);
+
+    QList<QThread *> threads;
+    for(int i = 0; i < 4; ++i) {
+        threads.append(QThread::create([=]() {
+            for(int j = 0; j < 200; ++j)
+                backend->request(m_url, "PUT", QString("/t%1.json").arg(i), QByteArray::number(j));
+        }));
+        threads.last()->start();
+    }
+    for(QThread *thread : qAsConst(threads)) {
+        QVERIFY(thread->wait(10000));
+        delete thread;
+    }
+    disconnect(connection);
+
+    QCOMPARE(revisions.size(), 800);
+    for(int i = 1; i < revisions.size(); ++i)
+        QVERIFY(revisions.at(i) > revisions.at(i - 1));
+
+    // The last announced root is the final state of the database
+    QCOMPARE(lastRoot, backend->value(m_url, "/"));
+    for(int i = 0; i < 4; ++i)
+        QCOMPARE(backend->value(m_url, QString("/t%1").arg(i)), QJsonValue(199));
+}
+
+QTEST_GUILESS_MAIN(tst_MemoryBackend)
+
+#include "tst_memorybackend.moc"
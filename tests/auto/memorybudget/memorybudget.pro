@@ -0,0 +1,9 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase console
+CONFIG -= app_bundle
+TARGET = tst_memorybudget
+
+include(../../../QmlFirebaseCore.pri)
+
+SOURCES += tst_memorybudget.cpp
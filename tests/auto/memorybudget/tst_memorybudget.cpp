@@ -0,0 +1,119 @@
+#include <QtTest>
+#include <QThread>
+#include "firebase/firebasememorybudget.h"
+
+class tst_MemoryBudget : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+    void disabledAcceptsEverything();
+    void tryReserveStopsAtLimit();
+    void pressureHysteresis();
+    void concurrentReservations();
+    void settersClampBeforeComparing();
+};
+
+// The budget is process wide, every test starts from an empty, disabled one
+void tst_MemoryBudget::cleanup()
+{
+    FirebaseMemoryBudget *budget = FirebaseMemoryBudget::instance();
+    budget->release(budget->used());
+    budget->setLimit(0);
+}
+
+void tst_MemoryBudget::disabledAcceptsEverything()
+{
+    FirebaseMemoryBudget *budget = FirebaseMemoryBudget::instance();
+    QVERIFY(!budget->isEnabled());
+    QVERIFY(budget->tryReserve(1LL << 40));
+    QVERIFY(!budget->underPressure());
+}
+
+void tst_MemoryBudget::tryReserveStopsAtLimit()
+{
+    FirebaseMemoryBudget *budget = FirebaseMemoryBudget::instance();
+    budget->setLimit(1000);
+
+    QVERIFY(budget->tryReserve(600));
+    QVERIFY(!budget->tryReserve(500));
+    QCOMPARE(budget->used(), qint64(600));
+    QVERIFY(budget->tryReserve(400));
+    QCOMPARE(budget->used(), qint64(1000));
+
+    // Bytes held anyway are counted even past the limit
+    budget->reserve(500);
+    QCOMPARE(budget->used(), qint64(1500));
+    budget->release(1500);
+    QCOMPARE(budget->used(), qint64(0));
+}
+
+void tst_MemoryBudget::pressureHysteresis()
+{
+    FirebaseMemoryBudget *budget = FirebaseMemoryBudget::instance();
+    budget->setLimit(1000);
+    QSignalSpy spy(budget, &FirebaseMemoryBudget::pressureChanged);
+
+    QVERIFY(budget->tryReserve(790));
+    QVERIFY(!budget->underPressure());
+    QVERIFY(budget->tryReserve(10));
+    QVERIFY(budget->underPressure());
+
+    // Pressure only ends below 60%
+    budget->release(150);
+    QVERIFY(budget->underPressure());
+    budget->release(100);
+    QVERIFY(!budget->underPressure());
+
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(0).at(0).toBool(), true);
+    QCOMPARE(spy.at(1).at(0).toBool(), false);
+}
+
+void tst_MemoryBudget::concurrentReservations()
+{
+    FirebaseMemoryBudget *budget = FirebaseMemoryBudget::instance();
+    budget->setLimit(5000);
+
+    QAtomicInt granted;
+    QList<QThread *> threads;
+    for(int i = 0; i < 8; ++i) {
+        threads.append(QThread::create([&]() {
+            for(int j = 0; j < 1000; ++j) {
+                if(budget->tryReserve(1))
+                    granted.ref();
+            }
+        }));
+        threads.last()->start();
+    }
+    for(QThread *thread : qAsConst(threads)) {
+        QVERIFY(thread->wait(10000));
+        delete thread;
+    }
+
+    QCOMPARE(granted.loadAcquire(), 5000);
+    QCOMPARE(budget->used(), qint64(5000));
+}
+
+// Out of range values that clamp to the current one change nothing
+void tst_MemoryBudget::settersClampBeforeComparing()
+{
+    FirebaseMemoryBudget *budget = FirebaseMemoryBudget::instance();
+    QSignalSpy limitChanged(budget, &FirebaseMemoryBudget::limitChanged);
+    budget->setLimit(-1);
+    QCOMPARE(budget->limit(), qint64(0));
+    QCOMPARE(limitChanged.count(), 0);
+
+    const int readBufferSize = budget->readBufferSize();
+    QSignalSpy readBufferSizeChanged(budget, &FirebaseMemoryBudget::readBufferSizeChanged);
+    budget->setReadBufferSize(1);
+    budget->setReadBufferSize(2);
+    QCOMPARE(budget->readBufferSize(), 4096);
+    QCOMPARE(readBufferSizeChanged.count(), 1);
+    budget->setReadBufferSize(readBufferSize);
+}
+
+QTEST_GUILESS_MAIN(tst_MemoryBudget)
+
+#include "tst_memorybudget.moc"
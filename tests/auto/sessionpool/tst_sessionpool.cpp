@@ -0,0 +1,160 @@
+#include <QtTest>
+#include <QCborArray>
+#include <QCborValue>
+#include "firebase/firebasesessionpool.h"
+#include "firebase/firebasetrace.h"
+#include "utils/AuthUtils.h"
+
+// Answers of the token endpoint, replayed instead of the network after the given delay
+class TokenTrace
+{
+public:
+    void add(int delay, int status, const QJsonObject &body)
+    {
+        const qint64 id = ++m_exchanges;
+        const QUrl url(AuthUtils::endpoint_refreshToken + "test-key");
+        append(0, {{"id", id}, {"k", "request"}, {"verb", "POST"}, {"url", FirebaseTraceManager::redact(url)}});
+        append(delay, {{"id", id}, {"k", "response"}, {"status", status}, {"headers", QCborArray()}});
+        append(delay, {{"id", id}, {"k", "data"}, {"data", QJsonDocument(body).toJson(QJsonDocument::Compact)}});
+        append(delay, {{"id", id}, {"k", "finished"},
+                       {"error", status < 400 ? 0 : static_cast<int>(QNetworkReply::ProtocolInvalidOperationError)}, {"message", QString()}});
+    }
+
+    void addToken(int delay, const QString &userId)
+    {
+        add(delay, 200, {{"id_token", idToken(userId)}, {"refresh_token", "refresh-" + userId}, {"user_id", userId}, {"expires_in", "3600"}});
+    }
+
+    bool replay(const QString &fileName) const
+    {
+        QFile file(fileName);
+        if(!file.open(QIODevice::WriteOnly) || file.write(m_data) != m_data.size())
+            return false;
+        file.close();
+        return FirebaseTransport::shared()->startReplay(fileName);
+    }
+
+    // Unsigned, but with the claims the pool schedules the next refresh from
+    static QString idToken(const QString &userId)
+    {
+        const auto encode = [](const QJsonObject &object) {
+            return QJsonDocument(object).toJson(QJsonDocument::Compact).toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+        };
+        const qint64 now = QDateTime::currentSecsSinceEpoch();
+        return QString::fromLatin1(encode({{"alg", "RS256"}}) + "." + encode({{"sub", userId}, {"iat", now}, {"exp", now + 3600}}) + ".c2ln");
+    }
+
+private:
+    void append(qint64 time, QCborMap entry)
+    {
+        entry.insert(QStringLiteral("t"), time);
+        m_data += QCborValue(entry).toCbor();
+    }
+
+    QByteArray m_data;
+    qint64 m_exchanges = 0;
+};
+
+class tst_SessionPool : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    void restoreHonoursConcurrencyLimit();
+    void answerOfRemovedSessionIsIgnored();
+    void failedRefreshFreesItsSlot();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+void tst_SessionPool::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+void tst_SessionPool::cleanup()
+{
+    FirebaseTransport::shared()->stopReplay();
+}
+
+void tst_SessionPool::restoreHonoursConcurrencyLimit()
+{
+    TokenTrace trace;
+    for(int i = 0; i < 6; ++i)
+        trace.addToken(100, "user-" + QString::number(i));
+    QVERIFY(trace.replay(m_dir.filePath("restore.trace")));
+
+    FirebaseSessionPool pool;
+    pool.setApiKey("test-key");
+    pool.setMaxConcurrentRefreshes(2);
+
+    QElapsedTimer timer;
+    QList<qint64> refreshedAt;
+    connect(&pool, &FirebaseSessionPool::sessionRefreshed, this, [&]() {
+        refreshedAt.append(timer.elapsed());
+    });
+
+    // Restoring many sessions at startup must not send all their refreshes at once
+    timer.start();
+    for(int i = 0; i < 6; ++i)
+        pool.restoreSession("session-" + QString::number(i), "refresh-" + QString::number(i));
+
+    QTRY_COMPARE_WITH_TIMEOUT(refreshedAt.size(), 6, 10000);
+    QVERIFY2(refreshedAt.last() >= 250, qPrintable(QString::number(refreshedAt.last())));
+    for(int i = 0; i < 6; ++i)
+        QVERIFY(!pool.idToken("session-" + QString::number(i)).isEmpty());
+}
+
+void tst_SessionPool::answerOfRemovedSessionIsIgnored()
+{
+    TokenTrace trace;
+    trace.addToken(100, "old");
+    trace.addToken(0, "new");
+    QVERIFY(trace.replay(m_dir.filePath("removed.trace")));
+
+    FirebaseSessionPool pool;
+    pool.setApiKey("test-key");
+    pool.setMaxConcurrentRefreshes(1);
+    QSignalSpy refreshed(&pool, &FirebaseSessionPool::sessionRefreshed);
+
+    pool.restoreSession("a", "refresh-old");
+    pool.removeSession("a");
+    pool.restoreSession("a", "refresh-new");
+    QCOMPARE(pool.count(), 1);
+
+    // The answer for the removed session still held the only slot, the new one is only sent after it
+    QTRY_COMPARE(refreshed.count(), 1);
+    QCOMPARE(pool.user("a")->userId(), QString("new"));
+    QTest::qWait(100);
+    QCOMPARE(refreshed.count(), 1);
+}
+
+void tst_SessionPool::failedRefreshFreesItsSlot()
+{
+    TokenTrace trace;
+    trace.add(50, 400, {{"error", QJsonObject {{"code", 400}, {"message", "INVALID_REFRESH_TOKEN"}}}});
+    trace.addToken(50, "b");
+    QVERIFY(trace.replay(m_dir.filePath("failed.trace")));
+
+    FirebaseSessionPool pool;
+    pool.setApiKey("test-key");
+    pool.setMaxConcurrentRefreshes(1);
+    QSignalSpy refreshed(&pool, &FirebaseSessionPool::sessionRefreshed);
+    QSignalSpy errors(&pool, &FirebaseSessionPool::sessionError);
+
+    pool.restoreSession("a", "revoked");
+    pool.restoreSession("b", "refresh-b");
+
+    QTRY_COMPARE(refreshed.count(), 1);
+    QCOMPARE(refreshed.first().at(0).toString(), QString("b"));
+    QCOMPARE(errors.count(), 1);
+    QCOMPARE(errors.first().at(0).toString(), QString("a"));
+    QVERIFY(FirebaseError::category(errors.first().at(2).value<FirebaseError::Code>()) != FirebaseError::Retryable);
+}
+
+QTEST_GUILESS_MAIN(tst_SessionPool)
+
+#include "tst_sessionpool.moc"
@@ -0,0 +1,417 @@
+#include <QtTest>
+#include <QCborArray>
+#include <QCborValue>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "firebase/firebasestorage.h"
+#include "firebase/firebasestoragecache.h"
+#include "firebase/firebasetrace.h"
+#include "firebase/firebasetransport.h"
+
+// Upload session on the loopback interface, answering the commands of the resumable upload protocol
+class UploadSession : public QObject
+{
+public:
+    struct Request {
+        QByteArray command;
+        qint64 offset = -1;
+        int size = 0;
+    };
+
+    UploadSession()
+    {
+        connect(&m_server, &QTcpServer::newConnection, this, &UploadSession::accept);
+        m_server.listen(QHostAddress::LocalHost);
+    }
+
+    QUrl url() const { return QUrl(QStringLiteral("http://127.0.0.1:%1/upload/session").arg(m_server.serverPort())); }
+
+    qint64 received = 0;
+    bool finalized = false;
+    QList<Request> requests;
+
+private:
+    void accept()
+    {
+        while(QTcpSocket *socket = m_server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() {
+                QByteArray &data = m_data[socket];
+                data += socket->readAll();
+
+                const int headerEnd = data.indexOf("\r\n\r\n");
+                if(headerEnd < 0)
+                    return;
+
+                Request request;
+                int contentLength = 0;
+                for(const QByteArray &line : data.left(headerEnd).split('\n')) {
+                    const int colon = line.indexOf(':');
+                    const QByteArray name = line.left(colon).trimmed().toLower();
+                    const QByteArray value = line.mid(colon + 1).trimmed();
+                    if(name == "content-length")
+                        contentLength = value.toInt();
+                    else if(name == "x-goog-upload-command")
+                        request.command = value;
+                    else if(name == "x-goog-upload-offset")
+                        request.offset = value.toLongLong();
+                }
+
+                if(data.size() < headerEnd + 4 + contentLength)
+                    return;
+                request.size = contentLength;
+                m_data.remove(socket);
+                requests.append(request);
+                socket->write(answer(request));
+                socket->disconnectFromHost();
+            });
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+    QByteArray answer(const Request &request)
+    {
+        if(request.command != "query") {
+            received = request.offset + request.size;
+            finalized = request.command.contains("finalize");
+        }
+
+        const QByteArray body = finalized ? QByteArray("{\"name\":\"docs/report.bin\"}") : QByteArray();
+        return "HTTP/1.1 200 OK\r\n"
+               "X-Goog-Upload-Status: " + QByteArray(finalized ? "final" : "active") + "\r\n"
+               "X-Goog-Upload-Size-Received: " + QByteArray::number(received) + "\r\n"
+               "Content-Length: " + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    }
+
+    QTcpServer m_server;
+    QHash<QTcpSocket *, QByteArray> m_data;
+};
+
+// Trace answering requests in the order they were added, replayed instead of the network
+class Trace
+{
+public:
+    void add(const QUrl &url, int status, const QByteArray &body, const QCborArray &headers = {},
+             QNetworkReply::NetworkError error = QNetworkReply::NoError)
+    {
+        const qint64 id = ++m_exchanges;
+        append({{"id", id}, {"k", "request"}, {"verb", "GET"}, {"url", FirebaseTraceManager::redact(url)}});
+        append({{"id", id}, {"k", "response"}, {"status", status}, {"headers", headers}});
+        if(!body.isEmpty())
+            append({{"id", id}, {"k", "data"}, {"data", body}});
+        append({{"id", id}, {"k", "finished"}, {"error", static_cast<int>(error)}, {"message", QString()}});
+    }
+
+    // Metadata and content of an object, as the server sends them
+    void addObject(const QString &bucket, const QString &storagePath, const QByteArray &content, const QString &generation = "1")
+    {
+        const QJsonObject metadata {
+            {"size", QString::number(content.size())},
+            {"generation", generation},
+            {"md5Hash", QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Md5).toBase64())}
+        };
+        add(objectUrl(bucket, storagePath, false), 200, QJsonDocument(metadata).toJson(QJsonDocument::Compact));
+        add(objectUrl(bucket, storagePath, true), 200, content);
+    }
+
+    bool replay(const QString &fileName) const
+    {
+        QFile file(fileName);
+        if(!file.open(QIODevice::WriteOnly) || file.write(m_data) != m_data.size())
+            return false;
+        file.close();
+        return FirebaseTransport::shared()->startReplay(fileName, 0.0);
+    }
+
+    static QUrl objectUrl(const QString &bucket, const QString &storagePath, bool media)
+    {
+        return QUrl::fromEncoded("https://firebasestorage.googleapis.com/v0/b/" + bucket.toUtf8() + "/o/"
+                                 + QUrl::toPercentEncoding(storagePath) + (media ? "?alt=media" : ""));
+    }
+
+private:
+    void append(QCborMap entry)
+    {
+        entry.insert(QStringLiteral("t"), 0);
+        m_data += QCborValue(entry).toCbor();
+    }
+
+    QByteArray m_data;
+    qint64 m_exchanges = 0;
+};
+
+class tst_Storage : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void resumeContinuesAtReceivedOffset();
+    void resumeOfFinishedUpload();
+    void changedFileIsDiscarded();
+    void missingFile();
+    void downloadIsCached();
+    void cacheTellsBucketsApart();
+    void concurrentDownloadsOfSameContent();
+    void interruptedRangeContinues();
+    void cleanup();
+
+private:
+    QString writeFile(qint64 size);
+    void saveSession(const QString &filePath, const QUrl &sessionUrl, qint64 size = -1);
+    QJsonObject state() const;
+
+    QTemporaryDir m_dir;
+    const QString m_storagePath = QStringLiteral("docs/report.bin");
+};
+
+void tst_Storage::initTestCase()
+{
+    QStandardPaths::setTestMode(true);
+    QVERIFY(m_dir.isValid());
+}
+
+void tst_Storage::init()
+{
+    QFile::remove(m_dir.filePath("uploads.json"));
+
+    // Every test starts with an empty download cache
+    FirebaseStorageCache::shared()->setDirectory(m_dir.filePath(QString("cache-") + QTest::currentTestFunction()));
+}
+
+void tst_Storage::cleanup()
+{
+    FirebaseTransport::shared()->stopReplay();
+}
+
+QString tst_Storage::writeFile(qint64 size)
+{
+    const QString filePath = m_dir.filePath("report.bin");
+    QFile file(filePath);
+    if(file.open(QIODevice::WriteOnly))
+        file.write(QByteArray(size, 'x'));
+    return filePath;
+}
+
+// The state left behind by an upload interrupted when the application stopped
+void tst_Storage::saveSession(const QString &filePath, const QUrl &sessionUrl, qint64 size)
+{
+    const QFileInfo info(filePath);
+
+    QJsonObject saved;
+    saved["file"] = info.absoluteFilePath();
+    saved["size"] = static_cast<double>(size < 0 ? info.size() : size);
+    saved["modified"] = static_cast<double>(info.lastModified().toMSecsSinceEpoch());
+    saved["contentType"] = "application/octet-stream";
+    saved["sessionUrl"] = sessionUrl.toString();
+
+    QFile file(m_dir.filePath("uploads.json"));
+    if(file.open(QIODevice::WriteOnly))
+        file.write(QJsonDocument(QJsonObject {{m_storagePath, saved}}).toJson(QJsonDocument::Compact));
+}
+
+QJsonObject tst_Storage::state() const
+{
+    QFile file(m_dir.filePath("uploads.json"));
+    return file.open(QIODevice::ReadOnly) ? QJsonDocument::fromJson(file.readAll()).object() : QJsonObject();
+}
+
+void tst_Storage::resumeContinuesAtReceivedOffset()
+{
+    const qint64 size = 600 * 1024;
+    UploadSession session;
+    session.received = 256 * 1024;
+    saveSession(writeFile(size), session.url());
+
+    FirebaseStorage storage;
+    storage.setStateFile(m_dir.filePath("uploads.json"));
+    storage.setChunkSize(256 * 1024);
+    QSignalSpy progress(&storage, &FirebaseStorage::uploadProgress);
+    QSignalSpy finished(&storage, &FirebaseStorage::uploadFinished);
+
+    storage.resumeUploads(QString());
+    QCOMPARE(storage.activeUploads(), 1);
+    QTRY_COMPARE(finished.count(), 1);
+
+    // Only the part the server has not received yet is sent, in chunks of the granularity
+    QCOMPARE(session.requests.size(), 3);
+    QCOMPARE(session.requests[0].command, QByteArray("query"));
+    QCOMPARE(session.requests[1].command, QByteArray("upload"));
+    QCOMPARE(session.requests[1].offset, qint64(256 * 1024));
+    QCOMPARE(session.requests[1].size, 256 * 1024);
+    QCOMPARE(session.requests[2].command, QByteArray("upload, finalize"));
+    QCOMPARE(session.requests[2].offset, qint64(512 * 1024));
+    QCOMPARE(session.requests[2].size, 88 * 1024);
+
+    QCOMPARE(progress.count(), 2);
+    QCOMPARE(progress.last().at(1).toLongLong(), size);
+    QCOMPARE(finished.first().at(0).toString(), m_storagePath);
+    QCOMPARE(finished.first().at(1).toByteArray(), QByteArray("{\"name\":\"docs/report.bin\"}"));
+    QCOMPARE(storage.activeUploads(), 0);
+    QVERIFY(!state().contains(m_storagePath));
+}
+
+void tst_Storage::resumeOfFinishedUpload()
+{
+    UploadSession session;
+    session.received = 1024;
+    session.finalized = true;
+    saveSession(writeFile(1024), session.url());
+
+    FirebaseStorage storage;
+    storage.setStateFile(m_dir.filePath("uploads.json"));
+    QSignalSpy finished(&storage, &FirebaseStorage::uploadFinished);
+
+    storage.resumeUploads(QString());
+    QTRY_COMPARE(finished.count(), 1);
+    QCOMPARE(session.requests.size(), 1);
+    QCOMPARE(session.requests[0].command, QByteArray("query"));
+    QVERIFY(!state().contains(m_storagePath));
+}
+
+void tst_Storage::changedFileIsDiscarded()
+{
+    UploadSession session;
+    saveSession(writeFile(1024), session.url(), 2048);
+
+    FirebaseStorage storage;
+    storage.setStateFile(m_dir.filePath("uploads.json"));
+
+    storage.resumeUploads(QString());
+    QCOMPARE(storage.activeUploads(), 0);
+    QVERIFY(!state().contains(m_storagePath));
+    QTest::qWait(50);
+    QVERIFY(session.requests.isEmpty());
+}
+
+void tst_Storage::missingFile()
+{
+    FirebaseStorage storage;
+    storage.setStateFile(m_dir.filePath("uploads.json"));
+    QSignalSpy errors(&storage, &FirebaseStorage::errorOcurred);
+
+    storage.upload(m_dir.filePath("missing.bin"), m_storagePath, QString());
+    QCOMPARE(errors.count(), 1);
+    QCOMPARE(errors.first().at(1).value<FirebaseError::Code>(), FirebaseError::NotFound);
+    QCOMPARE(storage.activeUploads(), 0);
+}
+
+static QByteArray readAll(const QString &fileName)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void tst_Storage::downloadIsCached()
+{
+    const QByteArray content("alpha content");
+    Trace trace;
+    trace.addObject("bucket-a", m_storagePath, content);
+    QVERIFY(trace.replay(m_dir.filePath("download.trace")));
+
+    FirebaseStorage storage;
+    storage.setStorageBucket("bucket-a");
+    QSignalSpy finished(&storage, &FirebaseStorage::downloadFinished);
+    QSignalSpy errors(&storage, &FirebaseStorage::errorOcurred);
+
+    storage.download(m_storagePath, QString());
+    QTRY_COMPARE(finished.count(), 1);
+    QCOMPARE(finished.last().at(2).toBool(), false);
+    QCOMPARE(readAll(finished.last().at(1).toString()), content);
+
+    // Validated a moment ago, the trace has no more answers so any request would fail
+    storage.download(m_storagePath, QString(), m_dir.filePath("copy.bin"));
+    QTRY_COMPARE(finished.count(), 2);
+    QCOMPARE(finished.last().at(1).toString(), m_dir.filePath("copy.bin"));
+    QCOMPARE(finished.last().at(2).toBool(), true);
+    QCOMPARE(readAll(m_dir.filePath("copy.bin")), content);
+    QVERIFY(errors.isEmpty());
+}
+
+void tst_Storage::cacheTellsBucketsApart()
+{
+    Trace trace;
+    trace.addObject("bucket-a", m_storagePath, "content of bucket a");
+    trace.addObject("bucket-b", m_storagePath, "content of bucket b");
+    QVERIFY(trace.replay(m_dir.filePath("buckets.trace")));
+
+    FirebaseStorage first;
+    first.setStorageBucket("bucket-a");
+    QSignalSpy firstFinished(&first, &FirebaseStorage::downloadFinished);
+    first.download(m_storagePath, QString());
+    QTRY_COMPARE(firstFinished.count(), 1);
+
+    // The same path in another bucket is another object, it is downloaded instead of taken from the cache
+    FirebaseStorage second;
+    second.setStorageBucket("gs://bucket-b");
+    QSignalSpy secondFinished(&second, &FirebaseStorage::downloadFinished);
+    second.download(m_storagePath, QString());
+    QTRY_COMPARE(secondFinished.count(), 1);
+    QCOMPARE(secondFinished.last().at(2).toBool(), false);
+    QCOMPARE(readAll(secondFinished.last().at(1).toString()), QByteArray("content of bucket b"));
+    QCOMPARE(readAll(firstFinished.last().at(1).toString()), QByteArray("content of bucket a"));
+}
+
+void tst_Storage::concurrentDownloadsOfSameContent()
+{
+    const QByteArray content(64 * 1024, 'c');
+    Trace trace;
+    trace.add(Trace::objectUrl("bucket-a", "a.bin", false), 200, QJsonDocument(QJsonObject {
+        {"size", QString::number(content.size())}, {"generation", "1"},
+        {"md5Hash", QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Md5).toBase64())}}).toJson());
+    trace.add(Trace::objectUrl("bucket-a", "b.bin", false), 200, QJsonDocument(QJsonObject {
+        {"size", QString::number(content.size())}, {"generation", "7"},
+        {"md5Hash", QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Md5).toBase64())}}).toJson());
+    trace.add(Trace::objectUrl("bucket-a", "a.bin", true), 200, content);
+    trace.add(Trace::objectUrl("bucket-a", "b.bin", true), 200, content);
+    QVERIFY(trace.replay(m_dir.filePath("same.trace")));
+
+    // Both transfers run at once and have the same content key, each needs a partial file of its own
+    FirebaseStorage storage;
+    storage.setStorageBucket("bucket-a");
+    QSignalSpy finished(&storage, &FirebaseStorage::downloadFinished);
+    QSignalSpy errors(&storage, &FirebaseStorage::errorOcurred);
+    storage.download("a.bin", QString());
+    storage.download("b.bin", QString());
+
+    QTRY_COMPARE(finished.count(), 2);
+    QVERIFY(errors.isEmpty());
+    for(const QList<QVariant> &arguments : qAsConst(finished))
+        QCOMPARE(readAll(arguments.at(1).toString()), content);
+}
+
+void tst_Storage::interruptedRangeContinues()
+{
+    QByteArray content(300 * 1024, '\0');
+    for(int i = 0; i < content.size(); ++i)
+        content[i] = static_cast<char>(i % 251);
+    const int split = 100 * 1024;
+
+    // The connection drops after the first part, the rest is asked for with a Range request
+    Trace trace;
+    trace.add(Trace::objectUrl("bucket-a", m_storagePath, false), 200, QJsonDocument(QJsonObject {
+        {"size", QString::number(content.size())}, {"generation", "1"},
+        {"md5Hash", QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Md5).toBase64())}}).toJson());
+    trace.add(Trace::objectUrl("bucket-a", m_storagePath, true), 200, content.left(split), {},
+              QNetworkReply::RemoteHostClosedError);
+    QCborArray headers;
+    headers.append(QCborArray {"Content-Range", QString("bytes %1-%2/%3").arg(split).arg(content.size() - 1).arg(content.size())});
+    trace.add(Trace::objectUrl("bucket-a", m_storagePath, true), 206, content.mid(split), headers);
+    QVERIFY(trace.replay(m_dir.filePath("range.trace")));
+
+    FirebaseStorage storage;
+    storage.setStorageBucket("bucket-a");
+    QSignalSpy progress(&storage, &FirebaseStorage::downloadProgress);
+    QSignalSpy finished(&storage, &FirebaseStorage::downloadFinished);
+    QSignalSpy errors(&storage, &FirebaseStorage::errorOcurred);
+
+    storage.download(m_storagePath, QString());
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+    QVERIFY(errors.isEmpty());
+    QCOMPARE(readAll(finished.last().at(1).toString()), content);
+    QCOMPARE(progress.last().at(1).toLongLong(), qint64(content.size()));
+}
+
+QTEST_GUILESS_MAIN(tst_Storage)
+
+#include "tst_storage.moc"
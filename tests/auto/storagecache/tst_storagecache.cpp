@@ -0,0 +1,152 @@
+#include <QtTest>
+#include "firebase/firebasestoragecache.h"
+
+class tst_StorageCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void insertAndFind();
+    void namesAreExact();
+    void temporaryFilesAreUnique();
+    void evictsLeastRecentlyUsed();
+    void indexSurvivesRestart();
+    void partialFilesAreDropped();
+
+private:
+    QString download(FirebaseStorageCache &cache, const QString &key, const QByteArray &content);
+
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+void tst_StorageCache::init()
+{
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+}
+
+// A finished transfer waiting in its partial file
+QString tst_StorageCache::download(FirebaseStorageCache &cache, const QString &key, const QByteArray &content)
+{
+    const QString fileName = cache.temporaryFile(key);
+    QFile file(fileName);
+    if(file.open(QIODevice::WriteOnly))
+        file.write(content);
+    return fileName;
+}
+
+void tst_StorageCache::insertAndFind()
+{
+    FirebaseStorageCache cache;
+    cache.setDirectory(m_dir->path());
+
+    const QString partial = download(cache, "k1", "first");
+    const QString stored = cache.insert("gs://bucket/a.txt", "3", "k1", partial);
+    QCOMPARE(stored, m_dir->filePath("k1"));
+    QVERIFY(!QFile::exists(partial));
+    QCOMPARE(cache.size(), qint64(5));
+
+    QString generation;
+    qint64 validatedAt = 0;
+    QCOMPARE(cache.find("gs://bucket/a.txt", &generation, &validatedAt), stored);
+    QCOMPARE(generation, QString("3"));
+    QVERIFY(qAbs(validatedAt - QDateTime::currentSecsSinceEpoch()) <= 1);
+
+    // Another path with the same content shares the file
+    cache.link("gs://bucket/b.txt", "1", "k1");
+    QCOMPARE(cache.find("gs://bucket/b.txt"), stored);
+    QCOMPARE(cache.findContent("k1"), stored);
+
+    cache.remove("gs://bucket/a.txt");
+    QVERIFY(cache.find("gs://bucket/a.txt").isEmpty());
+    QCOMPARE(cache.find("gs://bucket/b.txt"), stored);
+}
+
+void tst_StorageCache::namesAreExact()
+{
+    FirebaseStorageCache cache;
+    cache.setDirectory(m_dir->path());
+    cache.insert("gs://bucket-a/a.txt", "1", "k1", download(cache, "k1", "a"));
+
+    QVERIFY(cache.find("gs://bucket-b/a.txt").isEmpty());
+    QVERIFY(cache.find("a.txt").isEmpty());
+}
+
+void tst_StorageCache::temporaryFilesAreUnique()
+{
+    FirebaseStorageCache cache;
+    cache.setDirectory(m_dir->path());
+
+    const QString first = cache.temporaryFile("k1");
+    const QString second = cache.temporaryFile("k1");
+    QVERIFY(first != second);
+    QCOMPARE(QFileInfo(first).absolutePath(), QFileInfo(second).absolutePath());
+}
+
+void tst_StorageCache::evictsLeastRecentlyUsed()
+{
+    FirebaseStorageCache cache;
+    cache.setDirectory(m_dir->path());
+    cache.setMaxSize(250);
+
+    const QByteArray content(100, 'x');
+    cache.insert("gs://bucket/1", "1", "k1", download(cache, "k1", content));
+    QTest::qWait(5);
+    cache.insert("gs://bucket/2", "1", "k2", download(cache, "k2", content));
+    QTest::qWait(5);
+
+    // Reading the first one makes the second the least recently used
+    QVERIFY(!cache.find("gs://bucket/1").isEmpty());
+    QTest::qWait(5);
+    cache.insert("gs://bucket/3", "1", "k3", download(cache, "k3", content));
+
+    QCOMPARE(cache.size(), qint64(200));
+    QVERIFY(!cache.find("gs://bucket/1").isEmpty());
+    QVERIFY(cache.find("gs://bucket/2").isEmpty());
+    QVERIFY(!QFile::exists(m_dir->filePath("k2")));
+    QVERIFY(!cache.find("gs://bucket/3").isEmpty());
+
+    // Shrinking evicts right away, but never more than needed
+    cache.setMaxSize(100);
+    QCOMPARE(cache.size(), qint64(100));
+    QVERIFY(cache.find("gs://bucket/1").isEmpty());
+    QVERIFY(!cache.find("gs://bucket/3").isEmpty());
+}
+
+void tst_StorageCache::indexSurvivesRestart()
+{
+    {
+        FirebaseStorageCache cache;
+        cache.setDirectory(m_dir->path());
+        cache.insert("gs://bucket/a.txt", "5", "k1", download(cache, "k1", "content"));
+    }
+
+    FirebaseStorageCache cache;
+    cache.setDirectory(m_dir->path());
+    QString generation;
+    QCOMPARE(cache.find("gs://bucket/a.txt", &generation), m_dir->filePath("k1"));
+    QCOMPARE(generation, QString("5"));
+    QCOMPARE(cache.size(), qint64(7));
+}
+
+void tst_StorageCache::partialFilesAreDropped()
+{
+    QString partial;
+    {
+        FirebaseStorageCache cache;
+        cache.setDirectory(m_dir->path());
+        partial = download(cache, "k1", "half");
+    }
+    QVERIFY(QFile::exists(partial));
+
+    // Transfers of a previous run cannot be trusted
+    FirebaseStorageCache cache;
+    cache.setDirectory(m_dir->path());
+    QVERIFY(cache.find("gs://bucket/a.txt").isEmpty());
+    QVERIFY(!QFile::exists(partial));
+}
+
+QTEST_GUILESS_MAIN(tst_StorageCache)
+
+#include "tst_storagecache.moc"
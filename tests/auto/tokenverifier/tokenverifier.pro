@@ -0,0 +1,9 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase console
+CONFIG -= app_bundle
+TARGET = tst_tokenverifier
+
+include(../../../QmlFirebaseCore.pri)
+
+SOURCES += tst_tokenverifier.cpp
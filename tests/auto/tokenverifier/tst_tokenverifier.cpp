@@ -0,0 +1,204 @@
+#include <QtTest>
+#include "firebase/firebasetokenverifier.h"
+#include "utils/JwtUtils.h"
+
+namespace {
+
+/*
+    Known answers: tokens of the project qmlfirebase-test signed with a throwaway 2048 bit RSA key (e = 65537) whose public half
+    is below. Every token is validly signed unless the test tampers with it; they differ only in the claim named after them.
+*/
+const char projectId[] = "qmlfirebase-test";
+const char keyId[] = "test-key";
+
+const char modulus[] =
+    "3RXJOZVMecY45M7QjhU-dqFHHzhbe2F-oanCpsST7AWIxU8u5xyFESp6gvj_KN0ou6g9BKp9GhgfyIEkEbHHmH33rsEfCHSAdzRE"
+    "9HSSs5Z3sWdGykUxmiaOvvmHbdtbEzkeUTh6Nib3q1Oj_9Dwwm_rSxCx3vT9bSC-Q2LwBnOxzdberHnj77bemFnihURzWj96tgpQ"
+    "RALxSzZR7p17DhEvNPl2Uqucvtwp8vwTJBy62XjbEB0i4qTmHNOxd5_eOzPT00lFLOe94TYdnSf5PmE7CHENjrdE1Wl94-6o6pOq"
+    "BlBjCBV-PIC3xd2aZKXdguuhT0LUy-1ZSW9D18Dk2Q";
+
+const char validToken[] =
+    "eyJhbGciOiJSUzI1NiIsImtpZCI6InRlc3Qta2V5IiwidHlwIjoiSldUIn0.eyJpc3MiOiJodHRwczovL3NlY3VyZXRva2VuLmdv"
+    "b2dsZS5jb20vcW1sZmlyZWJhc2UtdGVzdCIsImF1ZCI6InFtbGZpcmViYXNlLXRlc3QiLCJhdXRoX3RpbWUiOjE3MDAwMDAwMDAs"
+    "InVzZXJfaWQiOiJhbGljZSIsInN1YiI6ImFsaWNlIiwiaWF0IjoxNzAwMDAwMDAwLCJleHAiOjQxMDI0NDQ4MDB9.gFoBSgMsG3Q"
+    "kZDWyiM02VH-J6wtSP1SnptreUa8QuYwFWkDQQtb2TruTav0fb4BT4nuz4ikO10IOcttSVkMSsrQSAdbNrBObMPGVU4eNr3Rur4T"
+    "SqSo2aYjmXWpF7VD8uPYY4B9KKX4RnAmvHJYShL8wvSuzG3EEcz-Gur2NpTCmy_gRQn7KlMdO80YDeWZSNCpcIMoSew4BnbxgSAQ"
+    "8kMjoFJzh7Ksb2BDo8MRa522VqydXoiL_SrkVa7BA8A_K-6PBv4Ys24g5CzSIgvY8_bag603lL5PA41zyMNhgaQzAiK_ioOjmNK6"
+    "PUL6ZdtZtFf262HeUCtmL8FdvH_ewgg";
+
+const char wrongAudienceToken[] =
+    "eyJhbGciOiJSUzI1NiIsImtpZCI6InRlc3Qta2V5IiwidHlwIjoiSldUIn0.eyJpc3MiOiJodHRwczovL3NlY3VyZXRva2VuLmdv"
+    "b2dsZS5jb20vcW1sZmlyZWJhc2UtdGVzdCIsImF1ZCI6Im90aGVyLXByb2plY3QiLCJhdXRoX3RpbWUiOjE3MDAwMDAwMDAsInVz"
+    "ZXJfaWQiOiJhbGljZSIsInN1YiI6ImFsaWNlIiwiaWF0IjoxNzAwMDAwMDAwLCJleHAiOjQxMDI0NDQ4MDB9.NJrQ0LMNbi75UID"
+    "SXhfYPInEguvv5QxpCgjrCigbI6EBh6XhLIPIreL7kq05bFniBNSrCgbK2xvBWFI7-fbKJf2roXUTeYRRff3pXln2Op-LWmZEQyN"
+    "xoWfurk-b-s7-GJzHH9bfGoNmEAwtyfSJP-_gMc6mt2aFVQ24c-tv39x4YYZCEPC3GwGP4Mm2-rbr7pvO37PqOx2_92Bax9sFZEi"
+    "EhwfOor9pwIoDRw5-6B_syqMMRk8yiwMi_9cOYQuoUdv0k4LrYdDmHlIuFNSgwwOOpUoSrj7s0EP3ENat6Ce0csPA6KQUF6APDzz"
+    "_NdlsWGfplAf4DCxshJWUXp5V6A";
+
+const char wrongIssuerToken[] =
+    "eyJhbGciOiJSUzI1NiIsImtpZCI6InRlc3Qta2V5IiwidHlwIjoiSldUIn0.eyJpc3MiOiJodHRwczovL3NlY3VyZXRva2VuLmdv"
+    "b2dsZS5jb20vb3RoZXItcHJvamVjdCIsImF1ZCI6InFtbGZpcmViYXNlLXRlc3QiLCJhdXRoX3RpbWUiOjE3MDAwMDAwMDAsInVz"
+    "ZXJfaWQiOiJhbGljZSIsInN1YiI6ImFsaWNlIiwiaWF0IjoxNzAwMDAwMDAwLCJleHAiOjQxMDI0NDQ4MDB9.woqDxFi4vBP8Ne2"
+    "OdWzITwx7XFRnT104f3NDuKMhaJkYm-TDDnhTWnZpTKRT_y22Lh6iQP5RR5eVilKLgM390UGTLm5g-Sgc4yUIFNRaGUIqnGKeslP"
+    "8vqSuG0Rw0NKHT7fSE4FK1LRcwzv5uxZRMLe0-_Z8Ltb7fGZ7sZ6wjWTw26S1mTx2Pi8PDamW33cJt6n-bNZyaqofGxuCBwZv2EA"
+    "TXd1OmTPkMmfk1HWqan4Om5mnpDPWhUt4wCtsbeT7TQM4H4CYUsYJjz3UQcGyFf16AqcavvycTcFHPaBKD_cBnvgmrKpnovXcJP3"
+    "a-jSj_OmzRZmK4R98Hd959n5_Jw";
+
+const char expiredToken[] =
+    "eyJhbGciOiJSUzI1NiIsImtpZCI6InRlc3Qta2V5IiwidHlwIjoiSldUIn0.eyJpc3MiOiJodHRwczovL3NlY3VyZXRva2VuLmdv"
+    "b2dsZS5jb20vcW1sZmlyZWJhc2UtdGVzdCIsImF1ZCI6InFtbGZpcmViYXNlLXRlc3QiLCJhdXRoX3RpbWUiOjE3MDAwMDAwMDAs"
+    "InVzZXJfaWQiOiJhbGljZSIsInN1YiI6ImFsaWNlIiwiaWF0IjoxNzAwMDAwMDAwLCJleHAiOjE3MDAwMDM2MDB9.wUORC6jo20n"
+    "RcrJvbjRspSdQXvkWZ3y-EzP34FEIPXoNz1ewngoAqS7pg7ZNBraj1_eKBqWCluRx1YFFqmPkbOcthJC6QkO29Hbj9jmp-D5SOvw"
+    "n3JcqfqakyNhK5NtD-unuYIl2p3QQvtdXsDAtLEYtCL2g-zuN32hcIvcom3kWF4PyPwFtVzhoj4cSIuZHR_qbxnhelMaP5piBb6q"
+    "fcpqB_9M8g1mojgsUiqcF86JKdScujD9_-MmurDcA5MZMUZrqRJSF8xhUrBM-dn3ObaUUMgiwPeYrYaUEFTA6fuA_ECKYqCzkKl6"
+    "RXl6pZH8fAY8bZ1W7Mx_nNajrIYiMcg";
+
+const char issuedInFutureToken[] =
+    "eyJhbGciOiJSUzI1NiIsImtpZCI6InRlc3Qta2V5IiwidHlwIjoiSldUIn0.eyJpc3MiOiJodHRwczovL3NlY3VyZXRva2VuLmdv"
+    "b2dsZS5jb20vcW1sZmlyZWJhc2UtdGVzdCIsImF1ZCI6InFtbGZpcmViYXNlLXRlc3QiLCJhdXRoX3RpbWUiOjE3MDAwMDAwMDAs"
+    "InVzZXJfaWQiOiJhbGljZSIsInN1YiI6ImFsaWNlIiwiaWF0Ijo0MTAyNDQxMjAwLCJleHAiOjQxMDI0NDQ4MDB9.gpLGKkhJA5p"
+    "4MeWEzgA84NjqHG_lqJ9c0SaiaA_kp6KrDrlDwB86NMsgReGrWHkZFNDQ4MAadPoALpAExb0b8wZal3tb2NlAaDgUJ_7QVwmLwZ5"
+    "w6xWW_uqa4Er823b_eT4D_PKkAZ_ISl_jKbEbxDXfLmMc4bSvkO0oQoog0k2KchxWFQ8kgPNMsk6p6gUjvrdIl77MYdrC9Cjwkxh"
+    "Ju3_Quc8EEqwhbbtLTSvlEg2GKDkQ0MHk2judEeA20q8iin88k7nN0bBKnZHyZvftZdJTE9FSZdURegET2OyBfmckDEGCBxrneab"
+    "EtVMjQnCVMyuVaAQJvex981oc1r2Wpg";
+
+const char otherAlgorithmToken[] =
+    "eyJhbGciOiJSUzUxMiIsImtpZCI6InRlc3Qta2V5IiwidHlwIjoiSldUIn0.eyJpc3MiOiJodHRwczovL3NlY3VyZXRva2VuLmdv"
+    "b2dsZS5jb20vcW1sZmlyZWJhc2UtdGVzdCIsImF1ZCI6InFtbGZpcmViYXNlLXRlc3QiLCJhdXRoX3RpbWUiOjE3MDAwMDAwMDAs"
+    "InVzZXJfaWQiOiJhbGljZSIsInN1YiI6ImFsaWNlIiwiaWF0IjoxNzAwMDAwMDAwLCJleHAiOjQxMDI0NDQ4MDB9.s3k4Mf2Ky6g"
+    "QF0NkD_NdwrzNGfcCszoq1jDgx1ir8zSGja9sGCGTZ3JCJLgJAG_NmnANE23ZBmtx3sn8pU_j2nriQHzmmTg4YuErEJizTU6DWr3"
+    "s2zKePZjK6mLicUPRRt9niGV9St1s_FkGEvD4zDytO_KfgnMxQ3qqqcbXLooTbwJvlAbTzvizq71c7UyCeDI_gCRaIkpzi44xGno"
+    "cQf7KShcK-tFGHGj-zkrGKH1KM_xEWao675lqqp2C8mPG3ASTKq4tPrPA-GQp7jqe5Cz0p0sHZq6UfhS80EbKwD8TFCxOOMK3tjS"
+    "AY8CF-MaG8H-DHP1vU9_fXpI4N6FAlQ";
+
+const char unknownKeyToken[] =
+    "eyJhbGciOiJSUzI1NiIsImtpZCI6InJvdGF0ZWQta2V5IiwidHlwIjoiSldUIn0.eyJpc3MiOiJodHRwczovL3NlY3VyZXRva2Vu"
+    "Lmdvb2dsZS5jb20vcW1sZmlyZWJhc2UtdGVzdCIsImF1ZCI6InFtbGZpcmViYXNlLXRlc3QiLCJhdXRoX3RpbWUiOjE3MDAwMDAw"
+    "MDAsInVzZXJfaWQiOiJhbGljZSIsInN1YiI6ImFsaWNlIiwiaWF0IjoxNzAwMDAwMDAwLCJleHAiOjQxMDI0NDQ4MDB9.ki3uwhx"
+    "-mc1-XvxMpw3p4iVkAt8ieoSqOSqJCuCVxoJaFpKcDW01HZaUzflCFl8zxN7J9_WkJIqgmGoUouSQD61IqywkG6RGlsXg9NZ0EIE"
+    "iBtIqaYmSTD9Ug-SsEg5pV_RQ9VS2UAHSugrtmi9ton0qonJ7c6g7EfrX0X_ACsltEV71ww1v2YZGrM06dz4xV-ax0Q1QkkGYky_"
+    "a9DG-uhS7_D57Yx2dCxoLrDQKkQUUBFa6WLhTeJkrlSY3OGOw8_fv94QfJvd_uY8YMISwoIO2V6w5VLKuMCbzCBxsmL2XJ51lrFt"
+    "9VaLSArflgfCAPggaTXZS4gLL2ljpwyl7vg";
+
+}
+
+class tst_TokenVerifier : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void knownAnswers_data();
+    void knownAnswers();
+    void unknownKey();
+
+private:
+    static QString replaceSegment(const QString &token, int index, const QByteArray &segment);
+
+    QTemporaryDir m_dir;
+};
+
+void tst_TokenVerifier::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    // The verifier reads keys from its cache file before downloading them, so no network access is needed
+    const QJsonObject key {{"kty", "RSA"}, {"alg", "RS256"}, {"kid", keyId}, {"n", modulus}, {"e", "AQAB"}};
+    const QJsonObject root {
+        {"expires", static_cast<double>(QDateTime::currentSecsSinceEpoch() + 3600)},
+        {"jwks", QJsonObject {{"keys", QJsonArray {key}}}}
+    };
+
+    QFile file(m_dir.filePath("keys.json"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+}
+
+QString tst_TokenVerifier::replaceSegment(const QString &token, int index, const QByteArray &segment)
+{
+    QStringList parts = token.split('.');
+    parts[index] = QString::fromLatin1(segment);
+    return parts.join('.');
+}
+
+void tst_TokenVerifier::knownAnswers_data()
+{
+    QTest::addColumn<QString>("token");
+    QTest::addColumn<QString>("project");
+    QTest::addColumn<QString>("error");
+
+    const QString project = QString::fromLatin1(projectId);
+    const QString valid = QString::fromLatin1(validToken);
+
+    // Same header and signature, the payload names another user
+    QJsonObject claims = JwtUtils::payload(valid);
+    claims["sub"] = "mallory";
+    claims["user_id"] = "mallory";
+    const QString tamperedPayload = replaceSegment(valid, 1, QJsonDocument(claims).toJson(QJsonDocument::Compact)
+                                                   .toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+
+    // One bit of the signature flipped
+    QByteArray signature = JwtUtils::decodeBase64Url(valid.section('.', 2).toLatin1());
+    signature[signature.size() / 2] = signature.at(signature.size() / 2) ^ 0x01;
+    const QString tamperedSignature = replaceSegment(valid, 2, signature.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+
+    const QString malformed = replaceSegment(valid, 1, valid.section('.', 1, 1).toLatin1().insert(10, '*'));
+
+    QTest::newRow("valid") << valid << project << QString();
+    QTest::newRow("tampered payload") << tamperedPayload << project << QString("ID token signature is invalid");
+    QTest::newRow("tampered signature") << tamperedSignature << project << QString("ID token signature is invalid");
+    QTest::newRow("wrong aud") << QString(wrongAudienceToken) << project << QString("ID token was issued for another project");
+    QTest::newRow("wrong iss") << QString(wrongIssuerToken) << project << QString("ID token was issued for another project");
+    QTest::newRow("other project") << valid << QString("other-project") << QString("ID token was issued for another project");
+    QTest::newRow("no project") << valid << QString() << QString("No project id to check the ID token audience against");
+    QTest::newRow("expired exp") << QString(expiredToken) << project << QString("ID token has expired");
+    QTest::newRow("future iat") << QString(issuedInFutureToken) << project << QString("ID token was issued in the future");
+    QTest::newRow("alg RS512") << QString(otherAlgorithmToken) << project << QString("Unexpected ID token algorithm");
+    QTest::newRow("malformed base64url") << malformed << project << QString("Malformed ID token");
+    QTest::newRow("two segments") << valid.section('.', 0, 1) << project << QString("Malformed ID token");
+}
+
+void tst_TokenVerifier::knownAnswers()
+{
+    QFETCH(QString, token);
+    QFETCH(QString, project);
+    QFETCH(QString, error);
+
+    FirebaseTokenVerifier verifier;
+    verifier.setCacheFile(m_dir.filePath("keys.json"));
+
+    // Tokens signed with a cached key are checked right away
+    bool called = false;
+    bool result = false;
+    QString reason;
+    verifier.verify(token, project, this, [&](bool valid, const QString &message) {
+        called = true;
+        result = valid;
+        reason = message;
+    });
+
+    QVERIFY(called);
+    QCOMPARE(reason, error);
+    QCOMPARE(result, error.isEmpty());
+}
+
+// An unknown key id makes the verifier download the keys again, the token is rejected whatever the download brings
+void tst_TokenVerifier::unknownKey()
+{
+    FirebaseTokenVerifier verifier;
+    verifier.setCacheFile(m_dir.filePath("keys.json"));
+
+    bool called = false;
+    bool result = true;
+    verifier.verify(unknownKeyToken, projectId, this, [&](bool valid, const QString &) {
+        called = true;
+        result = valid;
+    });
+
+    QTRY_VERIFY_WITH_TIMEOUT(called, 30000);
+    QVERIFY(!result);
+}
+
+QTEST_GUILESS_MAIN(tst_TokenVerifier)
+
+#include "tst_tokenverifier.moc"
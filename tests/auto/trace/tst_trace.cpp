@@ -0,0 +1,90 @@
+#include <QtTest>
+#include "firebase/firebasetrace.h"
+#include "utils/AuthUtils.h"
+
+class tst_Trace : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void redactBody_data();
+    void redactBody();
+    void redactBinaryBody();
+    void redactUrl();
+    void redactTokensUsesSecretFields();
+    void redactTokensNested();
+};
+
+void tst_Trace::redactBody_data()
+{
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<QByteArray>("redacted");
+
+    QTest::newRow("json") << QByteArray("{\"email\":\"a@b.c\",\"password\":\"hunter2\",\"returnSecureToken\":true}")
+                          << QByteArray("{\"email\":\"a@b.c\",\"password\":\"REDACTED\",\"returnSecureToken\":true}");
+    QTest::newRow("json escapes") << QByteArray("{\"newPassword\" : \"a\\\"b\",\"oauthIdToken\":\"x\"}")
+                                  << QByteArray("{\"newPassword\" : \"REDACTED\",\"oauthIdToken\":\"REDACTED\"}");
+    QTest::newRow("form") << QByteArray("grant_type=refresh_token&refresh_token=AOEOulZ%3D")
+                          << QByteArray("grant_type=refresh_token&refresh_token=REDACTED");
+    QTest::newRow("form first") << QByteArray("idToken=eyJ&requestUri=http%3A%2F%2Flocalhost")
+                                << QByteArray("idToken=REDACTED&requestUri=http%3A%2F%2Flocalhost");
+    QTest::newRow("event stream") << QByteArray("event: put\ndata: {\"path\":\"/\",\"data\":{\"token\":\"t\",\"q\":\"a=b\"}}\n\n")
+                                  << QByteArray("event: put\ndata: {\"path\":\"/\",\"data\":{\"token\":\"REDACTED\",\"q\":\"a=b\"}}\n\n");
+    QTest::newRow("nothing secret") << QByteArray("{\"name\":\"value\"}") << QByteArray("{\"name\":\"value\"}");
+}
+
+void tst_Trace::redactBody()
+{
+    QFETCH(QByteArray, body);
+    QFETCH(QByteArray, redacted);
+
+    QCOMPARE(FirebaseTraceManager::redact(body), redacted);
+}
+
+void tst_Trace::redactBinaryBody()
+{
+    const QByteArray binary("\xff\xfe{\"idToken\":\"x\"}", 17);
+    QCOMPARE(FirebaseTraceManager::redact(binary), binary);
+}
+
+void tst_Trace::redactUrl()
+{
+    const QString redacted = FirebaseTraceManager::redact(QUrl("https://db.example.com/a.json?auth=SECRET&print=silent&key=API"));
+
+    QVERIFY(!redacted.contains("SECRET"));
+    QVERIFY(!redacted.contains("API"));
+    QVERIFY(redacted.contains("auth=REDACTED"));
+    QVERIFY(redacted.contains("key=REDACTED"));
+    QVERIFY(redacted.contains("print=silent"));
+}
+
+// Logs and traces hide the same fields
+void tst_Trace::redactTokensUsesSecretFields()
+{
+    QJsonObject response {{"email", "a@b.c"}};
+    for(const QString &field : AuthUtils::secretFields)
+        response[field] = "secret";
+
+    const QJsonObject redacted = AuthUtils::redactTokens(response);
+    QCOMPARE(redacted["email"].toString(), QString("a@b.c"));
+    for(const QString &field : AuthUtils::secretFields)
+        QVERIFY2(redacted[field].toString() != "secret", qPrintable(field));
+}
+
+// Account lookups carry credentials below users[] and providerUserInfo[]
+void tst_Trace::redactTokensNested()
+{
+    const QJsonObject response = QJsonDocument::fromJson(
+                "{\"users\":[{\"localId\":\"alice\",\"passwordHash\":\"x\",\"providerUserInfo\":"
+                "[{\"providerId\":\"google.com\",\"oauthAccessToken\":\"secret\",\"idToken\":\"secret\"}]}],"
+                "\"refreshToken\":\"secret\"}").object();
+
+    const QByteArray redacted = QJsonDocument(AuthUtils::redactTokens(response)).toJson(QJsonDocument::Compact);
+    QVERIFY2(!redacted.contains("secret"), redacted.constData());
+    QVERIFY(redacted.contains("\"localId\":\"alice\""));
+    QVERIFY(redacted.contains("\"providerId\":\"google.com\""));
+}
+
+QTEST_GUILESS_MAIN(tst_Trace)
+
+#include "tst_trace.moc"
@@ -0,0 +1,253 @@
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "firebase/firebasetransport.h"
+
+/*
+    Answers every request on its own connection after a delay, counting the requests it holds at the same time. The
+    first requests are answered with the statuses queued in statuses, the rest with status. The body is sent in two
+    halves, the second one after another delay.
+*/
+class LocalServer : public QObject
+{
+public:
+    explicit LocalServer(int status = 200, int delay = 50) : m_status(status), m_delay(delay)
+    {
+        connect(&m_server, &QTcpServer::newConnection, this, &LocalServer::accept);
+        m_server.listen(QHostAddress::LocalHost);
+    }
+
+    QUrl url() const { return QUrl(QStringLiteral("http://127.0.0.1:%1/value.json").arg(m_server.serverPort())); }
+
+    QQueue<int> statuses;
+    QByteArray body = "{}";
+    int received = 0;
+    int active = 0;
+    int maxActive = 0;
+
+private:
+    void accept()
+    {
+        while(QTcpSocket *socket = m_server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() {
+                if(socket->property("answered").toBool())
+                    return;
+                QByteArray &request = m_requests[socket];
+                request += socket->readAll();
+                if(!request.contains("\r\n\r\n"))
+                    return;
+                socket->setProperty("answered", true);
+
+                ++received;
+                maxActive = qMax(maxActive, ++active);
+                const int status = statuses.isEmpty() ? m_status : statuses.dequeue();
+                QTimer::singleShot(m_delay, socket, [this, socket, status]() {
+                    --active;
+                    const int half = body.size() / 2;
+                    socket->write("HTTP/1.1 " + QByteArray::number(status) + " Status\r\nContent-Type: application/json\r\n"
+                                  "Content-Length: " + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body.left(half));
+                    QTimer::singleShot(m_delay, socket, [this, socket, half]() {
+                        socket->write(body.mid(half));
+                        socket->disconnectFromHost();
+                    });
+                });
+            });
+            connect(socket, &QTcpSocket::disconnected, socket, [this, socket]() {
+                m_requests.remove(socket);
+                socket->deleteLater();
+            });
+        }
+    }
+
+    QTcpServer m_server;
+    QHash<QTcpSocket *, QByteArray> m_requests;
+    int m_status;
+    int m_delay;
+};
+
+class tst_Transport : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void windowCapsRequestsInFlight();
+    void tokenBucketPacesRequests();
+    void throttlingHalvesLimits();
+    void cancelWhileQueued();
+    void serverErrorIsRetried();
+    void badRequestIsNotRetried();
+    void streamDeliversBodyAsItArrives();
+    void streamRetriedBeforeData();
+
+private:
+    quint64 get(FirebaseTransport &transport, const QUrl &url, FirebaseResponse *response = nullptr, int *finished = nullptr);
+};
+
+quint64 tst_Transport::get(FirebaseTransport &transport, const QUrl &url, FirebaseResponse *response, int *finished)
+{
+    return transport.send("GET", QNetworkRequest(url), QByteArray(), this, [response, finished](const FirebaseResponse &result) {
+        if(response)
+            *response = result;
+        if(finished)
+            ++*finished;
+    });
+}
+
+void tst_Transport::windowCapsRequestsInFlight()
+{
+    LocalServer server;
+    FirebaseTransport transport;
+    transport.setMaxConcurrency(2);
+
+    int finished = 0;
+    for(int i = 0; i < 6; ++i)
+        get(transport, server.url(), nullptr, &finished);
+
+    QTRY_COMPARE(finished, 6);
+    QCOMPARE(server.received, 6);
+    QCOMPARE(server.maxActive, 2);
+}
+
+void tst_Transport::tokenBucketPacesRequests()
+{
+    LocalServer server(200, 0);
+    FirebaseTransport transport;
+    transport.setRateLimit(10.0, 1);
+
+    // The first request takes the single token, each of the others waits about 100 ms for a new one
+    QElapsedTimer timer;
+    timer.start();
+    int finished = 0;
+    for(int i = 0; i < 4; ++i)
+        get(transport, server.url(), nullptr, &finished);
+
+    QTRY_COMPARE(finished, 4);
+    QVERIFY2(timer.elapsed() >= 250, qPrintable(QString::number(timer.elapsed())));
+}
+
+void tst_Transport::throttlingHalvesLimits()
+{
+    LocalServer server(429, 0);
+    FirebaseTransport transport;
+    transport.setMaxRetries(0);
+
+    FirebaseResponse response;
+    int finished = 0;
+    get(transport, server.url(), &response, &finished);
+    QTRY_COMPARE(finished, 1);
+    QCOMPARE(response.status, 429);
+    QVERIFY(response.error != FirebaseError::NoError);
+
+    const QVariantMap host = transport.connectionMetrics().value("127.0.0.1").toMap();
+    QCOMPARE(host["throttled"].toInt(), 1);
+    QCOMPARE(host["concurrencyLimit"].toDouble(), 4.0);
+    QCOMPARE(host["rateLimit"].toDouble(), 10.0);
+}
+
+void tst_Transport::cancelWhileQueued()
+{
+    LocalServer server;
+    FirebaseTransport transport;
+    transport.setMaxConcurrency(1);
+
+    FirebaseResponse first;
+    FirebaseResponse queued;
+    int finished = 0;
+    get(transport, server.url(), &first, &finished);
+    const quint64 id = get(transport, server.url(), &queued, &finished);
+    transport.cancel(id);
+
+    // The queued request never reaches the server
+    QTRY_COMPARE(finished, 2);
+    QCOMPARE(first.error, FirebaseError::NoError);
+    QCOMPARE(queued.error, FirebaseError::Cancelled);
+    QTest::qWait(100);
+    QCOMPARE(server.received, 1);
+}
+
+void tst_Transport::serverErrorIsRetried()
+{
+    LocalServer server(200, 0);
+    server.statuses.enqueue(503);
+    FirebaseTransport transport;
+
+    FirebaseResponse response;
+    int finished = 0;
+    get(transport, server.url(), &response, &finished);
+
+    QTRY_COMPARE(finished, 1);
+    QCOMPARE(response.error, FirebaseError::NoError);
+    QCOMPARE(response.attempts, 2);
+    QCOMPARE(server.received, 2);
+}
+
+void tst_Transport::badRequestIsNotRetried()
+{
+    LocalServer server(400, 0);
+    FirebaseTransport transport;
+
+    FirebaseResponse response;
+    int finished = 0;
+    get(transport, server.url(), &response, &finished);
+
+    QTRY_COMPARE(finished, 1);
+    QCOMPARE(response.status, 400);
+    QCOMPARE(response.error, FirebaseError::BadRequest);
+    QCOMPARE(response.attempts, 1);
+    QTest::qWait(100);
+    QCOMPARE(server.received, 1);
+}
+
+void tst_Transport::streamDeliversBodyAsItArrives()
+{
+    LocalServer server;
+    server.body = "[{\"document\":1},{\"document\":2}]";
+    FirebaseTransport transport;
+
+    QByteArrayList pieces;
+    FirebaseResponse response;
+    int finished = 0;
+    transport.stream("POST", QNetworkRequest(server.url()), "{}", this, [&pieces](const FirebaseResponse &head, const QByteArray &data) {
+        QCOMPARE(head.status, 200);
+        pieces.append(data);
+    }, [&response, &finished](const FirebaseResponse &result) {
+        response = result;
+        ++finished;
+    });
+
+    // The first half is handed over before the second one is sent, nothing is left for the final response
+    QTRY_COMPARE(finished, 1);
+    QCOMPARE(response.error, FirebaseError::NoError);
+    QVERIFY(response.body.isEmpty());
+    QVERIFY(pieces.size() >= 2);
+    QCOMPARE(pieces.join(), server.body);
+}
+
+void tst_Transport::streamRetriedBeforeData()
+{
+    LocalServer server(200, 0);
+    server.statuses.enqueue(503);
+    server.body = "[{\"document\":1}]";
+    FirebaseTransport transport;
+
+    QByteArray received;
+    FirebaseResponse response;
+    int finished = 0;
+    transport.stream("POST", QNetworkRequest(server.url()), "{}", this, [&received](const FirebaseResponse &, const QByteArray &data) {
+        received += data;
+    }, [&response, &finished](const FirebaseResponse &result) {
+        response = result;
+        ++finished;
+    });
+
+    // The error body of the 503 never reaches the receiver
+    QTRY_COMPARE(finished, 1);
+    QCOMPARE(response.error, FirebaseError::NoError);
+    QCOMPARE(response.attempts, 2);
+    QCOMPARE(server.received, 2);
+    QCOMPARE(received, server.body);
+}
+
+QTEST_GUILESS_MAIN(tst_Transport)
+
+#include "tst_transport.moc"
@@ -0,0 +1,213 @@
+#include <QtTest>
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "firebase/firebasetrace.h"
+#include "firebase/firebasetransport.h"
+#include "firebase/firebaseusercache.h"
+#include "utils/AuthUtils.h"
+
+// Answers of the user lookup endpoint, replayed in the order they were added
+class LookupTrace
+{
+public:
+    void add(const QStringList &userIds, const QString &name)
+    {
+        QJsonArray users;
+        for(const QString &userId : userIds)
+            users.append(QJsonObject {{"localId", userId}, {"displayName", name}});
+
+        const qint64 id = ++m_exchanges;
+        append({{"id", id}, {"k", "request"}, {"verb", "POST"}, {"url", FirebaseTraceManager::redact(QUrl(AuthUtils::endpoint_lookupUsers))}});
+        append({{"id", id}, {"k", "response"}, {"status", 200}, {"headers", QCborArray()}});
+        append({{"id", id}, {"k", "data"}, {"data", QJsonDocument(QJsonObject {{"users", users}}).toJson(QJsonDocument::Compact)}});
+        append({{"id", id}, {"k", "finished"}, {"error", 0}, {"message", QString()}});
+    }
+
+    bool replay(const QString &fileName) const
+    {
+        QFile file(fileName);
+        if(!file.open(QIODevice::WriteOnly) || file.write(m_data) != m_data.size())
+            return false;
+        file.close();
+        return FirebaseTransport::shared()->startReplay(fileName, 0.0);
+    }
+
+private:
+    void append(QCborMap entry)
+    {
+        entry.insert(QStringLiteral("t"), 0);
+        m_data += QCborValue(entry).toCbor();
+    }
+
+    QByteArray m_data;
+    qint64 m_exchanges = 0;
+};
+
+class tst_UserCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void lookupsAreBatched();
+    void largeBatchesAreSplit();
+    void freshProfilesAreNotFetched();
+    void expiredProfilesAreRefreshed();
+    void diskEvictsLeastRecentlyUsed();
+
+private:
+    static QStringList userIds(int first, int count);
+    void setUp(FirebaseUserCache &cache);
+
+    QTemporaryDir m_dir;
+};
+
+QStringList tst_UserCache::userIds(int first, int count)
+{
+    QStringList result;
+    for(int i = first; i < first + count; ++i)
+        result.append("user-" + QString::number(i));
+    return result;
+}
+
+void tst_UserCache::setUp(FirebaseUserCache &cache)
+{
+    cache.setProjectId("qmlfirebase-test");
+    cache.setAccessToken("test-token");
+}
+
+void tst_UserCache::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_dir.isValid());
+}
+
+// Every test starts without stored profiles
+void tst_UserCache::init()
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QVERIFY(QDir(cacheDir + "/firebase/users").removeRecursively());
+}
+
+void tst_UserCache::cleanup()
+{
+    FirebaseTransport::shared()->stopReplay();
+}
+
+void tst_UserCache::lookupsAreBatched()
+{
+    // A second request would not be in the trace and fail
+    LookupTrace trace;
+    trace.add(userIds(0, 3), "batched");
+    QVERIFY(trace.replay(m_dir.filePath("batched.cbor")));
+
+    FirebaseUserCache cache;
+    setUp(cache);
+    QSignalSpy changed(&cache, &FirebaseUserCache::profileChanged);
+    QSignalSpy errors(&cache, &FirebaseUserCache::errorOcurred);
+
+    for(const QString &userId : userIds(0, 3))
+        QVERIFY(cache.profile(userId).isEmpty());
+
+    QTRY_COMPARE(changed.count(), 3);
+    QTest::qWait(50);
+    QCOMPARE(errors.count(), 0);
+    QCOMPARE(cache.profile("user-2").value("name").toString(), QString("batched"));
+}
+
+void tst_UserCache::largeBatchesAreSplit()
+{
+    // Each answer only knows the users of its own batch, the others would get an empty profile
+    LookupTrace trace;
+    trace.add(userIds(0, AuthUtils::maxUsersPerLookup), "first");
+    trace.add(userIds(AuthUtils::maxUsersPerLookup, 50), "second");
+    QVERIFY(trace.replay(m_dir.filePath("split.cbor")));
+
+    FirebaseUserCache cache;
+    setUp(cache);
+    QSignalSpy changed(&cache, &FirebaseUserCache::profileChanged);
+    QSignalSpy errors(&cache, &FirebaseUserCache::errorOcurred);
+
+    cache.prefetch(userIds(0, AuthUtils::maxUsersPerLookup + 50));
+
+    QTRY_COMPARE(changed.count(), AuthUtils::maxUsersPerLookup + 50);
+    QCOMPARE(errors.count(), 0);
+    QCOMPARE(cache.profile("user-0").value("name").toString(), QString("first"));
+    QCOMPARE(cache.profile("user-99").value("name").toString(), QString("first"));
+    QCOMPARE(cache.profile("user-100").value("name").toString(), QString("second"));
+    QCOMPARE(cache.profile("user-149").value("name").toString(), QString("second"));
+}
+
+void tst_UserCache::freshProfilesAreNotFetched()
+{
+    QVERIFY(LookupTrace().replay(m_dir.filePath("empty.cbor")));
+
+    FirebaseUserCache cache;
+    setUp(cache);
+    QSignalSpy errors(&cache, &FirebaseUserCache::errorOcurred);
+
+    cache.insert("user-0", QVariantMap {{"name", "inserted"}});
+    QCOMPARE(cache.profile("user-0").value("name").toString(), QString("inserted"));
+
+    QTest::qWait(50);
+    QCOMPARE(errors.count(), 0);
+}
+
+void tst_UserCache::expiredProfilesAreRefreshed()
+{
+    LookupTrace trace;
+    trace.add({"user-0"}, "fetched");
+    QVERIFY(trace.replay(m_dir.filePath("expired.cbor")));
+
+    FirebaseUserCache cache;
+    setUp(cache);
+    cache.setTimeToLive(0);
+    QSignalSpy changed(&cache, &FirebaseUserCache::profileChanged);
+    QSignalSpy errors(&cache, &FirebaseUserCache::errorOcurred);
+
+    cache.insert("user-0", QVariantMap {{"name", "inserted"}});
+    QCOMPARE(changed.count(), 1);
+    QTest::qWait(5);
+
+    // The expired profile is still returned while the new one is fetched
+    QCOMPARE(cache.profile("user-0").value("name").toString(), QString("inserted"));
+    QTRY_COMPARE(changed.count(), 2);
+
+    cache.setTimeToLive(3600);
+    QCOMPARE(cache.profile("user-0").value("name").toString(), QString("fetched"));
+    QCOMPARE(errors.count(), 0);
+}
+
+void tst_UserCache::diskEvictsLeastRecentlyUsed()
+{
+    // Without an access token nothing is fetched, profiles only come from insert() and the disk
+    FirebaseUserCache cache;
+    cache.setMaxProfiles(1);
+
+    const qint64 profileSize = QJsonDocument(QJsonObject {{"name", "user-0"}}).toJson(QJsonDocument::Compact).size();
+    cache.setMaxDiskSize(2 * profileSize + profileSize / 2);
+
+    cache.insert("user-0", QVariantMap {{"name", "user-0"}});
+    QTest::qWait(5);
+    cache.insert("user-1", QVariantMap {{"name", "user-1"}});
+    QTest::qWait(5);
+
+    // Reading user-0 back from disk makes user-1 the least recently used one
+    QCOMPARE(cache.profile("user-0").value("name").toString(), QString("user-0"));
+    QTest::qWait(5);
+    cache.insert("user-2", QVariantMap {{"name", "user-2"}});
+
+    QCOMPARE(cache.profile("user-1"), QVariantMap());
+    QCOMPARE(cache.profile("user-0").value("name").toString(), QString("user-0"));
+    QCOMPARE(cache.profile("user-2").value("name").toString(), QString("user-2"));
+}
+
+QTEST_GUILESS_MAIN(tst_UserCache)
+
+#include "tst_usercache.moc"
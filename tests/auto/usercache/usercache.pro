@@ -0,0 +1,8 @@
+QT += testlib
+CONFIG += testcase console
+CONFIG -= app_bundle
+TARGET = tst_usercache
+
+include(../../../QmlFirebase.pri)
+
+SOURCES += tst_usercache.cpp
@@ -0,0 +1,10 @@
+# Cost of applying one auth response to FirebaseUser, before and after the table-driven dispatcher
+QT += testlib
+QT -= gui
+CONFIG += testcase console
+CONFIG -= app_bundle
+TARGET = tst_bench_authreply
+
+include(../../../QmlFirebaseCore.pri)
+
+SOURCES += tst_bench_authreply.cpp
@@ -0,0 +1,89 @@
+#include <QtTest>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "firebase/firebaseauth.h"
+#include "firebase/firebaseuser.h"
+#include "utils/AuthUtils.h"
+
+/*
+    Per-reply cost of handling a signIn response. "perMethodLambda" is what every FirebaseAuth method used to do:
+    pretty-print the whole response through qDebug() and copy the fields by hand. "tableDriven" calls
+    FirebaseAuth::handleReply() itself: the disabled logging category and AuthUtils::applyFields(). Messages are dropped
+    by a message handler, so only building them is measured, not writing them to the terminal.
+*/
+class tst_BenchAuthReply : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void perMethodLambda();
+    void tableDriven();
+
+private:
+    QByteArray m_response;
+    QtMessageHandler m_previousHandler = nullptr;
+};
+
+static void dropMessage(QtMsgType, const QMessageLogContext &, const QString &)
+{
+}
+
+void tst_BenchAuthReply::initTestCase()
+{
+    // Shape and size of a real signInWithPassword response, the ID token is about 900 bytes
+    QJsonObject response;
+    response["kind"] = "identitytoolkit#VerifyPasswordResponse";
+    response["localId"] = "ZY1rJK0eYLg9mS3Sx8ZgVQ2xWbL2";
+    response["email"] = "alice@example.com";
+    response["displayName"] = "";
+    response["idToken"] = QString(900, QLatin1Char('a'));
+    response["registered"] = true;
+    response["refreshToken"] = QString(220, QLatin1Char('r'));
+    response["expiresIn"] = "3600";
+    m_response = QJsonDocument(response).toJson(QJsonDocument::Compact);
+
+    m_previousHandler = qInstallMessageHandler(dropMessage);
+}
+
+void tst_BenchAuthReply::cleanupTestCase()
+{
+    qInstallMessageHandler(m_previousHandler);
+}
+
+void tst_BenchAuthReply::perMethodLambda()
+{
+    FirebaseUser user;
+
+    QBENCHMARK {
+        QJsonParseError err;
+        const QJsonDocument doc = QJsonDocument::fromJson(m_response, &err);
+        qDebug().noquote() << "\n RESPONSE: \n" << doc.toJson(QJsonDocument::Indented);
+
+        user.setEmail(doc["email"].toString());
+        user.setIdToken(doc["idToken"].toString());
+        user.setRefreshToken(doc["refreshToken"].toString());
+        user.setUserId(doc["localId"].toString());
+    }
+
+    QCOMPARE(user.email(), QStringLiteral("alice@example.com"));
+}
+
+void tst_BenchAuthReply::tableDriven()
+{
+    FirebaseAuth auth;
+    FirebaseResponse response;
+    response.status = 200;
+    response.body = m_response;
+
+    QBENCHMARK {
+        auth.handleReply(AuthUtils::request_signIn, response);
+    }
+
+    QCOMPARE(auth.currentUser()->email(), QStringLiteral("alice@example.com"));
+}
+
+QTEST_GUILESS_MAIN(tst_BenchAuthReply)
+
+#include "tst_bench_authreply.moc"
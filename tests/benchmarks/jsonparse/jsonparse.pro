@@ -0,0 +1,10 @@
+# Parsing and reading database payloads with JsonUtils::Document compared to QJsonDocument
+QT += testlib
+QT -= gui
+CONFIG += testcase console
+CONFIG -= app_bundle
+TARGET = tst_bench_jsonparse
+
+INCLUDEPATH += ../../..
+
+SOURCES += tst_bench_jsonparse.cpp
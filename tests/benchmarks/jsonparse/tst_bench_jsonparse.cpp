@@ -0,0 +1,132 @@
+#include <QtTest>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "utils/JsonUtils.h"
+
+/*
+    Cost of the three things FirebaseDatabase does with a large snapshot: parsing it, reading one value deep inside it,
+    and converting all of it, e.g for FirebaseDataSnapshot::value(). Each is measured with QJsonDocument, which is what
+    payloads below JsonUtils::minTapeSize still use, and with JsonUtils::Document. The snapshots are shaped like a chat
+    room: messages keyed by push id, each a small object with a few strings, numbers and an escaped text.
+*/
+class tst_BenchJsonParse : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parse_data();
+    void parse();
+    void lookup_data();
+    void lookup();
+    void convert_data();
+    void convert();
+
+private:
+    static QByteArray snapshot(int messages);
+    void addSizes();
+};
+
+QByteArray tst_BenchJsonParse::snapshot(int messages)
+{
+    QJsonObject room;
+    for(int i = 0; i < messages; ++i) {
+        QJsonObject message;
+        message["author"] = QString("user%1").arg(i % 37);
+        message["sentAt"] = 1700000000000.0 + i * 1000;
+        message["text"] = QString("Message number %1 says \"hello\"\nand ends here").arg(i);
+        message["read"] = i % 3 == 0;
+        room[QString("-Nx%1").arg(i, 8, 10, QChar('0'))] = message;
+    }
+    return QJsonDocument(QJsonObject {{"messages", room}}).toJson(QJsonDocument::Compact);
+}
+
+void tst_BenchJsonParse::addSizes()
+{
+    QTest::addColumn<QByteArray>("json");
+    QTest::addColumn<bool>("tape");
+
+    for(const int messages : {500, 8000, 64000}) {
+        const QByteArray json = snapshot(messages);
+        const QByteArray size = QByteArray::number(json.size() / 1024) + " KiB";
+        QTest::newRow(("QJsonDocument " + size).constData()) << json << false;
+        QTest::newRow(("JsonUtils " + size).constData()) << json << true;
+    }
+}
+
+void tst_BenchJsonParse::parse_data()
+{
+    addSizes();
+}
+
+void tst_BenchJsonParse::parse()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(bool, tape);
+
+    if(tape) {
+        QBENCHMARK {
+            QVERIFY(JsonUtils::Document::parse(json));
+        }
+    } else {
+        QBENCHMARK {
+            QVERIFY(QJsonDocument::fromJson(json).isObject());
+        }
+    }
+}
+
+void tst_BenchJsonParse::lookup_data()
+{
+    addSizes();
+}
+
+// Parsing, then reading /messages/<last>/text, which is what a listener on a child location does with a root event
+void tst_BenchJsonParse::lookup()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(bool, tape);
+
+    const QString last = QJsonDocument::fromJson(json).object()["messages"].toObject().keys().constLast();
+    QString text;
+
+    if(tape) {
+        QBENCHMARK {
+            const QSharedPointer<const JsonUtils::Document> document = JsonUtils::Document::parse(json);
+            const int message = document->child(document->child(0, "messages"), last);
+            text = document->string(document->child(message, "text"));
+        }
+    } else {
+        QBENCHMARK {
+            text = QJsonDocument::fromJson(json).object()["messages"].toObject()[last].toObject()["text"].toString();
+        }
+    }
+
+    QVERIFY(text.startsWith("Message number"));
+}
+
+void tst_BenchJsonParse::convert_data()
+{
+    addSizes();
+}
+
+void tst_BenchJsonParse::convert()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(bool, tape);
+
+    QJsonValue value;
+    if(tape) {
+        QBENCHMARK {
+            value = JsonUtils::Document::parse(json)->toJsonValue(0);
+        }
+    } else {
+        QBENCHMARK {
+            value = QJsonDocument::fromJson(json).object();
+        }
+    }
+
+    QVERIFY(value.isObject());
+}
+
+QTEST_GUILESS_MAIN(tst_BenchJsonParse)
+
+#include "tst_bench_jsonparse.moc"
@@ -0,0 +1,12 @@
+# Round trip of an awaited request, from starting the task to the coroutine resuming from the event loop
+QT += testlib
+QT -= gui
+CONFIG += testcase console c++2a
+CONFIG -= app_bundle
+TARGET = tst_bench_taskawait
+
+gcc:!clang: QMAKE_CXXFLAGS += -fcoroutines
+
+include(../../../QmlFirebaseCore.pri)
+
+SOURCES += tst_bench_taskawait.cpp
@@ -0,0 +1,74 @@
+#include <QtTest>
+#include "firebase/firebasedatabase.h"
+#include "firebase/firebasememorybackend.h"
+#include "firebase/firebasetask.h"
+
+#ifdef FIREBASE_HAS_COROUTINES
+static FirebaseTask<void> awaitResponse(FirebaseTask<FirebaseResponse> task, bool *done)
+{
+    co_await task;
+    *done = true;
+}
+#endif
+
+/*
+    Overhead of the awaitable API per request. The memory backend answers without any network, so what is measured
+    is the awaiter itself: starting the request, the state kept while suspended and the queued resume. Requests with
+    a timeout and a cancellation token additionally arm a timer and subscribe to the token.
+*/
+class tst_BenchTaskAwait : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void roundTrip_data();
+    void roundTrip();
+
+private:
+    const QString m_url = QStringLiteral("memory://bench-task");
+};
+
+void tst_BenchTaskAwait::initTestCase()
+{
+#ifndef FIREBASE_HAS_COROUTINES
+    QSKIP("Built without C++20 coroutines");
+#endif
+    FirebaseMemoryBackend::instance()->request(m_url, "PUT", "/.json", "{\"topic\":\"hi\"}");
+}
+
+void tst_BenchTaskAwait::roundTrip_data()
+{
+    QTest::addColumn<bool>("guarded");
+
+    QTest::newRow("plain") << false;
+    QTest::newRow("timeout and cancellation") << true;
+}
+
+void tst_BenchTaskAwait::roundTrip()
+{
+#ifdef FIREBASE_HAS_COROUTINES
+    QFETCH(bool, guarded);
+
+    FirebaseDatabase database;
+    database.setDatabaseUrl(m_url);
+
+    FirebaseCancellation cancellation;
+    FirebaseRequestOptions options;
+    if(guarded) {
+        options.timeout = 10000;
+        options.cancellation = &cancellation;
+    }
+
+    QBENCHMARK {
+        bool done = false;
+        FirebaseTask<void> task = awaitResponse(database.getValueAsync("/topic.json", QString(), options), &done);
+        while(!done)
+            QCoreApplication::processEvents();
+    }
+#endif
+}
+
+QTEST_GUILESS_MAIN(tst_BenchTaskAwait)
+
+#include "tst_bench_taskawait.moc"
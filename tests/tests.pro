@@ -0,0 +1,3 @@
+# Unit tests and benchmarks, run with "make check" after building, e.g: qmake tests.pro && make && make check
+TEMPLATE = subdirs
+SUBDIRS = auto benchmarks
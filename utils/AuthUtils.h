@@ -1,78 +1,247 @@
-#ifndef AUTHUTILS_H
-#define AUTHUTILS_H
-#include <QString>
-
-namespace AuthUtils {
-
-static const QString endpoint_signUp("https://identitytoolkit.googleapis.com/v1/accounts:signUp?key=");
-static const QString endpoint_signIn("https://identitytoolkit.googleapis.com/v1/accounts:signInWithPassword?key=");
-static const QString endpoint_signInOAuth("https://identitytoolkit.googleapis.com/v1/accounts:signInWithIdp?key=");
-static const QString endpoint_fetchProviders("https://identitytoolkit.googleapis.com/v1/accounts:createAuthUri?key=");
-static const QString endpoint_sendPasswordReset("https://identitytoolkit.googleapis.com/v1/accounts:sendOobCode?key=");
-static const QString endpoint_verifyPasswordReset("https://identitytoolkit.googleapis.com/v1/accounts:resetPassword?key=");
-static const QString endpoint_confirmPasswordReset("https://identitytoolkit.googleapis.com/v1/accounts:resetPassword?key=");
-static const QString endpoint_changeEmail("https://identitytoolkit.googleapis.com/v1/accounts:update?key=");
-static const QString endpoint_changePassword("https://identitytoolkit.googleapis.com/v1/accounts:update?key=");
-static const QString endpoint_profileUpdate("https://identitytoolkit.googleapis.com/v1/accounts:update?key=");
-static const QString endpoint_getUserData("https://identitytoolkit.googleapis.com/v1/accounts:lookup?key=");
-static const QString endpoint_sendEmailVerification("https://identitytoolkit.googleapis.com/v1/accounts:sendOobCode?key=");
-static const QString endpoint_confirmEmailVerification("https://identitytoolkit.googleapis.com/v1/accounts:update?key=");
-static const QString endpoint_deleteAccount("https://identitytoolkit.googleapis.com/v1/accounts:delete?key=");
-static const QString endpoint_refreshToken("https://securetoken.googleapis.com/v1/token?key=");
-
-// For showing a clearer message to the user
-static QString parseJSONerror(QString err)
-{
-    // Exchange refresh token for ID token
-    if(err == "TOKEN_EXPIRED")
-        return "User credential not valid, sign in again";
-    else if(err == "USER_DISABLED")
-        return "User account disabled, contact administrator";
-    else if(err == "USER_NOT_FOUND")
-        return "User with the corresponding refreshToken not found";
-    else if(err == "INVALID_REFRESH_TOKEN")
-        return "Invalid refresh token was provided";
-    else if(err == "INVALID_GRANT_TYPE")
-        return "MISSING_REFRESH_TOKEN";
-    else if(err == "MISSING_REFRESH_TOKEN")
-        return "No refresh token provided";
-    else if(err == "USER_DISABLED")
-        return "User account disabled, contact administrator";
-
-    // Sign up with email/password
-    else if(err == "EMAIL_EXISTS")
-        return "Email already exists, please use another";
-    else if(err == "OPERATION_NOT_ALLOWED")
-        return "Password sign-in disabled for this project";
-    else if(err == "TOO_MANY_ATTEMPTS_TRY_LATER")
-        return "User account disabled, contact administrator";
-    else if(err == "USER_DISABLED")
-        return "User account disabled, contact administrator";
-
-    // Sign in with email/password
-    else if(err == "EMAIL_NOT_FOUND" || err == "INVALID_EMAIL")
-        return "Email was not found, verify if it is correct";
-    else if(err == "USER_DISABLED")
-        return "User account disabled, contact administrator";
-    else if(err == "INVALID_PASSWORD")
-        return "Password is invalid";
-
-    // Change email
-    else if(err == "INVALID_ID_TOKEN")
-        return "User credential not valid, sign in again";
-    // Change password
-    else if(err == "WEAK_PASSWORD")
-        return "Password must be 6 characters long or more";
-
-    // Get user profile data
-    else if(err == "USER_NOT_FOUND")
-        return "User account disabled, contact administrator";
-
-    // Return back same string if it isn't in this list
-    else
-        return err;
-}
-
-}
-
-#endif // AUTHUTILS_H
+#ifndef AUTHUTILS_H
+#define AUTHUTILS_H
+#include <QString>
+#include <QVector>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QMetaProperty>
+#include <QJsonDocument>
+#include <QUrlQuery>
+#include <QStringList>
+
+namespace AuthUtils {
+
+static const QString endpoint_signUp("https://identitytoolkit.googleapis.com/v1/accounts:signUp?key=");
+static const QString endpoint_signIn("https://identitytoolkit.googleapis.com/v1/accounts:signInWithPassword?key=");
+static const QString endpoint_signInOAuth("https://identitytoolkit.googleapis.com/v1/accounts:signInWithIdp?key=");
+static const QString endpoint_fetchProviders("https://identitytoolkit.googleapis.com/v1/accounts:createAuthUri?key=");
+static const QString endpoint_sendPasswordReset("https://identitytoolkit.googleapis.com/v1/accounts:sendOobCode?key=");
+static const QString endpoint_verifyPasswordReset("https://identitytoolkit.googleapis.com/v1/accounts:resetPassword?key=");
+static const QString endpoint_confirmPasswordReset("https://identitytoolkit.googleapis.com/v1/accounts:resetPassword?key=");
+static const QString endpoint_changeEmail("https://identitytoolkit.googleapis.com/v1/accounts:update?key=");
+static const QString endpoint_changePassword("https://identitytoolkit.googleapis.com/v1/accounts:update?key=");
+static const QString endpoint_profileUpdate("https://identitytoolkit.googleapis.com/v1/accounts:update?key=");
+static const QString endpoint_getUserData("https://identitytoolkit.googleapis.com/v1/accounts:lookup?key=");
+static const QString endpoint_sendEmailVerification("https://identitytoolkit.googleapis.com/v1/accounts:sendOobCode?key=");
+static const QString endpoint_confirmEmailVerification("https://identitytoolkit.googleapis.com/v1/accounts:update?key=");
+static const QString endpoint_deleteAccount("https://identitytoolkit.googleapis.com/v1/accounts:delete?key=");
+static const QString endpoint_refreshToken("https://securetoken.googleapis.com/v1/token?key=");
+
+// Lookup of other users by id, needs an OAuth access token with access to the project instead of an ID token
+static const QString endpoint_lookupUsers("https://identitytoolkit.googleapis.com/v1/accounts:lookup");
+static const int maxUsersPerLookup = 100;
+
+// Actions performed by FirebaseAuth once a request succeeds
+enum ReplyAction {
+    NoAction = 0x0,
+    UserChanged = 0x1,
+    SignedIn = 0x2,
+    SignedOut = 0x4
+};
+
+// Copies a field of the JSON response into a property of FirebaseUser
+struct FieldMapping {
+    const char *responseField;
+    const char *userProperty;
+    bool skipEmpty;
+};
+
+// Describes one auth request: where it is sent and how its response is applied to the current user
+struct Request {
+    const char *name;
+    QString endpoint;
+    const char *contentType;
+    const char *responseRoot;   // If set, fields are read from the first element of this array
+    QVector<FieldMapping> fields;
+    int actions;
+    bool sideEffects;           // Resending after a lost response could repeat the action, e.g create the account twice
+};
+
+static const Request request_signUp { "signUp", endpoint_signUp, "application/json", nullptr,
+    { {"email", "email", false}, {"idToken", "idToken", false}, {"refreshToken", "refreshToken", false}, {"localId", "userId", false} },
+    UserChanged | SignedIn, true };
+
+static const Request request_signIn { "signIn", endpoint_signIn, "application/json", nullptr,
+    { {"email", "email", false}, {"idToken", "idToken", false}, {"refreshToken", "refreshToken", false}, {"localId", "userId", false} },
+    UserChanged | SignedIn };
+
+static const Request request_signInOAuth { "signInWithIdp", endpoint_signInOAuth, "application/json", nullptr,
+    { {"displayName", "name", false}, {"email", "email", false}, {"idToken", "idToken", false}, {"refreshToken", "refreshToken", false},
+      {"localId", "userId", false}, {"emailVerified", "emailVerified", false}, {"photoUrl", "photoUrl", false} },
+    UserChanged | SignedIn };
+
+static const Request request_refreshToken { "refreshToken", endpoint_refreshToken, "application/x-www-form-urlencoded", nullptr,
+    { {"id_token", "idToken", false}, {"refresh_token", "refreshToken", false}, {"user_id", "userId", false} },
+    NoAction };
+
+static const Request request_sendEmailVerification { "sendEmailVerification", endpoint_sendEmailVerification, "application/json", nullptr, {}, NoAction };
+
+static const Request request_changeEmail { "changeEmail", endpoint_changeEmail, "application/json", nullptr,
+    { {"email", "email", false}, {"idToken", "idToken", false}, {"refreshToken", "refreshToken", false}, {"localId", "userId", false} },
+    UserChanged };
+
+static const Request request_confirmEmailVerification { "confirmEmailVerification", endpoint_confirmEmailVerification, "application/json", nullptr, {}, NoAction };
+
+static const Request request_sendPasswordReset { "sendPasswordReset", endpoint_sendPasswordReset, "application/json", nullptr, {}, NoAction };
+
+static const Request request_changePassword { "changePassword", endpoint_changePassword, "application/json", nullptr,
+    { {"email", "email", false}, {"idToken", "idToken", false}, {"refreshToken", "refreshToken", false}, {"localId", "userId", false} },
+    UserChanged };
+
+static const Request request_verifyPasswordReset { "verifyPasswordReset", endpoint_verifyPasswordReset, "application/json", nullptr, {}, NoAction };
+
+static const Request request_confirmPasswordReset { "confirmPasswordReset", endpoint_confirmPasswordReset, "application/json", nullptr, {}, NoAction };
+
+static const Request request_getUserData { "getUserData", endpoint_getUserData, "application/json", "users",
+    { {"displayName", "name", true}, {"emailVerified", "emailVerified", false}, {"photoUrl", "photoUrl", false} },
+    NoAction };
+
+static const Request request_profileUpdate { "profileUpdate", endpoint_profileUpdate, "application/json", nullptr,
+    { {"displayName", "name", false}, {"photoUrl", "photoUrl", false}, {"idToken", "idToken", false}, {"refreshToken", "refreshToken", false} },
+    NoAction };
+
+static const Request request_deleteAccount { "deleteAccount", endpoint_deleteAccount, "application/json", nullptr, {}, SignedOut, true };
+
+// Request payloads, shared by the signal based and the awaitable API
+static QByteArray toPayload(const QJsonObject &data)
+{
+    return QJsonDocument(data).toJson(QJsonDocument::Compact);
+}
+
+static QByteArray payload_signUp(const QString &email, const QString &password, const QString &name)
+{
+    return toPayload({ {"email", email}, {"password", password}, {"returnSecureToken", true}, {"displayName", name} });
+}
+
+static QByteArray payload_signIn(const QString &email, const QString &password)
+{
+    return toPayload({ {"email", email}, {"password", password}, {"returnSecureToken", true} });
+}
+
+static QByteArray payload_signInOAuth(const QString &authToken, const QString &providerId)
+{
+    QUrlQuery postBody;
+    postBody.addQueryItem("access_token", authToken);
+    postBody.addQueryItem("providerId", providerId);
+
+    return toPayload({ {"postBody", postBody.toString(QUrl::FullyEncoded)}, {"requestUri", "http://127.0.0.1:8080"},
+                       {"returnIdpCredential", true}, {"returnSecureToken", true} });
+}
+
+static QByteArray payload_refreshToken(const QString &refreshToken)
+{
+    QUrlQuery data;
+    data.addQueryItem("grant_type", "refresh_token");
+    data.addQueryItem("refresh_token", refreshToken);
+
+    return data.toString(QUrl::FullyEncoded).toUtf8();
+}
+
+static QByteArray payload_sendEmailVerification(const QString &idToken)
+{
+    return toPayload({ {"requestType", "VERIFY_EMAIL"}, {"idToken", idToken} });
+}
+
+static QByteArray payload_changeEmail(const QString &idToken, const QString &newEmail)
+{
+    return toPayload({ {"idToken", idToken}, {"email", newEmail}, {"returnSecureToken", true} });
+}
+
+static QByteArray payload_confirmEmailVerification(const QString &verificationCode)
+{
+    return toPayload({ {"oobCode", verificationCode} });
+}
+
+static QByteArray payload_sendPasswordReset(const QString &email)
+{
+    return toPayload({ {"requestType", "PASSWORD_RESET"}, {"email", email} });
+}
+
+static QByteArray payload_changePassword(const QString &idToken, const QString &newPassword)
+{
+    return toPayload({ {"idToken", idToken}, {"password", newPassword}, {"returnSecureToken", true} });
+}
+
+static QByteArray payload_verifyPasswordReset(const QString &verificationCode)
+{
+    return toPayload({ {"oobCode", verificationCode} });
+}
+
+static QByteArray payload_confirmPasswordReset(const QString &verificationCode, const QString &newPassword)
+{
+    return toPayload({ {"oobCode", verificationCode}, {"newPassword", newPassword} });
+}
+
+static QByteArray payload_getUserData(const QString &idToken)
+{
+    return toPayload({ {"idToken", idToken} });
+}
+
+// Looking up other users with an OAuth access token needs the project they belong to
+static QByteArray payload_lookupUsers(const QStringList &userIds, const QString &projectId)
+{
+    return toPayload({ {"localId", QJsonArray::fromStringList(userIds)}, {"targetProjectId", projectId} });
+}
+
+static QByteArray payload_profileUpdate(const QString &idToken, const QString &name, const QString &photoUrl)
+{
+    return toPayload({ {"idToken", idToken}, {"displayName", name}, {"photoUrl", photoUrl}, {"returnSecureToken", true} });
+}
+
+static QByteArray payload_deleteAccount(const QString &idToken)
+{
+    return toPayload({ {"idToken", idToken} });
+}
+
+// Copies the response fields listed in the request into the properties of user
+static void applyFields(const Request &request, QJsonObject response, QObject *user)
+{
+    if(request.responseRoot)
+        response = response[request.responseRoot].toArray().at(0).toObject();
+
+    const QMetaObject *meta = user->metaObject();
+    for(const FieldMapping &field : request.fields) {
+        QVariant value = response[field.responseField].toVariant();
+        if(field.skipEmpty && value.toString().isEmpty())
+            continue;
+
+        // A missing field resets the property to the default value of its type
+        const QMetaProperty property = meta->property(meta->indexOfProperty(field.userProperty));
+        value.convert(property.userType());
+        property.write(user, value);
+    }
+}
+
+// Request and response fields holding credentials, in JSON and form-encoded bodies alike
+static const QStringList secretFields { "idToken", "refreshToken", "id_token", "refresh_token", "accessToken", "access_token",
+                                        "oauthAccessToken", "oauthIdToken", "password", "newPassword", "oobCode",
+                                        "postBody", "pendingToken", "token", "customToken" };
+
+static QJsonValue redactValue(const QJsonValue &value);
+
+// Replaces credentials in a response so it can be safely logged, also in nested objects such as users[].providerUserInfo[]
+static QJsonObject redactTokens(QJsonObject object)
+{
+    for(auto it = object.begin(); it != object.end(); ++it)
+        it.value() = secretFields.contains(it.key()) ? QJsonValue("<redacted>") : redactValue(it.value());
+    return object;
+}
+
+static QJsonValue redactValue(const QJsonValue &value)
+{
+    if(value.isObject())
+        return redactTokens(value.toObject());
+
+    if(value.isArray()) {
+        QJsonArray array = value.toArray();
+        for(auto it = array.begin(); it != array.end(); ++it)
+            *it = redactValue(*it);
+        return array;
+    }
+
+    return value;
+}
+
+}
+
+#endif // AUTHUTILS_H
@@ -0,0 +1,389 @@
+#ifndef DATABASEUTILS_H
+#define DATABASEUTILS_H
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QList>
+#include "JsonUtils.h"
+
+namespace DatabaseUtils {
+
+// Location of a request path such as "/users/alice/.json?shallow=true", i.e "/users/alice"
+static QString location(const QString &dbPath)
+{
+    QString path = dbPath.section('?', 0, 0);
+    if(path.endsWith(".json"))
+        path.chop(5);
+
+    const QStringList segments = path.split('/', Qt::SkipEmptyParts);
+    return "/" + segments.join('/');
+}
+
+/*
+    The database sends bare values such as null or "text", which QJsonDocument does not parse on its own. Large
+    payloads, such as the first put of a listener or a big response, are indexed first and their top level children
+    are converted in parallel.
+*/
+static QJsonValue parse(const QByteArray &json)
+{
+    if(json.size() >= JsonUtils::minParallelSize) {
+        if(const QSharedPointer<const JsonUtils::Document> document = JsonUtils::Document::parse(json))
+            return document->toJsonValue(0);
+    }
+
+    const QByteArray trimmed = json.trimmed();
+    if(trimmed.startsWith('{') || trimmed.startsWith('[')) {
+        const QJsonDocument document = QJsonDocument::fromJson(trimmed);
+        return document.isObject() ? QJsonValue(document.object()) : QJsonValue(document.array());
+    }
+
+    const QJsonArray wrapped = QJsonDocument::fromJson('[' + trimmed + ']').array();
+    return wrapped.isEmpty() ? QJsonValue(QJsonValue::Null) : wrapped.first();
+}
+
+static QByteArray serialize(const QJsonValue &value)
+{
+    if(value.isObject())
+        return QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact);
+    if(value.isArray())
+        return QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact);
+
+    const QByteArray wrapped = QJsonDocument(QJsonArray {value}).toJson(QJsonDocument::Compact);
+    return wrapped.mid(1, wrapped.size() - 2);
+}
+
+static QJsonValue valueAt(QJsonValue value, const QString &path)
+{
+    for(const QString &segment : path.split('/', Qt::SkipEmptyParts)) {
+        if(value.isObject()) {
+            value = value.toObject().value(segment);
+        } else if(value.isArray()) {
+            bool ok = false;
+            const int index = segment.toInt(&ok);
+            value = ok ? value.toArray().at(index) : QJsonValue(QJsonValue::Undefined);
+        } else {
+            return QJsonValue::Null;
+        }
+    }
+
+    return value.isUndefined() ? QJsonValue(QJsonValue::Null) : value;
+}
+
+/*
+    Returns root with value stored at path, with the semantics of the database: null deletes, and locations left
+    without children disappear. Arrays are written as objects keyed by index, like the server stores them.
+*/
+static QJsonValue setAt(const QJsonValue &root, const QStringList &segments, int index, const QJsonValue &value)
+{
+    if(index == segments.size())
+        return value.isUndefined() ? QJsonValue(QJsonValue::Null) : value;
+
+    QJsonObject object;
+    if(root.isObject()) {
+        object = root.toObject();
+    } else if(root.isArray()) {
+        const QJsonArray array = root.toArray();
+        for(int i = 0; i < array.size(); ++i)
+            if(!array.at(i).isNull())
+                object.insert(QString::number(i), array.at(i));
+    }
+
+    const QString &key = segments.at(index);
+    const QJsonValue child = setAt(object.value(key), segments, index + 1, value);
+    if(child.isNull())
+        object.remove(key);
+    else
+        object.insert(key, child);
+
+    return object.isEmpty() ? QJsonValue(QJsonValue::Null) : QJsonValue(object);
+}
+
+static QJsonValue setAt(const QJsonValue &root, const QString &path, const QJsonValue &value)
+{
+    return setAt(root, path.split('/', Qt::SkipEmptyParts), 0, value);
+}
+
+// Applies a PATCH: only the given children of path change
+static QJsonValue patchAt(QJsonValue root, const QString &path, const QJsonObject &children)
+{
+    for(auto it = children.begin(); it != children.end(); ++it)
+        root = setAt(root, path + "/" + it.key(), it.value());
+    return root;
+}
+
+// Applies a write of the REST API (PUT, PATCH, POST as a PUT to its key, or DELETE) to root
+static QJsonValue applyWrite(const QJsonValue &root, const QByteArray &verb, const QString &location, const QJsonValue &data)
+{
+    if(verb == "PATCH")
+        return patchAt(root, location, data.toObject());
+    if(verb == "DELETE")
+        return setAt(root, location, QJsonValue::Null);
+    return setAt(root, location, data);
+}
+
+/*
+    Turns a write (a put or patch of data at path, leaving the database at root) into the event a listener on location
+    receives, the way the server does: writes at or below the location keep their event with a relative path, writes
+    above it become a put of the location's new value. Returns false if the listener does not see the write.
+*/
+static bool eventFor(const QString &location, const QJsonValue &root, QByteArray *event, QString *path, QJsonValue *data)
+{
+    const QString prefix = location == "/" ? location : location + "/";
+    if(*path == location || path->startsWith(prefix)) {
+        *path = *path == location ? QString("/") : path->mid(prefix.size() - 1);
+        return true;
+    }
+
+    const QString parent = *path == "/" ? *path : *path + "/";
+    if(!location.startsWith(parent))
+        return false;
+
+    // A patch above the location only matters if one of its, possibly multi-path, keys leads to it
+    if(*event == "patch") {
+        const QString branch = location.mid(parent.size());
+        const QJsonObject children = data->toObject();
+
+        bool touched = false;
+        for(auto it = children.begin(); it != children.end() && !touched; ++it) {
+            QString key = it.key();
+            while(key.startsWith('/'))
+                key.remove(0, 1);
+            touched = branch == key || branch.startsWith(key + "/") || key.startsWith(branch + "/");
+        }
+        if(!touched)
+            return false;
+    }
+
+    *event = "put";
+    *path = "/";
+    *data = valueAt(root, location);
+    return true;
+}
+
+/*
+    Local view of a database for optimistic writes: the data last reported by the server with the writes still
+    waiting for its answer applied on top, in the order they were made. Confirming a write moves it into the server
+    data, rejecting it drops it, and the view is rebuilt so later writes stay applied either way.
+*/
+class LocalView
+{
+public:
+    // Ids continue after lastId, so writes of a previous view are never confused with writes of this one
+    explicit LocalView(quint64 lastId = 0) : m_lastId(lastId) {}
+
+    quint64 lastId() const
+    {
+        return m_lastId;
+    }
+
+    QJsonValue root() const
+    {
+        return m_local;
+    }
+
+    quint64 addWrite(const QByteArray &verb, const QString &location, const QJsonValue &data)
+    {
+        const Write write {++m_lastId, verb, location, data};
+        m_pending.append(write);
+        m_local = applyWrite(m_local, verb, location, data);
+        return write.id;
+    }
+
+    // False if the write is not pending in this view
+    bool confirm(quint64 id)
+    {
+        for(int i = 0; i < m_pending.size(); ++i) {
+            if(m_pending.at(i).id == id) {
+                const Write write = m_pending.takeAt(i);
+                m_server = applyWrite(m_server, write.verb, write.location, write.data);
+                rebuild();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool reject(quint64 id)
+    {
+        for(int i = 0; i < m_pending.size(); ++i) {
+            if(m_pending.at(i).id == id) {
+                m_pending.removeAt(i);
+                rebuild();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Data reported by the server for location, a put replaces it and a patch merges into it
+    void serverData(const QString &location, const QByteArray &event, const QJsonValue &data)
+    {
+        m_server = event == "patch" ? patchAt(m_server, location, data.toObject()) : setAt(m_server, location, data);
+        rebuild();
+    }
+
+private:
+    struct Write {
+        quint64 id;
+        QByteArray verb;
+        QString location;
+        QJsonValue data;
+    };
+
+    void rebuild()
+    {
+        m_local = m_server;
+        for(const Write &write : m_pending)
+            m_local = applyWrite(m_local, write.verb, write.location, write.data);
+    }
+
+    QJsonValue m_server;
+    QJsonValue m_local;
+    QList<Write> m_pending;
+    quint64 m_lastId;
+};
+
+// True if path is location or lies below it
+static bool covers(const QString &location, const QString &path)
+{
+    return path == location || location == "/" || path.startsWith(location + "/");
+}
+
+// Event of a listener, the path is relative to the listened location
+struct Event {
+    QByteArray name;
+    QString path;
+    QJsonValue data;
+};
+
+/*
+    Events of one listener waiting to be delivered, with successive events merged so that only the resulting state
+    is delivered: a put replaces pending events at or below its path, an event below a pending put is applied to the
+    data of that put, and patches of the same path are combined. Events are only merged where the result equals
+    delivering them one by one, so the order of overlapping events is kept.
+*/
+class EventQueue
+{
+public:
+    // Returns true if the event was merged into a pending one
+    bool add(const QByteArray &name, const QString &path, const QJsonValue &data)
+    {
+        for(int i = m_events.size() - 1; i >= 0; --i) {
+            Event &pending = m_events[i];
+
+            // Later events below a pending put were merged into it, so nothing after it overlaps
+            if(pending.name == "put" && covers(pending.path, path)) {
+                const QString relative = path.mid(pending.path == "/" ? 0 : pending.path.size());
+                pending.data = name == "put" ? setAt(pending.data, relative, data) : patchAt(pending.data, relative, data.toObject());
+                return true;
+            }
+
+            if(name == "patch" && pending.name == "patch" && pending.path == path) {
+                QJsonObject merged = pending.data.toObject();
+                const QJsonObject children = data.toObject();
+                for(auto it = children.begin(); it != children.end(); ++it) {
+                    // A key replaces the keys below it, multi-path keys included
+                    for(auto existing = merged.begin(); existing != merged.end();) {
+                        if(existing.key().startsWith(it.key() + "/"))
+                            existing = merged.erase(existing);
+                        else
+                            ++existing;
+                    }
+                    merged.insert(it.key(), it.value());
+                }
+                pending.data = merged;
+                return true;
+            }
+
+            // An overlapping event in between keeps the new one separate
+            if(covers(pending.path, path) || covers(path, pending.path))
+                break;
+        }
+
+        bool merged = false;
+        if(name == "put") {
+            for(int i = m_events.size() - 1; i >= 0; --i) {
+                if(covers(path, m_events.at(i).path)) {
+                    m_events.removeAt(i);
+                    merged = true;
+                }
+            }
+        }
+
+        m_events.append(Event {name, path, data});
+        return merged;
+    }
+
+    QList<Event> take()
+    {
+        QList<Event> events;
+        events.swap(m_events);
+        return events;
+    }
+
+    int size() const
+    {
+        return m_events.size();
+    }
+
+private:
+    QList<Event> m_events;
+};
+
+// Location below dbPath, keeping the .json suffix and query of dbPath, e.g "/messages/.json" and "k" give "/messages/k.json"
+static QString childPath(const QString &dbPath, const QString &key)
+{
+    const int query = dbPath.indexOf('?');
+    const QString location = DatabaseUtils::location(dbPath);
+    return (location == "/" ? location : location + "/") + key + ".json" + (query < 0 ? QString() : dbPath.mid(query));
+}
+
+/*
+    Generates keys in the format of the Firebase SDKs: 8 characters of timestamp followed by 12 random characters, in
+    an alphabet that sorts like ASCII. Keys sort chronologically, and keys created in the same millisecond by the same
+    generator increment the random part so they keep their order. Not thread safe, callers serialize access.
+*/
+class PushIdGenerator
+{
+public:
+    QString next(qint64 now)
+    {
+        static const char alphabet[] = "-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz";
+
+        if(now == m_lastTime) {
+            // Carry the increment through the random part, from its last character
+            int i = 11;
+            while(i >= 0 && m_random[i] == 63)
+                m_random[i--] = 0;
+            if(i >= 0)
+                ++m_random[i];
+        } else {
+            for(int i = 0; i < 12; ++i)
+                m_random[i] = static_cast<int>(QRandomGenerator::global()->bounded(64));
+        }
+        m_lastTime = now;
+
+        QString id(20, Qt::Uninitialized);
+        for(int i = 7; i >= 0; --i) {
+            id[i] = QLatin1Char(alphabet[now % 64]);
+            now /= 64;
+        }
+        for(int i = 0; i < 12; ++i)
+            id[8 + i] = QLatin1Char(alphabet[m_random[i]]);
+
+        return id;
+    }
+
+private:
+    qint64 m_lastTime = -1;
+    int m_random[12] = {};
+};
+
+}
+
+#endif // DATABASEUTILS_H
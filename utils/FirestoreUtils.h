@@ -0,0 +1,209 @@
+#ifndef FIRESTOREUTILS_H
+#define FIRESTOREUTILS_H
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QtMath>
+
+namespace FirestoreUtils {
+
+static const QString endpoint_documents("https://firestore.googleapis.com/v1/");
+
+// Firestore limits the number of writes in one commit
+static const int maxWritesPerCommit = 500;
+
+// Converts a typed Firestore Value into plain JSON, e.g {"integerValue": "5"} into 5
+static QJsonValue fromValue(const QJsonObject &value)
+{
+    if(value.contains("stringValue"))
+        return value["stringValue"];
+    if(value.contains("booleanValue"))
+        return value["booleanValue"];
+    if(value.contains("doubleValue"))
+        return value["doubleValue"];
+    if(value.contains("integerValue")) {
+        // int64 is sent as string, keep it a string if a double cannot hold it exactly
+        const qint64 integer = value["integerValue"].toString().toLongLong();
+        return qAbs(integer) <= (Q_INT64_C(1) << 53) ? QJsonValue(static_cast<double>(integer)) : value["integerValue"];
+    }
+    if(value.contains("timestampValue"))
+        return value["timestampValue"];
+    if(value.contains("referenceValue"))
+        return value["referenceValue"];
+    if(value.contains("bytesValue"))
+        return value["bytesValue"];
+    if(value.contains("geoPointValue"))
+        return value["geoPointValue"];
+    if(value.contains("arrayValue")) {
+        QJsonArray array;
+        for(const QJsonValue &item : value["arrayValue"].toObject().value("values").toArray())
+            array.append(fromValue(item.toObject()));
+        return array;
+    }
+    if(value.contains("mapValue")) {
+        QJsonObject map;
+        const QJsonObject fields = value["mapValue"].toObject().value("fields").toObject();
+        for(auto it = fields.begin(); it != fields.end(); ++it)
+            map[it.key()] = fromValue(it.value().toObject());
+        return map;
+    }
+
+    return QJsonValue::Null;
+}
+
+static QJsonObject toValue(const QJsonValue &value)
+{
+    QJsonObject typed;
+
+    switch(value.type()) {
+    case QJsonValue::Bool:
+        typed["booleanValue"] = value;
+        break;
+    case QJsonValue::Double: {
+        const double number = value.toDouble();
+        if(qFloor(number) == number && qAbs(number) <= static_cast<double>(Q_INT64_C(1) << 53))
+            typed["integerValue"] = QString::number(static_cast<qint64>(number));
+        else
+            typed["doubleValue"] = number;
+        break;
+    }
+    case QJsonValue::String:
+        typed["stringValue"] = value;
+        break;
+    case QJsonValue::Array: {
+        QJsonArray values;
+        for(const QJsonValue &item : value.toArray())
+            values.append(toValue(item));
+        typed["arrayValue"] = QJsonObject {{"values", values}};
+        break;
+    }
+    case QJsonValue::Object: {
+        QJsonObject fields;
+        const QJsonObject map = value.toObject();
+        for(auto it = map.begin(); it != map.end(); ++it)
+            fields[it.key()] = toValue(it.value());
+        typed["mapValue"] = QJsonObject {{"fields", fields}};
+        break;
+    }
+    default:
+        typed["nullValue"] = QJsonValue::Null;
+    }
+
+    return typed;
+}
+
+static QJsonObject toFields(const QJsonObject &data)
+{
+    QJsonObject fields;
+    for(auto it = data.begin(); it != data.end(); ++it)
+        fields[it.key()] = toValue(it.value());
+    return fields;
+}
+
+// Field path of a top level key, keys that are not simple identifiers must be quoted with backticks
+static QString fieldPath(const QString &key)
+{
+    bool simple = !key.isEmpty() && !key.at(0).isDigit();
+    for(const QChar c : key)
+        simple = simple && (c == '_' || (c.unicode() < 128 && c.isLetterOrNumber()));
+    if(simple)
+        return key;
+
+    QString quoted = key;
+    quoted.replace('\\', "\\\\").replace('`', "\\`");
+    return '`' + quoted + '`';
+}
+
+static QStringList fieldPaths(const QStringList &keys)
+{
+    QStringList paths;
+    for(const QString &key : keys)
+        paths.append(fieldPath(key));
+    return paths;
+}
+
+// Plain form of a Firestore Document: its path relative to the database, id, data and timestamps
+static QJsonObject fromDocument(const QJsonObject &document)
+{
+    const QString name = document["name"].toString();
+    const int documents = name.indexOf("/documents/");
+
+    QJsonObject data;
+    const QJsonObject fields = document["fields"].toObject();
+    for(auto it = fields.begin(); it != fields.end(); ++it)
+        data[it.key()] = fromValue(it.value().toObject());
+
+    QJsonObject plain;
+    plain["path"] = documents < 0 ? name : name.mid(documents + 11);
+    plain["id"] = name.mid(name.lastIndexOf('/') + 1);
+    plain["data"] = data;
+    plain["createTime"] = document["createTime"];
+    plain["updateTime"] = document["updateTime"];
+    return plain;
+}
+
+/*
+    Splits a JSON array arriving in pieces into its elements, so streamed responses can be handled element by element
+    while the rest is still downloading. Only the element being received is buffered.
+*/
+class ArrayStream
+{
+public:
+    QList<QByteArray> feed(const QByteArray &data)
+    {
+        QList<QByteArray> elements;
+
+        for(const char c : data) {
+            if(!m_started) {
+                m_started = c == '[';
+                continue;
+            }
+
+            if(m_depth == 0) {
+                // Between elements: separators, whitespace and the end of the array
+                if(c == ',' || c == ']' || c == ' ' || c == '\n' || c == '\r' || c == '\t')
+                    continue;
+            }
+
+            m_element.append(c);
+
+            if(m_inString) {
+                if(m_escape)
+                    m_escape = false;
+                else if(c == '\\')
+                    m_escape = true;
+                else if(c == '"')
+                    m_inString = false;
+                continue;
+            }
+
+            if(c == '"') {
+                m_inString = true;
+            } else if(c == '{' || c == '[') {
+                ++m_depth;
+            } else if(c == '}' || c == ']') {
+                if(--m_depth == 0) {
+                    elements.append(m_element);
+                    m_element.clear();
+                }
+            }
+        }
+
+        return elements;
+    }
+
+private:
+    QByteArray m_element;
+    int m_depth = 0;
+    bool m_started = false;
+    bool m_inString = false;
+    bool m_escape = false;
+};
+
+}
+
+#endif // FIRESTOREUTILS_H
@@ -0,0 +1,626 @@
+#ifndef JSONUTILS_H
+#define JSONUTILS_H
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QVariant>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSONUTILS_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define JSONUTILS_NEON
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/*
+    Two stage JSON parser for large database payloads. The first stage classifies 64 bytes at a time with SIMD
+    compares and produces the positions of all structural characters, string quotes and value starts. The second
+    stage walks these positions only, never the bytes in between, and records every value as one entry of a flat
+    tape pointing into the original text. Nothing is converted while parsing: strings stay UTF-8 until they are
+    read, objects are navigated by comparing raw keys, and a subtree is only turned into QJsonValue or QVariant when
+    asked for.
+*/
+namespace JsonUtils {
+
+// Below this size QJsonDocument is as fast and the tape is not worth building
+static const int minTapeSize = 64 * 1024;
+
+static const int maxDepth = 1024;
+
+// Containers at least this large have their children converted on several threads
+static const int minParallelSize = 1024 * 1024;
+
+enum Type : quint8 {
+    Null,
+    False,
+    True,
+    Number,
+    String,
+    Array,
+    Object
+};
+
+// One value of the tape. Containers are followed by their children, next is the entry after the whole value
+struct Node {
+    Type type;
+    bool escaped;       // String containing escape sequences
+    quint32 start;      // Offset of the first byte, after the opening quote for strings
+    quint32 length;     // Length in bytes, without quotes for strings
+    quint32 next;
+    quint32 count;      // Number of children of containers
+};
+
+struct BlockMasks {
+    quint64 quote;
+    quint64 backslash;
+    quint64 op;
+    quint64 whitespace;
+};
+
+static inline int trailingZeros(quint64 bits)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+// Sets bits of masks for the 64 bytes at block
+static inline void classify(const char *block, BlockMasks *masks)
+{
+#if defined(__AVX2__)
+    masks->quote = masks->backslash = masks->op = masks->whitespace = 0;
+    for(int i = 0; i < 64; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i));
+        const auto eq = [&chunk](char c) { return _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(c)); };
+        const auto bits = [](__m256i m) { return static_cast<quint64>(static_cast<quint32>(_mm256_movemask_epi8(m))); };
+
+        masks->quote |= bits(eq('"')) << i;
+        masks->backslash |= bits(eq('\\')) << i;
+        masks->op |= bits(_mm256_or_si256(_mm256_or_si256(_mm256_or_si256(eq('{'), eq('}')), _mm256_or_si256(eq('['), eq(']'))),
+                                          _mm256_or_si256(eq(':'), eq(',')))) << i;
+        masks->whitespace |= bits(_mm256_or_si256(_mm256_or_si256(eq(' '), eq('\n')), _mm256_or_si256(eq('\r'), eq('\t')))) << i;
+    }
+#elif defined(JSONUTILS_SSE2)
+    masks->quote = masks->backslash = masks->op = masks->whitespace = 0;
+    for(int i = 0; i < 64; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+        const auto eq = [&chunk](char c) { return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c)); };
+        const auto bits = [](__m128i m) { return static_cast<quint64>(static_cast<quint16>(_mm_movemask_epi8(m))); };
+
+        masks->quote |= bits(eq('"')) << i;
+        masks->backslash |= bits(eq('\\')) << i;
+        masks->op |= bits(_mm_or_si128(_mm_or_si128(_mm_or_si128(eq('{'), eq('}')), _mm_or_si128(eq('['), eq(']'))),
+                                       _mm_or_si128(eq(':'), eq(',')))) << i;
+        masks->whitespace |= bits(_mm_or_si128(_mm_or_si128(eq(' '), eq('\n')), _mm_or_si128(eq('\r'), eq('\t')))) << i;
+    }
+#elif defined(JSONUTILS_NEON)
+    masks->quote = masks->backslash = masks->op = masks->whitespace = 0;
+    const uint8x16_t weights = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    for(int i = 0; i < 64; i += 16) {
+        const uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t *>(block + i));
+        const auto eq = [&chunk](char c) { return vceqq_u8(chunk, vdupq_n_u8(static_cast<uint8_t>(c))); };
+        const auto bits = [&weights](uint8x16_t m) {
+            const uint8x16_t weighted = vandq_u8(m, weights);
+            return static_cast<quint64>(vaddv_u8(vget_low_u8(weighted))) | (static_cast<quint64>(vaddv_u8(vget_high_u8(weighted))) << 8);
+        };
+
+        masks->quote |= bits(eq('"')) << i;
+        masks->backslash |= bits(eq('\\')) << i;
+        masks->op |= bits(vorrq_u8(vorrq_u8(vorrq_u8(eq('{'), eq('}')), vorrq_u8(eq('['), eq(']'))), vorrq_u8(eq(':'), eq(',')))) << i;
+        masks->whitespace |= bits(vorrq_u8(vorrq_u8(eq(' '), eq('\n')), vorrq_u8(eq('\r'), eq('\t')))) << i;
+    }
+#else
+    masks->quote = masks->backslash = masks->op = masks->whitespace = 0;
+    for(int i = 0; i < 64; ++i) {
+        const quint64 bit = Q_UINT64_C(1) << i;
+        switch(block[i]) {
+        case '"': masks->quote |= bit; break;
+        case '\\': masks->backslash |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',': masks->op |= bit; break;
+        case ' ': case '\n': case '\r': case '\t': masks->whitespace |= bit; break;
+        default: break;
+        }
+    }
+#endif
+}
+
+// Turns each bit into the parity of the bits up to and including it, i.e marks the bytes from an opening quote on
+static inline quint64 prefixXor(quint64 bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+/*
+    Stage one: offsets of the structural characters outside of strings, of all unescaped quotes and of the first byte
+    of numbers, true, false and null. Returns false for unterminated strings.
+*/
+static bool structuralIndex(const char *data, int size, std::vector<quint32> *index)
+{
+    index->clear();
+    index->reserve(static_cast<size_t>(size / 8 + 16));
+
+    quint64 escapeCarry = 0;    // First byte of the next block is escaped
+    quint64 inStringCarry = 0;  // All ones if the next block starts inside a string
+    quint64 scalarCarry = 0;    // Last byte of the previous block belongs to a scalar
+
+    for(int offset = 0; offset < size; offset += 64) {
+        const char *block = data + offset;
+        char padded[64];
+        if(size - offset < 64) {
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, block, static_cast<size_t>(size - offset));
+            block = padded;
+        }
+
+        BlockMasks masks;
+        classify(block, &masks);
+
+        // Escapes are rare, so backslashes are resolved one by one: a backslash escapes the next byte unless it is
+        // escaped itself, which handles runs such as \\\" correctly
+        quint64 escaped = escapeCarry;
+        escapeCarry = 0;
+        for(quint64 backslashes = masks.backslash; backslashes; backslashes &= backslashes - 1) {
+            const int bit = trailingZeros(backslashes);
+            if(escaped & (Q_UINT64_C(1) << bit))
+                continue;
+            if(bit == 63)
+                escapeCarry = 1;
+            else
+                escaped |= Q_UINT64_C(1) << (bit + 1);
+        }
+
+        const quint64 quotes = masks.quote & ~escaped;
+        const quint64 inString = prefixXor(quotes) ^ inStringCarry;
+        inStringCarry = static_cast<quint64>(0) - (inString >> 63);
+
+        const quint64 scalar = ~(masks.op | masks.whitespace | quotes | inString);
+        const quint64 scalarStarts = scalar & ~((scalar << 1) | scalarCarry);
+        scalarCarry = scalar >> 63;
+
+        quint64 structurals = (masks.op & ~inString) | quotes | scalarStarts;
+        if(size - offset < 64)
+            structurals &= (Q_UINT64_C(1) << (size - offset)) - 1;
+
+        for(; structurals; structurals &= structurals - 1)
+            index->push_back(static_cast<quint32>(offset + trailingZeros(structurals)));
+    }
+
+    return inStringCarry == 0;
+}
+
+// Stage two: builds the tape from the structural index
+class TapeBuilder
+{
+public:
+    TapeBuilder(const char *data, int size, const std::vector<quint32> &index, std::vector<Node> *tape)
+        : m_data(data), m_size(size), m_index(index), m_tape(tape)
+    {
+    }
+
+    bool build()
+    {
+        m_tape->clear();
+        m_tape->reserve(m_index.size() / 2 + 1);
+        return value(0) && m_position == m_index.size();
+    }
+
+private:
+    char peek() const
+    {
+        return m_position < m_index.size() ? m_data[m_index[m_position]] : '\0';
+    }
+
+    bool string()
+    {
+        if(m_position + 1 >= m_index.size() || peek() != '"')
+            return false;
+
+        const quint32 open = m_index[m_position];
+        const quint32 close = m_index[m_position + 1];
+        if(m_data[close] != '"')
+            return false;
+        m_position += 2;
+
+        const quint32 length = close - open - 1;
+        const bool escaped = memchr(m_data + open + 1, '\\', length) != nullptr;
+        m_tape->push_back(Node {String, escaped, open + 1, length, static_cast<quint32>(m_tape->size() + 1), 0});
+        return true;
+    }
+
+    bool scalar()
+    {
+        const quint32 start = m_index[m_position++];
+        quint32 end = m_position < m_index.size() ? m_index[m_position] : static_cast<quint32>(m_size);
+        while(end > start && (m_data[end - 1] == ' ' || m_data[end - 1] == '\n' || m_data[end - 1] == '\r' || m_data[end - 1] == '\t'))
+            --end;
+
+        const quint32 length = end - start;
+        const char *text = m_data + start;
+        Type type;
+        if(length == 4 && memcmp(text, "null", 4) == 0) {
+            type = Null;
+        } else if(length == 4 && memcmp(text, "true", 4) == 0) {
+            type = True;
+        } else if(length == 5 && memcmp(text, "false", 5) == 0) {
+            type = False;
+        } else {
+            for(quint32 i = 0; i < length; ++i) {
+                const char c = text[i];
+                if(!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'))
+                    return false;
+            }
+            type = Number;
+        }
+
+        m_tape->push_back(Node {type, false, start, length, static_cast<quint32>(m_tape->size() + 1), 0});
+        return true;
+    }
+
+    bool container(char close, int depth)
+    {
+        const quint32 open = m_index[m_position++];
+        const size_t node = m_tape->size();
+        m_tape->push_back(Node {close == '}' ? Object : Array, false, open, 0, 0, 0});
+
+        quint32 count = 0;
+        if(peek() == close) {
+            ++m_position;
+        } else {
+            for(;;) {
+                if(close == '}') {
+                    if(!string() || peek() != ':')
+                        return false;
+                    ++m_position;
+                }
+                if(!value(depth + 1))
+                    return false;
+                ++count;
+
+                const char separator = peek();
+                ++m_position;
+                if(separator == close)
+                    break;
+                if(separator != ',')
+                    return false;
+            }
+        }
+
+        Node &entry = (*m_tape)[node];
+        entry.length = m_index[m_position - 1] - open + 1;
+        entry.next = static_cast<quint32>(m_tape->size());
+        entry.count = count;
+        return true;
+    }
+
+    bool value(int depth)
+    {
+        if(m_position >= m_index.size() || depth > maxDepth)
+            return false;
+
+        switch(peek()) {
+        case '{':
+            return container('}', depth);
+        case '[':
+            return container(']', depth);
+        case '"':
+            return string();
+        case '}': case ']': case ':': case ',':
+            return false;
+        default:
+            return scalar();
+        }
+    }
+
+    const char *m_data;
+    int m_size;
+    const std::vector<quint32> &m_index;
+    std::vector<Node> *m_tape;
+    size_t m_position = 0;
+};
+
+// Decodes the escape sequences of a JSON string, including surrogate pairs written as two \u escapes
+static QString unescape(const char *text, int length)
+{
+    QString result;
+    result.reserve(length);
+
+    int start = 0;
+    for(int i = 0; i < length; ++i) {
+        if(text[i] != '\\')
+            continue;
+
+        result += QString::fromUtf8(text + start, i - start);
+        if(++i >= length)
+            break;
+
+        switch(text[i]) {
+        case 'b': result += QChar('\b'); break;
+        case 'f': result += QChar('\f'); break;
+        case 'n': result += QChar('\n'); break;
+        case 'r': result += QChar('\r'); break;
+        case 't': result += QChar('\t'); break;
+        case 'u':
+            if(i + 4 < length) {
+                result += QChar(static_cast<ushort>(QByteArray(text + i + 1, 4).toUShort(nullptr, 16)));
+                i += 4;
+            }
+            break;
+        default: result += QChar::fromLatin1(text[i]); break;
+        }
+        start = i + 1;
+    }
+
+    result += QString::fromUtf8(text + start, length - start);
+    return result;
+}
+
+/*
+    Parsed JSON text. Nodes are addressed by their position on the tape, the root is 0. The document keeps the text
+    alive, so it can be shared by snapshots of different parts of it.
+*/
+class Document
+{
+public:
+    static QSharedPointer<const Document> parse(const QByteArray &json)
+    {
+        QSharedPointer<Document> document(new Document);
+        document->m_json = json;
+
+        std::vector<quint32> index;
+        if(!structuralIndex(json.constData(), json.size(), &index) || index.empty())
+            return {};
+
+        TapeBuilder builder(json.constData(), json.size(), index, &document->m_tape);
+        if(!builder.build())
+            return {};
+
+        document->m_tape.shrink_to_fit();
+        return document;
+    }
+
+    Type type(int node) const
+    {
+        return m_tape[static_cast<size_t>(node)].type;
+    }
+
+    int count(int node) const
+    {
+        return static_cast<int>(m_tape[static_cast<size_t>(node)].count);
+    }
+
+    // Raw JSON text of node
+    QByteArray raw(int node) const
+    {
+        const Node &entry = m_tape[static_cast<size_t>(node)];
+        return entry.type == String ? m_json.mid(static_cast<int>(entry.start) - 1, static_cast<int>(entry.length) + 2)
+                                    : m_json.mid(static_cast<int>(entry.start), static_cast<int>(entry.length));
+    }
+
+    QString string(int node) const
+    {
+        const Node &entry = m_tape[static_cast<size_t>(node)];
+        const char *text = m_json.constData() + entry.start;
+        return entry.escaped ? unescape(text, static_cast<int>(entry.length)) : QString::fromUtf8(text, static_cast<int>(entry.length));
+    }
+
+    // Child of an object by key or of an array by index, -1 if there is none
+    int child(int node, const QString &key) const
+    {
+        const Node &entry = m_tape[static_cast<size_t>(node)];
+        if(entry.type == Array) {
+            bool ok = false;
+            const int index = key.toInt(&ok);
+            if(!ok || index < 0 || index >= static_cast<int>(entry.count))
+                return -1;
+
+            quint32 child = static_cast<quint32>(node) + 1;
+            for(int i = 0; i < index; ++i)
+                child = m_tape[child].next;
+            return static_cast<int>(child);
+        }
+
+        if(entry.type != Object)
+            return -1;
+
+        // Keys are compared in UTF-8 without decoding them, the last one wins like in QJsonObject
+        const QByteArray utf8 = key.toUtf8();
+        int found = -1;
+        for(quint32 k = static_cast<quint32>(node) + 1; k < entry.next; k = m_tape[k + 1].next) {
+            const Node &name = m_tape[k];
+            const bool equal = name.escaped ? string(static_cast<int>(k)) == key
+                                            : name.length == static_cast<quint32>(utf8.size())
+                                              && memcmp(m_json.constData() + name.start, utf8.constData(), name.length) == 0;
+            if(equal)
+                found = static_cast<int>(k + 1);
+        }
+        return found;
+    }
+
+    QStringList keys(int node) const
+    {
+        const Node &entry = m_tape[static_cast<size_t>(node)];
+        QStringList keys;
+        keys.reserve(static_cast<int>(entry.count));
+
+        if(entry.type == Array) {
+            for(quint32 i = 0; i < entry.count; ++i)
+                keys.append(QString::number(i));
+        } else if(entry.type == Object) {
+            for(quint32 k = static_cast<quint32>(node) + 1; k < entry.next; k = m_tape[k + 1].next)
+                keys.append(string(static_cast<int>(k)));
+            keys.sort();
+            keys.removeDuplicates();
+        }
+        return keys;
+    }
+
+    QJsonValue toJsonValue(int node) const
+    {
+        const Node &entry = m_tape[static_cast<size_t>(node)];
+        if(entry.length >= static_cast<quint32>(minParallelSize) && entry.count > 1 && (entry.type == Object || entry.type == Array))
+            return toJsonValueParallel(node);
+
+        return toJsonValueSequential(node);
+    }
+
+    QJsonValue toJsonValueSequential(int node) const
+    {
+        const Node &entry = m_tape[static_cast<size_t>(node)];
+        switch(entry.type) {
+        case Null:
+            return QJsonValue::Null;
+        case False:
+            return false;
+        case True:
+            return true;
+        case Number:
+            return QByteArray::fromRawData(m_json.constData() + entry.start, static_cast<int>(entry.length)).toDouble();
+        case String:
+            return string(node);
+        case Array: {
+            QJsonArray array;
+            for(quint32 child = static_cast<quint32>(node) + 1; child < entry.next; child = m_tape[child].next)
+                array.append(toJsonValueSequential(static_cast<int>(child)));
+            return array;
+        }
+        case Object: {
+            // Inserting in key order appends, in any other order every insert moves the keys after it
+            std::vector<std::pair<QString, quint32>> members;
+            members.reserve(entry.count);
+            for(quint32 k = static_cast<quint32>(node) + 1; k < entry.next; k = m_tape[k + 1].next)
+                members.emplace_back(string(static_cast<int>(k)), k + 1);
+            std::stable_sort(members.begin(), members.end(), [](const std::pair<QString, quint32> &a, const std::pair<QString, quint32> &b) {
+                return a.first < b.first;
+            });
+
+            QJsonObject object;
+            for(const auto &member : members)
+                object.insert(member.first, toJsonValueSequential(static_cast<int>(member.second)));
+            return object;
+        }
+        }
+        return QJsonValue::Null;
+    }
+
+    /*
+        Converts the children of node on the global thread pool and splices them into one container. The children
+        are handed out one at a time from a shared counter, so threads that get small subtrees keep taking more
+        while another one works on a big one. The calling thread converts children as well, and only pool threads
+        that are idle right now are used, so a busy pool never blocks the conversion.
+    */
+    QJsonValue toJsonValueParallel(int node) const
+    {
+        const Node &entry = m_tape[static_cast<size_t>(node)];
+        const bool object = entry.type == Object;
+
+        std::vector<quint32> children;
+        children.reserve(entry.count);
+        for(quint32 child = static_cast<quint32>(node) + 1; child < entry.next; child = m_tape[object ? child + 1 : child].next)
+            children.push_back(object ? child + 1 : child);
+
+        std::vector<QJsonValue> values(children.size());
+        std::atomic<size_t> next(0);
+        const auto convert = [&]() {
+            for(size_t i = next++; i < children.size(); i = next++)
+                values[i] = toJsonValueSequential(static_cast<int>(children[i]));
+        };
+
+        QThreadPool *pool = QThreadPool::globalInstance();
+        QSemaphore done;
+        int started = 0;
+        const int helpers = qMin(pool->maxThreadCount(), static_cast<int>(children.size())) - 1;
+        for(int i = 0; i < helpers; ++i) {
+            QRunnable *task = QRunnable::create([&]() {
+                convert();
+                done.release();
+            });
+            if(!pool->tryStart(task)) {
+                delete task;
+                break;
+            }
+            ++started;
+        }
+
+        convert();
+        done.acquire(started);
+
+        if(!object) {
+            QJsonArray array;
+            for(const QJsonValue &value : values)
+                array.append(value);
+            return array;
+        }
+
+        std::vector<std::pair<QString, size_t>> members;
+        members.reserve(children.size());
+        for(size_t i = 0; i < children.size(); ++i)
+            members.emplace_back(string(static_cast<int>(children[i]) - 1), i);
+        std::stable_sort(members.begin(), members.end(), [](const std::pair<QString, size_t> &a, const std::pair<QString, size_t> &b) {
+            return a.first < b.first;
+        });
+
+        QJsonObject result;
+        for(const auto &member : members)
+            result.insert(member.first, values[member.second]);
+        return result;
+    }
+
+    // Same result as toJsonValue(node).toVariant(), without building the QJsonValue first
+    QVariant toVariant(int node) const
+    {
+        const Node &entry = m_tape[static_cast<size_t>(node)];
+        switch(entry.type) {
+        case Array: {
+            QVariantList list;
+            list.reserve(static_cast<int>(entry.count));
+            for(quint32 child = static_cast<quint32>(node) + 1; child < entry.next; child = m_tape[child].next)
+                list.append(toVariant(static_cast<int>(child)));
+            return list;
+        }
+        case Object: {
+            QVariantMap map;
+            for(quint32 k = static_cast<quint32>(node) + 1; k < entry.next; k = m_tape[k + 1].next)
+                map.insert(string(static_cast<int>(k)), toVariant(static_cast<int>(k + 1)));
+            return map;
+        }
+        default:
+            return toJsonValue(node).toVariant();
+        }
+    }
+
+private:
+    QByteArray m_json;
+    std::vector<Node> m_tape;
+};
+
+}
+
+#endif // JSONUTILS_H
@@ -0,0 +1,73 @@
+#ifndef JWTUTILS_H
+#define JWTUTILS_H
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QVector>
+
+namespace JwtUtils {
+
+static const QString issuerPrefix("https://securetoken.google.com/");
+
+// Public keys used by Firebase Auth to sign ID tokens, in JWK format
+static const QString endpoint_publicKeys("https://www.googleapis.com/service_accounts/v1/jwk/securetoken@system.gserviceaccount.com");
+
+static QByteArray decodeBase64Url(const QByteArray &data)
+{
+    return QByteArray::fromBase64(data, QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+}
+
+// Splits a compact JWT into its header, payload and signature segments, returns empty list if malformed
+static QVector<QByteArray> splitToken(const QString &token)
+{
+    const QList<QByteArray> parts = token.toLatin1().split('.');
+    if(parts.size() != 3)
+        return {};
+
+    // QByteArray::fromBase64() skips characters outside the alphabet, so they are rejected here
+    for(const QByteArray &part : parts) {
+        for(const char c : part) {
+            if(!((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_'))
+                return {};
+        }
+    }
+
+    return QVector<QByteArray>(parts.begin(), parts.end());
+}
+
+static QJsonObject decodeSegment(const QByteArray &segment)
+{
+    QJsonParseError err;
+    QJsonDocument doc = QJsonDocument::fromJson(decodeBase64Url(segment), &err);
+    if(err.error != QJsonParseError::NoError)
+        return QJsonObject();
+
+    return doc.object();
+}
+
+static QJsonObject header(const QString &token)
+{
+    const QVector<QByteArray> parts = splitToken(token);
+    return parts.isEmpty() ? QJsonObject() : decodeSegment(parts.at(0));
+}
+
+static QJsonObject payload(const QString &token)
+{
+    const QVector<QByteArray> parts = splitToken(token);
+    return parts.isEmpty() ? QJsonObject() : decodeSegment(parts.at(1));
+}
+
+// Converts a NumericDate claim (seconds since epoch) into a QDateTime
+static QDateTime numericDate(const QJsonObject &claims, const QString &name)
+{
+    if(!claims.contains(name))
+        return QDateTime();
+
+    return QDateTime::fromSecsSinceEpoch(static_cast<qint64>(claims[name].toDouble()), Qt::UTC);
+}
+
+}
+
+#endif // JWTUTILS_H